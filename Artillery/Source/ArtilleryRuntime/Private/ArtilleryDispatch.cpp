@@ -12,6 +12,7 @@
 #include "StaticAssetLoader.h"
 #include "Threads/FArtilleryStateTreesThread.h"
 #include "Threads/FArtilleryTicklitesThread.h"
+#include "Algo/StableSort.h"
 
 bool UArtilleryDispatch::RegistrationImplementation()
 {
@@ -55,7 +56,7 @@ bool UArtilleryDispatch::RegistrationImplementation()
 	ArtilleryAsyncWorldSim.RequestorQueue_Abilities_TripleBuffer = RequestorQueue_Abilities_TripleBuffer;
 	//OH BOY. REFERENCE TIME. GWAHAHAHA.
 	ArtilleryAsyncWorldSim.Locomos_BufferNotThreadSafe = RequestorQueue_Locomos;
-	GunToFiringFunctionMapping->Empty();
+	GunRegistry->Empty();
 	ThreadSetup();
 
 	WorldSim_Thread->Create(&ArtilleryAsyncWorldSim, TEXT("ARTILLERY_WORLDSIM_ONLINE."),0, TPri_AboveNormal);
@@ -71,26 +72,31 @@ bool UArtilleryDispatch::RegistrationImplementation()
 void UArtilleryDispatch::REGISTER_ENTITY_FINAL_TICK_RESOLVER(const ActorKey& Self)
 {
 	TLEntityFinalTickResolver temp = TLEntityFinalTickResolver(Self); //this semantic sucks. gotta fix it.
-	this->RequestAddTicklite(MakeShareable(new EntityFinalTickResolver(temp)), FINAL_TICK_RESOLVE);
+	this->RequestAddPooledTicklite<EntityFinalTickResolver>(temp, FINAL_TICK_RESOLVE, FTickliteSchedule(), Self);
 }
 
 void UArtilleryDispatch::REGISTER_PROJECTILE_FINAL_TICK_RESOLVER(uint32 MaximumLifespanInTicks,
                                                                  const FSkeletonKey& Self)
 {
-	TLProjectileFinalTickResolver temp = TLProjectileFinalTickResolver(MaximumLifespanInTicks, Self);
-	this->RequestAddTicklite(MakeShareable(new ProjectileFinalTickResolver(temp)), FINAL_TICK_RESOLVE);
+	//nothing happens over a projectile's life but the countdown, so don't run it at all until the last tick.
+	//it expires on the same tick it would have counting down the whole way.
+	const uint32 Lifespan = FMath::Max(MaximumLifespanInTicks, 1u);
+	TLProjectileFinalTickResolver temp = TLProjectileFinalTickResolver(1, Self);
+	FTickliteSchedule AtDeadline;
+	AtDeadline.Delay = Lifespan - 1;
+	this->RequestAddPooledTicklite<ProjectileFinalTickResolver>(temp, FINAL_TICK_RESOLVE, AtDeadline, Self);
 }
 
 void UArtilleryDispatch::REGISTER_GUN_FINAL_TICK_RESOLVER(const FGunKey& Self, const FArtilleryGun* ExistCheck)
 {
 	TLGunFinalTickResolver temp = TLGunFinalTickResolver(Self, ExistCheck); //this semantic sucks. gotta fix it.
-	this->RequestAddTicklite(MakeShareable(new GunFinalTickResolver(temp)), FINAL_TICK_RESOLVE);
+	this->RequestAddPooledTicklite<GunFinalTickResolver>(temp, FINAL_TICK_RESOLVE, FTickliteSchedule(), Self);
 }
 
 void UArtilleryDispatch::INITIATE_JUMP_TIMER(const FSkeletonKey& Self)
 {
 	FTJumpTimer JumpTimer = FTJumpTimer(Self);
-	this->RequestAddTicklite(MakeShareable(new TL_JumpTimer(JumpTimer)), Normal);
+	this->RequestAddPooledTicklite<TL_JumpTimer>(JumpTimer, Normal, FTickliteSchedule(), Self);
 }
 
 //legit, it can't. ffs. you can get sliced ANYWHERE in here and lose your reffed memory.
@@ -131,6 +137,11 @@ void UArtilleryDispatch::OnWorldBeginPlay(UWorld& InWorld)
 {
 	if ([[maybe_unused]] const UWorld* World = InWorld.GetWorld())
 	{
+		const UGameInstance* GameInst = World->GetGameInstance();
+		if (GameInst != nullptr)
+		{
+			PooledGuns->Prewarm(GameInst->GetSubsystem<UStaticGunLoader>());
+		}
 	}
 }
 
@@ -177,7 +188,8 @@ void UArtilleryDispatch::Deinitialize()
 	GameplayTagContainerToDataMapping->Empty();
 	KeyToControlliteMapping->Empty();
 	VectorSetToDataMapping->Empty();
-	GunByKey->Empty();
+	GunRegistry->Empty();
+	PooledGuns->Empty();
 	HoldOpen.Reset();
 	
 	Super::Deinitialize();
@@ -202,184 +214,335 @@ Attr3MapPtr UArtilleryDispatch::GetVectorSetShadowByObjectKey(const FSkeletonKey
 	return VectorSetToDataMapping->FindChecked(Target);
 }
 
-//this approach is risky for determinism, because, again, the thread accumulator map's ordering is random.
-//to fix this, we'll need to enforce orderings in a LOT of places OR sort by time then order by target, I think.
+namespace
+{
+	//the order kinds of request run in, within a tick. guns get bound before anything can fire them, and meshes get
+	//spawned before anything attaches to them. anything we don't know goes last, and falls into the fatal.
+	int32 RoutedRank(ArtilleryRequestType Type)
+	{
+		switch (Type)
+		{
+		case ArtilleryRequestType::GetAnUnboundGun: return 0;
+		case ArtilleryRequestType::FireAGun: return 1;
+		case ArtilleryRequestType::SpawnStaticMesh: return 2;
+		case ArtilleryRequestType::SpawnParticleSystemAttached: return 3;
+		case ArtilleryRequestType::SpawnParticleSystemAtLocation: return 4;
+		case ArtilleryRequestType::ParticleSystemActivateOrDeactivate: return 5;
+		default: return 6;
+		}
+	}
+
+	uint64 RoutedEntity(const FRequestGameThreadThing& Request)
+	{
+		return Request.GetType() == ArtilleryRequestType::FireAGun ? Request.Gun.GunInstanceID.Obj : Request.SourceOrSelf.Obj;
+	}
+}
+
+//this used to run on the game thread straight off the accumulators, in whatever order the feeds happened to be in.
+//now the busy worker drains them once a cycle, sorts by stamp, type, then entity, and does the work that doesn't need a
+//uobject. ties on all three keep the order they were drained in, which is feed order, so two requests of the same
+//kind about the same entity on the same tick from two different threads are still a coin flip. that's rare enough to live with.
+void UArtilleryDispatch::StageRequestRouterGameThread()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Stage Game Thread Requests");
+	if (!RequestRouter)
+	{
+		return;
+	}
+	Incoming.Reset();
+	for (F_INeedA::GameFeedMap& FeedMap : RequestRouter->GameThreadAcc)
+	{
+		TSharedPtr<F_INeedA::GameThreadRequestQ> HoldOpenQueue;
+		if (FeedMap.Queue && ((HoldOpenQueue = FeedMap.Queue)) && FeedMap.That != std::thread::id())
+		{
+			FRequestGameThreadThing Request;
+			while (HoldOpenQueue->Dequeue(Request))
+			{
+				Incoming.Requests.Add(Request);
+			}
+		}
+	}
+	if (Incoming.Requests.IsEmpty())
+	{
+		//nothing new, but the game thread may have caught up on something we were holding.
+		if (StagingBatch && !StagingBatch->Requests.IsEmpty() && RoutedToGameThread->Enqueue(StagingBatch))
+		{
+			StagingBatch = nullptr;
+		}
+		return;
+	}
+
+	const int32 Num = Incoming.Requests.Num();
+	IncomingOrder.SetNumUninitialized(Num, EAllowShrinking::No);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		IncomingOrder[i] = i;
+	}
+	Algo::StableSort(IncomingOrder, [this](int32 A, int32 B)
+	{
+		const FRequestGameThreadThing& Left = Incoming.Requests[A];
+		const FRequestGameThreadThing& Right = Incoming.Requests[B];
+		if (Left.Stamp != Right.Stamp)
+		{
+			return Left.Stamp < Right.Stamp;
+		}
+		const int32 LeftRank = RoutedRank(Left.GetType());
+		const int32 RightRank = RoutedRank(Right.GetType());
+		if (LeftRank != RightRank)
+		{
+			return LeftRank < RightRank;
+		}
+		return RoutedEntity(Left) < RoutedEntity(Right);
+	});
+
+	if (!StagingBatch)
+	{
+		if (!RoutedBatchesToRecycle->Dequeue(StagingBatch) || !StagingBatch)
+		{
+			StagingBatch = MakeShareable(new FRoutedGameThreadBatch());
+		}
+	}
+	FRoutedGameThreadBatch& Batch = *StagingBatch;
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const FRequestGameThreadThing& Request = Incoming.Requests[IncomingOrder[i]];
+		const int32 Index = Batch.Requests.Add(Request);
+		FPreparedGun& Prepared = Batch.Guns.AddDefaulted_GetRef();
+		if (Request.GetType() == ArtilleryRequestType::GetAnUnboundGun)
+		{
+			//minted here, in sorted order, so the keys come out the same on every client.
+			Prepared = PrepareGun(Request.Gun.GunDefinitionID, ActorKey(Request.SourceOrSelf));
+		}
+		FRoutedGameThreadBatch::FRun* Run = Batch.Runs.IsEmpty() ? nullptr : &Batch.Runs.Last();
+		if (Run && Run->Type == Request.GetType() && Batch.Requests[Run->Begin].Stamp == Request.Stamp)
+		{
+			Run->End = Index + 1;
+		}
+		else
+		{
+			Batch.Runs.Add({Request.GetType(), Index, Index + 1});
+		}
+	}
+	//if the game thread's too far behind to take it, hang on and keep adding. it'll go next cycle.
+	if (RoutedToGameThread->Enqueue(StagingBatch))
+	{
+		StagingBatch = nullptr;
+	}
+}
+
 void UArtilleryDispatch::ProcessRequestRouterGameThread()
 {
 	if (__LIVE__ && RequestRouter)
 	{
-		for (F_INeedA::GameFeedMap& FeedMap : RequestRouter->GameThreadAcc)
+		TSharedPtr<FRoutedGameThreadBatch> Batch;
+		while (HoldOpen && RoutedToGameThread->Dequeue(Batch))
+		{
+			if (!Batch)
+			{
+				continue;
+			}
+			for (const FRoutedGameThreadBatch::FRun& Run : Batch->Runs)
+			{
+				RunRoutedRequests(*Batch, Run);
+			}
+			Batch->Reset();
+			//if the recycle queue is full, this one just goes away.
+			RoutedBatchesToRecycle->Enqueue(Batch);
+		}
+	}
+}
+
+void UArtilleryDispatch::RunRoutedRequests(const FRoutedGameThreadBatch& Batch, const FRoutedGameThreadBatch::FRun& Run)
+{
+	//PINPOINT: YAGAMETHREADBOYRUNNETHREQUESTSHERE
+	//subsystems are looked up once per run, rather than once per request.
+	switch (Run.Type)
+	{
+	case ArtilleryRequestType::FireAGun:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Fire Guns");
+			for (int32 i = Run.Begin; i < Run.End; ++i)
+			{
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				EventBufferInfo def = EventBufferInfo::Default();
+				def.Action = ArtIPMKey::InternallyStateless;
+				bool Fired = false;
+				GunRegistry->Read(Request.Gun, [&](const FArtilleryGunRecord& Record)
+				{
+					if (Record.Gun)
+					{
+						Fired = Record.Fire.ExecuteIfBound(Record.Gun, false, def);
+					}
+				});
+				if (Fired)
+				{
+					++TotalFirings;
+				}
+				else
+				{
+					// TODO - we are absolutely going to want to turn this and things like it into a periodic
+					//		  log call to avoid clogging log files
+					UE_LOG(
+						LogTemp,
+						Error,
+						TEXT("ArtilleryDispatch::ProcessRequestRouterGameThread: Error processing FireGun request with gun key [id: %llu, name: %s]"),
+						Request.Gun.GunInstanceID.Obj,
+						*Request.Gun.GunDefinitionID);
+				}
+			}
+		}
+		break;
+	// *****************
+	// * Particle Handling
+	// *****************
+	case ArtilleryRequestType::ParticleSystemActivateOrDeactivate:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Toggle Particles");
+			UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<UNiagaraParticleDispatch>();
+			for (int32 i = Run.Begin; i < Run.End; ++i)
+			{
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				FParticleID PID(Request.SourceOrSelf);
+				if (Request.ActivateIfPossible)
+				{
+					ParticleDispatch->ActivateInternal(PID);
+				}
+				else
+				{
+					ParticleDispatch->DeactivateInternal(PID);
+				}
+			}
+		}
+		break;
+	case ArtilleryRequestType::SpawnParticleSystemAttached:
 		{
-			TSharedPtr<F_INeedA::GameThreadRequestQ> HoldOpenQueue;
-			if (FeedMap.Queue && ((HoldOpenQueue = FeedMap.Queue)) && FeedMap.That != std::thread::id())
-			//if there IS a thread.
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Spawn Attached Particles");
+			UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<UNiagaraParticleDispatch>();
+			UArtilleryProjectileDispatch* ProjectileDispatch = GetWorld()->GetSubsystem<UArtilleryProjectileDispatch>();
+			UTransformDispatch* TransformDispatch = GetWorld()->GetSubsystem<UTransformDispatch>();
+			for (int32 i = Run.Begin; i < Run.End; ++i)
 			{
-				FRequestGameThreadThing Request;
-				while (HoldOpen && HoldOpenQueue->Dequeue(Request))
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				FSkeletonKey AttachToKey = Request.SourceOrSelf;
+
+				if (Request.ActivateIfPossible)
 				{
-					//PINPOINT: YAGAMETHREADBOYRUNNETHREQUESTSHERE
-					switch (Request.GetType())
+					TWeakObjectPtr<USceneComponent> SceneComp = ProjectileDispatch->
+						GetSceneComponentForProjectile(Request.SourceOrSelf);
+					if (SceneComp.IsValid())
 					{
-					case ArtilleryRequestType::FireAGun:
-						{
-							TSharedPtr<FArtilleryGun> GunHoldOpen = GunByKey->FindRef(Request.Gun);
-							TDelegate<void(TSharedPtr<FArtilleryGun>, bool, EventBufferInfo)>* FireFunction =
-								GunToFiringFunctionMapping->Find(Request.Gun);
-
-							if (FireFunction != nullptr && GunHoldOpen)
-							{
-								EventBufferInfo def = EventBufferInfo::Default();
-								def.Action = ArtIPMKey::InternallyStateless;
-								TotalFirings += FireFunction->ExecuteIfBound(GunHoldOpen, false, def);
-							}
-							else
-							{
-								// TODO - we are absolutely going to want to turn this and things like it into a periodic
-								//		  log call to avoid clogging log files
-								UE_LOG(
-									LogTemp,
-									Error,
-									TEXT("ArtilleryDispatch::ProcessRequestRouterGameThread: Error processing FireGun request with gun key [id: %llu, name: %s]"),
-									Request.Gun.GunInstanceID.Obj,
-									*Request.Gun.GunDefinitionID);
-							}
-						}
-						break;
-					// *****************
-					// * Particle Handling
-					// *****************
-					case ArtilleryRequestType::ParticleSystemActivateOrDeactivate:
-						{
-							UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<
-								UNiagaraParticleDispatch>();
-							FParticleID PID(Request.SourceOrSelf);
-							if (Request.ActivateIfPossible)
-							{
-								ParticleDispatch->ActivateInternal(PID);
-							}
-							else
-							{
-								ParticleDispatch->DeactivateInternal(PID);
-							}
-						}
-						break;
-					case ArtilleryRequestType::SpawnParticleSystemAttached:
-						{
-							FSkeletonKey AttachToKey = Request.SourceOrSelf;
-
-							if (Request.ActivateIfPossible)
-							{
-								UArtilleryProjectileDispatch* ProjectileDispatch = GetWorld()->GetSubsystem<
-									UArtilleryProjectileDispatch>();
-								TWeakObjectPtr<USceneComponent> SceneComp = ProjectileDispatch->
-									GetSceneComponentForProjectile(Request.SourceOrSelf);
-								if (SceneComp.IsValid())
-								{
-									FBoneKey AttachToAsBoneKey = MAKE_BONEKEY(SceneComp.Get());
-									UTransformDispatch* TransformDispatch = GetWorld()->GetSubsystem<
-										UTransformDispatch>();
-									TransformDispatch->RegisterSceneCompToShadowTransform(
-										AttachToAsBoneKey, SceneComp.Get());
-									AttachToKey = AttachToAsBoneKey;
-								}
-							}
-
-							UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<
-								UNiagaraParticleDispatch>();
-							[[maybe_unused]] FParticleID PID = ParticleDispatch->SpawnAttachedNiagaraSystem(
-								*Request.ThingName.ToString(),
-								AttachToKey,
-								NAME_None,
-								EAttachLocation::Type::SnapToTarget);
-						}
-						break;
-					case ArtilleryRequestType::GetAnUnboundGun:
-						{
-							IdMapPtr WordsOfPower = GetRelationships(Request.SourceOrSelf);
-							FGunKey Gun = GetGun(Request.Gun.GunDefinitionID, ActorKey(Request.SourceOrSelf));
-							FGunInstanceKey BANG = Gun.GunInstanceID;
-							if (WordsOfPower)
-							{
-								TSharedPtr<FConservedAttributeKey> MaterialComponent = WordsOfPower.Get()->FindOrAdd(
-									Request.Relationship);
-								if (MaterialComponent)
-								{
-									MaterialComponent.Get()->SetCurrentValue(BANG);
-								}
-								else
-								{
-									TSharedPtr<FConservedAttributeKey> PowerWordGun = MakeShareable(new FConservedAttributeKey);
-									PowerWordGun->SetBaseValue(BANG);
-									PowerWordGun->SetCurrentValue(BANG);
-									WordsOfPower.Get()->Add(Request.Relationship, PowerWordGun);
-								}
-							}
-							else
-							{
-								TSharedPtr<TMap<Ident, IdentPtr>> RelationshipMap = MakeShareable(new IdentityMap());
-
-								//TODO: swap this to loading values from a data table, and REMOVE this fallback.
-								//If we want defaults, those defaults should ALSO live in a data table, that way when a defaulting bug screws us
-								//maybe we can fix it without going through a full cert using a data only update.
-								TSharedPtr<FConservedAttributeKey> PowerWordGun = MakeShareable(
-									new FConservedAttributeKey);
-								RelationshipMap->Add(Request.Relationship, PowerWordGun);
-								PowerWordGun->SetBaseValue(BANG);
-								PowerWordGun->SetCurrentValue(BANG);
-								RegisterRelationships(Request.SourceOrSelf, RelationshipMap);
-							}
-						}
-						break;
-					case ArtilleryRequestType::SpawnParticleSystemAtLocation:
-						{
-							UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<
-								UNiagaraParticleDispatch>();
-							[[maybe_unused]] FParticleID PID = ParticleDispatch->SpawnFixedNiagaraSystem(
-								*Request.ThingName.ToString(),
-								Request.ThingVector,
-								Request.ThingRotator,
-								FVector(1));
-						}
-						break;
-					// *****************
-					// * Mesh Handling
-					// *****************
-					case ArtilleryRequestType::SpawnStaticMesh:
-						{
-							UArtilleryProjectileDispatch* ProjectileDispatch = GetWorld()->GetSubsystem<
-								UArtilleryProjectileDispatch>();
-							ProjectileDispatch->CreateProjectileInstance(
-								Request.SourceOrSelf,
-								Request.Gun,
-								Request.ThingName,
-								FTransform(Request.ThingVector),
-								Request.ThingVector3,
-								Request.ThingVector2.X,
-								true,
-								true,
-								Request.Layer,
-								Request.CanExpire,
-								Request.TicksDuration);
-							AddTagToEntity(Request.SourceOrSelf,InitState_GameplayReady);
-						}
-						break;
-					default:
-						UE_LOG(
-							LogTemp,
-							Fatal,
-							TEXT("ArtilleryDispatch::ProcessRequestRouterGameThread: Received Request Router request for unimplemented request type: [%d]"),
-							Request.GetType());
-						throw;
+						FBoneKey AttachToAsBoneKey = MAKE_BONEKEY(SceneComp.Get());
+						TransformDispatch->RegisterSceneCompToShadowTransform(
+							AttachToAsBoneKey, SceneComp.Get());
+						AttachToKey = AttachToAsBoneKey;
 					}
 				}
+
+				[[maybe_unused]] FParticleID PID = ParticleDispatch->SpawnAttachedNiagaraSystem(
+					*Request.ThingName.ToString(),
+					AttachToKey,
+					NAME_None,
+					EAttachLocation::Type::SnapToTarget);
 			}
 		}
+		break;
+	case ArtilleryRequestType::GetAnUnboundGun:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Bind Guns");
+			for (int32 i = Run.Begin; i < Run.End; ++i)
+			{
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				IdMapPtr WordsOfPower = GetRelationships(Request.SourceOrSelf);
+				FGunKey Gun = BindPreparedGun(Batch.Guns[i], ActorKey(Request.SourceOrSelf));
+				FGunInstanceKey BANG = Gun.GunInstanceID;
+				if (WordsOfPower)
+				{
+					TSharedPtr<FConservedAttributeKey> MaterialComponent = WordsOfPower.Get()->FindOrAdd(
+						Request.Relationship);
+					if (MaterialComponent)
+					{
+						MaterialComponent.Get()->SetCurrentValue(BANG);
+					}
+					else
+					{
+						TSharedPtr<FConservedAttributeKey> PowerWordGun = MakeShareable(new FConservedAttributeKey);
+						PowerWordGun->SetBaseValue(BANG);
+						PowerWordGun->SetCurrentValue(BANG);
+						WordsOfPower.Get()->Add(Request.Relationship, PowerWordGun);
+					}
+				}
+				else
+				{
+					TSharedPtr<TMap<Ident, IdentPtr>> RelationshipMap = MakeShareable(new IdentityMap());
+
+					//TODO: swap this to loading values from a data table, and REMOVE this fallback.
+					//If we want defaults, those defaults should ALSO live in a data table, that way when a defaulting bug screws us
+					//maybe we can fix it without going through a full cert using a data only update.
+					TSharedPtr<FConservedAttributeKey> PowerWordGun = MakeShareable(
+						new FConservedAttributeKey);
+					RelationshipMap->Add(Request.Relationship, PowerWordGun);
+					PowerWordGun->SetBaseValue(BANG);
+					PowerWordGun->SetCurrentValue(BANG);
+					RegisterRelationships(Request.SourceOrSelf, RelationshipMap);
+				}
+			}
+		}
+		break;
+	case ArtilleryRequestType::SpawnParticleSystemAtLocation:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Spawn Fixed Particles");
+			UNiagaraParticleDispatch* ParticleDispatch = GetWorld()->GetSubsystem<UNiagaraParticleDispatch>();
+			for (int32 i = Run.Begin; i < Run.End; ++i)
+			{
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				[[maybe_unused]] FParticleID PID = ParticleDispatch->SpawnFixedNiagaraSystem(
+					*Request.ThingName.ToString(),
+					Request.ThingVector,
+					Request.ThingRotator,
+					FVector(1));
+			}
+		}
+		break;
+	// *****************
+	// * Mesh Handling
+	// *****************
+	case ArtilleryRequestType::SpawnStaticMesh:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Routed: Spawn Meshes");
+			UArtilleryProjectileDispatch* ProjectileDispatch = GetWorld()->GetSubsystem<UArtilleryProjectileDispatch>();
+			for (int32 i = Run.Begin; i < Run.End; ++i)
+			{
+				const FRequestGameThreadThing& Request = Batch.Requests[i];
+				ProjectileDispatch->CreateProjectileInstance(
+					Request.SourceOrSelf,
+					Request.Gun,
+					Request.ThingName,
+					FTransform(Request.ThingVector),
+					Request.ThingVector3,
+					Request.ThingVector2.X,
+					true,
+					true,
+					Request.Layer,
+					Request.CanExpire,
+					Request.TicksDuration);
+				AddTagToEntity(Request.SourceOrSelf,InitState_GameplayReady);
+			}
+		}
+		break;
+	default:
+		UE_LOG(
+			LogTemp,
+			Fatal,
+			TEXT("ArtilleryDispatch::ProcessRequestRouterGameThread: Received Request Router request for unimplemented request type: [%d]"),
+			Run.Type);
+		throw;
 	}
 }
 
 void UArtilleryDispatch::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	RERunGuns();
 	RunGuns(); // ALL THIS WORK. FOR THIS?! (Okay, that's really cool)
 	UBarrageDispatch* BarrageDispatch = GetWorld()->GetSubsystem<UBarrageDispatch>();
 	// both transform dispatch and gamesim must be ready. Otherwise, let the queue build up.
@@ -394,6 +557,14 @@ void UArtilleryDispatch::Tick(float DeltaTime)
 	//and then "allocating" from that free list, we can then move resizing the pool of available instances onto the manager tick.
 	//this split likely needs a bit of hemming and hawing to ensure determinism, but I think it's tractable.
 	ProcessRequestRouterGameThread();
+	//guns handed back get reset here, once nobody's holding them, and any definition running low gets a few more.
+	//the registry keeps a removed gun alive until its readers are done, so let it let go first.
+	GunRegistry->Collect();
+	PooledGuns->Recycle();
+	if (const UGameInstance* GameInst = GetWorld()->GetGameInstance())
+	{
+		PooledGuns->TopUp(GameInst->GetSubsystem<UStaticGunLoader>());
+	}
 }
 
 TStatId UArtilleryDispatch::GetStatId() const
@@ -404,46 +575,62 @@ TStatId UArtilleryDispatch::GetStatId() const
 // TODO - Rename to ConjureGun, not renaming right now
 FGunKey UArtilleryDispatch::GetGun(const FString& GunDefinitionID, const ActorKey& ProbableOwner) const
 {
+	return BindPreparedGun(PrepareGun(GunDefinitionID, ProbableOwner), ProbableOwner);
+}
+
+//no uobjects get made or touched in here. most of the time this is a pop off the gun pool. if the pool's dry, we go
+//to the loader, whose maps are fixed once the game instance is up, and the gun is just a struct until it's initialized.
+FPreparedGun UArtilleryDispatch::PrepareGun(const FString& GunDefinitionID, const ActorKey& ProbableOwner) const
+{
+	FPreparedGun Prepared;
+	Prepared.Gun = PooledGuns->Acquire(GunDefinitionID);
 	const UWorld* World = GetWorld();
-	if (World != nullptr)
+	if (!Prepared.Gun && World != nullptr)
 	{
 		const UGameInstance* GameInst = World->GetGameInstance();
-		if (GameInst != nullptr)
+		UStaticGunLoader* Arsenal = GameInst ? GameInst->GetSubsystem<UStaticGunLoader>() : nullptr;
+		if (Arsenal && Arsenal->CommonNameToProperNameMapping.Contains(GunDefinitionID))
 		{
-			UStaticGunLoader* Arsenal = GameInst->GetSubsystem<UStaticGunLoader>();
-			if (Arsenal && Arsenal->CommonNameToProperNameMapping.Contains(GunDefinitionID))
+			Prepared.Gun = Arsenal->GetNewInstanceUninitialized(GunDefinitionID);
+			if (Prepared.Gun)
 			{
-				TSharedPtr<FArtilleryGun> FreshBakedGun = Arsenal->GetNewInstanceUninitialized(GunDefinitionID);
-				TSharedPtr<TMap<FSkeletonKey, TSharedPtr<FArtilleryGun>>> HoldOpenGuns = GunByKey;
-				if (FreshBakedGun && HoldOpen)
-				{
-					FreshBakedGun->UpdateProbableOwner(ProbableOwner);
-
-					//TODO find an alternative that's truly deterministic and doesn't suck ten million bees. we need a ticker that's monotonic
-					// do we? or can we achieve outcome determinism without it? I think we can...
-					FGunKey Key = FGunKey(GunDefinitionID, F_INeedA::HashDownTo32(ProbableOwner + ++monotonkey));
-					//TODO: replace with probable owner?
-
-					FreshBakedGun->Initialize(Key, false);
-					if (FreshBakedGun->ReadyToFire)
-					{
-						HoldOpenGuns->Add(Key, FreshBakedGun);
-						// TODO - add tooling to toggle messages like this as we are starting to see enough of them that it affects framerate
-						// UE_LOG(LogTemp, Warning,
-						// 	   TEXT(
-						// 		   "UArtilleryDispatch::GetGun: Gun Definition ID [%s] is valid! New instance created. (Probable Owner = [%llu])"
-						// 	   ), *(GunDefinitionID), ProbableOwner.Obj);
-						return Key;
-					}
-					return DefaultGunKey;
-				}
-				// UE_LOG(LogTemp, Warning,
-				//        TEXT(
-				// 	       "UArtilleryDispatch::GetGun: Gun Definition ID [%s] is invalid! Instance could not be created. Check that your GunDefinitionID matches the entry in GunDefinitions. (Probable Owner = [%llu])"
-				//        ), *(GunDefinitionID), ProbableOwner.Obj);
+				Prepared.Gun->Poolable = true;
 			}
 		}
 	}
+	if (Prepared.Gun)
+	{
+		//TODO find an alternative that's truly deterministic and doesn't suck ten million bees. we need a ticker that's monotonic
+		// do we? or can we achieve outcome determinism without it? I think we can...
+		//this is at least only ever bumped from one thread, in request order, now.
+		Prepared.Key = FGunKey(GunDefinitionID, F_INeedA::HashDownTo32(ProbableOwner + ++monotonkey));
+		//TODO: replace with probable owner?
+	}
+	// else UE_LOG(LogTemp, Warning,
+	//        TEXT(
+	// 	       "UArtilleryDispatch::GetGun: Gun Definition ID [%s] is invalid! Instance could not be created. Check that your GunDefinitionID matches the entry in GunDefinitions. (Probable Owner = [%llu])"
+	//        ), *(GunDefinitionID), ProbableOwner.Obj);
+	return Prepared;
+}
+
+FGunKey UArtilleryDispatch::BindPreparedGun(const FPreparedGun& Prepared, const ActorKey& ProbableOwner) const
+{
+	if (Prepared.Gun && HoldOpen)
+	{
+		Prepared.Gun->UpdateProbableOwner(ProbableOwner);
+		Prepared.Gun->Initialize(Prepared.Key, false);
+		if (Prepared.Gun->ReadyToFire)
+		{
+			GunRegistry->Update(Prepared.Key, [&Prepared](FArtilleryGunRecord& Record) { Record.Gun = Prepared.Gun; });
+			// TODO - add tooling to toggle messages like this as we are starting to see enough of them that it affects framerate
+			// UE_LOG(LogTemp, Warning,
+			// 	   TEXT(
+			// 		   "UArtilleryDispatch::GetGun: Gun Definition ID [%s] is valid! New instance created. (Probable Owner = [%llu])"
+			// 	   ), *(GunDefinitionID), ProbableOwner.Obj);
+			return Prepared.Key;
+		}
+		return DefaultGunKey;
+	}
 	return FGunKey();
 }
 
@@ -452,7 +639,7 @@ FGunKey UArtilleryDispatch::RegisterExistingGun(const TSharedPtr<FArtilleryGun>&
 {
 	//TODO: see if this code path needs to evolve to do more sophisticated management of the gunkey itself
 	ToBind->UpdateProbableOwner(ProbableOwner);
-	GunByKey->Add(ToBind->MyGunKey, ToBind);
+	GunRegistry->Update(ToBind->MyGunKey, [&ToBind](FArtilleryGunRecord& Record) { Record.Gun = ToBind; });
 	return ToBind->MyGunKey;
 }
 
@@ -460,10 +647,12 @@ bool UArtilleryDispatch::IsGunLive(FSkeletonKey Key)
 {
 	if (__LIVE__)
 	{
-		TSharedPtr<TMap<FSkeletonKey, TSharedPtr<FArtilleryGun>>> HoldOpenGuns = GunByKey;
-		if (UArtilleryDispatch::SelfPtr != nullptr && HoldOpenGuns && HoldOpenGuns.IsValid() && HoldOpenGuns->Num() > 0 && HoldOpenGuns.Get() && IsReady)
+		TSharedPtr<FArtilleryGunRegistry> HoldOpenGuns = GunRegistry;
+		if (UArtilleryDispatch::SelfPtr != nullptr && HoldOpenGuns && IsReady)
 		{
-			return HoldOpenGuns->IsEmpty() ? false : HoldOpenGuns->Contains(Key);
+			bool Live = false;
+			HoldOpenGuns->Read(Key, [&Live](const FArtilleryGunRecord& Record) { Live = Record.Gun.IsValid(); });
+			return Live;
 		}
 	}
 	return false;
@@ -486,10 +675,11 @@ bool UArtilleryDispatch::ReleaseGun(const FGunKey& Key)
 	//See you soon, Chief.
 	if (__LIVE__)
 	{
-		TSharedPtr<FArtilleryGun> tracker = nullptr;
-		if (GunByKey->RemoveAndCopyValue(Key, tracker))
+		//the firing function goes too. the gun's about to be reset and handed to someone else under a new key.
+		FArtilleryGunRecord Released;
+		if (GunRegistry->Remove(Key, &Released) && Released.Gun)
 		{
-			PooledGuns.Add(Key.GunDefinitionID, tracker);
+			PooledGuns->Retire(Released.Gun);
 			return true;
 		}
 	}
@@ -498,15 +688,19 @@ bool UArtilleryDispatch::ReleaseGun(const FGunKey& Key)
 
 TSharedPtr<FArtilleryGun> UArtilleryDispatch::GetPointerToGun(const FGunKey& GunToGet) const
 {
-	TSharedPtr<FArtilleryGun>* Gun = GunByKey->Find(GunToGet);
-	return Gun != nullptr ? *Gun : nullptr;
+	TSharedPtr<FArtilleryGun> Gun;
+	GunRegistry->Read(GunToGet, [&Gun](const FArtilleryGunRecord& Record) { Gun = Record.Gun; });
+	return Gun;
 }
 
-void UArtilleryDispatch::QueueResim(FGunKey Key, ArtilleryTime Time) const
+void UArtilleryDispatch::QueueResim(const EventBufferInfo& Event, ArtilleryTime Time) const
 {
 	if (ActionsToReconcile && ActionsToReconcile.IsValid())
 	{
-		ActionsToReconcile->Enqueue(std::pair(Key, Time));
+		if (!ActionsToReconcile->Enqueue(std::pair(Time, Event)))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ArtilleryDispatch:QueueResim: reconcile queue is full, dropping a rerun of gun [%s]."), *Event.GunKey.GunDefinitionID);
+		}
 	}
 }
 
@@ -524,7 +718,12 @@ AttrPtr UArtilleryDispatch::AddAttrib(const FSkeletonKey Owner, AttribKey Attrib
 		AttrMapPtr AttributeMap;
 		if (AttributeSetToDataMapping->find(Owner, AttributeMap) && AttributeMap != nullptr)
 		{
-			AttrPtr& NewAttrPtr = AttributeMap->Add(Attrib, MakeShareable(new FConservedAttributeData()));
+			AttrPtr NewAttr = AttributeStore->Allocate(Owner, Attrib);
+			if (!NewAttr)
+			{
+				return nullptr;
+			}
+			AttrPtr& NewAttrPtr = AttributeMap->Add(Attrib, NewAttr);
 			NewAttrPtr->SetBaseValue(AttribValue);
 			NewAttrPtr->SetCurrentValue(AttribValue);
 			return NewAttrPtr;
@@ -687,11 +886,15 @@ void UArtilleryDispatch::Deregister(const FGunKey& Key) const
 {
 	if (__LIVE__)
 	{
-		TSharedPtr<TMap<FGunKey, FArtilleryFireGunFromDispatch>> holdopen = GunToFiringFunctionMapping;
+		TSharedPtr<FArtilleryGunRegistry> holdopen = GunRegistry;
 		if(holdopen && holdopen.IsValid())
 		{
-			GunToFiringFunctionMapping->Remove(Key);
-			GunByKey->Remove(Key);
+			FArtilleryGunRecord Removed;
+			if (holdopen->Remove(Key, &Removed))
+			{
+				//guns that came from the pool go back to it.
+				PooledGuns->Retire(Removed.Gun);
+			}
 		}
 		//TODO: add the rest of the wipe here?
 	}
@@ -802,6 +1005,16 @@ void UArtilleryDispatch::DeregisterVecAttribs(FSkeletonKey in)
 	}
 }
 
+bool UArtilleryDispatch::FireGunFromRegistry(const FGunKey& Key, bool InputAlreadyUsedOnce, const EventBufferInfo& FiringAction) const
+{
+	bool Fired = false;
+	GunRegistry->Read(Key, [&](const FArtilleryGunRecord& Record)
+	{
+		Fired = Record.Fire.ExecuteIfBound(Record.Gun, InputAlreadyUsedOnce, FiringAction);
+	});
+	return Fired;
+}
+
 void UArtilleryDispatch::RunGuns() const
 {
 	if (__LIVE__ && RequestorQueue_Abilities_TripleBuffer && RequestorQueue_Abilities_TripleBuffer->IsDirty())
@@ -810,10 +1023,7 @@ void UArtilleryDispatch::RunGuns() const
 		RequestorQueue_Abilities_TripleBuffer->SwapReadBuffers();
 		for (TTuple<long, EventBufferInfo>& GunToRun : RequestorQueue_Abilities_TripleBuffer->Read())
 		{
-			TotalFirings += GunToFiringFunctionMapping->Find(GunToRun.Value.GunKey)->ExecuteIfBound(
-				GunByKey->FindRef(GunToRun.Value.GunKey),
-				false,
-				GunToRun.Value);
+			TotalFirings += FireGunFromRegistry(GunToRun.Value.GunKey, false, GunToRun.Value);
 		}
 		RequestorQueue_Abilities_TripleBuffer->Read().Reset();
 	}
@@ -828,12 +1038,11 @@ void UArtilleryDispatch::RunLocomotions() const
 		//Sort is not stable. Sortedness appears to be lost for operations I would not expect.
 		for (LocomotionParams& Params : *RequestorQueue_Locomos)
 		{
-			IArtilleryControllite** SpanningLinkage = KeyToControlliteMapping->Find(Params.parent);
-			if (SpanningLinkage != nullptr)
+			KeyToControlliteMapping->Read(Params.parent, [&Params](const Machlet& SpanningLinkage)
 			{
-				(*SpanningLinkage)->ArtilleryTick(Params.previousIndex, Params.currentIndex, false, false);
+				SpanningLinkage->ArtilleryTick(Params.previousIndex, Params.currentIndex, false, false);
 				++TotalFirings;
-			}
+			});
 		}
 		RequestorQueue_Locomos->Empty();
 	}
@@ -861,17 +1070,33 @@ void UArtilleryDispatch::CheckFutures()
 {
 }
 
+//reruns run before this frame's guns, in the order the resim matched them, so a gun sees its past before its present.
 void UArtilleryDispatch::RERunGuns()
 {
 	if (__LIVE__ && ActionsToReconcile && ActionsToReconcile.IsValid())
 	{
-		//throw;
+		std::pair<ArtilleryTime, EventBufferInfo> GunToRerun;
+		while (ActionsToReconcile->Dequeue(GunToRerun))
+		{
+			TotalFirings += FireGunFromRegistry(GunToRerun.second.GunKey, true, GunToRerun.second);
+		}
 	}
 }
 
-void UArtilleryDispatch::RERunLocomotions()
+//same as RunLocomotions, but everything in here has been run at least once already, so cosmetics can sit it out.
+void UArtilleryDispatch::RERunLocomotions() const
 {
-	//throw;
+	if (__LIVE__ && RequestorQueue_Locomos)
+	{
+		for (LocomotionParams& Params : *RequestorQueue_Locomos)
+		{
+			KeyToControlliteMapping->Read(Params.parent, [&Params](const Machlet& SpanningLinkage)
+			{
+				SpanningLinkage->ArtilleryTick(Params.previousIndex, Params.currentIndex, true, false);
+			});
+		}
+		RequestorQueue_Locomos->Empty();
+	}
 }
 
 void UArtilleryDispatch::LoadGunData()
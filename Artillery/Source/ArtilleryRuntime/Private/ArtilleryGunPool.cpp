@@ -0,0 +1,127 @@
+#include "ArtilleryGunPool.h"
+#include "FArtilleryGun.h"
+#include "StaticAssetLoader.h"
+
+TSharedPtr<FArtilleryGun> FArtilleryGunPool::Make(UStaticGunLoader* Arsenal, const FString& GunDefinitionID) const
+{
+	TSharedPtr<FArtilleryGun> Gun = Arsenal->GetNewInstanceUninitialized(GunDefinitionID);
+	if (Gun)
+	{
+		Gun->Poolable = true;
+		//the abilities are the expensive part of a gun, and they don't care who owns it. make them now.
+		Gun->PrepareAbilities();
+	}
+	return Gun;
+}
+
+void FArtilleryGunPool::Prewarm(UStaticGunLoader* Arsenal, int32 PerDefinition)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Prewarm Gun Pool");
+	if (!Arsenal)
+	{
+		return;
+	}
+	for (const TPair<FString, FString>& Definition : Arsenal->CommonNameToProperNameMapping)
+	{
+		TArray<TSharedPtr<FArtilleryGun>> Warm;
+		Warm.Reserve(PerDefinition * 2);
+		for (int32 i = 0; i < PerDefinition; ++i)
+		{
+			if (TSharedPtr<FArtilleryGun> Gun = Make(Arsenal, Definition.Key))
+			{
+				Warm.Add(Gun);
+			}
+		}
+		FScopeLock PoolLock(&Lock);
+		Free.FindOrAdd(Definition.Key).Append(MoveTemp(Warm));
+	}
+}
+
+TSharedPtr<FArtilleryGun> FArtilleryGunPool::Acquire(const FString& GunDefinitionID)
+{
+	FScopeLock PoolLock(&Lock);
+	TArray<TSharedPtr<FArtilleryGun>>* List = Free.Find(GunDefinitionID);
+	return List && !List->IsEmpty() ? List->Pop(EAllowShrinking::No) : nullptr;
+}
+
+void FArtilleryGunPool::Retire(TSharedPtr<FArtilleryGun> Gun)
+{
+	//guns built by hand, like test guns, might not be the type their definition says. let those go.
+	if (Gun && Gun->Poolable)
+	{
+		FScopeLock PoolLock(&Lock);
+		Returned.Add(MoveTemp(Gun));
+	}
+}
+
+void FArtilleryGunPool::Recycle()
+{
+	{
+		FScopeLock PoolLock(&Lock);
+		Recycling.Append(MoveTemp(Returned));
+		Returned.Reset();
+	}
+	for (int32 i = 0; i < Recycling.Num();)
+	{
+		TSharedPtr<FArtilleryGun>& Gun = Recycling[i];
+		//somebody's still got it. try again next frame.
+		if (Gun.GetSharedReferenceCount() > 1)
+		{
+			++i;
+			continue;
+		}
+		const FString Definition = Gun->MyGunKey.GunDefinitionID;
+		Gun->ResetForPool();
+		{
+			FScopeLock PoolLock(&Lock);
+			Free.FindOrAdd(Definition).Add(MoveTemp(Gun));
+		}
+		Recycling.RemoveAtSwap(i, 1, EAllowShrinking::No);
+	}
+}
+
+void FArtilleryGunPool::TopUp(UStaticGunLoader* Arsenal, int32 Budget)
+{
+	if (!Arsenal)
+	{
+		return;
+	}
+	TArray<FString, TInlineAllocator<8>> Low;
+	{
+		FScopeLock PoolLock(&Lock);
+		for (const TPair<FString, TArray<TSharedPtr<FArtilleryGun>>>& List : Free)
+		{
+			if (List.Value.Num() < LowWater)
+			{
+				Low.Add(List.Key);
+			}
+		}
+	}
+	for (int32 i = 0; i < Low.Num() && Budget > 0; ++i)
+	{
+		while (Budget > 0)
+		{
+			TSharedPtr<FArtilleryGun> Gun = Make(Arsenal, Low[i]);
+			if (!Gun)
+			{
+				break;
+			}
+			--Budget;
+			FScopeLock PoolLock(&Lock);
+			TArray<TSharedPtr<FArtilleryGun>>& List = Free.FindOrAdd(Low[i]);
+			List.Add(MoveTemp(Gun));
+			if (List.Num() >= LowWater)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void FArtilleryGunPool::Empty()
+{
+	FScopeLock PoolLock(&Lock);
+	Free.Empty();
+	Returned.Empty();
+	Recycling.Empty();
+}
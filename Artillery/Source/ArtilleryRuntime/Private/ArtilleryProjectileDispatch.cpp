@@ -5,17 +5,57 @@
 #include "ArtilleryBPLibs.h"
 #include "BarrageDispatch.h"
 #include "FArtilleryGun.h"
+#include "Algo/StableSort.h"
 
 void UArtilleryProjectileDispatch::ArtilleryTick()
 {
 	//On Tick, we see if anybody needs to go.
 	++ExpirationCounter;
-	if (ExpirationDeadliner->Contains(ExpirationCounter))
+	Expiring.Reset();
+	ExpirationWheel->Expire(ExpirationCounter, Expiring);
+	if (!Expiring.IsEmpty())
 	{
-		TArray<FSkeletonKey> AnyToExpire = ExpirationDeadliner->FindAndRemoveChecked(ExpirationCounter);
-		for (FSkeletonKey Goner : AnyToExpire)
+		ExpireProjectiles(Expiring);
+	}
+}
+
+void UArtilleryProjectileDispatch::ExpireProjectiles(TArray<FProjectileExpiryWheel::FExpired>& Expired)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Expire Projectiles");
+	if (!UArtilleryDispatch::SelfPtr || !UBarrageDispatch::SelfPtr)
+	{
+		return;
+	}
+	//tombstones go out in the order things were fired, same as before, so this stays deterministic.
+	const ArtilleryTime Now = MyDispatch->GetShadowNow();
+	UNiagaraParticleDispatch* NPD = UNiagaraParticleDispatch::SelfPtr;
+	for (const FProjectileExpiryWheel::FExpired& Goner : Expired)
+	{
+		MyDispatch->DeregisterGameplayTags(Goner.Key);
+		ProjectileKeyToMeshManagerMapping->erase(Goner.Key);
+		ProjectileToGunMapping->erase(Goner.Key);
+		if (NPD)
+		{
+			NPD->CleanupKey(Goner.Key);
+		}
+		FBLet Prim = MyDispatch->GetFBLetByObjectKey(Goner.Key, Now);
+		UBarrageDispatch::SelfPtr->SuggestTombstone(Prim);
+	}
+
+	//then the instances, one batch per manager. a stable sort keeps each batch in firing order.
+	Algo::StableSortBy(Expired, [](const FProjectileExpiryWheel::FExpired& Goner) { return Goner.Manager.Get(); });
+	TArray<FSkeletonKey, TInlineAllocator<64>> Batch;
+	for (int32 i = 0; i < Expired.Num();)
+	{
+		AInstancedMeshManager* Manager = Expired[i].Manager.Get();
+		Batch.Reset();
+		for (; i < Expired.Num() && Expired[i].Manager.Get() == Manager; ++i)
 		{
-			UArtilleryLibrary::TombstonePrimitive(Goner);
+			Batch.Add(Expired[i].Key);
+		}
+		if (Manager)
+		{
+			Manager->CleanupInstances(Batch);
 		}
 	}
 }
@@ -82,7 +122,8 @@ bool UArtilleryProjectileDispatch::RegistrationImplementation()
 	MyDispatch = GetWorld()->GetSubsystem<UArtilleryDispatch>();
 	check(MyDispatch);
 	UBarrageDispatch* BarrageDispatch = GetWorld()->GetSubsystem<UBarrageDispatch>();
-	BarrageDispatch->OnBarrageContactAddedDelegate.AddUObject(this, &UArtilleryProjectileDispatch::OnBarrageContactAdded);
+	//the whole step's projectile contacts arrive as one span. the dispatch outlives the busy worker, so raw this is fine here.
+	BarrageDispatch->AddContactConsumer(EBarrageContactGroup::Projectile, [this](const FBContactEventSpan& Span) { OnProjectileContacts(Span); });
 	UArtilleryDispatch::SelfPtr->SetProjectileDispatch(this);
 	SelfPtr = this;
 	return true;
@@ -111,7 +152,8 @@ void UArtilleryProjectileDispatch::Deinitialize()
 	ManagerKeyToMeshManagerMapping->Empty();
 	ProjectileNameToMeshManagerMapping->Empty();
 	ProjectileToGunMapping->clear();
-	ExpirationDeadliner->Empty();
+	ExpirationWheel->Empty();
+	Expiring.Empty();
 	ExpirationCounter = 0;
 	if (HoldOpen)
 	{
@@ -151,7 +193,8 @@ UArtilleryProjectileDispatch::UArtilleryProjectileDispatch(): ProjectileDefiniti
 	ExpirationCounter = 0; //just to make it clear.
 	ManagerKeyToMeshManagerMapping = MakeShareable(new TMap<FSkeletonKey, TWeakObjectPtr<AInstancedMeshManager>>());
 	ProjectileKeyToMeshManagerMapping = MakeShareable(new KeyToItemCuckooMap());
-	ExpirationDeadliner = MakeShareable(new TSortedMap<int, TArray<FSkeletonKey>>());
+	ExpirationWheel = MakeShareable(new FProjectileExpiryWheel());
+	Expiring.Reserve(1024);
 	ProjectileNameToMeshManagerMapping = MakeShareable(new TMap<FName, TWeakObjectPtr<AInstancedMeshManager>>());
 	MeshAssetToMeshManagerMapping = MakeShareable(new TMap<FString, TWeakObjectPtr<AInstancedMeshManager>>());
 	ProjectileToGunMapping = MakeShareable(new KeyToGunMap());
@@ -234,16 +277,9 @@ FSkeletonKey UArtilleryProjectileDispatch::CreateProjectileInstance(FSkeletonKey
 				if (CanExpire)
 				{
 					//TODO: revisit to provide rollback support. it'll be exactly like tombstones.
-					int ExpireTicks = LifeInTicks == -1 ? DEFAULT_LIFE_OF_PROJECTILE : LifeInTicks;
-					TArray<FSkeletonKey>* ArrayIfAny = ExpirationDeadliner->Find(ExpirationCounter + ExpireTicks);
-					if (ArrayIfAny != nullptr)
-					{
-						ArrayIfAny->Add(NewProjectileKey);
-					}
-					else
-					{
-						ExpirationDeadliner->Add(ExpirationCounter + ExpireTicks, {NewProjectileKey});
-					}
+					//at least a tick out, or the wheel will already have passed its slot.
+					int ExpireTicks = FMath::Max(1, LifeInTicks == -1 ? DEFAULT_LIFE_OF_PROJECTILE : LifeInTicks);
+					ExpirationWheel->Schedule(NewProjectileKey, *MeshManagerPtr, ExpirationCounter + ExpireTicks);
 				}
 				return NewProjectileKey;
 			}
@@ -261,6 +297,8 @@ void UArtilleryProjectileDispatch::DeleteProjectile(const FSkeletonKey Target)
 {
 	if (UArtilleryDispatch::SelfPtr)
 	{
+		//covers collisions too, since they tombstone through here. nothing's left to expire.
+		ExpirationWheel->Cancel(Target);
 		TWeakObjectPtr<AInstancedMeshManager> MeshManager;
 		ProjectileKeyToMeshManagerMapping->find(Target, MeshManager);
 		UArtilleryDispatch::SelfPtr->DeregisterGameplayTags(Target);
@@ -297,26 +335,27 @@ TWeakObjectPtr<USceneComponent> UArtilleryProjectileDispatch::GetSceneComponentF
 	return ManagerRef.IsValid() ? ManagerRef->GetSceneComponentForInstance(ProjectileKey) : nullptr;
 }
 
-void UArtilleryProjectileDispatch::OnBarrageContactAdded(const BarrageContactEvent& ContactEvent)
+void UArtilleryProjectileDispatch::OnProjectileContacts(const FBContactEventSpan& Span)
 {
-	// We only care if one of the entities is a projectile
+	// Everything in this span has a projectile on at least one side.
 	if (UBarrageDispatch::SelfPtr)
 	{
-		if (ContactEvent.IsEitherEntityAProjectile())
+		for (int32 i = 0; i < Span.Num; ++i)
 		{
-			bool Body1_IsBullet = ContactEvent.ContactEntity1.bIsProjectile;
+			if (Span.Type[i] != EBarrageContactEventType::ADDED)
+			{
+				continue;
+			}
+			bool Body1_IsBullet = Span.IsProjectile1(i);
 			// if both are bullets, if their layers allow it, we will collide them.
 			// this is actually how antimissile works.
 			//Oh and these are FBarrageKeys
-			FBarrageKey ProjectileKey = Body1_IsBullet
-				                     ? ContactEvent.ContactEntity1.ContactKey
-				                     : ContactEvent.ContactEntity2.ContactKey;
-			FBarrageKey EntityHitKey = Body1_IsBullet
-				                    ? ContactEvent.ContactEntity2.ContactKey
-				                    : ContactEvent.ContactEntity1.ContactKey;
+			FBarrageKey ProjectileKey = Body1_IsBullet ? Span.Body1[i] : Span.Body2[i];
+			FBarrageKey EntityHitKey = Body1_IsBullet ? Span.Body2[i] : Span.Body1[i];
 
 			//we defer this as late as we can to minimize contention during the sim step.
-			//don't make this a ref unless you want a very bad time.
+			//don't make this a ref unless you want a very bad time. this is also the tombstone check, so a bullet that
+			//already hit something earlier in the span doesn't hit again.
 			FBLet quickfib = UBarrageDispatch::SelfPtr->GetShapeRef(ProjectileKey);
 			bool ProbablyValid = FBarragePrimitive::IsNotNull(quickfib);
 			if (ProbablyValid)
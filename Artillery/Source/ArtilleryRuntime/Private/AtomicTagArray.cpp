@@ -24,6 +24,11 @@ void AtomicTagArray::Init()
 		SeenT->Emplace(Tag, ++Counter);
 		MasterDecoderRing->Emplace(Counter,Tag);
 	}
+	if (Counter >= FAST_TAG_BITS)
+	{
+		//the extra tags can never be added to a fast path entity. Add will just fail for them.
+		UE_LOG(LogTemp, Error, TEXT("AtomicTagArray: %d tags registered, but the fast tag bitset only holds %d. Raise FAST_TAG_BITS."), Counter, FAST_TAG_BITS - 1);
+	}
 }
 
 bool AtomicTagArray::Add(FSkeletonKey Top, FGameplayTag Bot)
@@ -31,9 +36,8 @@ bool AtomicTagArray::Add(FSkeletonKey Top, FGameplayTag Bot)
 	uint32_t Key = KeyToHash(Top);
 	if (!AddImpl(Key, Bot))
 	{
-		return false; // we really should do more but right now, this is just for entities with seven tags or less.
-		//I had a sketch of something that was a little more versatile, but ultimately, I actually think it might be
-		//overkill. entities should EITHER get added to FastSKRP or to the normal tag set.
+		return false; // the entity's not registered, or the tag's numbered past FAST_TAG_BITS.
+		//entities should EITHER get added to FastSKRP or to the normal tag set.
 	}
 	return true;
 	//okay this is a satanic mess.
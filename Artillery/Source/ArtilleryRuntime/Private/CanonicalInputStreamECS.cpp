@@ -109,6 +109,7 @@ bool UCanonicalInputStreamECS::registerPattern(IPM::CanonPattern ToBind,
 			newMap.Get()->Add(FCM_Owner_ActorParams.ToSeek, FCM_Owner_ActorParams);
 			thisInputStream->MyPatternMatcher->AllPatternBinds.Add(ToBind->getName(), newMap);
 		}
+		PatternMatcher->BindsVersion.fetch_add(1, std::memory_order_release);
 		return true;
 	}
 	return false;
@@ -128,11 +129,84 @@ bool UCanonicalInputStreamECS::removePattern(IPM::CanonPattern ToBind, FActionPa
 		{
 			//names are never removed. sets are only added to or removed from.
 			pinSharedPtr.Get()->Remove(FCM_Owner_ActorParams.ToSeek);
+			thisInputStream->Get()->MyPatternMatcher->BindsVersion.fetch_add(1, std::memory_order_release);
 			return true;
 		}
 	}
 	return false;
 }
+void UCanonicalInputStreamECS::FConservedInputPatternMatcher::Compile()
+{
+	Slots.Reset();
+	Binds.Reset();
+	//same order the binds were always walked in, so events come out in the same order they always did.
+	for (TPair<ArtIPMKey, TSharedPtr<TMap<FActionBitMask, FActionPatternParams>>>& SetTuple : AllPatternBinds)
+	{
+		if (!SetTuple.Value || SetTuple.Value->Num() == 0)
+		{
+			continue;
+		}
+		const int32 SlotIndex = Slots.Num();
+		FCompiledSlot& Slot = Slots.AddDefaulted_GetRef();
+		Slot.Pattern = AllPatternsByName[SetTuple.Key];
+		Slot.Compiled = Slot.Pattern->getCompiled();
+		for (TPair<FActionBitMask, FActionPatternParams>& Elem : *SetTuple.Value)
+		{
+			Slot.Union.buttons |= Elem.Value.ToSeek.buttons;
+			const uint32 ToSeek = Elem.Value.ToSeek.getFlat();
+			if (ToSeek != 0)
+			{
+				FCompiledBind& Bind = Binds.AddDefaulted_GetRef();
+				Bind.Slot = SlotIndex;
+				Bind.ToSeek = ToSeek;
+				Bind.Mask = Elem.Value.ToSeek;
+				Bind.ToFire = Elem.Value.ToFire;
+				Bind.Action = Slot.Pattern->getName();
+			}
+		}
+	}
+}
+
+const UCanonicalInputStreamECS::FConservedInputPatternMatcher::FInputAges& UCanonicalInputStreamECS::FConservedInputPatternMatcher::AgesAt(
+	uint64_t Input, const TSharedPtr<FConservedInputStream>& Stream)
+{
+	if (HistoryOf != Stream.Get())
+	{
+		for (FInputAges& Stale : History)
+		{
+			Stale.Input = MAX_uint64;
+		}
+		HistoryOf = Stream.Get();
+	}
+	FInputAges& Ages = History[Input & (AgesKept - 1)];
+	if (Ages.Input == Input)
+	{
+		return Ages;
+	}
+	std::optional<FArtilleryShell> Current = Stream->peek(Input);
+	const uint32 Down = Current.has_value() ? Current->GetButtonsAndEventsFlat() : 0;
+	const FInputAges& Before = History[(Input - 1) & (AgesKept - 1)];
+	if (Input > 0 && Before.Input == Input - 1)
+	{
+		for (uint32 Age = FCompiledActionPattern::MaxAge - 1; Age > 0; --Age)
+		{
+			Ages.Ago[Age] = Before.Ago[Age - 1];
+		}
+	}
+	else
+	{
+		//cold, or a rerun from further back than we remember. walk back the once and we're warm again.
+		for (uint32 Age = 1; Age < FCompiledActionPattern::MaxAge; ++Age)
+		{
+			std::optional<FArtilleryShell> Then = Input >= Age ? Stream->peek(Input - Age) : std::nullopt;
+			Ages.Ago[Age] = Then.has_value() ? Then->GetButtonsAndEventsFlat() : 0;
+		}
+	}
+	Ages.Ago[0] = Down;
+	Ages.Input = Input;
+	return Ages;
+}
+
 TPair<ActorKey, InputStreamKey> UCanonicalInputStreamECS::RegisterKeysToParentActorMapping(FireControlKey MachineKey, bool IsActorForLocalPlayer , const ActorKey ParentKey)
 {
 	LocalActorToFireControlMapping->Add(ParentKey, MachineKey);
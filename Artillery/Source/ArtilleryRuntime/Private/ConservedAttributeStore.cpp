@@ -0,0 +1,158 @@
+#include "ConservedAttributeStore.h"
+
+void FConservedAttributeData::Record(EConservedAttributeChannel Channel, double Old, double New) const
+{
+	if (Store)
+	{
+		Store->Record(*this, Channel, Old, New);
+	}
+}
+
+FConservedAttributeStore::FConservedAttributeStore()
+{
+	DeltaLog = MakeUnique<FLoggedDelta[]>(DeltaLogSize);
+}
+
+Arty::AttrPtr FConservedAttributeStore::Allocate(FSkeletonKey Owner, E_AttribKey Key)
+{
+	FConservedAttributeData* Data = nullptr;
+	uint32 Slot = 0;
+	{
+		FScopeLock Lock(&AllocationLock);
+		FColumn& Column = Columns[static_cast<uint8>(Key)];
+		if (Column.Free.IsEmpty())
+		{
+			const uint32 NumChunks = Column.NumChunks.load(std::memory_order_relaxed);
+			if (NumChunks == MaxChunks)
+			{
+				UE_LOG(LogTemp, Error, TEXT("FConservedAttributeStore: attribute %d is full at %d live instances."), static_cast<uint8>(Key), MaxChunks * SlotsPerChunk);
+				return nullptr;
+			}
+			if (Column.Chunks.IsEmpty())
+			{
+				//reserved whole, up front, so the array never reallocates out from under a ForEach.
+				Column.Chunks.Reserve(MaxChunks);
+			}
+			Column.Chunks.Emplace(MakeUnique<FChunk>());
+			//handed out lowest first, so live slots stay packed toward the front.
+			for (uint32 i = SlotsPerChunk; i > 0; --i)
+			{
+				Column.Free.Add(NumChunks * SlotsPerChunk + i - 1);
+			}
+			Column.NumChunks.store(NumChunks + 1, std::memory_order_release);
+		}
+		Slot = Column.Free.Pop(EAllowShrinking::No);
+		FChunk& Chunk = *Column.Chunks[Slot / SlotsPerChunk];
+		const uint32 Index = Slot % SlotsPerChunk;
+		Data = &Chunk.Data[Index];
+		Data->Store = this;
+		Data->Slot = Slot;
+		Data->Key = static_cast<uint8>(Key);
+		Chunk.Owner[Index] = Owner;
+		Chunk.Live[Index] = true;
+	}
+	//the deleter holds the store open, so an attribute outliving the dispatch can't point into freed chunks.
+	return Arty::AttrPtr(Data, [Store = AsShared(), Key, Slot](FConservedAttributeData*)
+	{
+		Store->Release(Key, Slot);
+	});
+}
+
+void FConservedAttributeStore::Release(E_AttribKey Key, uint32 Slot)
+{
+	FScopeLock Lock(&AllocationLock);
+	FColumn& Column = Columns[static_cast<uint8>(Key)];
+	FChunk& Chunk = *Column.Chunks[Slot / SlotsPerChunk];
+	const uint32 Index = Slot % SlotsPerChunk;
+	Chunk.Live[Index] = false;
+	Chunk.Owner[Index] = FSkeletonKey();
+	//values only. the slot keeps its store, slot, and key, since those are where it lives, not what it holds.
+	Chunk.Data[Index] = FConservedAttributeData();
+	Column.Free.Add(Slot);
+}
+
+FConservedAttributeData* FConservedAttributeStore::Find(E_AttribKey Key, uint32 Slot, FSkeletonKey Owner)
+{
+	FColumn& Column = Columns[static_cast<uint8>(Key)];
+	if (Slot / SlotsPerChunk >= Column.NumChunks.load(std::memory_order_acquire))
+	{
+		return nullptr;
+	}
+	FChunk& Chunk = *Column.Chunks[Slot / SlotsPerChunk];
+	const uint32 Index = Slot % SlotsPerChunk;
+	//slots get reused. if someone else has it now, the delta isn't theirs.
+	return Chunk.Live[Index] && Chunk.Owner[Index] == Owner ? &Chunk.Data[Index] : nullptr;
+}
+
+void FConservedAttributeStore::Record(const FConservedAttributeData& Attribute, EConservedAttributeChannel Channel, double Old, double New)
+{
+	if (Old == New)
+	{
+		return;
+	}
+	const uint32 Slot = Attribute.Slot;
+	const uint64 Index = DeltaHead.fetch_add(1, std::memory_order_acq_rel);
+	FLoggedDelta& Entry = DeltaLog[Index & (DeltaLogSize - 1)];
+	Entry.Seq.store(0, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_release);
+	Entry.Delta.Tick = GetNow();
+	Entry.Delta.Owner = Columns[Attribute.Key].Chunks[Slot / SlotsPerChunk]->Owner[Slot % SlotsPerChunk];
+	Entry.Delta.Old = Old;
+	Entry.Delta.New = New;
+	Entry.Delta.Slot = Slot;
+	Entry.Delta.Key = static_cast<E_AttribKey>(Attribute.Key);
+	Entry.Delta.Channel = Channel;
+	Entry.Seq.store(Index + 1, std::memory_order_release);
+}
+
+bool FConservedAttributeStore::ReadDelta(uint64 Index, FConservedAttributeDelta& Out) const
+{
+	const FLoggedDelta& Entry = DeltaLog[Index & (DeltaLogSize - 1)];
+	if (Entry.Seq.load(std::memory_order_acquire) != Index + 1)
+	{
+		return false;
+	}
+	Out = Entry.Delta;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return Entry.Seq.load(std::memory_order_relaxed) == Index + 1;
+}
+
+bool FConservedAttributeStore::RewindTo(ArtilleryTime To)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Rewind Conserved Attributes");
+	const uint64 Head = DeltaHead.load(std::memory_order_acquire);
+	const uint64 Oldest = Head > DeltaLogSize ? Head - DeltaLogSize : 0;
+	if (Oldest > 0)
+	{
+		//the log has lapped. make sure the oldest entry left is at or before To, or we'd rewind partway.
+		FConservedAttributeDelta Tail;
+		if (!ReadDelta(Oldest, Tail) || Tail.Tick > To)
+		{
+			return false;
+		}
+	}
+
+	FScopeLock Lock(&AllocationLock);
+	ForEachDeltaSince(To, [this](const FConservedAttributeDelta& Delta)
+	{
+		FConservedAttributeData* Data = Find(Delta.Key, Delta.Slot, Delta.Owner);
+		if (!Data)
+		{
+			return;
+		}
+		switch (Delta.Channel)
+		{
+		case EConservedAttributeChannel::Current:
+			Data->CurrentValue = static_cast<float>(Delta.Old);
+			break;
+		case EConservedAttributeChannel::Base:
+			Data->BaseValue = static_cast<float>(Delta.Old);
+			break;
+		case EConservedAttributeChannel::Remote:
+			Data->RemoteValue = Delta.Old;
+			break;
+		}
+	});
+	//the rewound deltas stay in the log, but they're a future that didn't happen. the resim logs its own.
+	return true;
+}
@@ -1,77 +1,247 @@
 ﻿#include "ConservedTagContainer.h"
 
-bool FTagStateRepresentation::Find(uint16 Numerology)
+void FTagStateRepresentation::BeginWrite()
 {
-	for (uint8 i = 0; i < FAST_TAG_MAX_C; i++)
+	uint32 Seen = Sequence.load(std::memory_order_relaxed);
+	while ((Seen & 1) != 0 || !Sequence.compare_exchange_weak(Seen, Seen + 1, std::memory_order_acquire, std::memory_order_relaxed))
 	{
-		if (Tags[i] == Numerology)
-		{
-			return true;
-		}
+		//someone else is mid write. it's a handful of instructions, so spin.
+		FPlatformProcess::YieldCycles(16);
+		Seen = Sequence.load(std::memory_order_relaxed);
 	}
-	return false;
 }
 
 bool FTagStateRepresentation::Remove(uint16 Numerology)
 {
-	bool foundandremoved = false;
-	for (uint8 i = 0; i < FAST_TAG_MAX_C; i++)
+	if (!FTagBits::InRange(Numerology))
 	{
-		if (Tags[i] == Numerology)
-		{
-			Tags[i] = 0;
-			[[maybe_unused]] uint32_t A = snagged.fetch_and(0 << i, std::memory_order_acquire);
-			foundandremoved = true;
-		}
+		return false;
 	}
-	return foundandremoved;
+	const uint64 Mask = 1ull << (Numerology & 63);
+	BeginWrite();
+	const uint64 Was = Words[Numerology >> 6].fetch_and(~Mask, std::memory_order_relaxed);
+	EndWrite();
+	return (Was & Mask) != 0;
 }
 
 bool FTagStateRepresentation::Add(uint16 Numerology)
 {
-	for (uint8 i = 0; i < FAST_TAG_MAX_C; i++)
+	//no more slots to run out of. the only way to fail is a tag the fast path can't number.
+	if (!FTagBits::InRange(Numerology))
 	{
-		//attempt weakly to prevent double entry. remove removes all instances, so this isn't a huge problem
-		//we just want to make it only arise when contested in specific ways.
-		if (Tags[i] == Numerology)
-			return true;
+		return false;
 	}
-	for (uint8 i = 0; i < FAST_TAG_MAX_C; i++)
+	BeginWrite();
+	Words[Numerology >> 6].fetch_or(1ull << (Numerology & 63), std::memory_order_relaxed);
+	EndWrite();
+	return true;
+}
+
+void FTagStateRepresentation::Snapshot(FTagBits& Out) const
+{
+	for (;;)
 	{
-		//this protects us from add races pretty well. now to get a double entry we need a fairly specific sequence
-		//to all line up to contend.
-		if (Tags[i] == 0 || Tags[i] == Numerology)
+		const uint32 Before = Sequence.load(std::memory_order_acquire);
+		if ((Before & 1) == 0)
 		{
-			uint32_t A = snagged.fetch_and(1 << i, std::memory_order_acquire);
-			if ((A & 1 << i) == 0) //was unset, is now set.
+			for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+			{
+				Out.Words[i] = Words[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Sequence.load(std::memory_order_relaxed) == Before)
 			{
-				//we got it.
-				Tags[i] = Numerology;
-				return true;
+				return;
 			}
 		}
+		FPlatformProcess::YieldCycles(16);
 	}
+}
 
-	return false;
+bool FTagStateRepresentation::HasAll(const FTagBits& Query) const
+{
+	FTagBits Now;
+	Snapshot(Now);
+	uint64 Missing = 0;
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		Missing |= Query.Words[i] & ~Now.Words[i];
+	}
+	return Missing == 0;
+}
+
+bool FTagStateRepresentation::HasAny(const FTagBits& Query) const
+{
+	FTagBits Now;
+	Snapshot(Now);
+	uint64 Hit = 0;
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		Hit |= Query.Words[i] & Now.Words[i];
+	}
+	return Hit != 0;
+}
+
+void FTagStateRepresentation::Overwrite(const FTagBits& In)
+{
+	BeginWrite();
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		Words[i].store(In.Words[i], std::memory_order_relaxed);
+	}
+	EndWrite();
 }
 
-void FConservedTagContainer::CacheLayer()
+void FConservedTagContainer::CacheLayer(uint64_t Tick)
+{
+	if (!Tags)
+	{
+		return;
+	}
+	//a tick we already hold gets recached from scratch, so back out it and everything after it first.
+	while (HeldLayers > 0 && Newest().Tick >= Tick)
+	{
+		Unflip(Newest(), LastCached);
+		DropNewest();
+	}
+
+	FTagBits Now;
+	Tags->Snapshot(Now);
+	uint16 Changed = 0;
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		if (Now.Words[i] != LastCached.Words[i])
+		{
+			Changed |= static_cast<uint16>(1u << i);
+		}
+	}
+	const uint32 Count = FMath::CountBits(Changed);
+
+	//when the window's full, the slot we're about to write is the oldest layer, and its words free up with it.
+	uint32 LiveFrom = FlipHead;
+	if (HeldLayers == RollbackFrames)
+	{
+		LiveFrom = CurrentHistory[(CurrentWriteHead + 1) % RollbackFrames].FlipsAt;
+	}
+	else if (HeldLayers > 0)
+	{
+		LiveFrom = CurrentHistory[(CurrentWriteHead - HeldLayers) % RollbackFrames].FlipsAt;
+	}
+	const uint32 Needed = FlipHead + Count - LiveFrom;
+	if (Needed > static_cast<uint32>(FlipPool.Num()))
+	{
+		//positions don't change, only the mask does, so the live words just move to where the new mask puts them.
+		TArray<uint64> Grown;
+		Grown.SetNumZeroed(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(Needed, FAST_TAG_WORDS)));
+		const uint32 OldMask = FlipPool.Num() - 1;
+		const uint32 NewMask = Grown.Num() - 1;
+		for (uint32 At = LiveFrom; At != FlipHead; ++At)
+		{
+			Grown[At & NewMask] = FlipPool[At & OldMask];
+		}
+		FlipPool = MoveTemp(Grown);
+	}
+
+	FTagDelta& Layer = CurrentHistory[CurrentWriteHead % RollbackFrames];
+	Layer.Tick = Tick;
+	Layer.Changed = Changed;
+	Layer.FlipsAt = FlipHead;
+	const uint32 Mask = FlipPool.Num() - 1;
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		if (Changed & 1 << i)
+		{
+			FlipPool[FlipHead++ & Mask] = Now.Words[i] ^ LastCached.Words[i];
+		}
+	}
+	LastCached = Now;
+	++CurrentWriteHead;
+	HeldLayers = FMath::Min<uint32>(HeldLayers + 1, RollbackFrames);
+}
+
+void FConservedTagContainer::Unflip(const FTagDelta& Layer, FTagBits& Bits) const
+{
+	const uint32 Mask = FlipPool.Num() - 1;
+	uint32 At = Layer.FlipsAt;
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
+	{
+		if (Layer.Changed & 1 << i)
+		{
+			Bits.Words[i] ^= FlipPool[At++ & Mask];
+		}
+	}
+}
+
+void FConservedTagContainer::DropNewest()
+{
+	FlipHead = Newest().FlipsAt;
+	--CurrentWriteHead;
+	--HeldLayers;
+}
+
+bool FConservedTagContainer::GetBitsAtTick(uint64_t Tick, FTagBits& Out) const
+{
+	if (HeldLayers == 0)
+	{
+		return false;
+	}
+	const uint64_t Held = HeldLayers;
+	const FTagDelta& Oldest = CurrentHistory[(CurrentWriteHead - Held) % RollbackFrames];
+	if (Tick < Oldest.Tick)
+	{
+		return false;
+	}
+	Out = LastCached;
+	//walk back from the newest layer, unflipping each one that happened after the tick we want.
+	for (uint64_t Back = 1; Back <= Held; ++Back)
+	{
+		const FTagDelta& Layer = CurrentHistory[(CurrentWriteHead - Back) % RollbackFrames];
+		if (Layer.Tick <= Tick)
+		{
+			break;
+		}
+		Unflip(Layer, Out);
+	}
+	return true;
+}
+
+bool FConservedTagContainer::RewindTo(uint64_t Tick)
+{
+	FTagBits Then;
+	if (!Tags || !GetBitsAtTick(Tick, Then))
+	{
+		return false;
+	}
+	Tags->Overwrite(Then);
+	//drop every layer after the tick. the resim caches its own.
+	while (HeldLayers > 0 && Newest().Tick > Tick)
+	{
+		DropNewest();
+	}
+	LastCached = Then;
+	return true;
+}
+
+TSharedPtr<TArray<FGameplayTag>> FConservedTagContainer::Decode(const FTagBits& Bits) const
 {
-	uint32 index = CurrentHistory.GetNextIndex(CurrentWriteHead);
-	CurrentHistory[index] = FTagLayer();
 	TSharedPtr<UnderlyingTagReverse> WornRing = DecoderRing.Pin();
-	if (WornRing)
+	if (!WornRing)
+	{
+		return nullptr;
+	}
+	FTagLayer Out = MakeShareable(new TArray<FGameplayTag>());
+	for (uint32 i = 0; i < FAST_TAG_WORDS; ++i)
 	{
-		for (uint16_t tagcode : Tags->Tags)
+		for (uint64 Word = Bits.Words[i]; Word != 0; Word &= Word - 1)
 		{
-			FGameplayTag* ATag = WornRing->Find(tagcode);
-			if (ATag != nullptr)
+			const uint16 Code = static_cast<uint16>(i * 64 + FMath::CountTrailingZeros64(Word));
+			if (const FGameplayTag* ATag = WornRing->Find(Code))
 			{
-				CurrentHistory[index]->Add(*ATag);
+				Out->Add(*ATag);
 			}
 		}
-		++CurrentWriteHead;
 	}
+	return Out;
 }
 
 FConservedTags FConservedTagContainer::GetReference()
@@ -84,10 +254,9 @@ FConservedTags FConservedTagContainer::GetReference()
 	return nullptr;
 }
 
-//frame numbering starts at _1_
 FTagLayer FConservedTagContainer::GetFrameByNumber(uint64_t FrameNumber)
 {
-	return CurrentHistory[CurrentHistory.GetNextIndex(FrameNumber-1)];
+	return GetAllTags(FrameNumber);
 }
 
 bool FConservedTagContainer::Find(FGameplayTag Bot)
@@ -129,14 +298,48 @@ bool FConservedTagContainer::Add(FGameplayTag Bot)
 	return false;
 }
 
-//todo: doublecheck my math here.
+bool FConservedTagContainer::FindAll(const FTagBits& Query) const
+{
+	return Tags && Tags->HasAll(Query);
+}
+
+bool FConservedTagContainer::FindAny(const FTagBits& Query) const
+{
+	return Tags && Tags->HasAny(Query);
+}
+
+bool FConservedTagContainer::EncodeQuery(const FGameplayTagContainer& In, FTagBits& Out) const
+{
+	Out = FTagBits();
+	bool AllKnown = SeenT.IsValid();
+	for (const FGameplayTag& Tag : In)
+	{
+		const uint16_t* Code = SeenT ? SeenT->Find(Tag) : nullptr;
+		if (Code && FTagBits::InRange(*Code))
+		{
+			Out.Set(*Code);
+		}
+		else
+		{
+			AllKnown = false;
+		}
+	}
+	return AllKnown;
+}
+
 TSharedPtr<TArray<FGameplayTag>> FConservedTagContainer::GetAllTags()
 {
-	return CurrentHistory[CurrentHistory.GetPreviousIndex(CurrentWriteHead)];
+	if (!Tags)
+	{
+		return nullptr;
+	}
+	FTagBits Now;
+	Tags->Snapshot(Now);
+	return Decode(Now);
 }
 
-//todo: again doublecheck my math here. can peek the FConservedAttrib. ATM, I gotta get this wired up.
 TSharedPtr<TArray<FGameplayTag>> FConservedTagContainer::GetAllTags(uint64_t FrameNumber)
 {
-	return CurrentHistory[CurrentHistory.GetPreviousIndex(FrameNumber)];
-}
\ No newline at end of file
+	FTagBits Then;
+	return GetBitsAtTick(FrameNumber, Then) ? Decode(Then) : nullptr;
+}
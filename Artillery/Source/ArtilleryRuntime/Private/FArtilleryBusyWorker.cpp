@@ -6,6 +6,7 @@
 #include "ArtilleryBPLibs.h"
 #include "BarrageDispatch.h"
 #include "Containers/TripleBuffer.h"
+#include "Algo/StableSort.h"
 
 FArtilleryBusyWorker::FArtilleryBusyWorker() : RequestorQueue_Abilities_TripleBuffer(nullptr), running(false)
 {
@@ -26,62 +27,24 @@ bool FArtilleryBusyWorker::Init()
 	return true;
 }
 
-void FArtilleryBusyWorker::RunStandardFrameSim(bool& missedPrior, uint64_t& currentIndexCabling,
-                                               bool& burstDropDetected, PacketElement& current,
+void FArtilleryBusyWorker::RunStandardFrameSim(uint64_t& currentIndexCabling, PacketElement& current,
                                                bool& RemoteInput)
 {
+	Building = FResimFrame();
+	LateThisFrame.Reset();
 	//this is an odd thing to do, I know, but we have some book-keeping we want to reserve for each code path.
 	//once this settles a little, I'll refactor, but I'm going to end up reworking this next weekend.
 	if (InputRingBuffer != nullptr && !InputRingBuffer.Get()->IsEmpty())
 	{
+		//we only see packets once a frame, so arrival is measured to the frame. that's also how finely we play out, so
+		//it's fine. the jitter buffer sorts out which cycles these are and when they should actually play.
+		const ArtilleryTime ArrivedAt = NarrowClock::getSlicedMicrosecondNow();
 		while (InputRingBuffer != nullptr && !InputRingBuffer.Get()->IsEmpty())
 		{
-			const Packet_tpl* packedInput = InputRingBuffer.Get()->Peek();
-			const long indexInput = packedInput->GetCycleMeta() + 3; //faster than 3xabs or a branch.
-			//unlike the old design, we use an array of inputs from first -> current
-			//so we want to add oldest first, then next, then next.
-			//we'll need to amend this to handle correct defaulting of missing input,
-			//which we can detect by both cycle skips and arrival window misses.
-			//we then need a way, during rollbacks, to perform the rewrite.
-			//right now, we just wait until we get the remote input.
-			if (missedPrior)
-			{
-				if (burstDropDetected)
-				{
-					BristleconeControlStream->Add(
-						*const_cast<Packet_tpl*>(packedInput)->GetPointerToElement((indexInput - 2) % 3),
-						packedInput->GetTransferTime());
-				}
-					
-				BristleconeControlStream->Add(
-					*const_cast<Packet_tpl*>(packedInput)->GetPointerToElement((indexInput - 1) % 3),
-					packedInput->GetTransferTime());
-			}
-			BristleconeControlStream->Add(
-				*const_cast<Packet_tpl*>(packedInput)->GetPointerToElement(indexInput % 3),
-				packedInput->GetTransferTime());
-
+			RemoteJitter.Receive(*InputRingBuffer.Get()->Peek(), ArrivedAt);
 			RemoteInput = true; //we check for empty at the start of the while. no need to check again.
 			InputRingBuffer.Get()->Dequeue();
 		}
-
-		if (RemoteInput == true)
-		{
-			missedPrior = false;
-			burstDropDetected = false;
-		}
-		else
-		{
-			if (burstDropDetected)
-			{
-				//add rolling average switch-over here
-			}
-			if (missedPrior)
-			{
-				burstDropDetected = true;
-			}
-			missedPrior = true;
-		}
 	}
 	else if (InputSwapSlot != nullptr && !InputSwapSlot.Get()->IsEmpty())
 	{
@@ -103,6 +66,52 @@ void FArtilleryBusyWorker::RunStandardFrameSim(bool& missedPrior, uint64_t& curr
 		CablingControlStream->Add(CablingControlStream->get(CablingControlStream->highestInput - 1)->MyInputActions,
 		                          TickliteNow);
 	}
+	//remote input plays when the jitter buffer says it's due, which is deliberately a little after it was sent, so
+	//on-time input runs now. only real input for a cycle we already covered with a repeat is late. it goes into the
+	//stream in the repeat's place, and we go back to the frame the repeat ran on and run it there instead.
+	RemotePlayout.Reset();
+	RemoteJitter.Playout(NarrowClock::getSlicedMicrosecondNow(), RemotePlayout);
+	int64 ResimFrom = INDEX_NONE;
+	for (const FArtilleryJitterBuffer::FPlayout& Play : RemotePlayout)
+	{
+		if (Play.Late)
+		{
+			const FCovering& Cover = CoveringFor(Play.Cycle);
+			std::optional<TheCone::PacketElement> Repeated;
+			if (Cover.Cycle == Play.Cycle && CanResimFrom(Cover.Frame)
+				&& (Repeated = BristleconeControlStream->Replace(Cover.Index, Play.Input)).has_value())
+			{
+				LateThisFrame.Add({Cover.Index, *Repeated, Play.Input, Play.SentAt});
+				ResimFrom = ResimFrom == INDEX_NONE ? Cover.Frame : FMath::Min<int64>(ResimFrom, Cover.Frame);
+				continue;
+			}
+			//too late to fix. it runs now, and we count it.
+			++LateInputsRunLate;
+		}
+		const uint64_t i = BristleconeControlStream->highestInput;
+		BristleconeControlStream->Add(Play.Input, Play.SentAt);
+		Building.Remote.Add(i);
+		if (Play.Repeat)
+		{
+			CoveringFor(Play.Cycle) = FCovering{Play.Cycle, i, FramesRecorded};
+		}
+	}
+	if (ResimFrom != INDEX_NONE && !Resim(ResimFrom))
+	{
+		//couldn't go back after all. put the repeats back the way they ran, and run the real ones late.
+		for (const FLateInput& Late : LateThisFrame)
+		{
+			BristleconeControlStream->Replace(Late.Index, Late.Repeated);
+			Building.Remote.Add(BristleconeControlStream->highestInput);
+			BristleconeControlStream->Add(Late.Input, Late.SentAt);
+		}
+		LateInputsRunLate += LateThisFrame.Num();
+	}
+	else if (ResimFrom == INDEX_NONE && VerifyResimEvery != 0 && FramesRecorded % VerifyResimEvery == 0)
+	{
+		VerifyResim();
+	}
+	
 #define ARTILLERY_FIRE_CONTROL_MACHINE_HANDLING (false)
 	//First, locomotions are pushed. Patterns run here. The thread queues the locomotions and fires.
 	//the dispatch fires guns via the machines on the gamethread.
@@ -112,36 +121,29 @@ void FArtilleryBusyWorker::RunStandardFrameSim(bool& missedPrior, uint64_t& curr
 	//Per input stream, run their patterns here. god in heaven.
 	EventBuffer& refDangerous_LifeCycleManaged_Abilities_TripleBuffered = RequestorQueue_Abilities_TripleBuffer->GetWriteBuffer();
 
+	const int32 FiredFrom = refDangerous_LifeCycleManaged_Abilities_TripleBuffered.Num();
+	Building.CablingFrom = currentIndexCabling;
+	Building.CablingTo = CablingControlStream->highestInput;
 	if (currentIndexCabling < CablingControlStream->highestInput)
 	{
 		//today's sin is PRIDE, bigbird!
 		for (int i = currentIndexCabling; i < CablingControlStream->highestInput; ++i)
 		{
-			//TODO: does this leak memory?
-			ActorKey StreamActorKey = CablingControlStream->GetActorByInputStream();
-			if (StreamActorKey)
-			{
-				Locomos_BufferNotThreadSafe->Add(
-					LocomotionParams(
-						CablingControlStream->peek(i)->SentAt,
-						StreamActorKey,
-						*CablingControlStream->peek(i - 1),
-						*CablingControlStream->peek(i)));
-
-				// this looks wrong but I'm pretty sure it ain' since we reserve highest.
-				CablingControlStream->MyPatternMatcher->runOneFrameWithSideEffects(
-					true,
-					0,
-					0,
-					i,
-					refDangerous_LifeCycleManaged_Abilities_TripleBuffered); 
-			}
+			PushInput(*CablingControlStream, i, refDangerous_LifeCycleManaged_Abilities_TripleBuffered);
 			//even if this doesn't get played for some reason, this is the last chance we've got to make a
 			//truly informed decision about the matter. By the time we reach the dispatch system, that chance is gone.
 			//Better to skip a cosmetic once in a while than crash the game.
 			CablingControlStream->get(CablingControlStream->highestInput - 1)->RunAtLeastOnce = true;
 		}
 	}
+	for (const uint64_t i : Building.Remote)
+	{
+		PushInput(*BristleconeControlStream, i, refDangerous_LifeCycleManaged_Abilities_TripleBuffered);
+	}
+	//a resim needs to know what's already gone off, or it'll fire it all over again.
+	Building.Fired.Append(
+		refDangerous_LifeCycleManaged_Abilities_TripleBuffered.GetData() + FiredFrom,
+		refDangerous_LifeCycleManaged_Abilities_TripleBuffered.Num() - FiredFrom);
 
 	Locomos_BufferNotThreadSafe->Sort();
 	refDangerous_LifeCycleManaged_Abilities_TripleBuffered.Sort();
@@ -151,6 +153,203 @@ void FArtilleryBusyWorker::RunStandardFrameSim(bool& missedPrior, uint64_t& curr
 	}
 }
 
+void FArtilleryBusyWorker::PushInput(ArtilleryControlStream& Stream, uint64_t Index, EventBuffer& Events) const
+{
+	//TODO: does this leak memory?
+	ActorKey StreamActorKey = Stream.GetActorByInputStream();
+	std::optional<FArtilleryShell> Current = Stream.peek(Index);
+	if (StreamActorKey && Current.has_value())
+	{
+		//the very first input has nothing before it. it's its own previous.
+		std::optional<FArtilleryShell> Previous = Stream.peek(Index - 1);
+		Locomos_BufferNotThreadSafe->Add(
+			LocomotionParams(
+				Current->SentAt,
+				StreamActorKey,
+				Previous.has_value() ? *Previous : *Current,
+				*Current));
+
+		// this looks wrong but I'm pretty sure it ain' since we reserve highest.
+		Stream.MyPatternMatcher->runOneFrameWithSideEffects(
+			true,
+			0,
+			0,
+			Index,
+			Events);
+	}
+}
+
+bool FArtilleryBusyWorker::CanResimFrom(uint64 Frame)
+{
+	if (ContingentPhysicsLinkage == nullptr || ContingentDispatchLinkage == nullptr || Frame >= FramesRecorded || FramesRecorded < 2)
+	{
+		return false;
+	}
+	//we restore to the end of the frame before the one we replay from, so that one has to still be around too.
+	const uint64 Oldest = FramesRecorded - FMath::Min<uint64>(FramesRecorded - 1, FMath::Min(MaxResimFrames, ResimHistory - 1));
+	//and a shared ticklite that's live is one we'd have no way to put back.
+	return Frame >= Oldest
+		&& (FramesRecorded - Frame) * FrameCostMicros <= ResimBudgetMicros
+		&& ContingentPhysicsLinkage->CanRestoreToTick(FrameAt(Frame - 1).Seq)
+		&& ContingentDispatchLinkage->ArtilleryTicklitesWorker_LockstepToWorldSim.CanRewindTo(FrameAt(Frame - 1).Now);
+}
+
+//puts physics, attributes, and tags back to the end of the frame before FromFrame, then runs every frame from there to
+//the newest again. false, with nothing changed, if physics won't restore.
+bool FArtilleryBusyWorker::Resim(uint64 FromFrame)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Artillery Resim");
+	UArtilleryDispatch* ArtilleryDispatch = ContingentDispatchLinkage;
+	if (ArtilleryDispatch == nullptr || ContingentPhysicsLinkage == nullptr)
+	{
+		return false;
+	}
+	const uint32 Started = NarrowClock::getSlicedMicrosecondNow();
+	//the ticklites thread can still be finishing last frame's apply. nothing else writes attributes on our clock, so
+	//once we hold this, nobody's writing what we're about to rewind.
+	FScopeLock TicklitesHeld(&ArtilleryDispatch->ArtilleryTicklitesWorker_LockstepToWorldSim.ApplyLock);
+	const FResimFrame& Before = FrameAt(FromFrame - 1);
+	//a shared ticklite can have gone in since we asked.
+	if (!ArtilleryDispatch->ArtilleryTicklitesWorker_LockstepToWorldSim.CanRewindTo(Before.Now))
+	{
+		return false;
+	}
+	if (!ContingentPhysicsLinkage->RestoreToTick(Before.Seq))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Artillery:BusyWorker: Physics refused to restore to tick [%d], late input will run late."), Before.Seq);
+		return false;
+	}
+	if (!ArtilleryDispatch->GetAttributeStore()->RewindTo(Before.Now))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Artillery:BusyWorker: Attribute log doesn't reach back to [%ld], resimming without rewinding attributes."), Before.Now);
+	}
+	//tag layers are cached at the start of a frame, so the one for FromFrame is already what we want to start from.
+	const ArtilleryTime FirstNow = FrameAt(FromFrame).Now;
+	for (FConservedTags& TagSet : TagRollbackManagement)
+	{
+		if (TagSet)
+		{
+			TagSet->RewindTo(FirstNow);
+		}
+	}
+
+	ResimEvents.Reset();
+	ResimTicks.Reset();
+	for (uint64 Frame = FromFrame; Frame < FramesRecorded; ++Frame)
+	{
+		FResimFrame& Rerun = FrameAt(Frame);
+		const int32 FrameEventsFrom = ResimEvents.Num();
+		ArtilleryDispatch->GetAttributeStore()->SetNow(Rerun.Now);
+		if (Frame != FromFrame)
+		{
+			for (FConservedTags& TagSet : TagRollbackManagement)
+			{
+				if (TagSet)
+				{
+					TagSet->CacheLayer(Rerun.Now);
+				}
+			}
+		}
+		//same inputs, same order, as the first time round. plus whatever was late.
+		for (uint64_t i = Rerun.CablingFrom; i < Rerun.CablingTo; ++i)
+		{
+			PushInput(*CablingControlStream, i, ResimEvents);
+		}
+		for (const uint64_t i : Rerun.Remote)
+		{
+			PushInput(*BristleconeControlStream, i, ResimEvents);
+		}
+		KeepNewlyFired(Rerun, FrameEventsFrom);
+		Locomos_BufferNotThreadSafe->Sort();
+		ArtilleryDispatch->RERunLocomotions();
+		ContingentPhysicsLinkage->StackUp();
+		ContingentPhysicsLinkage->StepWorld(Rerun.Now, Rerun.Seq);
+		//contacts come out of the resim fresh. attributes were rewound, so consumers see them as if for the first time.
+		// ReSharper disable once CppExpressionWithoutSideEffects
+		ContingentPhysicsLinkage->BroadcastContactEvents();
+		ResimTicks.Add(Rerun.Now);
+	}
+
+	Algo::StableSortBy(ResimEvents, [](const TPair<ArtilleryTime, EventBufferInfo>& Event) { return Event.Key; });
+	for (const TPair<ArtilleryTime, EventBufferInfo>& Event : ResimEvents)
+	{
+		ArtilleryDispatch->QueueResim(Event.Value, Event.Key);
+	}
+	ArtilleryDispatch->ArtilleryTicklitesWorker_LockstepToWorldSim.QueueRollback(ResimTicks, FromFrame);
+	ArtilleryDispatch->ArtilleryAIWorker_LockstepToWorldSim.QueueRollback(ResimTicks.Num());
+	++ResimsRun;
+
+	const uint32 Took = NarrowClock::getSlicedMicrosecondNow() - Started;
+	if (Took > ResimBudgetMicros)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Artillery:BusyWorker: Resim of [%d] frames took [%u]us, budget is [%u]us."), ResimTicks.Num(), Took, ResimBudgetMicros);
+	}
+	return true;
+}
+
+void FArtilleryBusyWorker::VerifyResim()
+{
+	const uint64 Frames = FMath::Min<uint64>(VerifyResimFrames, FMath::Min<uint64>(MaxResimFrames, ResimHistory - 1));
+	if (ContingentPhysicsLinkage == nullptr || ContingentDispatchLinkage == nullptr || Frames == 0 || FramesRecorded <= Frames)
+	{
+		return;
+	}
+	const uint64 FromFrame = FramesRecorded - Frames;
+	if (!ContingentPhysicsLinkage->CanRestoreToTick(FrameAt(FromFrame - 1).Seq)
+		|| !ContingentDispatchLinkage->ArtilleryTicklitesWorker_LockstepToWorldSim.CanRewindTo(FrameAt(FromFrame - 1).Now))
+	{
+		return;
+	}
+	VerifyFingerprints.Reset();
+	for (uint64 Frame = FromFrame; Frame < FramesRecorded; ++Frame)
+	{
+		VerifyFingerprints.Add(ContingentPhysicsLinkage->FingerprintTick(FrameAt(Frame).Seq));
+	}
+	if (!Resim(FromFrame))
+	{
+		return;
+	}
+	for (uint64 Frame = FromFrame; Frame < FramesRecorded; ++Frame)
+	{
+		const uint32 Before = VerifyFingerprints[Frame - FromFrame];
+		const uint32 After = ContingentPhysicsLinkage->FingerprintTick(FrameAt(Frame).Seq);
+		if (Before != 0 && Before != After)
+		{
+			++ResimMismatches;
+			UE_LOG(LogTemp, Error, TEXT("Artillery:BusyWorker: Resim of tick [%d] didn't come out the same, [%08x] the first time and [%08x] now."), FrameAt(Frame).Seq, Before, After);
+			//everything after diverges from here anyway.
+			return;
+		}
+	}
+}
+
+void FArtilleryBusyWorker::KeepNewlyFired(FResimFrame& Frame, int32 From)
+{
+	//a multiset match. the same gun can go off twice in a frame, and each original only cancels one rerun.
+	AlreadyFired.Reset();
+	AlreadyFired.Append(Frame.Fired.GetData(), Frame.Fired.Num());
+	int32 Kept = From;
+	for (int32 e = From; e < ResimEvents.Num(); ++e)
+	{
+		const TPair<ArtilleryTime, EventBufferInfo>& Event = ResimEvents[e];
+		const int32 Match = AlreadyFired.IndexOfByPredicate([&Event](const TPair<ArtilleryTime, EventBufferInfo>& Old)
+		{
+			return Old.Key == Event.Key
+				&& Old.Value.GunKey == Event.Value.GunKey
+				&& Old.Value.Action == Event.Value.Action
+				&& Old.Value.ActionBitMask == Event.Value.ActionBitMask;
+		});
+		if (Match != INDEX_NONE)
+		{
+			AlreadyFired.RemoveAtSwap(Match, 1, EAllowShrinking::No);
+			continue;
+		}
+		Frame.Fired.Add(Event);
+		ResimEvents[Kept++] = Event;
+	}
+	ResimEvents.SetNum(Kept, EAllowShrinking::No);
+}
+
 //TODO right now, this incurs two serious determinism risks:
 //The order that threads get queues is random, so if you just go down the line, that won't produce a deterministic execution order.
 //Even if you fix that, you still need to order the requests as a gestalt, and now you have a problem where you don't know the
@@ -194,7 +393,7 @@ void FArtilleryBusyWorker::ProcessRequestRouterBusyWorkerThread()
 	}
 }
 
-void FArtilleryBusyWorker::RunFrameProcessingLoop(bool missedPrior, uint64_t currentIndexCabling, bool burstDropDetected, bool sent, uint32_t LastIncrementWindow, uint32_t lsbTime, const uint32_t SendHertzFactor, const uint32_t Period, const std::chrono::microseconds HalfStep, UArtilleryDispatch* ArtilleryDispatch)
+void FArtilleryBusyWorker::RunFrameProcessingLoop(uint64_t currentIndexCabling, bool sent, uint32_t LastIncrementWindow, uint32_t lsbTime, const uint32_t SendHertzFactor, const uint32_t Period, const std::chrono::microseconds HalfStep, UArtilleryDispatch* ArtilleryDispatch)
 {
 	timeBeginPeriod(1);
 	
@@ -213,25 +412,29 @@ void FArtilleryBusyWorker::RunFrameProcessingLoop(bool missedPrior, uint64_t cur
 			currentIndexCabling = CablingControlStream->highestInput;
 			PacketElement current = 0;
 			bool RemoteInput = false;
-			RunStandardFrameSim(missedPrior, currentIndexCabling, burstDropDetected, current, RemoteInput);
+			RunStandardFrameSim(currentIndexCabling, current, RemoteInput);
 			/*
 			* Note: We also have Iris performing intermittent state stomps to recover from more serious desyncs.
 			* Ultimately, rollback can never solve everything. The windows just get too wide.
 			*/
 			sent = true;
 			TickliteNow = ContingentInputECSLinkage->Now(); // this updates ONCE PER CYCLE. ONCE. THIS IS INTENDED.
+			ArtilleryDispatch->GetAttributeStore()->SetNow(TickliteNow);
 
 			ProcessRequestRouterBusyWorkerThread();
+			//game thread requests get ordered and prepped here, so all the game thread has left is the uobject work.
+			ArtilleryDispatch->StageRequestRouterGameThread();
 			//tag container save-off currently happens before player and player-like locomotion.
 			//this SHOULD be the right place, by my limited reasoning, but I could be wrong.
 			for (FConservedTags& TagSet : TagRollbackManagement)
 			{
 				if (TagSet)
 				{
-					TagSet->CacheLayer();	
+					TagSet->CacheLayer(TickliteNow);	
 				}
 			}
 			
+			const uint32 SimStarted = NarrowClock::getSlicedMicrosecondNow();
 			ArtilleryDispatch->RunLocomotions();
 			//such a simple thing, after all this work.
 			if (ContingentPhysicsLinkage == nullptr) 
@@ -243,11 +446,19 @@ void FArtilleryBusyWorker::RunFrameProcessingLoop(bool missedPrior, uint64_t cur
 			{
 				ContingentPhysicsLinkage->StackUp();
 
+				TickliteFrame.store(FramesRecorded, std::memory_order_release);
 				StartTicklitesApply->Trigger();
 				StartRunAhead->Trigger();
 				ContingentPhysicsLinkage->StepWorld(TickliteNow, SeqNumber);
 				// ReSharper disable once CppExpressionWithoutSideEffects (it has _ rather a lot _ of side-effects)
 				ContingentPhysicsLinkage->BroadcastContactEvents();
+				//the frame's run, so it's one we can run again.
+				const uint32 SimCost = NarrowClock::getSlicedMicrosecondNow() - SimStarted;
+				FrameCostMicros = FrameCostMicros == 0 ? SimCost : (FrameCostMicros * 7 + SimCost) / 8;
+				Building.Now = TickliteNow;
+				Building.Seq = SeqNumber;
+				FrameAt(FramesRecorded) = MoveTemp(Building);
+				++FramesRecorded;
 				if (ParticleSystemPointer)
 				{
 					ParticleSystemPointer->ArtilleryTick(); //currently a no-op.
@@ -296,9 +507,7 @@ uint32 FArtilleryBusyWorker::Run()
 		return -1;
 	}
 	
-	bool missedPrior = false;
 	uint64_t currentIndexCabling = 0;
-	bool burstDropDetected = false;
 	bool sent = false;
 	//TODO: remember why this needs to be an int. 
 	//if you wanna use this for a really long lived session, you'll need to fix it. you know. one longer than 34 years.
@@ -337,10 +546,10 @@ uint32 FArtilleryBusyWorker::Run()
 	//where we can, so we're trying to hide the barrage dependency here in a sense. We can't fully, but.
 	UArtilleryDispatch* ArtilleryDispatch = ContingentInputECSLinkage->GetWorld()->GetSubsystem<UArtilleryDispatch>();
 	ArtilleryDispatch->ThreadSetup();
+	ContingentDispatchLinkage = ArtilleryDispatch;
 
 	//Run loop is in here.
-	RunFrameProcessingLoop(missedPrior, currentIndexCabling, burstDropDetected, sent, LastIncrementWindow, lsbTime,
-	                       SendHertzFactor, Period, HalfStep, ArtilleryDispatch);
+	RunFrameProcessingLoop(currentIndexCabling, sent, LastIncrementWindow, lsbTime, SendHertzFactor, Period, HalfStep, ArtilleryDispatch);
 
 	//just in case we end up unrolling or something weird.
 	timeEndPeriod(1);
@@ -129,7 +129,24 @@ bool FArtilleryGun::Initialize(const FGunKey& KeyFromDispatch, const bool MyCode
 	FiringPointComponentKey = MAKE_BONEKEY(&FiringPointComponent);
 	TransformDispatch->RegisterSceneCompToShadowTransform(FiringPointComponentKey, FiringPointComponent.Get());
 		
-	//we'd like to do it earlier, but there's actually not a great moment to do this.
+	//we'd like to do it earlier, but there's actually not a great moment to do this. pooled guns already did.
+	PrepareAbilities(PF, PFC, F, FC, PtF, PtFc, FFC);
+		
+	if(!MyCodeWillSetGunKey)
+	{
+		SetGunKey(MyGunKey);
+	}
+		
+	MyDispatch->REGISTER_GUN_FINAL_TICK_RESOLVER(MyGunKey, this);
+	ReadyToFire = ReadyToFire || !MyCodeWillSetGunKey;
+	return ReadyToFire;
+}
+
+void FArtilleryGun::PrepareAbilities(UArtilleryPerActorAbilityMinimum* PF, UArtilleryPerActorAbilityMinimum* PFC,
+                                     UArtilleryPerActorAbilityMinimum* F, UArtilleryPerActorAbilityMinimum* FC,
+                                     UArtilleryPerActorAbilityMinimum* PtF, UArtilleryPerActorAbilityMinimum* PtFc,
+                                     UArtilleryPerActorAbilityMinimum* FFC)
+{
 	if(Prefire == nullptr)
 	{
 		Prefire = PF ? PF : NewObject<UArtilleryPerActorAbilityMinimum>();
@@ -148,15 +165,19 @@ bool FArtilleryGun::Initialize(const FGunKey& KeyFromDispatch, const bool MyCode
 		FailedFireCosmetic = FFC ? FFC : NewObject<UArtilleryPerActorAbilityMinimum>();
 		FailedFireCosmetic->AddToRoot();
 	}
-		
-	if(!MyCodeWillSetGunKey)
-	{
-		SetGunKey(MyGunKey);
-	}
-		
-	MyDispatch->REGISTER_GUN_FINAL_TICK_RESOLVER(MyGunKey, this);
-	ReadyToFire = ReadyToFire || !MyCodeWillSetGunKey;
-	return ReadyToFire;
+}
+
+void FArtilleryGun::ResetForPool()
+{
+	//dropping the attribute map deregisters the old key's attributes.
+	MyAttributes.Reset();
+	MyProbableOwner = ActorKey();
+	ReadyToFire = false;
+	PlayerCameraComponent.Reset();
+	FiringPointComponent.Reset();
+	FiringPointComponentKey = FBoneKey();
+	//keeps the definition, so the pool knows where it goes. the instance is gone.
+	MyGunKey = FGunKey(MyGunKey.GunDefinitionID);
 }
 
 void FArtilleryGun::SetGunKey(FGunKey NewKey)
@@ -0,0 +1,181 @@
+#include "FArtilleryJitterBuffer.h"
+
+void FArtilleryJitterBuffer::Receive(const TheCone::Packet_tpl& Packet, ArtilleryTime ArrivedAt)
+{
+	const uint64 Newest = Packet.GetCycleMeta();
+	if (Newest == 0)
+	{
+		return;
+	}
+	const ArtilleryTime Sent = Packet.GetTransferTime();
+	if (Started && Newest + Slots < NextCycle)
+	{
+		//cycles went backwards a long way, so the sender started over. so do we.
+		UE_LOG(LogTemp, Warning, TEXT("Artillery:JitterBuffer: Remote cycles restarted, resetting."));
+		Reset();
+	}
+	if (!Started)
+	{
+		Started = true;
+		NextCycle = Newest > ClonesPerPacket - 1 ? Newest - (ClonesPerPacket - 1) : 1;
+		LastSentAt = Sent - static_cast<ArtilleryTime>(Newest - NextCycle + 1) * InputPeriodMicros;
+	}
+	Track(Since(ArrivedAt, Sent), Sent, Newest);
+
+	//the sender writes cycle N into slot (N - 1) % 3. older clones were sent a period apart, going back.
+	for (uint64 Age = 0; Age < ClonesPerPacket && Age < Newest; ++Age)
+	{
+		const uint64 Cycle = Newest - Age;
+		File(Cycle, *Packet.GetPointerToElement((Cycle - 1) % ClonesPerPacket),
+		     Sent - static_cast<ArtilleryTime>(Age) * InputPeriodMicros);
+	}
+	NewestCycle = FMath::Max(NewestCycle, Newest);
+}
+
+void FArtilleryJitterBuffer::File(uint64 Cycle, TheCone::PacketElement Input, ArtilleryTime SentAt)
+{
+	if (Cycle < NextCycle)
+	{
+		//either we played it already, and this is a clone, or we covered for it and it's late.
+		uint64& Cover = Covered[Cycle & (Slots - 1)];
+		if (Cover == Cycle)
+		{
+			Cover = 0;
+			PendingLate.Add({Input, SentAt, true, false, Cycle});
+			++Stats.Late;
+		}
+		return;
+	}
+	if (Cycle >= NextCycle + Slots)
+	{
+		//we've been stalled longer than we can hold. give up on everything that would fall off the ring.
+		const uint64 Skipped = Cycle - Slots + 1 - NextCycle;
+		Stats.Lost += Skipped;
+		for (uint64 Gone = NextCycle; Gone < Cycle - Slots + 1; ++Gone)
+		{
+			SlotFor(Gone).Present = false;
+		}
+		NextCycle = Cycle - Slots + 1;
+		RepeatsInARow = 0;
+	}
+	FSlot& Slot = SlotFor(Cycle);
+	if (Slot.Present && Slot.Cycle == Cycle)
+	{
+		return;
+	}
+	Slot.Cycle = Cycle;
+	Slot.Input = Input;
+	Slot.SentAt = SentAt;
+	Slot.Present = true;
+}
+
+void FArtilleryJitterBuffer::Track(int32 Transit, ArtilleryTime SentAt, uint64 Cycle)
+{
+	//how much transit moves packet to packet. quick to grow, slow to relax, so one calm second doesn't undo a spike.
+	if (HaveTransit)
+	{
+		const int32 Wobble = FMath::Abs(Transit - LastTransit);
+		JitterMicros += Wobble > JitterMicros ? (Wobble - JitterMicros) / 4 : (Wobble - JitterMicros) / 64;
+	}
+	LastTransit = Transit;
+	HaveTransit = true;
+
+	WindowMin = FMath::Min(WindowMin, Transit);
+	if (++WindowCount >= TransitWindow)
+	{
+		PriorWindowMin = WindowMin;
+		WindowMin = MAX_int32;
+		WindowCount = 0;
+	}
+
+	if (PeriodCycle != 0 && Cycle > PeriodCycle)
+	{
+		const int32 Spacing = Since(SentAt, PeriodSentAt) / static_cast<int32>(Cycle - PeriodCycle);
+		if (Spacing > 0)
+		{
+			InputPeriodMicros += (Spacing - InputPeriodMicros) / 16;
+		}
+	}
+	PeriodCycle = Cycle;
+	PeriodSentAt = SentAt;
+}
+
+int32 FArtilleryJitterBuffer::Depth() const
+{
+	int32 Held = 0;
+	for (uint64 Cycle = NextCycle; Cycle <= NewestCycle; ++Cycle)
+	{
+		const FSlot& Slot = Buffer[Cycle & (Slots - 1)];
+		Held += Slot.Present && Slot.Cycle == Cycle;
+	}
+	return Held;
+}
+
+void FArtilleryJitterBuffer::Playout(ArtilleryTime Now, TArray<FPlayout>& Out)
+{
+	const int32 Wanted = FMath::Min(MaxDelayMicros, JitterMicros * JitterMultiplier);
+	DelayMicros += FMath::Clamp(Wanted - DelayMicros, -DelayStepMicros, DelayStepMicros);
+
+	Out.Append(PendingLate);
+	PendingLate.Reset();
+	if (!Started)
+	{
+		return;
+	}
+
+	const int32 Lowest = FMath::Min(WindowMin, PriorWindowMin);
+	const int32 BaseTransit = Lowest == MAX_int32 ? LastTransit : Lowest;
+	int32 Released = 0;
+	//we'll run a couple of cycles past the newest we have, but only to cover for them.
+	while (NextCycle <= NewestCycle + MaxConsecutiveRepeats)
+	{
+		FSlot& Slot = SlotFor(NextCycle);
+		const bool Here = Slot.Present && Slot.Cycle == NextCycle;
+		const ArtilleryTime SentAt = Here ? Slot.SentAt : LastSentAt + InputPeriodMicros;
+		if (Since(Now, SentAt) < BaseTransit + DelayMicros)
+		{
+			break;
+		}
+		if (Here)
+		{
+			Out.Add({Slot.Input, Slot.SentAt, false, false, NextCycle});
+			Slot.Present = false;
+			LastPlayed = Slot.Input;
+			RepeatsInARow = 0;
+			++Stats.Played;
+		}
+		else if (RepeatsInARow < MaxConsecutiveRepeats)
+		{
+			Out.Add({LastPlayed, SentAt, false, true, NextCycle});
+			Covered[NextCycle & (Slots - 1)] = NextCycle;
+			++RepeatsInARow;
+			++Stats.Repeated;
+		}
+		else if (NextCycle + ClonesPerPacket <= NewestCycle)
+		{
+			//nothing still on its way can carry it, so it's gone. move past it without playing anything.
+			++Stats.Lost;
+		}
+		else
+		{
+			//it might still turn up as a clone. we've made up enough, so we wait.
+			break;
+		}
+		LastSentAt = SentAt;
+		++NextCycle;
+		++Released;
+	}
+
+	Stats.Bunched += Released > 1;
+	Stats.JitterMicros = JitterMicros;
+	Stats.BaseTransitMicros = BaseTransit;
+	Stats.DelayMicros = DelayMicros;
+	Stats.Depth = Depth();
+}
+
+void FArtilleryJitterBuffer::Reset()
+{
+	const FStats Kept = Stats;
+	*this = FArtilleryJitterBuffer();
+	Stats = Kept;
+}
@@ -0,0 +1,145 @@
+#include "FArtilleryTickliteCalcPool.h"
+
+FArtilleryTickliteCalcPool::~FArtilleryTickliteCalcPool()
+{
+	Stop();
+}
+
+void FArtilleryTickliteCalcPool::Start(TFunction<void()> ThreadSetup)
+{
+	if (Running.exchange(true))
+	{
+		return;
+	}
+	OnThreadStart = MoveTemp(ThreadSetup);
+	for (int32 i = 0; i < WorkerCount; ++i)
+	{
+		FCalcWorker& Worker = *Workers.Emplace_GetRef(MakeUnique<FCalcWorker>(*this));
+		Worker.Wake = FPlatformProcess::GetSynchEventFromPool(false);
+		Worker.Thread.Reset(FRunnableThread::Create(&Worker, *FString::Printf(TEXT("ARTILLERY_TICKLITE_CALC_%d"), i)));
+	}
+}
+
+void FArtilleryTickliteCalcPool::Stop()
+{
+	if (!Running.exchange(false))
+	{
+		return;
+	}
+	for (TUniquePtr<FCalcWorker>& Worker : Workers)
+	{
+		Worker->Wake->Trigger();
+	}
+	for (TUniquePtr<FCalcWorker>& Worker : Workers)
+	{
+		if (Worker->Thread)
+		{
+			Worker->Thread->WaitForCompletion();
+			Worker->Thread.Reset();
+		}
+		FPlatformProcess::ReturnSynchEventToPool(Worker->Wake);
+		Worker->Wake = nullptr;
+	}
+	Workers.Empty();
+}
+
+void FArtilleryTickliteCalcPool::RunChunk(const FChunk& Chunk, uint64 UpcomingFrame)
+{
+	if (Chunk.Lane)
+	{
+		Chunk.Lane->Calculate(UpcomingFrame, Chunk.Begin, Chunk.End);
+		return;
+	}
+	for (int32 i = Chunk.Begin; i < Chunk.End; ++i)
+	{
+		Arty::FTickliteHandle& Tickable = Chunk.Shared[i];
+		//expired ones get expired in apply, as that's a mutating op. they just don't calc.
+		if (Tickable.Schedule.IsDue(UpcomingFrame) && !Tickable->ShouldExpireTickable())
+		{
+			Tickable->CalculateTickable();
+		}
+	}
+}
+
+void FArtilleryTickliteCalcPool::Drain()
+{
+	for (;;)
+	{
+		const uint64 Claim = Cursor.fetch_add(1, std::memory_order_acq_rel);
+		if (static_cast<uint32>(Claim >> 32) != PassGeneration.load(std::memory_order_acquire))
+		{
+			//that pass is over, and this claim belongs to it.
+			return;
+		}
+		const int32 Index = static_cast<int32>(Claim & 0xFFFFFFFF);
+		if (Index >= Pass.Num())
+		{
+			return;
+		}
+		RunChunk(Pass[Index], PassFrame);
+		Finished.fetch_add(1, std::memory_order_acq_rel);
+	}
+}
+
+void FArtilleryTickliteCalcPool::Calculate(uint64 UpcomingFrame, TConstArrayView<FChunk> Chunks)
+{
+	int32 Total = 0;
+	for (const FChunk& Chunk : Chunks)
+	{
+		Total += Chunk.End - Chunk.Begin;
+	}
+	if (!Running.load(std::memory_order_acquire) || Total < InlineBelow)
+	{
+		for (const FChunk& Chunk : Chunks)
+		{
+			RunChunk(Chunk, UpcomingFrame);
+		}
+		return;
+	}
+
+	Pass = Chunks;
+	PassFrame = UpcomingFrame;
+	Finished.store(0, std::memory_order_relaxed);
+	CheckedOut.store(0, std::memory_order_relaxed);
+	const uint32 Generation = PassGeneration.load(std::memory_order_relaxed) + 1;
+	PassGeneration.store(Generation, std::memory_order_release);
+	Cursor.store(static_cast<uint64>(Generation) << 32, std::memory_order_release);
+	for (TUniquePtr<FCalcWorker>& Worker : Workers)
+	{
+		Worker->Wake->Trigger();
+	}
+
+	Drain();
+	//every woken worker has to check out too, or one could still be reading this pass when the next one's written.
+	//if we're shutting down, they may never wake, so stop waiting for them.
+	while (Finished.load(std::memory_order_acquire) < Chunks.Num()
+		|| (CheckedOut.load(std::memory_order_acquire) < Workers.Num() && Running.load(std::memory_order_acquire)))
+	{
+		FPlatformProcess::YieldCycles(64);
+	}
+	Pass = TConstArrayView<FChunk>();
+}
+
+uint32 FArtilleryTickliteCalcPool::FCalcWorker::Run()
+{
+	if (Owner.OnThreadStart)
+	{
+		Owner.OnThreadStart();
+	}
+	while (Owner.Running.load(std::memory_order_acquire))
+	{
+		Wake->Wait();
+		//always drain and check out, even when woken to stop, so a pass in flight is never left waiting on us.
+		Owner.Drain();
+		Owner.CheckedOut.fetch_add(1, std::memory_order_acq_rel);
+	}
+	return 0;
+}
+
+void FArtilleryTickliteCalcPool::FCalcWorker::Stop()
+{
+	if (Wake)
+	{
+		Wake->Trigger();
+	}
+}
@@ -0,0 +1,43 @@
+#include "KeyedSlabRegistry.h"
+
+namespace
+{
+	std::atomic<uint64> ReadersInUse[FKeyedSlabReaders::Max / 64];
+
+	struct FReaderId
+	{
+		int32 Index = -1;
+
+		~FReaderId()
+		{
+			if (Index >= 0)
+			{
+				ReadersInUse[Index / 64].fetch_and(~(1ull << (Index % 64)), std::memory_order_acq_rel);
+			}
+		}
+	};
+
+	thread_local FReaderId ThisThread;
+}
+
+int32 FKeyedSlabReaders::Mine()
+{
+	if (ThisThread.Index >= 0)
+	{
+		return ThisThread.Index;
+	}
+	for (int32 Word = 0; Word < Max / 64; ++Word)
+	{
+		uint64 Seen = ReadersInUse[Word].load(std::memory_order_acquire);
+		while (~Seen)
+		{
+			const uint64 Bit = FMath::CountTrailingZeros64(~Seen);
+			if (ReadersInUse[Word].compare_exchange_weak(Seen, Seen | (1ull << Bit), std::memory_order_acq_rel))
+			{
+				ThisThread.Index = Word * 64 + static_cast<int32>(Bit);
+				return ThisThread.Index;
+			}
+		}
+	}
+	return -1;
+}
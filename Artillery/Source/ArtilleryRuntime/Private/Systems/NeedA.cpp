@@ -38,7 +38,7 @@ FGrantWith F_INeedA::MobileAI(FSkeletonKey AIEntity, ArtilleryTime Stamp)
 }
 	
 //the following statement must return a non-null element
-//GunToFiringFunctionMapping->Find(Request.Gun)->ExecuteIfBound(GunByKey->FindRef(Request.Gun), false);
+//GunRegistry->Read(Request.Gun, ...) must find a gun with a bound firing function.
 //in other words, it MUST be bound already as per any other gun you wish to fire. globspeebcormbrad
 FGrantWith F_INeedA::GunFired(FGunKey Target, ArtilleryTime Stamp)
 {
@@ -0,0 +1,143 @@
+#include "ProjectileExpiryWheel.h"
+#include "AInstancedMeshManager.h"
+
+static_assert(FMath::IsPowerOfTwo(FProjectileExpiryWheel::SlotCount), "the wheel masks, so keep it a power of two.");
+
+FProjectileExpiryWheel::FProjectileExpiryWheel()
+{
+	Slots.SetNum(SlotCount);
+	Scheduled.Reserve(InitialCapacity);
+	Entries.SetNum(InitialCapacity);
+	for (int32 i = 0; i < InitialCapacity; ++i)
+	{
+		Entries[i].Next = i + 1 < InitialCapacity ? i + 1 : None;
+	}
+	FreeHead = 0;
+}
+
+int32 FProjectileExpiryWheel::Claim()
+{
+	if (FreeHead == None)
+	{
+		//indices are all we hand around, so growing is just more entries on the end.
+		const int32 Old = Entries.Num();
+		Entries.SetNum(Old * 2);
+		for (int32 i = Old; i < Entries.Num(); ++i)
+		{
+			Entries[i].Next = i + 1 < Entries.Num() ? i + 1 : None;
+		}
+		FreeHead = Old;
+	}
+	const int32 Index = FreeHead;
+	FreeHead = Entries[Index].Next;
+	return Index;
+}
+
+void FProjectileExpiryWheel::Unlink(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	FSlot& Slot = Slots[Entry.Deadline & (SlotCount - 1)];
+	(Entry.Prev == None ? Slot.Head : Entries[Entry.Prev].Next) = Entry.Next;
+	(Entry.Next == None ? Slot.Tail : Entries[Entry.Next].Prev) = Entry.Prev;
+}
+
+void FProjectileExpiryWheel::Release(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	Entry.Key = FSkeletonKey();
+	Entry.Manager.Reset();
+	Entry.Prev = None;
+	Entry.Next = FreeHead;
+	FreeHead = Index;
+}
+
+void FProjectileExpiryWheel::Schedule(FSkeletonKey Key, TWeakObjectPtr<AInstancedMeshManager> Manager, int32 Deadline)
+{
+	int32 GrewTo = 0;
+	{
+		FScopeLock WheelLock(&Lock);
+		const int32 Capacity = Entries.Num();
+		int32& Index = Scheduled.FindOrAdd(Key, None);
+		if (Index != None)
+		{
+			Unlink(Index);
+		}
+		else
+		{
+			Index = Claim();
+		}
+		FEntry& Entry = Entries[Index];
+		Entry.Key = Key;
+		Entry.Manager = MoveTemp(Manager);
+		Entry.Deadline = Deadline;
+
+		//append, so a slot expires in the order things were scheduled.
+		FSlot& Slot = Slots[Deadline & (SlotCount - 1)];
+		Entry.Prev = Slot.Tail;
+		Entry.Next = None;
+		(Slot.Tail == None ? Slot.Head : Entries[Slot.Tail].Next) = Index;
+		Slot.Tail = Index;
+		GrewTo = Entries.Num() != Capacity ? Entries.Num() : 0;
+	}
+	//the busy worker expires under the same lock, so don't make it wait on the log.
+	if (GrewTo)
+	{
+		UE_LOG(LogTemp, Log, TEXT("FProjectileExpiryWheel: grew to %d entries."), GrewTo);
+	}
+}
+
+bool FProjectileExpiryWheel::Cancel(FSkeletonKey Key)
+{
+	FScopeLock WheelLock(&Lock);
+	int32 Index = None;
+	if (!Scheduled.RemoveAndCopyValue(Key, Index))
+	{
+		return false;
+	}
+	Unlink(Index);
+	Release(Index);
+	return true;
+}
+
+void FProjectileExpiryWheel::Expire(int32 Now, TArray<FExpired>& Out)
+{
+	FScopeLock WheelLock(&Lock);
+	const FSlot& Slot = Slots[Now & (SlotCount - 1)];
+	int32 Index = Slot.Head;
+	while (Index != None)
+	{
+		FEntry& Entry = Entries[Index];
+		const int32 Next = Entry.Next;
+		//anything due on a later lap stays put.
+		if (Entry.Deadline == Now)
+		{
+			Out.Add({Entry.Key, Entry.Manager});
+			Scheduled.Remove(Entry.Key);
+			Unlink(Index);
+			Release(Index);
+		}
+		Index = Next;
+	}
+}
+
+void FProjectileExpiryWheel::Empty()
+{
+	FScopeLock WheelLock(&Lock);
+	for (FSlot& Slot : Slots)
+	{
+		Slot = FSlot();
+	}
+	for (int32 i = 0; i < Entries.Num(); ++i)
+	{
+		Entries[i] = FEntry();
+		Entries[i].Next = i + 1 < Entries.Num() ? i + 1 : None;
+	}
+	FreeHead = Entries.Num() > 0 ? 0 : None;
+	Scheduled.Reset();
+}
+
+int32 FProjectileExpiryWheel::Num() const
+{
+	FScopeLock WheelLock(&Lock);
+	return Scheduled.Num();
+}
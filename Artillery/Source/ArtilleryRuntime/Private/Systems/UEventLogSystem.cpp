@@ -2,6 +2,18 @@
 
 #include "ArtilleryBPLibs.h"
 
+UEventLogSubsystem::UEventLogSubsystem() : MyDispatch(nullptr)
+{
+	EventLog.SetNum(Capacity);
+	Links.SetNum(Capacity);
+	for (int32 i = 0; i < TypeCount; ++i)
+	{
+		ByType[i].SetNumZeroed(Capacity);
+		TypeHead[i] = 0;
+		TypeTail[i] = 0;
+	}
+}
+
 bool UEventLogSubsystem::RegistrationImplementation()
 {
 	UArtilleryDispatch::SelfPtr->SetEventLogSystem(this);
@@ -27,31 +39,115 @@ void UEventLogSubsystem::ArtilleryTick()
 	if (MyDispatch != nullptr)
 	{
 		int32 now = UArtilleryLibrary::GetTotalsTickCount();
-		// RemoveAllSwap does not maintain ordering but is the faster option
-		// For now we do not care about ordering
-		EventLog.RemoveAllSwap([now] (const FArtilleryEvent& Event)
+		//everything lives the same length of time, so the first event still alive is where we stop.
+		const uint64 Newest = Head.load(std::memory_order_acquire);
+		uint64 Oldest = Tail.load(std::memory_order_acquire);
+		while (Oldest < Newest && EventLog[Oldest & Mask].ExpiryTime < now)
+		{
+			++Oldest;
+		}
+		AdvanceTail(Oldest);
+	}
+}
+
+void UEventLogSubsystem::AdvanceTail(uint64 Target)
+{
+	uint64 Seen = Tail.load(std::memory_order_acquire);
+	while (Seen < Target && !Tail.compare_exchange_weak(Seen, Target, std::memory_order_acq_rel))
+	{
+	}
+}
+
+void UEventLogSubsystem::PruneEntities()
+{
+	const uint64 Oldest = Tail.load(std::memory_order_acquire);
+	for (; PrunedTo < Oldest; ++PrunedTo)
+	{
+		const FArtilleryEvent& Event = EventLog[PrunedTo & Mask];
+		for (const FSkeletonKey& Entity : {Event.LoggingKey, Event.OtherKey})
 		{
-			return Event.ExpiryTime < now;
-		});
+			const uint64* Latest = LatestFor.Find(Entity);
+			if (Latest && *Latest == PrunedTo)
+			{
+				LatestFor.Remove(Entity);
+			}
+		}
+		//each type's index is in log order, so an expired event is at the front of its type's, unless the index
+		//already dropped it for being full.
+		const int32 TypeIndex = static_cast<int32>(Event.Type);
+		if (TypeTail[TypeIndex] < TypeHead[TypeIndex] && ByType[TypeIndex][TypeTail[TypeIndex] & Mask] == PrunedTo)
+		{
+			++TypeTail[TypeIndex];
+		}
 	}
 }
 
+void UEventLogSubsystem::Link(FSkeletonKey Entity, uint64 Number, uint64& Prev)
+{
+	uint64& Latest = LatestFor.FindOrAdd(Entity, 0);
+	Prev = Latest;
+	Latest = Number;
+}
+
 void UEventLogSubsystem::LogEvent(E_EventLogType LoggingType, FSkeletonKey LoggingKey, FSkeletonKey Other)
 {
 	int32 now = UArtilleryLibrary::GetTotalsTickCount();
-	FArtilleryEvent NewEvent;
+	const uint64 Number = Head.load(std::memory_order_relaxed);
+	if (Number - Tail.load(std::memory_order_acquire) >= Capacity)
+	{
+		//it's full of live events. something is logging far more than it should, so lose the oldest.
+		UE_LOG(LogTemp, Warning, TEXT("UEventLogSubsystem: log is full, dropping the oldest event early."));
+		AdvanceTail(Number - Capacity + 1);
+	}
+	//has to happen before the slot is reused, while the chains can still see what they pointed at.
+	PruneEntities();
+
+	FArtilleryEvent& NewEvent = EventLog[Number & Mask];
 	NewEvent.LogTime = now;
-	NewEvent.ExpiryTime = now + (5 * 120);
+	NewEvent.ExpiryTime = now + LifeInTicks;
 	NewEvent.Type = LoggingType;
 	NewEvent.LoggingKey = LoggingKey;
 	NewEvent.OtherKey = Other;
-	EventLog.Add(NewEvent);
+
+	FEventLinks& NewLinks = Links[Number & Mask];
+	NewLinks = FEventLinks();
+	if (LoggingKey.IsValid())
+	{
+		Link(LoggingKey, Number, NewLinks.PrevForLogging);
+	}
+	if (Other.IsValid() && Other != LoggingKey)
+	{
+		Link(Other, Number, NewLinks.PrevForOther);
+	}
+
+	const int32 TypeIndex = static_cast<int32>(LoggingType);
+	if (TypeHead[TypeIndex] - TypeTail[TypeIndex] >= Capacity)
+	{
+		++TypeTail[TypeIndex];
+	}
+	ByType[TypeIndex][TypeHead[TypeIndex]++ & Mask] = Number;
+
+	Head.store(Number + 1, std::memory_order_release);
 }
 
-TArray<FArtilleryEvent> UEventLogSubsystem::GetEventsOfType(E_EventLogType TypeToFetch) const
+FArtilleryEventTypeView UEventLogSubsystem::GetEventsOfType(E_EventLogType TypeToFetch) const
 {
-	return EventLog.FilterByPredicate([TypeToFetch] (const FArtilleryEvent& Event)
+	const int32 TypeIndex = static_cast<int32>(TypeToFetch);
+	const uint64 Oldest = Tail.load(std::memory_order_acquire);
+	uint64 From = TypeTail[TypeIndex];
+	const uint64 To = TypeHead[TypeIndex];
+	//the index is in log order too, so the expired ones are all at the front. the last LogEvent pruned up to the tail
+	//as it was then, so this only skips what's expired since.
+	while (From < To && ByType[TypeIndex][From & Mask] < Oldest)
 	{
-		return Event.Type == TypeToFetch;
-	});
+		++From;
+	}
+	return FArtilleryEventTypeView(this, TypeToFetch, From, To);
+}
+
+FArtilleryEntityEventView UEventLogSubsystem::GetEventsFor(FSkeletonKey Entity) const
+{
+	const uint64 Oldest = Tail.load(std::memory_order_acquire);
+	const uint64* Latest = LatestFor.Find(Entity);
+	return FArtilleryEntityEventView(this, Entity, Latest && *Latest >= Oldest ? *Latest : 0, Oldest);
 }
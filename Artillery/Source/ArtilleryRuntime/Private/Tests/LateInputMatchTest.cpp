@@ -0,0 +1,93 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "CanonicalInputStreamECS.h"
+#include "UObject/StrongObjectPtr.h"
+
+//A press that turns up late goes into the stream over the repeat that ran in its place, and the frames from there are
+//resimmed, the way FArtilleryBusyWorker does it. The pattern matcher remembers the last few hundred inputs it saw, so
+//the resim has to match against the press, not against what it remembers of the repeat.
+//
+//Headless: the input ECS and the network subsystem it reads the clock off are made without a world, and nothing is
+//started.
+struct FArtilleryLateInputHarness
+{
+	static constexpr uint64_t Inputs = 32;
+	//button 0, on its own.
+	static constexpr INNNNCOMING Press = 0b1;
+
+	TStrongObjectPtr<UBristleconeWorldSubsystem> Network;
+	TStrongObjectPtr<UCanonicalInputStreamECS> ECS;
+	TSharedPtr<UCanonicalInputStreamECS::FConservedInputStream> Stream;
+
+	//the input index of every match, in the order they fired.
+	TArray<uint64_t> Matched;
+
+	explicit FArtilleryLateInputHarness(const TArray<INNNNCOMING>& Script)
+		: Network(NewObject<UBristleconeWorldSubsystem>()), ECS(NewObject<UCanonicalInputStreamECS>())
+	{
+		ECS->MyNetworkDispatch = Network.Get();
+		Stream = ECS->getNewStreamConstruct(E_PlayerKEY::ECHO);
+		FActionBitMask ToSeek = FActionBitMask::Default();
+		ToSeek.buttons.set(0);
+		ECS->registerPattern(IPM::GPerPress, FActionPatternParams(ToSeek, 1, Stream->MyKey, FGunKey(TEXT("LatePress"), 1)));
+		for (const INNNNCOMING Input : Script)
+		{
+			Stream->Add(Input, ECS->Now());
+		}
+	}
+
+	void Run(uint64_t From)
+	{
+		TArray<TPair<ArtilleryTime, EventBufferInfo>> Events;
+		for (uint64_t Input = From; Input < Inputs; ++Input)
+		{
+			Events.Reset();
+			Stream->MyPatternMatcher->runOneFrameWithSideEffects(true, 0, 0, Input, Events);
+			for (int32 i = 0; i < Events.Num(); ++i)
+			{
+				Matched.Add(Input);
+			}
+		}
+	}
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FArtilleryLateInputMatchTest, "Artillery.Input.LateInputMatchedOnResim",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FArtilleryLateInputMatchTest::RunTest(const FString& Parameters)
+{
+	//the press was for input 10, and the resim starts from there.
+	constexpr uint64_t LateInput = 10;
+	TArray<INNNNCOMING> OnTime;
+	OnTime.Init(0, FArtilleryLateInputHarness::Inputs);
+	OnTime[LateInput] = FArtilleryLateInputHarness::Press;
+	//the first time round, a repeat of the input before covered for it.
+	TArray<INNNNCOMING> Covered = OnTime;
+	Covered[LateInput] = Covered[LateInput - 1];
+
+	FArtilleryLateInputHarness Session(Covered);
+	Session.Run(0);
+	TestEqual(TEXT("nothing matches while the repeat covers for the press"), Session.Matched.Num(), 0);
+
+	const std::optional<INNNNCOMING> Repeat = Session.Stream->Replace(LateInput, FArtilleryLateInputHarness::Press);
+	if (!TestTrue(TEXT("the late press replaces the repeat"), Repeat.has_value() && *Repeat == Covered[LateInput]))
+	{
+		return false;
+	}
+	Session.Run(LateInput);
+
+	FArtilleryLateInputHarness Straight(OnTime);
+	Straight.Run(0);
+	TestTrue(TEXT("on time, the press matches once"), Straight.Matched == TArray<uint64_t>{LateInput});
+	TestTrue(TEXT("late, the resim matches it the same"), Session.Matched == Straight.Matched);
+
+	//and a second resim over the same inputs, with nothing replaced, matches the same again.
+	Session.Matched.Reset();
+	Session.Run(LateInput - 3);
+	TestTrue(TEXT("a deeper resim matches it once more"), Session.Matched == Straight.Matched);
+	return true;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectileExpiryWheel.h"
+#include "Containers/SortedMap.h"
+#include "HAL/PlatformTime.h"
+
+//autogun churn: every tick some projectiles spawn, some of the live ones hit something and get cancelled, and the rest
+//expire when their lifespan runs out. the wheel against the sorted map of per-tick arrays it replaced.
+namespace ProjectileExpiryBench
+{
+	struct FResult
+	{
+		double ScheduleSeconds = 0;
+		double CancelSeconds = 0;
+		double ExpireSeconds = 0;
+		int64 Scheduled = 0;
+		int64 Expired = 0;
+	};
+
+	//what ExpirationDeadliner was, plus the key to deadline map it would have needed to cancel on collision at all.
+	class FSortedDeadlines
+	{
+	public:
+		void Schedule(FSkeletonKey Key, int32 Deadline)
+		{
+			Deadlines.FindOrAdd(Deadline).Add(Key);
+			DeadlineOf.Add(Key, Deadline);
+		}
+
+		void Cancel(FSkeletonKey Key)
+		{
+			int32 Deadline = 0;
+			if (DeadlineOf.RemoveAndCopyValue(Key, Deadline))
+			{
+				if (TArray<FSkeletonKey>* Bucket = Deadlines.Find(Deadline))
+				{
+					Bucket->RemoveSingleSwap(Key, EAllowShrinking::No);
+				}
+			}
+		}
+
+		void Expire(int32 Now, TArray<FSkeletonKey>& Out)
+		{
+			TArray<FSkeletonKey> Bucket;
+			if (Deadlines.RemoveAndCopyValue(Now, Bucket))
+			{
+				for (const FSkeletonKey& Key : Bucket)
+				{
+					DeadlineOf.Remove(Key);
+					Out.Add(Key);
+				}
+			}
+		}
+
+	private:
+		TSortedMap<int32, TArray<FSkeletonKey>> Deadlines;
+		TMap<FSkeletonKey, int32> DeadlineOf;
+	};
+
+	//same seed, same spawns, same hits for both, so they have to expire the same number of projectiles.
+	template <typename FOnSchedule, typename FOnCancel, typename FOnExpire>
+	static FResult Run(int32 PerTick, int32 Lifespan, int32 Ticks, FOnSchedule&& Schedule, FOnCancel&& Cancel, FOnExpire&& Expire)
+	{
+		FResult Result;
+		FRandomStream Random(0xE7A1);
+		TArray<FSkeletonKey> Hits;
+		uint64 NextKey = 1;
+		for (int32 Tick = 0; Tick < Ticks; ++Tick)
+		{
+			double Start = FPlatformTime::Seconds();
+			for (int32 i = 0; i < PerTick; ++i)
+			{
+				const FSkeletonKey Key(NextKey++);
+				Schedule(Key, Tick + Lifespan);
+			}
+			Result.ScheduleSeconds += FPlatformTime::Seconds() - Start;
+			Result.Scheduled += PerTick;
+
+			//about a third of what's fired hits something, somewhere in the first half of its life. a key can get picked
+			//twice, which is a cancel of something already gone, and that happens in the game too.
+			Hits.Reset();
+			const int32 Recent = static_cast<int32>(FMath::Min<uint64>(NextKey - 1, PerTick * Lifespan / 2));
+			for (int32 i = 0; i < PerTick / 3; ++i)
+			{
+				Hits.Add(FSkeletonKey(NextKey - 1 - Random.RandHelper(Recent)));
+			}
+			Start = FPlatformTime::Seconds();
+			for (const FSkeletonKey& Key : Hits)
+			{
+				Cancel(Key);
+			}
+			Result.CancelSeconds += FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			Result.Expired += Expire(Tick);
+			Result.ExpireSeconds += FPlatformTime::Seconds() - Start;
+		}
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FArtilleryProjectileExpiryBenchmark, "Artillery.Benchmark.ProjectileExpiry",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FArtilleryProjectileExpiryBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace ProjectileExpiryBench;
+	//spawns per tick and lifespan in ticks. with a third hitting something, the last is ~10k live, the autoguns flat out.
+	const int32 Scenes[][2] = {{10, 120}, {30, 240}, {60, 240}};
+	constexpr int32 Ticks = 2048;
+	for (const auto& Scene : Scenes)
+	{
+		FProjectileExpiryWheel Wheel;
+		TArray<FProjectileExpiryWheel::FExpired> WheelOut;
+		const FResult WheelResult = Run(Scene[0], Scene[1], Ticks,
+			[&Wheel](FSkeletonKey Key, int32 Deadline) { Wheel.Schedule(Key, nullptr, Deadline); },
+			[&Wheel](FSkeletonKey Key) { Wheel.Cancel(Key); },
+			[&Wheel, &WheelOut](int32 Now)
+			{
+				WheelOut.Reset();
+				Wheel.Expire(Now, WheelOut);
+				return WheelOut.Num();
+			});
+
+		FSortedDeadlines Sorted;
+		TArray<FSkeletonKey> SortedOut;
+		const FResult SortedResult = Run(Scene[0], Scene[1], Ticks,
+			[&Sorted](FSkeletonKey Key, int32 Deadline) { Sorted.Schedule(Key, Deadline); },
+			[&Sorted](FSkeletonKey Key) { Sorted.Cancel(Key); },
+			[&Sorted, &SortedOut](int32 Now)
+			{
+				SortedOut.Reset();
+				Sorted.Expire(Now, SortedOut);
+				return SortedOut.Num();
+			});
+
+		const double PerSchedule = 1e9 / FMath::Max<int64>(WheelResult.Scheduled, 1);
+		AddInfo(FString::Printf(TEXT("%d/tick, %d tick life (<%d live): wheel schedule %.0fns cancel %.2fms expire %.2fms | sorted map schedule %.0fns cancel %.2fms expire %.2fms"),
+			Scene[0], Scene[1], Scene[0] * Scene[1],
+			WheelResult.ScheduleSeconds * PerSchedule, WheelResult.CancelSeconds * 1000, WheelResult.ExpireSeconds * 1000,
+			SortedResult.ScheduleSeconds * PerSchedule, SortedResult.CancelSeconds * 1000, SortedResult.ExpireSeconds * 1000));
+		TestEqual(FString::Printf(TEXT("both expire the same projectiles at %d/tick"), Scene[0]), WheelResult.Expired, SortedResult.Expired);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FWorldSimOwner.h"
+#include "EPhysicsLayer.h"
+#include "ConservedAttributeStore.h"
+#include "ConservedTagContainer.h"
+
+//Records a session, then goes back and resims the end of it the way FArtilleryBusyWorker::Resim does. Physics goes
+//back to the end of the tick before, attributes to the end of the tick before, and tags to the start of the tick. Then
+//it steps forward again. Every tick is fingerprinted three ways: physics, attributes, and tags. A resim with the same
+//inputs has to come out bit for bit the same. A late input resimmed in has to land exactly where a session that had
+//it on time would have.
+//
+//Headless: it builds its own jolt sim, attribute store, and tag containers, and no world, dispatch, or threads of ours.
+//A sim tears down jolt's global factory on the way out, so run it with -nullrhi, not next to a live barrage dispatch.
+struct FArtilleryResimHarness
+{
+	static constexpr int32 Bodies = 32;
+	//tag codes 1 to 16 come from input. this one's set whenever a body is off the ground.
+	static constexpr uint16 AirborneTag = 20;
+
+	struct FFingerprint
+	{
+		uint32 Physics = 0;
+		uint32 Attributes = 0;
+		uint32 Tags = 0;
+
+		bool operator==(const FFingerprint& Other) const
+		{
+			return Physics == Other.Physics && Attributes == Other.Attributes && Tags == Other.Tags;
+		}
+	};
+
+	//one input word per body per tick.
+	TArray<uint32> Script;
+	TArray<FFingerprint> Prints;
+
+	explicit FArtilleryResimHarness(const TArray<uint32>& InScript)
+		: Script(InScript), Sim(1.0f / 120.0f, [](int) {}), Store(MakeShared<FConservedAttributeStore>())
+	{
+		JPH::BodyInterface& Interface = *Sim.body_interface;
+		JPH::BodyCreationSettings Ground(new JPH::BoxShape(JPH::Vec3(50, 1, 50)), JPH::RVec3(0, -1, 0),
+			JPH::Quat::sIdentity(), JPH::EMotionType::Static, Layers::NON_MOVING);
+		Interface.CreateAndAddBody(Ground, JPH::EActivation::DontActivate);
+
+		//a loose pile, so bodies land on each other and an impulse on one reaches its neighbours through contacts.
+		JPH::RefConst<JPH::Shape> Box = new JPH::BoxShape(JPH::Vec3(0.5f, 0.5f, 0.5f));
+		for (int32 i = 0; i < Bodies; ++i)
+		{
+			JPH::BodyCreationSettings Settings(Box, JPH::RVec3((i % 4) * 1.1f, 0.5f + (i / 16) * 1.2f, ((i / 4) % 4) * 1.1f),
+				JPH::Quat::sIdentity(), JPH::EMotionType::Dynamic, Layers::MOVING);
+			Ids.Add(Interface.CreateAndAddBody(Settings, JPH::EActivation::Activate));
+
+			Arty::AttrPtr Attribute = Store->Allocate(FSkeletonKey(static_cast<uint64>(i + 1)), E_AttribKey::Health);
+			Attribute->SetBaseValue(100.0);
+			Attribute->SetCurrentValue(100.0);
+			Health.Add(Attribute);
+
+			TSharedPtr<FTagStateRepresentation> Bits = MakeShared<FTagStateRepresentation>();
+			TagBits.Add(Bits);
+			Tags.Add(MakeShareable(new FConservedTagContainer(Bits, nullptr, nullptr)));
+		}
+		Sim.OptimizeBroadPhase();
+	}
+
+	static ArtilleryTime NowOf(uint64 Tick) { return 1000 + Tick; }
+	uint64 Ticks() const { return Script.Num() / Bodies; }
+
+	//one busy worker frame: clock, tag layer, inputs, step, then the snapshot the step thread would take.
+	void Step(uint64 Tick, bool CacheTags = true)
+	{
+		Store->SetNow(NowOf(Tick));
+		if (CacheTags)
+		{
+			for (const FConservedTags& Container : Tags)
+			{
+				Container->CacheLayer(NowOf(Tick));
+			}
+		}
+		JPH::BodyInterface& Interface = *Sim.body_interface;
+		for (int32 i = 0; i < Bodies; ++i)
+		{
+			const uint32 Input = Script[Tick * Bodies + i];
+			if (Input & 1)
+			{
+				const JPH::Vec3 Push(((Input >> 1) & 7) - 3.5f, static_cast<float>((Input >> 4) & 7), ((Input >> 7) & 7) - 3.5f);
+				Interface.AddImpulse(Ids[i], Push * 400.0f);
+			}
+			//damage scales with how high the body sits, so attributes follow physics, and a physics desync shows up in
+			//both fingerprints.
+			const int32 Height = FMath::FloorToInt32(Interface.GetPosition(Ids[i]).GetY() * 4.0f);
+			if (Input & (1 << 10))
+			{
+				Health[i]->SetCurrentValue(static_cast<double>(Health[i]->GetCurrentValue() - FMath::Clamp(Height, 0, 8) - 1));
+			}
+			const uint16 Code = 1 + ((Input >> 12) & 15);
+			if (Input & (1 << 11))
+			{
+				TagBits[i]->Add(Code);
+			}
+			else if (Input & (1 << 16))
+			{
+				TagBits[i]->Remove(Code);
+			}
+			if (Height > 3)
+			{
+				TagBits[i]->Add(AirborneTag);
+			}
+			else
+			{
+				TagBits[i]->Remove(AirborneTag);
+			}
+		}
+		Sim.StepSimulation();
+		Sim.Snapshots.Capture(Tick, *Sim.physics_system, nullptr);
+
+		if (Prints.Num() <= static_cast<int32>(Tick))
+		{
+			Prints.SetNum(Tick + 1);
+		}
+		FFingerprint& Print = Prints[Tick];
+		Print.Physics = Sim.Snapshots.Fingerprint(Tick);
+		Print.Attributes = 0;
+		Store->ForEach(E_AttribKey::Health, [&Print](FSkeletonKey Owner, const FConservedAttributeData& Data)
+		{
+			const float Values[2] = {Data.GetCurrentValue(), Data.GetBaseValue()};
+			Print.Attributes = FCrc::MemCrc32(&Owner.Obj, sizeof(Owner.Obj), Print.Attributes);
+			Print.Attributes = FCrc::MemCrc32(Values, sizeof(Values), Print.Attributes);
+		});
+		Print.Tags = 0;
+		for (const TSharedPtr<FTagStateRepresentation>& Bits : TagBits)
+		{
+			FTagBits Now;
+			Bits->Snapshot(Now);
+			Print.Tags = FCrc::MemCrc32(Now.Words, sizeof(Now.Words), Print.Tags);
+		}
+	}
+
+	void Run()
+	{
+		for (uint64 Tick = 0; Tick < Ticks(); ++Tick)
+		{
+			Step(Tick);
+		}
+	}
+
+	//the same rewind the busy worker does, then every tick from From to the end of the script again.
+	bool Resim(uint64 From)
+	{
+		if (!Sim.Snapshots.Restore(From - 1, *Sim.physics_system, nullptr) || !Store->RewindTo(NowOf(From - 1)))
+		{
+			return false;
+		}
+		for (const FConservedTags& Container : Tags)
+		{
+			if (!Container->RewindTo(NowOf(From)))
+			{
+				return false;
+			}
+		}
+		for (uint64 Tick = From; Tick < Ticks(); ++Tick)
+		{
+			//the layer for From survived the rewind, and it's already what we start from.
+			Step(Tick, Tick != From);
+		}
+		return true;
+	}
+
+private:
+	FWorldSimOwner Sim;
+	TSharedPtr<FConservedAttributeStore> Store;
+	TArray<JPH::BodyID> Ids;
+	TArray<Arty::AttrPtr> Health;
+	TArray<TSharedPtr<FTagStateRepresentation>> TagBits;
+	TArray<FConservedTags> Tags;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FArtilleryResimDeterminismTest, "Artillery.Resim.Determinism",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FArtilleryResimDeterminismTest::RunTest(const FString& Parameters)
+{
+	using FFingerprint = FArtilleryResimHarness::FFingerprint;
+	constexpr int32 Ticks = 48;
+	//the tick the late input was really for, and two resim depths. tags only hold ten layers, so nine back is the deepest.
+	constexpr int32 LateTick = 44;
+	constexpr int32 ShallowFrom = 42;
+	constexpr int32 DeepFrom = Ticks - 9;
+
+	FRandomStream Random(0xA27111E);
+	TArray<uint32> OnTime;
+	OnTime.SetNumUninitialized(Ticks * FArtilleryResimHarness::Bodies);
+	for (uint32& Input : OnTime)
+	{
+		//mostly quiet, like real input. a press every so often.
+		Input = Random.RandRange(0, 7) == 0 ? static_cast<uint32>(Random.GetUnsignedInt()) : 0;
+	}
+	//the late press: the first time round, a repeat of nothing covered it.
+	TArray<uint32> Covered = OnTime;
+	for (int32 Body = 0; Body < 4; ++Body)
+	{
+		Covered[LateTick * FArtilleryResimHarness::Bodies + Body] = 0;
+		OnTime[LateTick * FArtilleryResimHarness::Bodies + Body] = 1 | (2 << 1) | (7 << 4) | (1 << 10) | (1 << 11) | (3 << 12);
+	}
+
+	TArray<FFingerprint> FirstPass;
+	TArray<FFingerprint> Resimmed;
+	TArray<FFingerprint> Deeper;
+	{
+		FArtilleryResimHarness Session(Covered);
+		Session.Run();
+		FirstPass = Session.Prints;
+
+		//nothing changed, so nothing may come out different.
+		if (!TestTrue(TEXT("resim with the same inputs restores"), Session.Resim(ShallowFrom)))
+		{
+			return false;
+		}
+		for (int32 Tick = ShallowFrom; Tick < Ticks; ++Tick)
+		{
+			TestTrue(FString::Printf(TEXT("unchanged resim of tick %d is bit identical"), Tick), Session.Prints[Tick] == FirstPass[Tick]);
+		}
+
+		//the real input turns up late, and goes in where the repeat ran.
+		Session.Script = OnTime;
+		if (!TestTrue(TEXT("resim for the late input restores"), Session.Resim(ShallowFrom)))
+		{
+			return false;
+		}
+		Resimmed = Session.Prints;
+
+		//and a second, deeper resim over the first has to leave it alone.
+		if (!TestTrue(TEXT("deeper resim restores"), Session.Resim(DeepFrom)))
+		{
+			return false;
+		}
+		Deeper = Session.Prints;
+	}
+
+	//the same session, had the input been on time.
+	FArtilleryResimHarness Straight(OnTime);
+	Straight.Run();
+
+	TestTrue(TEXT("the late input changes the outcome"), !(Straight.Prints[LateTick] == FirstPass[LateTick]));
+	for (int32 Tick = 0; Tick < Ticks; ++Tick)
+	{
+		const FFingerprint& Want = Straight.Prints[Tick];
+		TestEqual(FString::Printf(TEXT("physics at tick %d matches on-time"), Tick), Resimmed[Tick].Physics, Want.Physics);
+		TestEqual(FString::Printf(TEXT("attributes at tick %d match on-time"), Tick), Resimmed[Tick].Attributes, Want.Attributes);
+		TestEqual(FString::Printf(TEXT("tags at tick %d match on-time"), Tick), Resimmed[Tick].Tags, Want.Tags);
+		TestTrue(FString::Printf(TEXT("deeper resim of tick %d matches on-time"), Tick), Deeper[Tick] == Want);
+	}
+	return true;
+}
+
+#endif
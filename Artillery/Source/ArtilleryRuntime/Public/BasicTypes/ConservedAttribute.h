@@ -7,32 +7,53 @@
 #include "UObject/UnrealType.h"
 #include "Engine/DataTable.h"
 #include "AttributeSet.h"
-#include "Containers/CircularBuffer.h"
 
 #include "ConservedAttribute.generated.h"
 
+class FConservedAttributeStore;
+
+//which value a change landed on. recorded into the attribute store's delta log alongside the tick it happened on.
+enum class EConservedAttributeChannel : uint8
+{
+	Current,
+	Base,
+	Remote
+};
+
 /**
- * Conserved attributes record their last 128 changes.
- * Currently, this is for debug purposes, but we can use it with some additional features to provide a really expressive
- * model for rollback at a SUPER granular level if needed. 
+ * Conserved attributes record their changes into the delta log of the FConservedAttributeStore that allocated them,
+ * stamped with the tick they happened on, so rollback can walk back to any tick still in the log. This used to be
+ * three 128 entry circular buffers per attribute, which was 3k for every single attribute on every single entity,
+ * whether it ever changed or not. Now an attribute is just its values, and only changes cost anything.
+ *
+ * Attributes made outside a store (defaulted, copied, blueprint) work as before, they just don't record anything.
  */
 //TODO: do we need to break the GAS dependency? It's forcing a lot of unneeded stuff.
 USTRUCT(BlueprintType)
 struct ARTILLERYRUNTIME_API FConservedAttributeData : public FGameplayAttributeData
 {
 	GENERATED_BODY()
-	TCircularBuffer<double> CurrentHistory = TCircularBuffer<double>(128);
-	TCircularBuffer<double> RemoteHistory = TCircularBuffer<double>(128);
-	TCircularBuffer<double> BaseHistory = TCircularBuffer<double>(128);
+	friend class FConservedAttributeStore;
+
+	FConservedAttributeData() = default;
+	//a copy is a value, not a second handle on the same slot. it doesn't record.
+	FConservedAttributeData(const FConservedAttributeData& Other) : FGameplayAttributeData(Other), RemoteValue(Other.RemoteValue)
+	{
+	}
+	FConservedAttributeData& operator=(const FConservedAttributeData& Other)
+	{
+		FGameplayAttributeData::operator=(Other);
+		RemoteValue = Other.RemoteValue;
+		return *this;
+	}
 
 	virtual void SetCurrentValue(float NewValue) override {
 		SetCurrentValue(static_cast<double>(NewValue));
 	};
 
 	virtual void SetCurrentValue(double NewValue) {
-		CurrentHistory[CurrentHistory.GetNextIndex(CurrentHead)] = CurrentValue;
+		Record(EConservedAttributeChannel::Current, CurrentValue, NewValue);
 		CurrentValue = NewValue;
-		++CurrentHead;
 	};
 
 	virtual void AddToCurrentValue(double AddValue)
@@ -45,18 +66,19 @@ struct ARTILLERYRUNTIME_API FConservedAttributeData : public FGameplayAttributeD
 	};
 	
 	virtual void SetRemoteValue(double NewValue) {
-		RemoteHistory[RemoteHistory.GetNextIndex(RemoteHead)] = NewValue;
-		++RemoteHead;
+		Record(EConservedAttributeChannel::Remote, RemoteValue, NewValue);
+		RemoteValue = NewValue;
 	};
+
+	double GetRemoteValue() const { return RemoteValue; }
 	
 	virtual void SetBaseValue(float NewValue) override {
 		SetBaseValue(static_cast<double>(NewValue));
 	};
 
 	virtual void SetBaseValue(double NewValue) {
-		BaseHistory[BaseHistory.GetNextIndex(BaseHead)] = BaseValue;
+		Record(EConservedAttributeChannel::Base, BaseValue, NewValue);
 		BaseValue = NewValue;
-		++BaseHead;
 	};
 	
 	double operator*(FConservedAttributeData const& rhs) 
@@ -75,8 +97,13 @@ struct ARTILLERYRUNTIME_API FConservedAttributeData : public FGameplayAttributeD
 	}
 	
 protected:
-	uint64_t BaseHead = 0;
-	uint64_t CurrentHead = 0;
-	uint64_t RemoteHead = 0;
-};
+	//last value the network told us about. not the same thing as current, which is what the sim thinks.
+	double RemoteValue = 0;
+
+private:
+	void Record(EConservedAttributeChannel Channel, double Old, double New) const;
 
+	FConservedAttributeStore* Store = nullptr;
+	uint32 Slot = 0;
+	uint8 Key = 0;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include "CoreMinimal.h"
+#include "SkeletonTypes.h"
+#include "ConservedAttribute.h"
+#include "EAttributes.h"
+
+//one change to one attribute. Old is what the value was before this tick changed it, which is what rollback wants.
+struct FConservedAttributeDelta
+{
+	ArtilleryTime Tick = 0;
+	FSkeletonKey Owner;
+	double Old = 0;
+	double New = 0;
+	uint32 Slot = 0;
+	E_AttribKey Key = E_AttribKey::Speed;
+	EConservedAttributeChannel Channel = EConservedAttributeChannel::Current;
+};
+
+//Backing store for conserved attributes. Every attribute of one type, say Health, lives in the same run of fixed
+//size chunks, indexed by slot, so a pass over every entity's health reads straight down memory instead of chasing a
+//pointer per entity. AttrPtr is still a shared pointer, so nothing reading attributes has to change; the pointer
+//just points into a chunk, and letting go of the last one hands the slot back to the store.
+//
+//History is one delta log shared by every attribute, stamped with the tick each change happened on. Most attributes
+//on most entities don't change most ticks, so this is far smaller than keeping a ring of values per attribute.
+//
+//Allocation and release take a lock, and they're rare. Writes to the log don't: any thread can append, a slot is
+//claimed with one atomic add, and each entry carries a sequence stamp so a reader can tell a torn entry from a good one.
+//ForEach is safe against concurrent allocation, but like the attributes themselves, values can change under it.
+class ARTILLERYRUNTIME_API FConservedAttributeStore : public TSharedFromThis<FConservedAttributeStore>
+{
+public:
+	static constexpr uint32 SlotsPerChunk = 256;
+	//caps each attribute type at 64k live instances. chunk pointers never move, so readers don't need the lock.
+	static constexpr uint32 MaxChunks = 256;
+	//power of two. 64k changes is a good few seconds of the worst ticks we've seen, and ~3 megs.
+	static constexpr uint32 DeltaLogSize = 1 << 16;
+
+	FConservedAttributeStore();
+
+	//null if that attribute type is full.
+	Arty::AttrPtr Allocate(FSkeletonKey Owner, E_AttribKey Key);
+
+	//stamps every change recorded from here on. the busy worker advances it once per cycle.
+	void SetNow(ArtilleryTime Now) { Clock.store(Now, std::memory_order_release); }
+	ArtilleryTime GetNow() const { return Clock.load(std::memory_order_acquire); }
+
+	//every live attribute of one type, in slot order.
+	template <typename Visitor>
+	void ForEach(E_AttribKey Key, Visitor&& Visit) const
+	{
+		const FColumn& Column = Columns[static_cast<uint8>(Key)];
+		const uint32 NumChunks = Column.NumChunks.load(std::memory_order_acquire);
+		for (uint32 c = 0; c < NumChunks; ++c)
+		{
+			const FChunk& Chunk = *Column.Chunks[c];
+			for (uint32 i = 0; i < SlotsPerChunk; ++i)
+			{
+				if (Chunk.Live[i])
+				{
+					Visit(Chunk.Owner[i], Chunk.Data[i]);
+				}
+			}
+		}
+	}
+
+	//newest first, every delta stamped after Since that's still in the log. false if the log has already lapped past
+	//Since, in which case what you got is incomplete.
+	template <typename Visitor>
+	bool ForEachDeltaSince(ArtilleryTime Since, Visitor&& Visit) const
+	{
+		const uint64 Head = DeltaHead.load(std::memory_order_acquire);
+		const uint64 Oldest = Head > DeltaLogSize ? Head - DeltaLogSize : 0;
+		for (uint64 Index = Head; Index > Oldest; --Index)
+		{
+			FConservedAttributeDelta Delta;
+			if (!ReadDelta(Index - 1, Delta))
+			{
+				//still being written, or already overwritten.
+				continue;
+			}
+			if (Delta.Tick <= Since)
+			{
+				return true;
+			}
+			Visit(Delta);
+		}
+		return Oldest == 0;
+	}
+
+	//puts every attribute back the way it was at the end of tick To, by walking the log back. changes made through
+	//here aren't logged. false if the log doesn't reach back that far, and nothing is touched.
+	bool RewindTo(ArtilleryTime To);
+
+	void Record(const FConservedAttributeData& Attribute, EConservedAttributeChannel Channel, double Old, double New);
+
+private:
+	struct FChunk
+	{
+		FConservedAttributeData Data[SlotsPerChunk];
+		FSkeletonKey Owner[SlotsPerChunk];
+		bool Live[SlotsPerChunk] = {};
+	};
+
+	struct FColumn
+	{
+		TArray<TUniquePtr<FChunk>> Chunks;
+		std::atomic<uint32> NumChunks = 0;
+		TArray<uint32> Free;
+	};
+
+	struct FLoggedDelta
+	{
+		//Index + 1 once the entry is whole, so a zeroed entry never reads as valid.
+		std::atomic<uint64> Seq = 0;
+		FConservedAttributeDelta Delta;
+	};
+
+	void Release(E_AttribKey Key, uint32 Slot);
+	FConservedAttributeData* Find(E_AttribKey Key, uint32 Slot, FSkeletonKey Owner);
+	bool ReadDelta(uint64 Index, FConservedAttributeDelta& Out) const;
+
+	FCriticalSection AllocationLock;
+	FColumn Columns[TNumericLimits<uint8>::Max() + 1];
+	std::atomic<ArtilleryTime> Clock = 0;
+	std::atomic<uint64> DeltaHead = 0;
+	TUniquePtr<FLoggedDelta[]> DeltaLog;
+};
@@ -9,7 +9,6 @@
 #include "Templates/SubclassOf.h"
 #include "UObject/UnrealType.h"
 #include "Engine/DataTable.h"
-#include "Containers/CircularBuffer.h"
 
 THIRD_PARTY_INCLUDES_START
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
@@ -22,7 +21,10 @@ THIRD_PARTY_INCLUDES_END
 struct FConservedTagContainer;
 typedef TSharedPtr<FGameplayTagContainer> FS_GameplayTagPtr;
 typedef TSharedPtr<TArray<FGameplayTag>> FTagLayer;
-#define FAST_TAG_MAX_C 30
+//tag codes are bit indices, so this is how many distinct tags the fast path can know about. AtomicTagArray::Init
+//complains if the project has more than this. code 0 is never handed out.
+#define FAST_TAG_BITS 1024
+#define FAST_TAG_WORDS (FAST_TAG_BITS / 64)
 typedef TMap<FGameplayTag, uint16_t> UnderlyingTagMapping;
 typedef TMap<uint16_t, FGameplayTag> UnderlyingTagReverse;
 typedef TSharedPtr<TMap<FGameplayTag, uint16_t>> TagsSeen;
@@ -30,35 +32,76 @@ typedef TSharedPtr<UnderlyingTagReverse> TagsByCode;
 
 typedef TWeakPtr<UnderlyingTagReverse> Flimsy;
 
-//TODO: add tag rollback in Artillery Dispatch
 //TODO: add save-all or copy-all for the tag representations themselves.
 //we don't need the cuckoo hash for rollback, since you can no longer remove or add entities to saved frames.
-//In fact, we technically don't need the atomic either, but it's best to keep the exact TagStateRepresentation.
 //if we switch to true tombstoning, we may be able to change erase so that it only deletes the mapping.
 //that would simplify this design some.
-//It seems likely that a modified generational allocator might actually point a way to success here by allowing us to just copy
-//BLOBBO and to get some better memory contiguity at the same time. Practical max burn here is gonna be 10 megs, which is
-//enough that we could use permanent pooled blocks per tick and avoid all fragmentation as well as closing out ticks trivially once they
-//can't be rolled back.
+
+//a plain, non-atomic tag set. one bit per tag code. this is what snapshots, history, and multi-tag queries are made of.
+struct FTagBits
+{
+	uint64 Words[FAST_TAG_WORDS] = {};
+
+	static bool InRange(uint16 Code) { return Code != 0 && Code < FAST_TAG_BITS; }
+	void Set(uint16 Code) { Words[Code >> 6] |= 1ull << (Code & 63); }
+	void Clear(uint16 Code) { Words[Code >> 6] &= ~(1ull << (Code & 63)); }
+	bool Test(uint16 Code) const { return (Words[Code >> 6] & 1ull << (Code & 63)) != 0; }
+	bool IsEmpty() const
+	{
+		uint64 Any = 0;
+		for (uint64 Word : Words)
+		{
+			Any |= Word;
+		}
+		return Any == 0;
+	}
+	bool operator==(const FTagBits& Other) const { return FMemory::Memcmp(Words, Other.Words, sizeof(Words)) == 0; }
+	bool operator!=(const FTagBits& Other) const { return !(*this == Other); }
+};
 
 //Tag rollback is easier than it looks.
-//We actually just save either the final or starting representation for every entity on a per tick basis.
-//During the StackUp sequence, or another fixed point in the tick, we save ALL state reps
-//in fact, ideally, we save the whole ATA, though it may be better
+//We save every entity's tags once per tick, at a fixed point (CacheLayer, from the busy worker), as the bits that
+//flipped since the last save. Going back is just flipping them back. The busy worker caches tick T's layer before T's
+//inputs and locomotions run, so layer T is the tags as T started, which is also how T-1 left them. Attributes go the
+//other way, stamped with the tick that wrote them, so to put both back to before tick T, rewind attributes to T-1 and
+//tags to T.
+//
+//The live tags are a fixed width bitset. A single tag check is one load and one AND. Single tag adds and removes
+//are one atomic or/and on one word, and also bump a sequence number so Snapshot, and multi-tag checks, can tell if
+//they read the words while something was changing them and try again. Writers take turns on the sequence, so a
+//snapshot never sees half an add.
 struct FTagStateRepresentation
 {
-	uint16_t Tags[FAST_TAG_MAX_C];
-	std::atomic_uint32_t snagged = 0;
+	std::atomic<uint64> Words[FAST_TAG_WORDS];
+	//odd while a write is in progress.
+	std::atomic<uint32> Sequence = 0;
 	TWeakPtr<FConservedTagContainer> AccessRefController;
 	
-	FTagStateRepresentation() : Tags{}
+	FTagStateRepresentation()
 	{
+		for (std::atomic<uint64>& Word : Words)
+		{
+			Word.store(0, std::memory_order_relaxed);
+		}
 	}
 	
 	//This allows a held conserved tag container to be used directly
-	bool Find(uint16 Numerology);
+	bool Find(uint16 Numerology) const
+	{
+		return FTagBits::InRange(Numerology) && (Words[Numerology >> 6].load(std::memory_order_acquire) & 1ull << (Numerology & 63)) != 0;
+	}
 	bool Remove(uint16 Numerology);
 	bool Add(uint16 Numerology);
+	//all of them, or any of them. consistent across words.
+	bool HasAll(const FTagBits& Query) const;
+	bool HasAny(const FTagBits& Query) const;
+	void Snapshot(FTagBits& Out) const;
+	//replaces every tag at once. used by rollback.
+	void Overwrite(const FTagBits& In);
+
+private:
+	void BeginWrite();
+	void EndWrite() { Sequence.fetch_add(1, std::memory_order_release); }
 };
 
 typedef TSharedPtr<FTagStateRepresentation> FTagsPtr;
@@ -79,25 +122,62 @@ struct ARTILLERYRUNTIME_API FConservedTagContainer
 	friend class UArtilleryDispatch;
 	friend class AtomicTagArray;
 	friend class FArtilleryBusyWorker;
+	//the headless resim determinism test caches layers the way the busy worker does.
+	friend struct FArtilleryResimHarness;
 	FConservedTagContainer() = default;
 	virtual ~FConservedTagContainer() = default;
 	friend class AtomicTagArray;
 	constexpr static uint8 RollbackFrames = 10;
 
+	//the tags as they stood when the layer for that tick was cached. null if that tick's out of the window.
 	virtual FTagLayer GetFrameByNumber(uint64_t FrameNumber);
 	virtual bool Find(FGameplayTag Bot);
+	//every tag in the query. build queries once with EncodeQuery and keep them.
+	bool FindAll(const FTagBits& Query) const;
+	bool FindAny(const FTagBits& Query) const;
+	//false if any of the tags isn't one the fast path knows.
+	bool EncodeQuery(const FGameplayTagContainer& In, FTagBits& Out) const;
 	FConservedTags GetReference();
+	//these allocate. they're for tools and debugging, don't put them in a tick.
 	TSharedPtr<TArray<FGameplayTag>> GetAllTags();
 	TSharedPtr<TArray<FGameplayTag>> GetAllTags(uint64_t FrameNumber);
 	virtual bool Remove(FGameplayTag Bot);
 	virtual bool Add(FGameplayTag Bot);
 	
 	Flimsy DecoderRing; // use at your own risk, but you might need this in some really narrow cases.
+
+	//the tags as they stood at the start of Tick, when its layer was cached. false if Tick is out of the window.
+	bool GetBitsAtTick(uint64_t Tick, FTagBits& Out) const;
+	//puts the live tags back to how they stood at the start of Tick, and drops the history after it.
+	bool RewindTo(uint64_t Tick);
 	
 protected:
-	virtual void CacheLayer();
-	
-	TCircularBuffer<FTagLayer> CurrentHistory = TCircularBuffer<FTagLayer>(RollbackFrames);
+	//called once per tick, from the busy worker only. history is only ever touched from there, so it takes no locks.
+	//caching a tick that's already held replaces it, and anything after it, so a resim can't hold a tick twice.
+	//only allocates when the history needs more changed words than it has ever held at once.
+	virtual void CacheLayer(uint64_t Tick);
+
+	//one cached tick, as the words that changed since the one before it. Changed has a bit per word, and the xor for
+	//each changed word sits in FlipPool, in word order, starting at FlipsAt. most ticks, for most entities, Changed is
+	//zero and the layer owns no words at all.
+	struct FTagDelta
+	{
+		uint64_t Tick = 0;
+		uint32 FlipsAt = 0;
+		uint16 Changed = 0;
+	};
+	static_assert(FAST_TAG_WORDS <= 16, "FTagDelta::Changed needs a bit per word.");
+
+	FTagDelta CurrentHistory[RollbackFrames];
+	//ring of changed words shared by every held layer. layers own consecutive runs of it, oldest first, and positions
+	//count up forever and get masked in. empty until the first tag changes. the size is always a power of two.
+	TArray<uint64> FlipPool;
+	//where the next layer's words go.
+	uint32 FlipHead = 0;
+	//how many layers in CurrentHistory are live. a rewind can drop layers, and the slots they overwrote don't come back.
+	uint32 HeldLayers = 0;
+	//what the newest layer cached. deltas are applied backward from here.
+	FTagBits LastCached;
 	
 	FConservedTagContainer(TSharedPtr<FTagStateRepresentation> Bind, TagsByCode TagsKnown, TagsSeen TagsSeen)
 	{
@@ -107,8 +187,15 @@ protected:
 	}
 
 private:
+	TSharedPtr<TArray<FGameplayTag>> Decode(const FTagBits& Bits) const;
+	const FTagDelta& Newest() const { return CurrentHistory[(CurrentWriteHead - 1) % RollbackFrames]; }
+	//undoes one layer's flips.
+	void Unflip(const FTagDelta& Layer, FTagBits& Bits) const;
+	void DropNewest();
+
 	TWeakPtr<FConservedTagContainer> AccessRefController;
 	TSharedPtr<FTagStateRepresentation> Tags;
+	//number of layers cached, less any a rewind dropped. the newest is at (CurrentWriteHead - 1) % RollbackFrames.
 	uint64_t CurrentWriteHead = 0;
 	TagsSeen SeenT;
-};
\ No newline at end of file
+};
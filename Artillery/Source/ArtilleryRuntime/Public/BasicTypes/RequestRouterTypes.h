@@ -7,6 +7,8 @@
 
 #include "RequestRouterTypes.generated.h"
 
+struct FArtilleryGun;
+
 enum ArtilleryRequestType
 {
 	FireAGun,
@@ -43,7 +45,7 @@ struct ARTILLERYRUNTIME_API FRequestThing
 		Type = MyType;
 	}
 	
-	ArtilleryRequestType GetType()
+	ArtilleryRequestType GetType() const
 	{
 		return Type;
 	}
@@ -83,6 +85,39 @@ struct ARTILLERYRUNTIME_API FRequestGameThreadThing : public FRequestThing//Fric
 	}
 };
 
+//a gun that's been allocated and keyed, but not initialized, since initializing touches uobjects.
+struct FPreparedGun
+{
+	TSharedPtr<FArtilleryGun> Gun;
+	FGunKey Key;
+};
+
+//Game thread requests, already drained, ordered, and grouped by the busy worker. The game thread just walks the runs.
+//Requests are sorted by stamp, then by type, then by the entity they're about, so every client runs the same requests
+//in the same order no matter which thread's feed they came in on. Each run is one type on one tick, so the game thread
+//does all of a kind at once instead of bouncing between subsystems per request.
+struct FRoutedGameThreadBatch
+{
+	struct FRun
+	{
+		ArtilleryRequestType Type;
+		int32 Begin = 0;
+		int32 End = 0;
+	};
+	
+	TArray<FRequestGameThreadThing> Requests;
+	//parallel to Requests. only filled in for GetAnUnboundGun.
+	TArray<FPreparedGun> Guns;
+	TArray<FRun> Runs;
+
+	void Reset()
+	{
+		Requests.Reset();
+		Guns.Reset();
+		Runs.Reset();
+	}
+};
+
 USTRUCT()
 struct ARTILLERYRUNTIME_API FGrantWith
 {
@@ -38,6 +38,8 @@ public:
 	FGunKey MyGunKey;
 	ActorKey MyProbableOwner;
 	bool ReadyToFire = false;
+	//made by the gun pool or the loader, so safe to hand back to the pool. guns built by hand aren't.
+	bool Poolable = false;
 	
 	UArtilleryDispatch* MyDispatch;
 	UTransformDispatch* MyTransformDispatch;
@@ -175,6 +177,20 @@ public:
 
 	void SetGunKey(FGunKey NewKey);
 
+	//makes any abilities not handed in. needs the game thread. safe to call again, it only does anything the first time.
+	void PrepareAbilities(
+		UArtilleryPerActorAbilityMinimum* PF = nullptr,
+		UArtilleryPerActorAbilityMinimum* PFC = nullptr,
+		UArtilleryPerActorAbilityMinimum* F = nullptr,
+		UArtilleryPerActorAbilityMinimum* FC = nullptr,
+		UArtilleryPerActorAbilityMinimum* PtF = nullptr,
+		UArtilleryPerActorAbilityMinimum* PtFc = nullptr,
+		UArtilleryPerActorAbilityMinimum* FFC = nullptr);
+
+	//puts a gun back the way the pool found it, minus the abilities, which are kept. if your gun keeps state of its
+	//own, override this, clear it, and call up.
+	virtual void ResetForPool();
+
 	FArtilleryGun();
 
 	//TODO: Refactor to take hit-entity key as well.
@@ -41,7 +41,12 @@ struct ARTILLERYRUNTIME_API FAttributeMap
 		//maybe we can fix it without going through a full cert using a data only update.
 		for(TPair<AttribKey, double> x : DefaultAttributesIn)
 		{
-			TSharedPtr<FConservedAttributeData>& NewData = MyAttributes->Add(x.Key, MakeShareable(new FConservedAttributeData));
+			AttrPtr Allocated = MyDispatch->GetAttributeStore()->Allocate(ParentKey, x.Key);
+			if (!Allocated)
+			{
+				continue;
+			}
+			TSharedPtr<FConservedAttributeData>& NewData = MyAttributes->Add(x.Key, Allocated);
 			NewData->SetBaseValue(x.Value);
 			NewData->SetCurrentValue(x.Value);
 		}
@@ -69,8 +69,403 @@ namespace Ticklites
 
 namespace Arty
 {
-	typedef TPair<TSharedPtr<TicklitePrototype>, TicklitePhase> StampLiteRequest;
-	typedef TArray< TSharedPtr<TicklitePrototype>> TickliteGroup;
+	struct FTickliteSchedule;
+
+	//Every live pooled ticklite of one type, in one phase, laid out contiguously and in the order they were added.
+	//The worker makes one virtual call per lane per pass, and the lane runs its whole array without any. Expiry
+	//compacts in place, keeping order, so the order ticklites run in only depends on the order they were added.
+	//Calculate takes a range so a pass can be split up; everything else is worker thread only.
+	//
+	//Lanes own their ticklites by value, so they can be rewound. Only ticklites that were due get touched by an apply,
+	//so each apply records a copy of just those, as they stood going in, and Save files that record. Every adoption is
+	//journaled. Restore undoes applies newest first, back to the newest save from before a tick, then re-adopts
+	//everything journaled since, in the order it first went in. A ticklite that expired in the rewound ticks comes back
+	//and expires again, OnExpiration and all, so that should only touch rewound state too.
+	//Calc state isn't recorded: calc only writes what StateReset clears, and a replay calcs before it applies.
+	//how many applies back a lane can be rewound.
+	static constexpr int32 TickliteSaveDepth = 32;
+
+	struct ITickliteLane
+	{
+		virtual int32 Adopt(TicklitePrototype* Staged, const FTickliteSchedule& Schedule) = 0;
+		//both go by artillery frame, for schedules. saves go by time, same as everything else that rewinds.
+		virtual void Calculate(uint64 UpcomingFrame, int32 Begin, int32 End) = 0;
+		virtual void Apply(uint64 Frame) = 0;
+		//call after the apply for Tick.
+		virtual void Save(ArtilleryTime Tick) = 0;
+		//puts the lane back how it stood going into the apply for Tick. false, with nothing changed, if the saves
+		//don't reach back that far.
+		virtual bool Restore(ArtilleryTime Tick) = 0;
+		virtual int32 Num() const = 0;
+		//drops everything without expiring it, saves and journal included.
+		virtual void Empty() = 0;
+		virtual ~ITickliteLane() = default;
+	};
+
+	//Pools hand ticklites out of slabs and take them back when they're done with, so a mass ticklite (resolvers,
+	//timers, spread fire) costs no heap allocation once the pool's warm. see Ticklites::TicklitePool.
+	//Pooled ticklites only sit in the slab between being requested and the worker adopting them into their lane.
+	struct ITicklitePool
+	{
+		virtual void Release(TicklitePrototype* Done) = 0;
+		virtual TUniquePtr<ITickliteLane> MakeLane() = 0;
+		virtual ~ITicklitePool() = default;
+	};
+
+	//When the ticklites worker bothers with a ticklite. On ticks it isn't due, it isn't calculated, applied, or checked
+	//for expiry, so skipping costs one branch and no virtual call.
+	//Both count artillery frames, the busy worker's frame number, which goes up by exactly one per frame it runs and
+	//which a resim replays with the same numbers. ArtilleryTime is microseconds, so it can't be used for this.
+	//Every is aligned to the frame number, not to when the ticklite was added, so cadences line up across a group.
+	//Delay is relative to the frame the worker adds it on: nothing runs until that many frames have passed.
+	//The default, every frame with no delay, is what every ticklite did before schedules existed.
+	struct FTickliteSchedule
+	{
+		uint32 Every = 1;
+		uint32 Delay = 0;
+		uint64 NotBefore = 0; //the first frame it's due on. set by the worker from Delay.
+
+		bool IsDue(uint64 Frame) const
+		{
+			return Frame >= NotBefore && (Every <= 1 || Frame % Every == 0);
+		}
+	};
+
+	//How a ticklite gets to the worker, and how shared ticklites are held once there. Either a shared pointer, for
+	//ticklites someone else also keeps a hand on, or a pooled ticklite the worker moves into its lane and owns outright.
+	//Adds that arrive for the same tick are sorted by SortKey before they're added, ties keeping arrival order, so
+	//give it the owning entity's key wherever you have one.
+	struct FTickliteHandle
+	{
+		TicklitePrototype* Raw = nullptr;
+		ITicklitePool* Pool = nullptr;
+		TSharedPtr<TicklitePrototype> Shared;
+		FTickliteSchedule Schedule;
+		uint64 SortKey = 0;
+
+		FTickliteHandle() = default;
+		FTickliteHandle(TSharedPtr<TicklitePrototype> InShared, FTickliteSchedule InSchedule = FTickliteSchedule())
+		: Raw(InShared.Get()), Shared(MoveTemp(InShared)), Schedule(InSchedule)
+		{
+		}
+		FTickliteHandle(TicklitePrototype* Pooled, ITicklitePool* From, FTickliteSchedule InSchedule = FTickliteSchedule(), uint64 InSortKey = 0)
+		: Raw(Pooled), Pool(From), Schedule(InSchedule), SortKey(InSortKey)
+		{
+		}
+
+		bool IsValid() const { return Raw != nullptr; }
+		TicklitePrototype* operator->() const { return Raw; }
+
+		//worker only, once the ticklite has expired or been adopted.
+		void Release()
+		{
+			if (Pool)
+			{
+				Pool->Release(Raw);
+			}
+			Shared.Reset();
+			Raw = nullptr;
+			Pool = nullptr;
+		}
+	};
+
+	typedef TPair<FTickliteHandle, TicklitePhase> StampLiteRequest;
+	typedef TArray<FTickliteHandle> TickliteGroup;
 	typedef TCircularQueue<StampLiteRequest> TickliteRequests;
 	typedef TSharedPtr<TCircularQueue<StampLiteRequest>> TickliteBuffer;
 }
+
+namespace Ticklites
+{
+	template <typename YourImplementation>
+	class TickliteLane final : public Arty::ITickliteLane
+	{
+	public:
+		using LaneTicklite = Ticklite<YourImplementation>;
+
+		virtual int32 Adopt(Arty::TicklitePrototype* Staged, const Arty::FTickliteSchedule& Schedule) override
+		{
+			const LaneTicklite& Adopted = *static_cast<LaneTicklite*>(Staged);
+			Journal.Add(FAdopted{AdoptedTotal++, Adopted, Schedule});
+			Schedules.Add(Schedule);
+			return Items.Add(Adopted);
+		}
+
+		//calc has no side effects outside the ticklite itself, so disjoint ranges can run at once.
+		virtual void Calculate(uint64 UpcomingFrame, int32 Begin, int32 End) override
+		{
+			for (int32 i = Begin; i < End; ++i)
+			{
+				LaneTicklite& Tickable = Items[i];
+				//expired ones get expired in apply, as that's a mutating op. they just don't calc.
+				if (Schedules[i].IsDue(UpcomingFrame) && !Tickable.Core.TICKLITE_CheckForExpiration())
+				{
+					Tickable.Core.TICKLITE_StateReset();
+					Tickable.Core.TICKLITE_Calculate();
+				}
+			}
+		}
+
+		virtual void Apply(uint64 Frame) override
+		{
+			int32 Kept = 0;
+			const int32 Count = Items.Num();
+			Building.CountBefore = Count;
+			Building.KeptFromSave = NumAtSave;
+			Building.Touched.Reset();
+			Building.Images.Reset();
+			for (int32 i = 0; i < Count; ++i)
+			{
+				LaneTicklite& Tickable = Items[i];
+				if (Schedules[i].IsDue(Frame))
+				{
+					const bool Expiring = Tickable.Core.TICKLITE_CheckForExpiration();
+					//the only ticklites this apply changes, so the only ones an undo needs.
+					Building.Touched.Add(FTouched{i, Schedules[i], Expiring});
+					Building.Images.Add(Tickable);
+					if (Expiring)
+					{
+						Tickable.Core.TICKLITE_OnExpiration();
+						Tickable.LaneTicklite::ReturnToPool();
+						continue;
+					}
+					Tickable.Core.TICKLITE_Apply();
+				}
+				//stable compaction. survivors slide down over the expired, and nobody changes places.
+				if (Kept != i)
+				{
+					Items[Kept] = MoveTemp(Items[i]);
+					Schedules[Kept] = Schedules[i];
+				}
+				++Kept;
+			}
+			if (Kept != Count)
+			{
+				Items.RemoveAt(Kept, Count - Kept, EAllowShrinking::No);
+				Schedules.RemoveAt(Kept, Count - Kept, EAllowShrinking::No);
+			}
+		}
+
+		virtual void Save(ArtilleryTime Tick) override
+		{
+			if (Held == Arty::TickliteSaveDepth)
+			{
+				//the oldest record goes. nothing can be restored to before the save it undoes back to now, so adoptions
+				//older than that are in every state we can still reach.
+				--Held;
+				const uint64 Oldest = Records[(Head - Held) % Arty::TickliteSaveDepth].Prev.Adopted;
+				const int32 Stale = Journal.IndexOfByPredicate([Oldest](const FAdopted& Entry) { return Entry.Ordinal >= Oldest; });
+				Journal.RemoveAt(0, Stale == INDEX_NONE ? Journal.Num() : Stale, EAllowShrinking::No);
+			}
+			//the record takes over what Building gathered, and Building gets the evicted record's arrays to reuse.
+			FApplied& Record = Records[Head % Arty::TickliteSaveDepth];
+			Swap(Record, Building);
+			Record.Tick = Tick;
+			Record.Prev = Base;
+			++Head;
+			++Held;
+			Base = FSavePoint{Tick, AdoptedTotal, false};
+			NumAtSave = Items.Num();
+		}
+
+		virtual bool Restore(ArtilleryTime Tick) override
+		{
+			//undo every apply saved at or after Tick. what's left is the lane as of the save before the oldest of them.
+			uint32 Undo = 0;
+			while (Undo < Held && Records[(Head - 1 - Undo) % Arty::TickliteSaveDepth].Tick >= Tick)
+			{
+				++Undo;
+			}
+			const FSavePoint Reached = Undo == 0 ? Base : Records[(Head - Undo) % Arty::TickliteSaveDepth].Prev;
+			if (!Reached.Origin && Reached.Tick >= Tick)
+			{
+				//that save's been evicted, so we can't get back to before Tick.
+				return false;
+			}
+
+			//adoptions since the last save come back from the journal with everything else.
+			Items.RemoveAt(NumAtSave, Items.Num() - NumAtSave, EAllowShrinking::No);
+			Schedules.RemoveAt(NumAtSave, Schedules.Num() - NumAtSave, EAllowShrinking::No);
+			for (uint32 i = 0; i < Undo; ++i)
+			{
+				UndoApply(Records[(Head - 1 - i) % Arty::TickliteSaveDepth]);
+			}
+			Head -= Undo;
+			Held -= Undo;
+			Base = Reached;
+			NumAtSave = Items.Num();
+			for (const FAdopted& Entry : Journal)
+			{
+				if (Entry.Ordinal >= Reached.Adopted)
+				{
+					Items.Add(Entry.Ticklite);
+					Schedules.Add(Entry.Schedule);
+				}
+			}
+			return true;
+		}
+
+		virtual int32 Num() const override { return Items.Num(); }
+
+		virtual void Empty() override
+		{
+			Items.Empty();
+			Schedules.Empty();
+			Journal.Empty();
+			AdoptedTotal = 0;
+			for (FApplied& Record : Records)
+			{
+				Record = FApplied();
+			}
+			Building = FApplied();
+			Head = 0;
+			Held = 0;
+			Base = FSavePoint();
+			NumAtSave = 0;
+		}
+
+	private:
+		//a state the lane can be put back to: right after the save for Tick, before anything adopted since.
+		struct FSavePoint
+		{
+			ArtilleryTime Tick = 0;
+			//adoptions there had been by then.
+			uint64 Adopted = 0;
+			//before the first save. the lane was empty, and the journal has everything.
+			bool Origin = true;
+		};
+		struct FTouched
+		{
+			int32 Index;
+			Arty::FTickliteSchedule Schedule;
+			bool Expired;
+		};
+		//one apply, as what it touched. Images[i] is the ticklite at Touched[i].Index, as it went into the apply.
+		struct FApplied
+		{
+			ArtilleryTime Tick = 0;
+			FSavePoint Prev;
+			int32 CountBefore = 0;
+			//of those, how many were there at the save before. the rest were adopted in between.
+			int32 KeptFromSave = 0;
+			TArray<FTouched> Touched;
+			TArray<LaneTicklite> Images;
+		};
+		struct FAdopted
+		{
+			uint64 Ordinal;
+			LaneTicklite Ticklite;
+			Arty::FTickliteSchedule Schedule;
+		};
+
+		//turns the lane as it stood after Applied back into how it stood after the save before it. untouched ticklites
+		//kept their order through compaction, so they slot back in between the touched ones.
+		void UndoApply(FApplied& Applied)
+		{
+			TArray<LaneTicklite> Before;
+			TArray<Arty::FTickliteSchedule> BeforeSchedules;
+			Before.Reserve(Applied.CountBefore);
+			BeforeSchedules.Reserve(Applied.CountBefore);
+			int32 After = 0;
+			int32 Next = 0;
+			for (int32 i = 0; i < Applied.CountBefore; ++i)
+			{
+				if (Next < Applied.Touched.Num() && Applied.Touched[Next].Index == i)
+				{
+					Before.Add(MoveTemp(Applied.Images[Next]));
+					BeforeSchedules.Add(Applied.Touched[Next].Schedule);
+					After += Applied.Touched[Next].Expired ? 0 : 1;
+					++Next;
+				}
+				else
+				{
+					Before.Add(MoveTemp(Items[After]));
+					BeforeSchedules.Add(Schedules[After]);
+					++After;
+				}
+			}
+			Before.RemoveAt(Applied.KeptFromSave, Before.Num() - Applied.KeptFromSave, EAllowShrinking::No);
+			BeforeSchedules.RemoveAt(Applied.KeptFromSave, BeforeSchedules.Num() - Applied.KeptFromSave, EAllowShrinking::No);
+			Items = MoveTemp(Before);
+			Schedules = MoveTemp(BeforeSchedules);
+		}
+
+		TArray<LaneTicklite> Items;
+		TArray<Arty::FTickliteSchedule> Schedules;
+		//a ring of the last TickliteSaveDepth applies. the newest is at (Head - 1) % TickliteSaveDepth.
+		FApplied Records[Arty::TickliteSaveDepth];
+		uint32 Head = 0;
+		uint32 Held = 0;
+		//what the apply in progress has touched. Save files it.
+		FApplied Building;
+		//the save the lane is currently built on, and how many ticklites it had then.
+		FSavePoint Base;
+		int32 NumAtSave = 0;
+		//every adoption since the oldest state we can still restore to, oldest first, as it was before it ever ran.
+		TArray<FAdopted> Journal;
+		uint64 AdoptedTotal = 0;
+	};
+
+	//One per ticklite type. A pooled ticklite is built in place in a fixed size slab, then copied into its lane by the
+	//worker, which gives the slab slot back. Slabs are never given back, so the pool's size is its high water mark,
+	//and that's only the ticklites in flight between a request and the next worker cycle.
+	//Acquire and Release take a lock, but it's held for a pop or a push, nothing more.
+	//
+	//The pool is a process lifetime static, so it outlives every worker that could still be holding its ticklites.
+	template <typename YourImplementation>
+	class TicklitePool final : public Arty::ITicklitePool
+	{
+	public:
+		using PooledTicklite = Ticklite<YourImplementation>;
+		static constexpr int32 SlabSize = 256;
+
+		static TicklitePool& Get()
+		{
+			static TicklitePool Pool;
+			return Pool;
+		}
+
+		PooledTicklite* Acquire(const YourImplementation& Impl)
+		{
+			void* Memory;
+			{
+				FScopeLock Lock(&PoolLock);
+				if (Free.IsEmpty())
+				{
+					FSlab& Slab = *Slabs.Emplace_GetRef(MakeUnique<FSlab>());
+					//backwards, so the slab hands out front to back.
+					for (int32 i = SlabSize - 1; i >= 0; --i)
+					{
+						Free.Add(&Slab.Items[i]);
+					}
+				}
+				Memory = Free.Pop(EAllowShrinking::No);
+			}
+			return new (Memory) PooledTicklite(Impl);
+		}
+
+		virtual void Release(Arty::TicklitePrototype* Done) override
+		{
+			PooledTicklite* Typed = static_cast<PooledTicklite*>(Done);
+			Typed->ReturnToPool();
+			Typed->~PooledTicklite();
+			FScopeLock Lock(&PoolLock);
+			Free.Add(Typed);
+		}
+
+		virtual TUniquePtr<Arty::ITickliteLane> MakeLane() override
+		{
+			return MakeUnique<TickliteLane<YourImplementation>>();
+		}
+
+	private:
+		struct FSlab
+		{
+			TTypeCompatibleBytes<PooledTicklite> Items[SlabSize];
+		};
+
+		FCriticalSection PoolLock;
+		TArray<TUniquePtr<FSlab>> Slabs;
+		TArray<void*> Free;
+	};
+}
@@ -137,6 +137,16 @@ public:
 		SwarmKineManager->CleanupInstance(Target);
 	}
 
+	// Same rules as CleanupInstance.
+	void CleanupInstances(TConstArrayView<FSkeletonKey> Targets)
+	{
+		for (const FSkeletonKey& Target : Targets)
+		{
+			TransformDispatch->ReleaseKineByKey(Target);
+		}
+		SwarmKineManager->CleanupInstances(Targets);
+	}
+
 private:
 	void CreateNewInstanceWithKeyInternal(FSkeletonKey ProjectileKey, const FTransform& WorldTransform, const FVector3d& MuzzleVelocity, const uint16_t Layer, float Scale) const
 	{
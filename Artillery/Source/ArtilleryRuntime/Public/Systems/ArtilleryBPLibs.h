@@ -513,7 +513,7 @@ public:
 
 		UTimerTickliteHandlerComponent* TimerComponent = Cast<UTimerTickliteHandlerComponent>(NewTimerTickliteComponent);
 		FTTimer TimerTicklite(TimerComponent, LifetimeInTicks);
-		UArtilleryDispatch::SelfPtr->RequestAddTicklite(MakeShareable(new TL_Timer(TimerTicklite)), Early);
+		UArtilleryDispatch::SelfPtr->RequestAddPooledTicklite<TL_Timer>(TimerTicklite, Early);
 		return TimerComponent;
 	}
 
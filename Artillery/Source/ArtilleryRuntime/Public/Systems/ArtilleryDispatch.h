@@ -8,6 +8,9 @@
 #include "UCablingWorldSubsystem.h"
 #include "ArtilleryCommonTypes.h"
 #include "AtomicTagArray.h"
+#include "ConservedAttributeStore.h"
+#include "KeyedSlabRegistry.h"
+#include "ArtilleryGunPool.h"
 #include "FArtilleryStateTreesThread.h"
 #include "Containers/TripleBuffer.h"
 #include "FArtilleryBusyWorker.h"
@@ -82,6 +85,15 @@ namespace Arty
 	typedef TSharedPtr<FGameplayTagContainer> GameplayTagContainerPtr;
 	
 	typedef TSharedPtr<FGameplayTagContainer> GameplayTagContainerPtrInternal;
+
+	//everything dispatch knows about one gun. the firing function gets bound before the gun itself is added, and a
+	//released gun keeps its firing function, so either can be empty.
+	struct FArtilleryGunRecord
+	{
+		TSharedPtr<FArtilleryGun> Gun;
+		FArtilleryFireGunFromDispatch Fire;
+	};
+	typedef TKeyedSlabRegistry<FArtilleryGunRecord> FArtilleryGunRegistry;
 }
 
 class UCanonicalInputStreamECS;
@@ -105,12 +117,16 @@ public:
 		GameplayTagContainerToDataMapping = MakeShareable(new AtomicTagArray());
 		RequestorQueue_Abilities_TripleBuffer = MakeShareable(new BufferedEvents());
 		RequestorQueue_Locomos = MakeShareable(new BufferedMoveEvents());
-		GunToFiringFunctionMapping = MakeShareable(new TMap<FGunKey, FArtilleryFireGunFromDispatch>());
+		GunRegistry = MakeShareable(new FArtilleryGunRegistry());
+		PooledGuns = MakeShareable(new FArtilleryGunPool());
 		AttributeSetToDataMapping = MakeShareable(new AttrCuckoo());
+		AttributeStore = MakeShareable(new FConservedAttributeStore());
 		IdentSetToDataMapping = MakeShareable(new IdentCuckoo());
-		KeyToControlliteMapping = MakeShareable(new TMap<FSkeletonKey, Machlet>());
+		KeyToControlliteMapping = MakeShareable(new TKeyedSlabRegistry<Machlet>(1 << 8, 1));
 		VectorSetToDataMapping = MakeShareable(new TMap<FSkeletonKey, Attr3MapPtr>());
-		GunByKey = MakeShareable(new TMap<FSkeletonKey, TSharedPtr<FArtilleryGun>>());
+		RoutedToGameThread = MakeShareable(new TCircularQueue<TSharedPtr<FRoutedGameThreadBatch>>(256));
+		RoutedBatchesToRecycle = MakeShareable(new TCircularQueue<TSharedPtr<FRoutedGameThreadBatch>>(256));
+		ActionsToReconcile = MakeShareable(new TCircularQueue<std::pair<ArtilleryTime, EventBufferInfo>>(1024));
 	};
 	
 	// dependencies expressed: ALL(transform pillar, cabling, bristlecone, input pillar, barrage) -> this.
@@ -122,6 +138,10 @@ public:
 	TSharedPtr<F_INeedA> RequestRouter;
 
 	ArtilleryTime GetShadowNow() const { return ArtilleryAsyncWorldSim.TickliteNow; }
+	//busy worker frame number for GetShadowNow. ticklite schedules count these.
+	uint64 GetShadowFrame() const { return ArtilleryAsyncWorldSim.TickliteFrame.load(std::memory_order_acquire); }
+	//where every conserved attribute lives. allocate attributes through this, not with new.
+	TSharedPtr<FConservedAttributeStore> GetAttributeStore() const { return AttributeStore; }
 	
 	void REGISTER_ENTITY_FINAL_TICK_RESOLVER(const ActorKey& Self);
 	void REGISTER_PROJECTILE_FINAL_TICK_RESOLVER(uint32 MaximumLifespanInTicks, const FSkeletonKey& Self);
@@ -163,8 +183,8 @@ protected:
 	virtual void Deinitialize() override;
 	TSharedPtr<FWorldSimOwner> HoldOpen;
 	
-	//TODO: this needs to be switched over to LibCuckoo. It's a little more delicate than the others, though.
-	TSharedPtr<TMap<FGunKey, FArtilleryFireGunFromDispatch>> GunToFiringFunctionMapping;
+	//guns and their firing functions, keyed by the gun's skeleton key. read from anywhere, without locks.
+	TSharedPtr<FArtilleryGunRegistry> GunRegistry;
 	TSharedPtr<BufferedEvents> RequestorQueue_Abilities_TripleBuffer;
 
 	//This is more straightforward than the guns problem.
@@ -172,9 +192,10 @@ protected:
 	FArtilleryUpdateEnemyControllerSubsystem EnemyUpdateHook;
 	FArtilleryAddEnemyToControllerSubsystem EnemyRegisterHook;
 	TSharedPtr<AttrCuckoo> AttributeSetToDataMapping;
+	TSharedPtr<FConservedAttributeStore> AttributeStore;
 	//TODO: Figure out how to apply the learnings from the design of the controller with the defaulting.
 	//It'll be necessary, I'm afraid. This can't use raw pointers safely. Likely we can use defaulting + the fblet design.
-	TSharedPtr<TMap<FSkeletonKey, Machlet>> KeyToControlliteMapping;
+	TSharedPtr<TKeyedSlabRegistry<Machlet>> KeyToControlliteMapping;
 	TSharedPtr<IdentCuckoo> IdentSetToDataMapping;
 	TSharedPtr<TMap<FSkeletonKey, Attr3MapPtr>> VectorSetToDataMapping;
 	
@@ -195,6 +216,16 @@ protected:
 	
 	Attr3MapPtr GetVectorSetShadowByObjectKey(const FSkeletonKey& Target, ArtilleryTime Now) const;
 	void ProcessRequestRouterGameThread();
+	//busy worker only. drains, orders, and prepares the game thread requests, then hands them over as one batch.
+	void StageRequestRouterGameThread();
+	void RunRoutedRequests(const FRoutedGameThreadBatch& Batch, const FRoutedGameThreadBatch::FRun& Run);
+	//busy worker to game thread, and the spent batches back again so staging never allocates after warm up.
+	TSharedPtr<TCircularQueue<TSharedPtr<FRoutedGameThreadBatch>>> RoutedToGameThread;
+	TSharedPtr<TCircularQueue<TSharedPtr<FRoutedGameThreadBatch>>> RoutedBatchesToRecycle;
+	//busy worker only. what's been staged but not yet handed over, if the game thread has fallen behind.
+	TSharedPtr<FRoutedGameThreadBatch> StagingBatch;
+	FRoutedGameThreadBatch Incoming;
+	TArray<int32> IncomingOrder;
 
 	TSharedPtr<BufferedMoveEvents> RequestorQueue_Locomos;
 	static inline long long TotalFirings = 0; //2024 was rough.
@@ -203,12 +234,18 @@ protected:
 	virtual TStatId GetStatId() const override;
 	//you don't wanna look at this.
 	FGunKey GetGun(const FString& GunDefinitionID, const ActorKey& ProbableOwner) const;
+	//GetGun, split at the uobject line. prepare allocates the gun and mints its key and is safe off the game thread.
+	//bind initializes it, which isn't.
+	FPreparedGun PrepareGun(const FString& GunDefinitionID, const ActorKey& ProbableOwner) const;
+	FGunKey BindPreparedGun(const FPreparedGun& Prepared, const ActorKey& ProbableOwner) const;
 	
 	//fully specifying the type is necessary to prevent spurious warnings in some cases.
 	TSharedPtr<TCircularQueue<std::pair<FGunKey, ArtilleryTime>>> ActionsToOrder;
-	//These two are the backbone of the Artillery gun lifecycle.
-	TSharedPtr< TMap<FSkeletonKey, TSharedPtr<FArtilleryGun>>> GunByKey;
-	TMultiMap<FString, TSharedPtr<FArtilleryGun>> PooledGuns;
+	//This and the gun registry are the backbone of the Artillery gun lifecycle.
+	//guns waiting to be handed out again. prewarmed at world begin play, refilled a few a frame.
+	TSharedPtr<FArtilleryGunPool> PooledGuns;
+	//runs the gun's firing function, if it has one bound. true if it ran.
+	bool FireGunFromRegistry(const FGunKey& Key, bool InputAlreadyUsedOnce, const EventBufferInfo& FiringAction) const;
 	
 	/**
 	 * Will hold the configuration for the gun definitions
@@ -219,10 +256,11 @@ protected:
 	//Note: https://www.reddit.com/r/unrealengine/comments/160mjkx/how_reliable_and_scalable_are_the_data_tables/
 	void LoadGunData();
 	
-	TSharedPtr<TCircularQueue<std::pair<FGunKey, ArtilleryTime>>> ActionsToReconcile;
+	//gun events a resim matched, waiting for the game thread. they've been seen once already, so they rerun as such.
+	TSharedPtr<TCircularQueue<std::pair<ArtilleryTime, EventBufferInfo>>> ActionsToReconcile;
 
 	void QueueFire(FGunKey Key, ArtilleryTime Time);
-	void QueueResim(FGunKey Key, ArtilleryTime Time) const;
+	void QueueResim(const EventBufferInfo& Event, ArtilleryTime Time) const;
 
 	//the separation of tick and frame is inspired by the Serious Engine and others.
 	//In fact, it's pretty common to this day, with Unity also using a similar model.
@@ -240,7 +278,7 @@ protected:
 	//c'mon. Seriously. you wanna find that bug?
 	//********************************
 	void RERunGuns();
-	void RERunLocomotions();
+	void RERunLocomotions() const;
 
 public:
 	typedef FArtilleryTicklitesWorker<UArtilleryDispatch> FTicklitesWorker;
@@ -274,9 +312,24 @@ public:
 	{
 		ArtilleryTicklitesWorker_LockstepToWorldSim.RequestAddTicklite(ToAdd, Group);
 	}
+
+	//Preferred for anything spawned in bulk. The ticklite is staged in its type's pool instead of the heap, then the
+	//worker moves it into that type's lane, where it lives until it expires, so nobody else gets to hold onto it.
+	//If you need to keep a pointer to your ticklite, use the shared pointer version above.
+	//SortKey orders ticklites added on the same tick. Pass the owning entity, so every client adds them in the same order.
+	template <typename TicklitePooled>
+	void RequestAddPooledTicklite(const typename TicklitePooled::Ticklite_Impl& Core, TicklitePhase Group,
+		FTickliteSchedule Schedule = FTickliteSchedule(), FSkeletonKey SortKey = FSkeletonKey())
+	{
+		Ticklites::TicklitePool<typename TicklitePooled::Ticklite_Impl>& Pool = Ticklites::TicklitePool<typename TicklitePooled::Ticklite_Impl>::Get();
+		ArtilleryTicklitesWorker_LockstepToWorldSim.RequestAddTicklite(FTickliteHandle(Pool.Acquire(Core), &Pool, Schedule, SortKey.Obj), Group);
+	}
 	
 	FGunKey RegisterExistingGun(const TSharedPtr<FArtilleryGun>& toBind, const ActorKey& ProbableOwner) const;
-	void UnregisterExistingGun(FGunKey GunKey) const { GunByKey->Remove(GunKey); }
+	void UnregisterExistingGun(FGunKey GunKey) const
+	{
+		GunRegistry->Modify(GunKey, [](FArtilleryGunRecord& Record) { Record.Gun = nullptr; });
+	}
 	bool IsGunLive(FSkeletonKey Key); 
 	bool IsActorTransformAlive(ActorKey Key) const;
 	
@@ -344,12 +397,14 @@ public:
 	
 	void RegisterReady(const FGunKey Key, const FArtilleryFireGunFromDispatch& Machine) const
 	{
-		GunToFiringFunctionMapping->Add(Key, Machine);
+		GunRegistry->Update(Key, [&Machine](FArtilleryGunRecord& Record) { Record.Fire = Machine; });
 	}
 
 	bool IsGunRegistered(const FGunKey Key) const
 	{
-		return GunToFiringFunctionMapping->Contains(Key);
+		bool Bound = false;
+		GunRegistry->Read(Key, [&Bound](const FArtilleryGunRecord& Record) { Bound = Record.Fire.IsBound(); });
+		return Bound;
 	}
 
 	void RegisterEnemySubsystem(FArtilleryUpdateEnemyControllerSubsystem Update, FArtilleryAddEnemyToControllerSubsystem Register)
@@ -390,7 +445,7 @@ public:
 	bool burstDropDetected = false;
 
 private:
-	static inline long long monotonkey = 0;
+	static inline std::atomic<long long> monotonkey = 0;
 	//If you're trying to figure out how artillery works, read the busy worker knowing it's a single thread coming off of Dispatch.
 	//this handles input from bristlecone, patching it into streams from the CanonicalInputStreamECS (ACIS), using the ACIS to perform mappings,
 	//and processing those streams using the pattern matcher. right now, we also expect it to own rollback and jolt when that's implemented.
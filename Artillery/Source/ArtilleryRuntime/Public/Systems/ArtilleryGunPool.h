@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FArtilleryGun;
+class UStaticGunLoader;
+
+//Free lists of guns, one per gun definition, so handing out a gun is a pop rather than a struct init and seven NewObjects.
+//Guns are prewarmed when the level starts, come back here when they're deregistered, and get reset in place before
+//anyone sees them again.
+//
+//A deregistered gun can still be in someone's hands for a moment, most likely a thread mid-fire through the gun
+//registry, so it isn't reset on the spot. It waits in Returned until we hold the only reference, and Recycle picks
+//it up from there. Acquire and Retire are safe from any thread; Prewarm, Recycle, and TopUp make uobjects and are
+//game thread only.
+class ARTILLERYRUNTIME_API FArtilleryGunPool
+{
+public:
+	static constexpr int32 PrewarmPerDefinition = 32;
+	//refill once a definition drops below this, a few guns a frame.
+	static constexpr int32 LowWater = PrewarmPerDefinition / 4;
+	static constexpr int32 TopUpPerFrame = 4;
+
+	void Prewarm(UStaticGunLoader* Arsenal, int32 PerDefinition = PrewarmPerDefinition);
+	//null if that definition's free list is empty.
+	TSharedPtr<FArtilleryGun> Acquire(const FString& GunDefinitionID);
+	//hand a gun back. it's reset and reused once nobody else is holding it.
+	void Retire(TSharedPtr<FArtilleryGun> Gun);
+	void Recycle();
+	void TopUp(UStaticGunLoader* Arsenal, int32 Budget = TopUpPerFrame);
+	void Empty();
+
+private:
+	TSharedPtr<FArtilleryGun> Make(UStaticGunLoader* Arsenal, const FString& GunDefinitionID) const;
+
+	FCriticalSection Lock;
+	TMap<FString, TArray<TSharedPtr<FArtilleryGun>>> Free;
+	TArray<TSharedPtr<FArtilleryGun>> Returned;
+	//game thread only. swapped with Returned so the lock isn't held over a reset.
+	TArray<TSharedPtr<FArtilleryGun>> Recycling;
+};
@@ -6,6 +6,7 @@
 #include "Subsystems/WorldSubsystem.h"
 #include "AInstancedMeshManager.h"
 #include "FProjectileDefinitionRow.h"
+#include "ProjectileExpiryWheel.h"
 //look, it's important that you wrap both your typedefs and your lib include in these, and that the lib include always be explicit.
 //lbc is a header only lib. this has some pretty stark implications. we probably need to move ALL type defs and ALL
 //includes into a Lbc module, isolate them, and compile them.
@@ -71,7 +72,7 @@ public:
 protected:
 	virtual ~UArtilleryProjectileDispatch() override;
 	UDataTable* ProjectileDefinitions;
-	TSharedPtr<TSortedMap<int, TArray<FSkeletonKey>>> ExpirationDeadliner;
+	TSharedPtr<FProjectileExpiryWheel> ExpirationWheel;
 	TSharedPtr<TMap<FSkeletonKey, TWeakObjectPtr<AInstancedMeshManager>>> ManagerKeyToMeshManagerMapping;
 	TSharedPtr<KeyToItemCuckooMap> ProjectileKeyToMeshManagerMapping;
 	TSharedPtr<TMap<FName, TWeakObjectPtr<AInstancedMeshManager>>> ProjectileNameToMeshManagerMapping;
@@ -96,8 +97,13 @@ public:
 	TWeakObjectPtr<AInstancedMeshManager> GetProjectileMeshManagerByProjectileKey(const FSkeletonKey ProjectileKey);
 	TWeakObjectPtr<USceneComponent> GetSceneComponentForProjectile(const FSkeletonKey ProjectileKey);
 
-	void OnBarrageContactAdded(const BarrageContactEvent& ContactEvent);
+	void OnProjectileContacts(const FBContactEventSpan& Span);
 
 private:
+	//everything DeleteProjectile does, for a whole tick's worth of expirations, with the mesh cleanup batched per manager.
+	void ExpireProjectiles(TArray<FProjectileExpiryWheel::FExpired>& Expired);
+
 	UArtilleryDispatch* MyDispatch;
+	//busy worker only. reused every tick.
+	TArray<FProjectileExpiryWheel::FExpired> Expiring;
 };
@@ -10,6 +10,7 @@
 #include "Containers/CircularBuffer.h"
 #include "BristleconeCommonTypes.h"
 #include "UBristleconeWorldSubsystem.h"
+#include <atomic>
 #include <optional>
 #include <unordered_map>
 #include <ArtilleryShell.h>
@@ -57,6 +58,9 @@ class ARTILLERYRUNTIME_API UCanonicalInputStreamECS : public UTickableWorldSubsy
 		SessionPlayerToStreamMapping = MakeShareable(new TMap<PlayerKey, InputStreamKey>());
 	}
 
+	//the headless late input test builds one of these without a world.
+	friend struct FArtilleryLateInputHarness;
+
 public:
 	constexpr static int OrdinateSeqKey = UBristleconeWorldSubsystem::OrdinateSeqKey + ORDIN::Step;
 	virtual bool RegistrationImplementation() override;
@@ -97,6 +101,7 @@ public:
 	//this is the most portable way to do a folding region in C++.
 #ifndef ARTILLERYECS_CLASSES_REGION_MARKER
 public:
+	class FConservedInputStream;
 	class ARTILLERYRUNTIME_API FConservedInputPatternMatcher
 	{
 		InputStreamKey MyStream; //and may god have mercy on my soul.
@@ -128,6 +133,8 @@ public:
 		//same with this set, actually. patterns are stateless, and few. it's inefficient to destroy them.
 		//instead we check binds.
 		TMap<ArtIPMKey, IPM::CanonPattern> AllPatternsByName;
+		//bumped whenever a bind is added or removed, so we know to recompile before the next match.
+		std::atomic<uint32> BindsVersion = 0;
 		
 		//***********************************************************
 		//
@@ -140,7 +147,10 @@ public:
 		//faction pretty much as a single FCM except for a few bosses.
 		//
 		//hard to say. we might need to revisit this if the FCMs prove too heavy as full actor components.
-
+		//
+		//the binds are compiled down to a flat table, and every compiled pattern is answered for every button at once
+		//from a rolling history of the last few inputs. so it's one pass per pattern, however many binds it has,
+		//and no walking back through the stream. patterns that don't compile still run the old way, once each.
 		void runOneFrameWithSideEffects(bool isResim_Unimplemented,
 		                                //USED TO DEFINE HOW TO HIDE LATENCY BY TRIMMING LEAD-IN FRAMES OF AN ARTILLERYGUN
 		                                uint32_t leftTrimFrames,
@@ -162,47 +172,132 @@ public:
 			//then pin it. at this point, we can be sure that we hold A STREAM that DOES exist.
 			//TODO: settle on a coherent error handling strategy here.
 			TSharedPtr<UCanonicalInputStreamECS::FConservedInputStream> Stream = ECS->GetStream(MyStream);
-			
-			//the lack of reference (&) here causes a _copy of the shared pointer._ This is not accidental.
-			for (TPair<ArtIPMKey, TSharedPtr<TMap<FActionBitMask, FActionPatternParams>>>& SetTuple : AllPatternBinds)
+			if (!Stream)
+			{
+				return;
+			}
+			const uint32 Version = BindsVersion.load(std::memory_order_acquire);
+			if (Version != CompiledVersion)
+			{
+				Compile();
+				CompiledVersion = Version;
+			}
+			if (Binds.IsEmpty())
 			{
-				if (SetTuple.Value->Num() > 0)
+				return;
+			}
+
+			const FInputAges& Ages = AgesAt(InputCycleNumber, Stream);
+			for (FCompiledSlot& Slot : Slots)
+			{
+				Slot.Result = Slot.Compiled.Compiled
+					              ? Evaluate(Slot.Compiled, Ages, Slot.Union.getFlat())
+					              : Slot.Pattern->runPattern(InputCycleNumber, Slot.Union, Stream);
+			}
+
+			std::optional<BristleTime> time;
+			for (const FCompiledBind& Bind : Binds)
+			{
+				const uint32 Result = Slots[Bind.Slot].Result;
+				if (Result && (Bind.ToSeek & Result) == Bind.ToSeek)
 				{
-					IPM::CanonPattern currentPattern = AllPatternsByName[SetTuple.Key];
-					FActionBitMask Union;
-					TMap<FActionBitMask, FActionPatternParams>* currentSet = SetTuple.Value.Get();
-					//TODO: remove and replace with a version that uses all bits set.
-					//lot of refactoring to do that. let's get this working first.
-					//for (FActionPatternParams& Elem : *currentSet)
-					for (TPair<FActionBitMask, FActionPatternParams>& Elem : *currentSet)
+					if (!time.has_value())
 					{
-						//todo: replace with toFlat(). ffs.
-						Union.buttons |= Elem.Value.ToSeek.buttons;
-					}
-					uint32_t result = currentPattern->runPattern(InputCycleNumber, Union, Stream);
-					if (result)
-					{
-						//for (FActionPatternParams& Elem : *currentSet)
-						for (TPair<FActionBitMask, FActionPatternParams>& Elem : *currentSet)
-						{
-							FActionBitMask& ToSeek = Elem.Value.ToSeek;
-							if (ToSeek.getFlat() != 0 && (ToSeek.getFlat() & result) == ToSeek.getFlat())
-							{
-								BristleTime time = Stream->peek(InputCycleNumber)->SentAt;
-								//THIS IS NOT SUPER SAFE. HAHAHAH. YAY.
-								EventBufferInfo EventInfo;
-								EventInfo.GunKey = Elem.Value.ToFire;
-								EventInfo.Action = currentPattern->getName();
-								EventInfo.ActionBitMask = ToSeek;
-								IN_PARAM_REF_TRIPLEBUFFER_LIFECYLEMANAGED.Add(TPair<ArtilleryTime, EventBufferInfo>(
-										time,
-										EventInfo));
-							}
-						}
+						time = Stream->peek(InputCycleNumber)->SentAt;
 					}
+					//THIS IS NOT SUPER SAFE. HAHAHAH. YAY.
+					EventBufferInfo EventInfo;
+					EventInfo.GunKey = Bind.ToFire;
+					EventInfo.Action = Bind.Action;
+					EventInfo.ActionBitMask = Bind.Mask;
+					IN_PARAM_REF_TRIPLEBUFFER_LIFECYLEMANAGED.Add(TPair<ArtilleryTime, EventBufferInfo>(
+							*time,
+							EventInfo));
 				}
 			}
 		}
+
+		//the input at Input has been swapped out, so what we remember of it, and of everything after it that was built
+		//on it, is wrong. the next match from there walks back through the stream again. busy worker only.
+		void ForgetFrom(uint64_t Input)
+		{
+			for (FInputAges& Stale : History)
+			{
+				if (Stale.Input != MAX_uint64 && Stale.Input >= Input)
+				{
+					Stale.Input = MAX_uint64;
+				}
+			}
+		}
+
+	private:
+		//every button that was down, by how many inputs back. Ago[0] is the input itself.
+		struct FInputAges
+		{
+			uint64_t Input = MAX_uint64;
+			uint32 Ago[FCompiledActionPattern::MaxAge] = {};
+		};
+		//power of two. comfortably deeper than a resim goes back, so reruns find their history already here.
+		static constexpr uint32 AgesKept = 256;
+
+		//one per pattern with live binds, in bind map order.
+		struct FCompiledSlot
+		{
+			IPM::CanonPattern Pattern = nullptr;
+			FCompiledActionPattern Compiled;
+			FActionBitMask Union;
+			uint32 Result = 0;
+		};
+		struct FCompiledBind
+		{
+			int32 Slot = 0;
+			uint32 ToSeek = 0;
+			FActionBitMask Mask;
+			FGunKey ToFire;
+			ArtIPMKey Action = ArtIPMKey::InternallyStateless;
+		};
+
+		void Compile();
+		//built from the input before it when that's to hand, which it nearly always is, so this is one shift per input.
+		const FInputAges& AgesAt(uint64_t Input, const TSharedPtr<FConservedInputStream>& Stream);
+
+		static uint32 Evaluate(const FCompiledActionPattern& Pattern, const FInputAges& Ages, uint32 Union)
+		{
+			uint32 Match = Union;
+			uint32 OneMiss = 0;
+			uint32 TwoMisses = 0;
+			for (uint32 Age = 0; Age < FCompiledActionPattern::MaxAge; ++Age)
+			{
+				const uint32 AgeBit = 1u << Age;
+				if (Pattern.Down & AgeBit)
+				{
+					Match &= Ages.Ago[Age];
+				}
+				if (Pattern.Up & AgeBit)
+				{
+					Match &= ~Ages.Ago[Age];
+				}
+				if (Pattern.AllowOneMiss & AgeBit)
+				{
+					const uint32 Missed = ~Ages.Ago[Age];
+					TwoMisses |= OneMiss & Missed;
+					OneMiss |= Missed;
+				}
+			}
+			Match &= ~TwoMisses;
+			if (Pattern.WholeUnion)
+			{
+				return Match == Union ? Union : 0;
+			}
+			return Match;
+		}
+
+		uint32 CompiledVersion = MAX_uint32;
+		TArray<FCompiledSlot> Slots;
+		TArray<FCompiledBind> Binds;
+		FInputAges History[AgesKept];
+		//streams can get swapped out from under us. if that happens, what we remember is about the old one.
+		const void* HistoryOf = nullptr;
 	};
 
 	class ARTILLERYRUNTIME_API FConservedInputStream : public FArtilleryNoGuaranteeReadOnly
@@ -305,6 +400,25 @@ public:
 			CurrentHistory[highestInput].SentAt = ECSParent->Now();
 			++highestInput;
 		}
+
+		//swaps in the real input for one we made up in its place, and hands back what was there. it keeps its index and
+		//SentAt, so everything around it stays where it was. busy worker only, and only while the input's still readable.
+		std::optional<INNNNCOMING> Replace(uint64_t input, INNNNCOMING shell)
+		{
+			if (input >= highestInput || (highestInput - input) > AddressableInputConservationWindow)
+			{
+				return std::nullopt;
+			}
+			const INNNNCOMING Was = CurrentHistory[input].MyInputActions;
+			CurrentHistory[input].MyInputActions = shell;
+			CurrentHistory[input].ReachedArtilleryAt = ECSParent->Now();
+			//otherwise the resim matches against what the matcher remembers, which is the repeat.
+			if (MyPatternMatcher)
+			{
+				MyPatternMatcher->ForgetFrom(input);
+			}
+			return Was;
+		}
 	};
 
 	//Used in the busyworker
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <atomic>
+#include "CoreMinimal.h"
+#include "SkeletonTypes.h"
+#include "MashFunctions.h"
+
+//hands out a small, reusable index per thread, so a registry can keep one epoch marker per reader without any reader
+//ever taking a lock. an index goes back when its thread exits.
+class ARTILLERYRUNTIME_API FKeyedSlabReaders
+{
+public:
+	static constexpr int32 Max = 128;
+	//-1 if every index is taken, in which case the caller falls back to the write lock.
+	static int32 Mine();
+};
+
+//Keyed storage for things that every artillery thread reads but that mostly the game thread writes, like guns.
+//Reads are wait-free: an open addressed index from key to handle, and a slab of records behind it. A record is never
+//touched once it's published. A write copies it into a fresh slot, swaps the handle, and retires the old slot, which
+//is only reused after every thread that could have been reading it has moved on. That's tracked with epochs: a reader
+//marks the epoch it started in, and a slot retired in some epoch waits until no reader is still marked with it or
+//anything before it.
+//
+//Handles carry the slot's generation, so a reader holding a stale one gets nothing rather than somebody else's record.
+//
+//Writes take a lock and are expected to be rare. The index never grows, so size it for the whole match. A removed key
+//leaves its index entry behind as a tombstone, so probe chains stay whole under readers; the next insert along that
+//chain reuses it. Once tombstones pile up past a quarter of the index, a write rebuilds it from the live keys into a
+//fresh array and retires the old one the same way as a slot, so misses keep stopping at an empty entry.
+template <typename Record>
+class TKeyedSlabRegistry
+{
+public:
+	static constexpr uint32 SlotsPerChunk = 256;
+
+	//capacity is rounded up to a power of two.
+	explicit TKeyedSlabRegistry(uint32 InIndexCapacity = 1 << 14, uint32 InMaxChunks = 64)
+		: IndexCapacity(FMath::RoundUpToPowerOfTwo(FMath::Max(InIndexCapacity, 2u))), MaxChunks(InMaxChunks)
+	{
+		OwnedIndex = MakeUnique<FIndexEntry[]>(IndexCapacity);
+		Index.store(OwnedIndex.Get(), std::memory_order_release);
+		//reserved whole, up front, so chunk pointers never move under a reader.
+		Chunks.Reserve(MaxChunks);
+	}
+
+	~TKeyedSlabRegistry()
+	{
+		Empty();
+	}
+
+	//calls Visit with the record for Key, if there is one. wait-free unless this thread couldn't get a reader index.
+	//Visit runs inside the read, so it can call back into the registry, reads or writes, but keep it short: nothing
+	//retired while it runs can be reclaimed until it's done.
+	template <typename Visitor>
+	bool Read(FSkeletonKey Key, Visitor&& Visit) const
+	{
+		const int32 Me = FKeyedSlabReaders::Mine();
+		if (Me < 0)
+		{
+			FScopeLock Lock(&WriteLock);
+			const FSlot* Slot = FindSlot(Key.Obj);
+			if (Slot)
+			{
+				Visit(Slot->Value);
+			}
+			return Slot != nullptr;
+		}
+		FReader& Reader = Readers[Me];
+		if (Reader.Depth++ == 0)
+		{
+			Reader.Epoch.store(GlobalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+		}
+		const FSlot* Slot = FindSlot(Key.Obj);
+		if (Slot)
+		{
+			Visit(Slot->Value);
+		}
+		if (--Reader.Depth == 0)
+		{
+			Reader.Epoch.store(0, std::memory_order_release);
+		}
+		return Slot != nullptr;
+	}
+
+	bool Contains(FSkeletonKey Key) const
+	{
+		return Read(Key, [](const Record&) {});
+	}
+
+	//copies the record out. prefer Read if you only need to look.
+	bool Find(FSkeletonKey Key, Record& Out) const
+	{
+		return Read(Key, [&Out](const Record& Found) { Out = Found; });
+	}
+
+	//adds Key if it's missing, starting from a default record, then lets Edit change the copy that gets published.
+	template <typename Editor>
+	bool Update(FSkeletonKey Key, Editor&& Edit)
+	{
+		return Publish(Key, Edit, true);
+	}
+
+	//same as Update, but false and no change if Key isn't there.
+	template <typename Editor>
+	bool Modify(FSkeletonKey Key, Editor&& Edit)
+	{
+		return Publish(Key, Edit, false);
+	}
+
+	bool Add(FSkeletonKey Key, const Record& Value)
+	{
+		return Update(Key, [&Value](Record& Slot) { Slot = Value; });
+	}
+
+	//false if it wasn't there. Out gets what was removed.
+	bool Remove(FSkeletonKey Key, Record* Out = nullptr)
+	{
+		FScopeLock Lock(&WriteLock);
+		FIndexEntry* Entry = FindEntry(Key.Obj);
+		const uint64 Handle = Entry ? Entry->Handle.load(std::memory_order_relaxed) : 0;
+		if (!Handle)
+		{
+			return false;
+		}
+		if (Out)
+		{
+			*Out = SlotAt(SlotOf(Handle)).Value;
+		}
+		Entry->Handle.store(0, std::memory_order_seq_cst);
+		Retire(SlotOf(Handle));
+		--Live;
+		RebuildIndexIfStale();
+		Collect();
+		return true;
+	}
+
+	void Empty()
+	{
+		FScopeLock Lock(&WriteLock);
+		FIndexEntry* Entries = Index.load(std::memory_order_relaxed);
+		for (uint32 i = 0; i < IndexCapacity; ++i)
+		{
+			const uint64 Handle = Entries[i].Handle.load(std::memory_order_relaxed);
+			if (Handle)
+			{
+				Entries[i].Handle.store(0, std::memory_order_seq_cst);
+				Retire(SlotOf(Handle));
+			}
+		}
+		Live = 0;
+		RebuildIndexIfStale();
+		Collect();
+	}
+
+	int32 Num() const
+	{
+		FScopeLock Lock(&WriteLock);
+		return Live;
+	}
+
+	//hands back whatever retired slots nobody can still be reading. writes do this on their own; call it if you've
+	//removed a lot and want the records released now.
+	void Collect()
+	{
+		FScopeLock Lock(&WriteLock);
+		uint64 OldestReader = TNumericLimits<uint64>::Max();
+		for (const FReader& Reader : Readers)
+		{
+			const uint64 Epoch = Reader.Epoch.load(std::memory_order_seq_cst);
+			if (Epoch != 0)
+			{
+				OldestReader = FMath::Min(OldestReader, Epoch);
+			}
+		}
+		for (int32 i = 0; i < Retired.Num();)
+		{
+			if (Retired[i].Epoch < OldestReader)
+			{
+				FSlot& Slot = SlotAt(Retired[i].Slot);
+				uint32 Generation = Slot.Generation.load(std::memory_order_relaxed) + 1;
+				//zero is never a live generation, so a zeroed handle can't match.
+				Slot.Generation.store(Generation ? Generation : 1, std::memory_order_release);
+				Slot.Key = 0;
+				Slot.Value = Record();
+				Free.Add(Retired[i].Slot);
+				Retired.RemoveAtSwap(i, 1, EAllowShrinking::No);
+			}
+			else
+			{
+				++i;
+			}
+		}
+		for (int32 i = 0; i < RetiredIndexes.Num();)
+		{
+			if (RetiredIndexes[i].Epoch < OldestReader)
+			{
+				RetiredIndexes.RemoveAtSwap(i, 1, EAllowShrinking::No);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+private:
+	struct FIndexEntry
+	{
+		//never goes back to zero once set, so probe chains never break under a reader.
+		std::atomic<uint64> Key = 0;
+		//generation in the high half, slot + 1 in the low half. zero means removed.
+		std::atomic<uint64> Handle = 0;
+	};
+
+	struct FSlot
+	{
+		std::atomic<uint32> Generation = 1;
+		uint64 Key = 0;
+		Record Value = Record();
+	};
+
+	struct FChunk
+	{
+		FSlot Slots[SlotsPerChunk];
+	};
+
+	struct alignas(64) FReader
+	{
+		std::atomic<uint64> Epoch = 0;
+		//only ever touched by the thread that owns this reader, so reads can nest.
+		int32 Depth = 0;
+	};
+
+	struct FRetired
+	{
+		int32 Slot;
+		uint64 Epoch;
+	};
+
+	struct FRetiredIndex
+	{
+		TUniquePtr<FIndexEntry[]> Entries;
+		uint64 Epoch;
+	};
+
+	template <typename Editor>
+	bool Publish(FSkeletonKey Key, Editor& Edit, bool AddIfMissing)
+	{
+		if (Key.Obj == 0)
+		{
+			return false;
+		}
+		FScopeLock Lock(&WriteLock);
+		FIndexEntry* Entry = AddIfMissing ? FindOrClaimEntry(Key.Obj) : FindEntry(Key.Obj);
+		if (!AddIfMissing && (!Entry || !Entry->Handle.load(std::memory_order_relaxed)))
+		{
+			return false;
+		}
+		if (!Entry)
+		{
+			UE_LOG(LogTemp, Error, TEXT("TKeyedSlabRegistry: index is full at %d entries."), IndexCapacity);
+			return false;
+		}
+		const int32 Fresh = AllocateSlot();
+		if (Fresh < 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("TKeyedSlabRegistry: out of slots at %d."), MaxChunks * SlotsPerChunk);
+			return false;
+		}
+		const uint64 OldHandle = Entry->Handle.load(std::memory_order_relaxed);
+		FSlot& Slot = SlotAt(Fresh);
+		Slot.Key = Key.Obj;
+		Slot.Value = OldHandle ? SlotAt(SlotOf(OldHandle)).Value : Record();
+		Edit(Slot.Value);
+
+		const uint64 EntryKey = Entry->Key.load(std::memory_order_relaxed);
+		if (EntryKey != Key.Obj)
+		{
+			Used += EntryKey == 0 ? 1 : 0;
+			Entry->Key.store(Key.Obj, std::memory_order_seq_cst);
+		}
+		Entry->Handle.store(MakeHandle(Slot.Generation.load(std::memory_order_relaxed), Fresh), std::memory_order_seq_cst);
+		if (OldHandle)
+		{
+			Retire(SlotOf(OldHandle));
+		}
+		else
+		{
+			++Live;
+		}
+		RebuildIndexIfStale();
+		Collect();
+		return true;
+	}
+
+	static uint64 MakeHandle(uint32 Generation, int32 Slot)
+	{
+		return (static_cast<uint64>(Generation) << 32) | static_cast<uint32>(Slot + 1);
+	}
+
+	static int32 SlotOf(uint64 Handle)
+	{
+		return static_cast<int32>(Handle & 0xFFFFFFFF) - 1;
+	}
+
+	FSlot& SlotAt(int32 Slot) const
+	{
+		return Chunks[Slot / SlotsPerChunk]->Slots[Slot % SlotsPerChunk];
+	}
+
+	uint32 Home(uint64 Key) const
+	{
+		return static_cast<uint32>(FMMM::FastHash64(Key)) & (IndexCapacity - 1);
+	}
+
+	const FSlot* FindSlot(uint64 Key) const
+	{
+		if (Key == 0)
+		{
+			return nullptr;
+		}
+		const FIndexEntry* Entries = Index.load(std::memory_order_seq_cst);
+		uint32 At = Home(Key);
+		for (uint32 Probe = 0; Probe < IndexCapacity; ++Probe, At = (At + 1) & (IndexCapacity - 1))
+		{
+			const FIndexEntry& Entry = Entries[At];
+			const uint64 EntryKey = Entry.Key.load(std::memory_order_seq_cst);
+			if (EntryKey == 0)
+			{
+				return nullptr;
+			}
+			if (EntryKey != Key)
+			{
+				continue;
+			}
+			const uint64 Handle = Entry.Handle.load(std::memory_order_seq_cst);
+			if (Handle == 0)
+			{
+				return nullptr;
+			}
+			const int32 SlotIndex = SlotOf(Handle);
+			if (static_cast<uint32>(SlotIndex) / SlotsPerChunk >= NumChunks.load(std::memory_order_acquire))
+			{
+				return nullptr;
+			}
+			const FSlot& Slot = SlotAt(SlotIndex);
+			//the entry can be handed to another key between our two loads. the slot knows whose it is.
+			if (Slot.Generation.load(std::memory_order_acquire) != static_cast<uint32>(Handle >> 32) || Slot.Key != Key)
+			{
+				return nullptr;
+			}
+			return &Slot;
+		}
+		return nullptr;
+	}
+
+	//write lock held for all of these.
+	FIndexEntry* FindEntry(uint64 Key)
+	{
+		if (Key == 0)
+		{
+			return nullptr;
+		}
+		FIndexEntry* Entries = Index.load(std::memory_order_relaxed);
+		uint32 At = Home(Key);
+		for (uint32 Probe = 0; Probe < IndexCapacity; ++Probe, At = (At + 1) & (IndexCapacity - 1))
+		{
+			const uint64 EntryKey = Entries[At].Key.load(std::memory_order_relaxed);
+			if (EntryKey == 0)
+			{
+				return nullptr;
+			}
+			if (EntryKey == Key)
+			{
+				return &Entries[At];
+			}
+		}
+		return nullptr;
+	}
+
+	FIndexEntry* FindOrClaimEntry(uint64 Key)
+	{
+		if (FIndexEntry* Existing = FindEntry(Key))
+		{
+			return Existing;
+		}
+		FIndexEntry* Entries = Index.load(std::memory_order_relaxed);
+		uint32 At = Home(Key);
+		for (uint32 Probe = 0; Probe < IndexCapacity; ++Probe, At = (At + 1) & (IndexCapacity - 1))
+		{
+			FIndexEntry& Entry = Entries[At];
+			//empty, or a removed key's leftover.
+			if (Entry.Key.load(std::memory_order_relaxed) == 0 || Entry.Handle.load(std::memory_order_relaxed) == 0)
+			{
+				return &Entry;
+			}
+		}
+		return nullptr;
+	}
+
+	//entries that have a key but no handle only lengthen probes, and a miss walks every one of them until it finds an
+	//empty entry. past a quarter of the index, copy the live ones into a fresh array. readers still in the old one
+	//finish there, and it's freed once they've all moved on.
+	void RebuildIndexIfStale()
+	{
+		if (static_cast<uint32>(Used - Live) <= IndexCapacity / 4)
+		{
+			return;
+		}
+		const FIndexEntry* Old = Index.load(std::memory_order_relaxed);
+		TUniquePtr<FIndexEntry[]> Fresh = MakeUnique<FIndexEntry[]>(IndexCapacity);
+		for (uint32 i = 0; i < IndexCapacity; ++i)
+		{
+			const uint64 Handle = Old[i].Handle.load(std::memory_order_relaxed);
+			if (!Handle)
+			{
+				continue;
+			}
+			const uint64 Key = Old[i].Key.load(std::memory_order_relaxed);
+			uint32 At = Home(Key);
+			while (Fresh[At].Key.load(std::memory_order_relaxed) != 0)
+			{
+				At = (At + 1) & (IndexCapacity - 1);
+			}
+			Fresh[At].Key.store(Key, std::memory_order_relaxed);
+			Fresh[At].Handle.store(Handle, std::memory_order_relaxed);
+		}
+		Used = Live;
+		Index.store(Fresh.Get(), std::memory_order_seq_cst);
+		RetiredIndexes.Add({MoveTemp(OwnedIndex), GlobalEpoch.fetch_add(1, std::memory_order_seq_cst)});
+		OwnedIndex = MoveTemp(Fresh);
+	}
+
+	int32 AllocateSlot()
+	{
+		if (Free.IsEmpty())
+		{
+			const uint32 Count = NumChunks.load(std::memory_order_relaxed);
+			if (Count == MaxChunks)
+			{
+				return -1;
+			}
+			Chunks.Emplace(MakeUnique<FChunk>());
+			for (uint32 i = SlotsPerChunk; i > 0; --i)
+			{
+				Free.Add(Count * SlotsPerChunk + i - 1);
+			}
+			NumChunks.store(Count + 1, std::memory_order_release);
+		}
+		return Free.Pop(EAllowShrinking::No);
+	}
+
+	void Retire(int32 Slot)
+	{
+		Retired.Add({Slot, GlobalEpoch.fetch_add(1, std::memory_order_seq_cst)});
+	}
+
+	const uint32 IndexCapacity;
+	const uint32 MaxChunks;
+	TUniquePtr<FIndexEntry[]> OwnedIndex;
+	//what readers probe. only ever OwnedIndex, but swapped whole by a rebuild.
+	std::atomic<FIndexEntry*> Index = nullptr;
+	TArray<FRetiredIndex> RetiredIndexes;
+	//entries with a key in them, live or tombstone.
+	int32 Used = 0;
+	TArray<TUniquePtr<FChunk>> Chunks;
+	std::atomic<uint32> NumChunks = 0;
+	TArray<int32> Free;
+	TArray<FRetired> Retired;
+	int32 Live = 0;
+	//starts at one, so a reader's zero always means "not reading".
+	std::atomic<uint64> GlobalEpoch = 1;
+	mutable FReader Readers[FKeyedSlabReaders::Max];
+	mutable FCriticalSection WriteLock;
+};
@@ -27,6 +27,8 @@ constexpr int ALLOWED_THREADS_FOR_ARTILLERY = 64;
 //That would require an indirection mapping, which I find highly highly distasteful, but on the other hand, we're in
 //extremely deep waters. On the grasping hand, everything we do to improve the UX NOW is a hundred bugs a year we don't have
 //to _______________ ________ until ____ __ _________ and fix later.
+// Game thread requests are drained, sorted, and prepped by the busy worker first (StageRequestRouterGameThread), then
+// run by the game thread in batches.
 // Find in files for YAGAMETHREADBOYRUNNETHREQUESTSHERE will show you the code in artillery dispatch that processes gamethread
 // and YABUSYTHREADBOYRUNNETHREQUESTSHERE will show you the equivalent code in our mutual friend artillery busy worker.
 class ARTILLERYRUNTIME_API F_INeedA //Frick
@@ -107,7 +109,7 @@ public:
 	FGrantWith MobileAI(FSkeletonKey AIEntity, ArtilleryTime Stamp);
 	
 	//the following statement must return a non-null element
-	//GunToFiringFunctionMapping->Find(Request.Gun)->ExecuteIfBound(GunByKey->FindRef(Request.Gun), false);
+	//GunRegistry->Read(Request.Gun, ...) must find a gun with a bound firing function.
 	//in other words, it MUST be bound already as per any other gun you wish to fire. globspeebcormbrad
 	FGrantWith GunFired(FGunKey Target, ArtilleryTime Stamp);
 	
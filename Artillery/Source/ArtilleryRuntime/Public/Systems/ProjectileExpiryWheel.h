@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SkeletonTypes.h"
+
+class AInstancedMeshManager;
+
+//When every live projectile is due to expire, as a hashed timing wheel. One slot per tick, wrapping, and each slot is an
+//intrusive list through a preallocated pool of entries, so scheduling, cancelling, and expiring are all constant time
+//per projectile and nothing allocates until the pool runs dry. The wheel covers SlotCount ticks; a deadline further out
+//than that just waits in its slot for another lap, which costs a compare each time the slot comes around.
+//
+//Projectiles are scheduled from the game thread and expired and cancelled from the busy worker, so everything here
+//takes the lock. Nothing done under it is more than a few stores.
+class ARTILLERYRUNTIME_API FProjectileExpiryWheel
+{
+public:
+	//a bit over 30 seconds at the artillery tick rate, so the default lifetime never laps.
+	static constexpr int32 SlotCount = 4096;
+	//enough for the autoguns at full tilt. past this, the pool doubles.
+	static constexpr int32 InitialCapacity = 1 << 14;
+
+	struct FExpired
+	{
+		FSkeletonKey Key;
+		TWeakObjectPtr<AInstancedMeshManager> Manager;
+	};
+
+	FProjectileExpiryWheel();
+
+	//a projectile scheduled twice keeps its latest deadline.
+	void Schedule(FSkeletonKey Key, TWeakObjectPtr<AInstancedMeshManager> Manager, int32 Deadline);
+	//false if it wasn't scheduled, which is normal for anything that already expired.
+	bool Cancel(FSkeletonKey Key);
+	//appends everything due at Now to Out, in the order it was scheduled. call once per tick, every tick.
+	void Expire(int32 Now, TArray<FExpired>& Out);
+	void Empty();
+	int32 Num() const;
+
+private:
+	static constexpr int32 None = INDEX_NONE;
+
+	struct FEntry
+	{
+		FSkeletonKey Key;
+		TWeakObjectPtr<AInstancedMeshManager> Manager;
+		int32 Deadline = 0;
+		int32 Prev = None;
+		int32 Next = None;
+	};
+
+	struct FSlot
+	{
+		int32 Head = None;
+		int32 Tail = None;
+	};
+
+	int32 Claim();
+	void Unlink(int32 Index);
+	void Release(int32 Index);
+
+	mutable FCriticalSection Lock;
+	TArray<FSlot> Slots;
+	TArray<FEntry> Entries;
+	//free entries are chained through Next.
+	int32 FreeHead = None;
+	TMap<FSkeletonKey, int32> Scheduled;
+};
@@ -9,7 +9,10 @@
 #include "LocomotionParams.h"
 
 #include "BarrageDispatch.h"
+#include "PhysicsSnapshots.h"
 #include "NeedA.h"
+#include "FArtilleryJitterBuffer.h"
+#include <atomic>
 
 //this is a busy-style thread, which runs preset bodies of work in a specified order. Generally, the goal is that it never
 //actually sleeps. In fact, it yields rather than sleeps, in general operation.
@@ -20,6 +23,17 @@
 // The artilleryworker needs to be kept fairly busy or it will melt one cpu core yield-cycling. to be honest, worth it.
 // no, seriously. with all the other sacrifices we've made occupying one core with game-sim physics, reconciliation,
 // rollbacks, and pattern matching is a pretty good bargain. we'll want to revisit this for servers, of course.
+//
+// Rollback works off a short history of the frames we've run: when each ran, its physics tick, and which inputs it
+// took. When the jitter buffer covers with a repeat for a remote input that hasn't shown, we note where the repeat went
+// in the stream and which frame ran it. If the real input turns up, it takes the repeat's place in the stream, and
+// before this frame's inputs go in, we rewind physics, attributes, and tags to just before that frame and run every
+// frame since again, same inputs, same order, with the real input where the repeat was. Ticklites and state
+// trees are told which ticks got replayed and catch up on their own threads, ticklite lanes rewinding themselves first.
+// Shared ticklites can't be rewound, so while one's live, nothing resims. Each frame remembers the gun events it
+// fired, and only what the resim matches beyond those goes to the game thread to fire as a rerun, so nothing the first
+// pass already fired fires twice. If the late frame is past what physics kept, or replaying back to it would blow the
+// budget, the input just runs late on the current frame, same as it always did.
 
 class FArtilleryBusyWorker : public FRunnable {
 	public:
@@ -32,6 +46,9 @@ class FArtilleryBusyWorker : public FRunnable {
 	TSharedPtr<BufferedAIMoveEvents> RequestorQueue_AI_Locomos_TripleBuffer;
 
 	ArtilleryTime TickliteNow = 0;
+	//the frame number of the frame ticklites are applying for. it's what ticklite schedules count, since it goes up by
+	//exactly one per frame and a resim replays the same numbers. set just before apply is triggered.
+	std::atomic<uint64> TickliteFrame{0};
 	FSharedEventRef StartTicklitesSim;
 	FSharedEventRef StartTicklitesApply;
 	FSharedEventRef StartRunAhead;
@@ -44,16 +61,14 @@ class FArtilleryBusyWorker : public FRunnable {
 	//deinitialized when if we need to, as well. It wouldn't even be that hard, simply add a deregister to SkeletonLord
 	
 	virtual bool Init() override;
-	void RunStandardFrameSim(bool& missedPrior,
-		uint64_t& currentIndexCabling,
-		bool& burstDropDetected,
+	void RunStandardFrameSim(uint64_t& currentIndexCabling,
 		TheCone::PacketElement& current,
 		bool& RemoteInput);
 	void ProcessRequestRouterBusyWorkerThread();
 	virtual uint32 Run() override;
 	virtual void Exit() override;
 	virtual void Stop() override;
-	void RunFrameProcessingLoop(bool missedPrior, uint64_t currentIndexCabling, bool burstDropDetected, bool sent, uint32_t LastIncrementWindow, uint32_t lsbTime, const uint32_t SendHertzFactor, const uint32_t Period, const std::chrono::microseconds HalfStep, UArtilleryDispatch* ArtilleryDispatch);
+	void RunFrameProcessingLoop(uint64_t currentIndexCabling, bool sent, uint32_t LastIncrementWindow, uint32_t lsbTime, const uint32_t SendHertzFactor, const uint32_t Period, const std::chrono::microseconds HalfStep, UArtilleryDispatch* ArtilleryDispatch);
 	// stop me if you've heard this one before
 	
 	//this is a hack and MIGHT be replaced with an ECS lookup
@@ -66,10 +81,80 @@ class FArtilleryBusyWorker : public FRunnable {
 	TheCone::SendQueue InputSwapSlot;
 	UCanonicalInputStreamECS* ContingentInputECSLinkage;
 	UBarrageDispatch* ContingentPhysicsLinkage;
+
+	//we can't go back further than physics snapshots do.
+	static constexpr uint32 ResimHistory = FBPhysicsSnapshots::Depth;
+	//most frames one resim will replay. anything later than this runs late instead.
+	uint32 MaxResimFrames = ResimHistory - 1;
+	//how long a resim can take, in microseconds, going by what frames have cost lately.
+	uint32 ResimBudgetMicros = 4000;
+	uint64 ResimsRun = 0;
+	uint64 LateInputsRunLate = 0;
+	//every this many frames, resim the last few with nothing changed and check physics comes out bit for bit the same.
+	//it's a real resim, so it costs like one. 0 is off. for soaks and debugging determinism, not for shipping.
+	uint32 VerifyResimEvery = 0;
+	uint32 VerifyResimFrames = 4;
+	uint64 ResimMismatches = 0;
+	//remote input waits here until it's due. its stats are safe enough to read for display.
+	FArtilleryJitterBuffer RemoteJitter;
 	
 private:
+	//one frame we've run, kept so we can run it again.
+	struct FResimFrame
+	{
+		ArtilleryTime Now = 0;
+		int Seq = 0;
+		uint64_t CablingFrom = 0;
+		uint64_t CablingTo = 0;
+		//indices into the bristlecone stream, in the order they ran. a late input replaces its repeat in place.
+		TArray<uint64_t, TInlineAllocator<4>> Remote;
+		//gun events this frame has fired so far, first run and reruns both.
+		TArray<TPair<ArtilleryTime, EventBufferInfo>, TInlineAllocator<2>> Fired;
+	};
+
+	//where a repeat covering for a remote cycle went, so the real input can take its place.
+	struct FCovering
+	{
+		uint64 Cycle = 0;
+		uint64_t Index = 0;
+		uint64 Frame = 0;
+	};
+	//a late input we've put in its repeat's place, and what to put back if the resim doesn't happen.
+	struct FLateInput
+	{
+		uint64_t Index = 0;
+		TheCone::PacketElement Repeated = 0;
+		TheCone::PacketElement Input = 0;
+		ArtilleryTime SentAt = 0;
+	};
+
+	FResimFrame& FrameAt(uint64 Frame) { return History[Frame % ResimHistory]; }
+	FCovering& CoveringFor(uint64 Cycle) { return Covering[Cycle & (FArtilleryJitterBuffer::Slots - 1)]; }
+	//whether we can still go back and run Frame again.
+	bool CanResimFrom(uint64 Frame);
+	void PushInput(ArtilleryControlStream& Stream, uint64_t Index, EventBuffer& Events) const;
+	bool Resim(uint64 FromFrame);
+	void VerifyResim();
+	//drops the events from From on in ResimEvents that Frame already fired, and files the rest under it as fired.
+	void KeepNewlyFired(FResimFrame& Frame, int32 From);
+	
 	void Cleanup();
 	bool running;
+	UArtilleryDispatch* ContingentDispatchLinkage = nullptr;
+	FResimFrame History[ResimHistory];
+	//frames recorded so far. the newest is FramesRecorded - 1.
+	uint64 FramesRecorded = 0;
+	FResimFrame Building;
+	//running average of what a frame's sim costs, so we know roughly what replaying one will.
+	uint32 FrameCostMicros = 0;
+	EventBuffer ResimEvents;
+	EventBuffer AlreadyFired;
+	TArray<ArtilleryTime> ResimTicks;
+	TArray<FLateInput, TInlineAllocator<8>> LateThisFrame;
+	//the jitter buffer only flags a cycle late while it's still in its ring, so ours is the same size.
+	FCovering Covering[FArtilleryJitterBuffer::Slots];
+	TArray<uint32, TInlineAllocator<ResimHistory>> VerifyFingerprints;
+	TArray<FArtilleryJitterBuffer::FPlayout> RemotePlayout;
 	//this needs to remain private and only be modified or used on this thread.
 	//if you want to add the ability to expose this off-thread, first, see if the ATA already present in ArtilleryDispatch is good enough.
 	//second, assess if you can use a shadow-copy-and-swap pattern identical to the one used for generating the quadtree we expose for radar.
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BristleconeCommonTypes.h"
+#include "ArtilleryCommonTypes.h"
+
+//Sits between the packets bristlecone hands us and the remote control stream, and decides when each remote input
+//actually gets played. Every input is due at the time it was sent, plus the least transit we've seen lately, plus a
+//delay sized off how much arrival has been wobbling. Inputs that show up early wait. Inputs that are due go out, as
+//many as are due, so a burst plays back over a frame or two instead of being dropped.
+//
+//The delay moves a little each frame rather than jumping, so when it grows inputs come out a bit further apart, and
+//when it shrinks they bunch up. If an input still isn't here when it's due, we repeat the one before it in its place,
+//which is what a hold would have done anyway, and if the real one turns up later it's handed back as late, with the
+//same cycle as the repeat it replaces, so rollback can fix things. We only make up a couple in a row. Past that, we wait.
+//
+//Busy worker only. Stats can be read from anywhere, for display, and may tear.
+class ARTILLERYRUNTIME_API FArtilleryJitterBuffer
+{
+public:
+	//a power of two, and far more cycles than we'd ever hold.
+	static constexpr int32 Slots = 64;
+	//each packet carries this many cycles, so losing fewer than this many packets in a row loses nothing.
+	static constexpr int32 ClonesPerPacket = 3;
+	//two repeats in a row is about as far as a hold carries before a release starts reading wrong.
+	static constexpr int32 MaxConsecutiveRepeats = 2;
+	static constexpr int32 JitterMultiplier = 3;
+	static constexpr int32 MaxDelayMicros = 60000;
+	//how far the delay can move in a frame.
+	static constexpr int32 DelayStepMicros = 500;
+	//packets per transit window. the base transit is the lowest over this window and the one before it.
+	static constexpr int32 TransitWindow = 256;
+
+	struct FPlayout
+	{
+		TheCone::PacketElement Input = 0;
+		ArtilleryTime SentAt = 0;
+		//the real input for a cycle we already covered with a repeat.
+		bool Late = false;
+		//not the real input, just the last one again, covering for it.
+		bool Repeat = false;
+		uint64 Cycle = 0;
+	};
+
+	struct FStats
+	{
+		int32 JitterMicros = 0;
+		int32 BaseTransitMicros = 0;
+		int32 DelayMicros = 0;
+		int32 Depth = 0;
+		uint64 Played = 0;
+		uint64 Repeated = 0;
+		//frames that played more than one input.
+		uint64 Bunched = 0;
+		uint64 Late = 0;
+		//cycles we never got and stopped covering for.
+		uint64 Lost = 0;
+	};
+
+	//files every cycle the packet carries. ArrivedAt is when we got it, on the same clock as its transfer time.
+	void Receive(const TheCone::Packet_tpl& Packet, ArtilleryTime ArrivedAt);
+	//appends everything that should play by Now to Out, oldest first. call once a frame.
+	void Playout(ArtilleryTime Now, TArray<FPlayout>& Out);
+	void Reset();
+
+	FStats Stats;
+
+private:
+	struct FSlot
+	{
+		uint64 Cycle = 0;
+		TheCone::PacketElement Input = 0;
+		ArtilleryTime SentAt = 0;
+		bool Present = false;
+	};
+
+	FSlot& SlotFor(uint64 Cycle) { return Buffer[Cycle & (Slots - 1)]; }
+	void File(uint64 Cycle, TheCone::PacketElement Input, ArtilleryTime SentAt);
+	void Track(int32 Transit, ArtilleryTime SentAt, uint64 Cycle);
+	int32 Depth() const;
+	//wrap-safe, since the sliced clock cycles.
+	static int32 Since(ArtilleryTime Later, ArtilleryTime Earlier)
+	{
+		return static_cast<int32>(static_cast<uint32>(Later) - static_cast<uint32>(Earlier));
+	}
+
+	FSlot Buffer[Slots];
+	bool Started = false;
+	uint64 NextCycle = 0;
+	uint64 NewestCycle = 0;
+	//cycles we covered with a repeat, so the real ones can be flagged late when they show.
+	uint64 Covered[Slots] = {};
+	//late real inputs, handed out with the next playout.
+	TArray<FPlayout, TInlineAllocator<4>> PendingLate;
+	TheCone::PacketElement LastPlayed = 0;
+	ArtilleryTime LastSentAt = 0;
+	int32 RepeatsInARow = 0;
+
+	bool HaveTransit = false;
+	int32 LastTransit = 0;
+	int32 WindowMin = MAX_int32;
+	int32 PriorWindowMin = MAX_int32;
+	int32 WindowCount = 0;
+	//smoothed send spacing between consecutive cycles, for placing cycles we only got as clones.
+	int32 InputPeriodMicros = 1000000 / TheCone::BristleconeSendHertz;
+	uint64 PeriodCycle = 0;
+	ArtilleryTime PeriodSentAt = 0;
+	int32 JitterMicros = 0;
+	int32 DelayMicros = 0;
+};
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <thread>
 
 #include "CoreMinimal.h"
@@ -14,6 +15,7 @@ class FStateTreesWorker : public FRunnable
 	//This isn't super safe but like busy worker, ticklites only runs in one spot.
 	friend class UArtilleryDispatch;
 	ArtilleryTime LocalNow;
+	std::atomic<int32> FramesToRerun = 0;
 
 protected:
 	FSharedEventRef RunAheadStateTrees;
@@ -57,14 +59,13 @@ public:
 		UE_LOG(LogTemp, Display, TEXT("Artillery: Destructing AI thread."));
 	}
 	
-	virtual bool QueueRollback()
+	//the busy worker resimmed its last few frames. state trees run ahead rather than in lockstep, so there's nothing of
+	//ours to rewind; we just rerun the enemy sim for those ticks before the next one, so decisions made against the old
+	//timeline get remade against the new one.
+	virtual bool QueueRollback(int32 Frames)
 	{
-		//rollback is not implemented yet, but works by removing ticklikes added after the rollback's timestamp.
-		//then adding back in any expired ticklikes that should be revived, clearing the current tick, and beginning resim.
-		//Implementing this will not be easy, but it will suck a lot less than trying to do this with gameplay effects.
-		//This is one reason we advocate STRONGLY for the use of KEYS over references, as references to memmory location
-		//are not durable across rollbacks.
-		throw; 
+		FramesToRerun.fetch_add(Frames, std::memory_order_acq_rel);
+		return Frames > 0;
 	}
 
 	virtual bool Init() override
@@ -80,6 +81,12 @@ public:
 		int SeqNumber = 0;
 		DispatchOwner->ThreadSetup();
 		while(running) {
+			//never further back than we've actually been.
+			const int32 Rerun = FMath::Min(FramesToRerun.exchange(0, std::memory_order_acq_rel), SeqNumber);
+			for (int32 Back = Rerun; Back > 0; --Back)
+			{
+				DispatchOwner->RunEnemySim(SeqNumber - Back);
+			}
 			DispatchOwner->RunEnemySim(SeqNumber);
 			RunAheadStateTrees->Wait();
 			RunAheadStateTrees->Reset(); // we can run long on sim, not on apply.
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include <Ticklite.h>
+
+//A fixed handful of threads that exist only to run ticklite calc. Calc has no side effects outside the ticklite itself,
+//so the ticklites thread cuts the calc pass into chunks and everybody, the ticklites thread included, pulls chunks
+//until they're gone. Apply stays on the ticklites thread, in order, so none of this changes what the sim does, only
+//how long calc takes.
+//
+//The pool threads sleep on an event between passes, so they're free while the ticklites thread is waiting on apply.
+//If they're gone or slow to wake, the ticklites thread just does the chunks itself, so a pass can't get stuck.
+class ARTILLERYRUNTIME_API FArtilleryTickliteCalcPool
+{
+public:
+	static constexpr int32 WorkerCount = 3;
+	//ticklites per chunk. small enough to balance, big enough that claiming one is noise.
+	static constexpr int32 ChunkSize = 128;
+	//passes smaller than this aren't worth waking anyone for.
+	static constexpr int32 InlineBelow = ChunkSize * 2;
+
+	//a run of either a lane, or a group of shared ticklites.
+	struct FChunk
+	{
+		Arty::ITickliteLane* Lane = nullptr;
+		Arty::FTickliteHandle* Shared = nullptr;
+		int32 Begin = 0;
+		int32 End = 0;
+	};
+
+	FArtilleryTickliteCalcPool() = default;
+	~FArtilleryTickliteCalcPool();
+
+	//ThreadSetup runs once on each pool thread before it does anything, same as every other artillery thread.
+	void Start(TFunction<void()> ThreadSetup);
+	void Stop();
+
+	//ticklites thread only. returns once every chunk has been calculated.
+	void Calculate(uint64 UpcomingFrame, TConstArrayView<FChunk> Chunks);
+
+private:
+	class FCalcWorker final : public FRunnable
+	{
+	public:
+		FCalcWorker(FArtilleryTickliteCalcPool& InOwner) : Owner(InOwner) {}
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+
+		FArtilleryTickliteCalcPool& Owner;
+		FEvent* Wake = nullptr;
+		TUniquePtr<FRunnableThread> Thread;
+	};
+
+	static void RunChunk(const FChunk& Chunk, uint64 UpcomingFrame);
+	//claims and runs chunks from the current pass until there are none left.
+	void Drain();
+
+	TFunction<void()> OnThreadStart;
+	TArray<TUniquePtr<FCalcWorker>> Workers;
+	std::atomic<bool> Running = false;
+
+	//the pass. written before Cursor is reset, so anyone who claims from the new cursor sees it.
+	TConstArrayView<FChunk> Pass;
+	uint64 PassFrame = 0;
+	std::atomic<uint32> PassGeneration = 0;
+	//generation in the high half, next chunk in the low half. a thread still holding a claim on an old pass
+	//can tell, because the generation won't match.
+	std::atomic<uint64> Cursor = 0;
+	std::atomic<int32> Finished = 0;
+	std::atomic<int32> CheckedOut = 0;
+};
@@ -3,6 +3,9 @@
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
 #include <Ticklite.h>
+#include "Algo/StableSort.h"
+#include "FArtilleryTickliteCalcPool.h"
+#include <atomic>
 
 //this is a busy-style thread, which runs preset bodies of work in a specified order. Generally, the goal is that it never
 //actually sleeps. In fact, it only ever waits on the Artillery busy thread.
@@ -41,12 +44,19 @@
 //  
 // As a result of being unable to fire the frame they are added, and unable to fire guns on the frame they fire,
 // the fastest cadence we allow a ticklite to be checked at is 2. Cadences are aligned for entire groups.
-// Do not rely on cadence to ensure ordering.
+// Do not rely on cadence to ensure ordering. Cadence and start delays are set per ticklite with an FTickliteSchedule
+// when it's added, and a ticklite that isn't due is skipped outright: no calc, no apply, no expiry check.
 // 
 // If ordering is mandatory, absolutely mandatory, start by using Phase. If that's not a strong enough guarantee,
 // consider using either an ArtilleryAutoGun or triggering an ArtilleryGun from your ticklite. In general, though,
 // effects like thorns should apply in the last phase. Phases are intended to order ticklikes relative to other ticklikes.
 // Any additional ordering benefits they provide should be considered UB for the time being, and should not be relied on.
+// What is guaranteed is determinism: within a phase, ticklites run in the same order every tick, and on every client
+// that added the same ticklites with the same sort keys. Expiry never reorders the survivors.
+// 
+// Calc is fanned out across a small fixed pool, in chunks, since calc only reads world state and writes to the ticklite
+// doing the calc. Apply never is: it stays on this thread, in the order above. So a ticklite that writes anything
+// other than itself during calc is a bug, and now one that can bite.
 // 
 //  Good luck, and may the force be with you.
 template <typename UDispatch>
@@ -54,40 +64,200 @@ class FArtilleryTicklitesWorker : public FRunnable
 {
 	//This isn't super safe but like busy worker, ticklites only runs in one spot.
 	friend class UArtilleryDispatch;
+	//the tick the last apply ran for, by time and by busy worker frame. schedules only ever look at the frame. calc
+	//runs ahead of the frame advancing, so it guesses LocalFrame + 1, and apply calcs again if that guess was wrong.
 	ArtilleryTime LocalNow;
+	uint64 LocalFrame = 0;
 
 	static const int GroupCount = 4;
+	//shared pointer ticklites, per phase, in the order they were added.
 	TickliteGroup ExecutionGroups[GroupCount];
+	//pooled ticklites, per phase, one lane per ticklite type, lanes in the order their type first showed up.
+	//within a phase, shared ticklites run first, then each lane in turn.
+	struct FPhaseLane
+	{
+		Arty::ITicklitePool* Pool;
+		TUniquePtr<Arty::ITickliteLane> Lane;
+	};
+	TArray<FPhaseLane> Lanes[GroupCount];
+	//one cycle's worth of adds, sorted before any of them go in. kept around so it never allocates after warm up.
+	TArray<StampLiteRequest> AddBatch;
+	//calc fans out across this. apply never does.
+	FArtilleryTickliteCalcPool CalcPool;
+	TArray<FArtilleryTickliteCalcPool::FChunk> CalcChunks;
+
+	//ticks a resim replayed that we haven't caught up on yet, with their frames. guarded by ApplyLock.
+	TArray<TPair<ArtilleryTime, uint64>> PendingReplay;
+	//the ticks the lanes were last saved at, a ring. it's how far back they can be rewound.
+	ArtilleryTime SavedTicks[Arty::TickliteSaveDepth] = {};
+	uint64 Saves = 0;
+	//read off this thread, by the busy worker deciding whether it can resim. see CanRewindTo.
+	std::atomic<ArtilleryTime> OldestSave{0};
+	std::atomic<ArtilleryTime> SharedLiveThrough{0};
+
+	//phases only order apply. calc is side effect free, so every phase's calc goes out as one pass.
+	void CalculateAll(uint64 UpcomingFrame)
+	{
+		CalcChunks.Reset();
+		for (int32 Phase = 0; Phase < GroupCount; ++Phase)
+		{
+			AddCalcChunks(nullptr, ExecutionGroups[Phase].GetData(), ExecutionGroups[Phase].Num());
+			for (FPhaseLane& Lane : Lanes[Phase])
+			{
+				AddCalcChunks(Lane.Lane.Get(), nullptr, Lane.Lane->Num());
+			}
+		}
+		CalcPool.Calculate(UpcomingFrame, CalcChunks);
+	}
+
+	void ApplyAll(uint64 Frame)
+	{
+		for (int32 Phase = 0; Phase < GroupCount; ++Phase)
+		{
+			//either a ticklite expires and drops out, or we apply it and keep it. survivors are compacted down
+			//in place, so the order they run in never changes from tick to tick.
+			TickliteGroup& Group = ExecutionGroups[Phase];
+			int32 Kept = 0;
+			const int32 Count = Group.Num();
+			for (int32 index = 0; index < Count; ++index)
+			{
+				if (Group[index].Schedule.IsDue(Frame))
+				{
+					if (Group[index]->ShouldExpireTickable())
+					{
+						Group[index]->OnExpireTickable();
+						Group[index].Release();
+						continue;
+					}
+					Group[index]->ApplyTickable();
+				}
+				if (Kept != index)
+				{
+					Group[Kept] = MoveTemp(Group[index]);
+				}
+				++Kept;
+			}
+			if (Kept != Count)
+			{
+				Group.RemoveAt(Kept, Count - Kept, EAllowShrinking::No);
+			}
+
+			for (FPhaseLane& Lane : Lanes[Phase])
+			{
+				Lane.Lane->Apply(Frame);
+			}
+		}
+	}
+
+	//lanes copy themselves after every apply, so a resim can put them back. shared ticklites can't be copied, so
+	//instead we note the last tick any were live, and nobody rewinds to before that.
+	void SaveAll(ArtilleryTime Now)
+	{
+		bool AnyShared = false;
+		for (int32 Phase = 0; Phase < GroupCount; ++Phase)
+		{
+			AnyShared |= !ExecutionGroups[Phase].IsEmpty();
+			for (FPhaseLane& Lane : Lanes[Phase])
+			{
+				Lane.Lane->Save(Now);
+			}
+		}
+		if (AnyShared)
+		{
+			SharedLiveThrough.store(FMath::Max(SharedLiveThrough.load(std::memory_order_relaxed), Now), std::memory_order_release);
+		}
+		SavedTicks[Saves % Arty::TickliteSaveDepth] = Now;
+		++Saves;
+		if (Saves >= Arty::TickliteSaveDepth)
+		{
+			//the slot we'll overwrite next is the oldest one left.
+			OldestSave.store(SavedTicks[Saves % Arty::TickliteSaveDepth], std::memory_order_release);
+		}
+	}
+
+	void RestoreAll(ArtilleryTime Tick)
+	{
+		for (int32 Phase = 0; Phase < GroupCount; ++Phase)
+		{
+			for (FPhaseLane& Lane : Lanes[Phase])
+			{
+				if (!Lane.Lane->Restore(Tick))
+				{
+					UE_LOG(LogTemp, Warning, TEXT("Artillery:TicklitesWorker: A lane can't rewind to tick [%ld], it replays from where it is."), Tick);
+				}
+			}
+		}
+	}
+
+	void AddCalcChunks(Arty::ITickliteLane* Lane, Arty::FTickliteHandle* Shared, int32 Num)
+	{
+		for (int32 Begin = 0; Begin < Num; Begin += FArtilleryTickliteCalcPool::ChunkSize)
+		{
+			FArtilleryTickliteCalcPool::FChunk& Chunk = CalcChunks.AddDefaulted_GetRef();
+			Chunk.Lane = Lane;
+			Chunk.Shared = Shared;
+			Chunk.Begin = Begin;
+			Chunk.End = FMath::Min(Begin + FArtilleryTickliteCalcPool::ChunkSize, Num);
+		}
+	}
 
 protected:
 	TickliteBuffer QueuedAdds;
-	
-	TSharedPtr<TicklitePrototype> TickliteAdd(TSharedPtr<TicklitePrototype> AllocatedTL,  TicklitePhase Group)
+
+	static int32 PhaseIndex(TicklitePhase Group)
 	{
 		switch (Group)
 		{
-		case TicklitePhase::Early :
+		case TicklitePhase::Early : return 0;
+		case TicklitePhase::Normal : return 1;
+		case TicklitePhase::Late : return 2;
+		case TicklitePhase::FINAL_TICK_RESOLVE : return 3;
+		}
+		return -1;
+	}
+
+	Arty::ITickliteLane& LaneFor(int32 Phase, Arty::ITicklitePool* Pool)
+	{
+		for (FPhaseLane& Existing : Lanes[Phase])
+		{
+			if (Existing.Pool == Pool)
 			{
-				ExecutionGroups[0].Add(AllocatedTL);
-				return AllocatedTL;
+				return *Existing.Lane;
 			}
-		case TicklitePhase::Normal :
+		}
+		return *Lanes[Phase].Add_GetRef(FPhaseLane{Pool, Pool->MakeLane()}).Lane;
+	}
+	
+	void TickliteAdd(FTickliteHandle AllocatedTL,  TicklitePhase Group, ArtilleryTime Upcoming, uint64 UpcomingFrame)
+	{
+		const int32 Phase = PhaseIndex(Group);
+		if (Phase < 0)
+		{
+			AllocatedTL.Release();
+			return;
+		}
+		AllocatedTL.Schedule.NotBefore = UpcomingFrame + AllocatedTL.Schedule.Delay;
+		const bool CalcNow = AllocatedTL.Schedule.IsDue(UpcomingFrame);
+		if (AllocatedTL.Pool)
+		{
+			Arty::ITickliteLane& Lane = LaneFor(Phase, AllocatedTL.Pool);
+			const int32 Index = Lane.Adopt(AllocatedTL.Raw, AllocatedTL.Schedule);
+			//the lane has its own copy now. the staging slot goes straight back.
+			AllocatedTL.Release();
+			if (CalcNow)
 			{
-				ExecutionGroups[1].Add( AllocatedTL);
-				return AllocatedTL;
+				Lane.Calculate(UpcomingFrame, Index, Index + 1);
 			}
-		case TicklitePhase::Late :
+		}
+		else
+		{
+			SharedLiveThrough.store(FMath::Max(SharedLiveThrough.load(std::memory_order_relaxed), Upcoming), std::memory_order_release);
+			TicklitePrototype* Added = ExecutionGroups[Phase].Add_GetRef(AllocatedTL).Raw;
+			if (CalcNow)
 			{
-				ExecutionGroups[2].Add(AllocatedTL);
-				return AllocatedTL;
+				CalcINE(Added);
 			}
-		case TicklitePhase::FINAL_TICK_RESOLVE :
-			{
-				ExecutionGroups[3].Add(AllocatedTL);
-				return AllocatedTL;
-			}	
 		}
-		return nullptr;
 	}
 	//we may be able to remove sim or move it outside the run loop. I don't think there's anything wrong with simulating
 	//as fast as we can, and it buys us a lot of perf time by not sleeping the thread until it's apply time.
@@ -116,7 +286,16 @@ public:
 
 	void RequestAddTicklite(TSharedPtr<TicklitePrototype> ToAdd, TicklitePhase Group)
 	{
-		QueuedAdds->Enqueue(StampLiteRequest(ToAdd, Group));
+		RequestAddTicklite(FTickliteHandle(ToAdd), Group);
+	}
+
+	void RequestAddTicklite(FTickliteHandle ToAdd, TicklitePhase Group)
+	{
+		if (!QueuedAdds->Enqueue(StampLiteRequest(ToAdd, Group)))
+		{
+			//nobody else will ever see it, so it goes straight back.
+			ToAdd.Release();
+		}
 	}
 	
 	ArtilleryTime GetShadowNow() const
@@ -124,6 +303,12 @@ public:
 		return DispatchOwner->GetShadowNow();
 	}
 
+	//the busy worker frame that GetShadowNow belongs to.
+	uint64 GetShadowFrame() const
+	{
+		return DispatchOwner->GetShadowFrame();
+	}
+
 	AttrPtr GetAttrib(FSkeletonKey Target, AttribKey Attr)
 	{
 		return DispatchOwner->GetAttrib(Target, Attr);
@@ -171,18 +356,48 @@ public:
 	virtual ~FArtilleryTicklitesWorker() override
 	{
 		UE_LOG(LogTemp, Display, TEXT("Artillery: Destructing SimTicklites thread."));
+		//pools outlive us. anything still staged goes back, or it's lost to the pool until the process exits.
+		StampLiteRequest Unadded;
+		while (QueuedAdds && QueuedAdds->Dequeue(Unadded))
+		{
+			Unadded.Key.Release();
+		}
 	}
 	
-	virtual bool QueueRollback()
+	//the busy worker has rewound attributes and tags and resimmed these ticks, oldest first. before our next apply, we
+	//put the lanes back how they stood going into the first of them, then calc and apply each again, against the
+	//rewound state. a ticklite added after a replayed tick isn't due on it yet, so it's skipped there for free.
+	//Shared ticklites can't be put back, so the busy worker checks CanRewindTo first and won't resim over them. This is
+	//still one reason we advocate STRONGLY for the use of KEYS over references, as references to memmory location are
+	//not durable across rollbacks.
+	//call it while holding ApplyLock, so it can't land between a rewind and the apply that should see it.
+	//replayed frames are consecutive, so the first one's number is enough to schedule them all.
+	virtual bool QueueRollback(TConstArrayView<ArtilleryTime> ReplayTicks, uint64 FirstFrame)
 	{
-		//rollback is not implemented yet, but works by removing ticklikes added after the rollback's timestamp.
-		//then adding back in any expired ticklikes that should be revived, clearing the current tick, and beginning resim.
-		//Implementing this will not be easy, but it will suck a lot less than trying to do this with gameplay effects.
-		//This is one reason we advocate STRONGLY for the use of KEYS over references, as references to memmory location
-		//are not durable across rollbacks.
-		throw; 
+		FScopeLock Lock(&ApplyLock);
+		if (!ReplayTicks.IsEmpty())
+		{
+			//a second resim before we caught up on the first redoes whatever they overlap. those go once, newest.
+			const ArtilleryTime From = ReplayTicks[0];
+			PendingReplay.RemoveAll([From](const TPair<ArtilleryTime, uint64>& Pending) { return Pending.Key >= From; });
+			for (int32 i = 0; i < ReplayTicks.Num(); ++i)
+			{
+				PendingReplay.Emplace(ReplayTicks[i], FirstFrame + i);
+			}
+		}
+		return !PendingReplay.IsEmpty();
+	}
+
+	//whether we can be put back how we stood after applying AfterTick. the busy worker asks before it resims.
+	bool CanRewindTo(ArtilleryTime AfterTick) const
+	{
+		return OldestSave.load(std::memory_order_acquire) <= AfterTick
+			&& SharedLiveThrough.load(std::memory_order_acquire) < AfterTick;
 	}
 
+	//held for the whole of an apply. a resim holds it to keep us from applying into state it's rewinding.
+	FCriticalSection ApplyLock;
+
 	virtual bool Init() override
 	{
 		LocalNow = 0;
@@ -192,7 +407,7 @@ public:
 	}
 	
 	//TODO: ADD NULL GUARDS OR COPY. PREFER GUARD.
-	void CalcINE(TSharedPtr<TicklitePrototype>& x)
+	void CalcINE(TicklitePrototype* x)
 	{
 		if( x->ShouldExpireTickable())
 		{
@@ -205,66 +420,69 @@ public:
 		}
 	}
 
-	//adding cadence is going to be quite annoying.
 	virtual uint32 Run() override
 	{
 		StartTicklitesSim->Wait();
 		DispatchOwner->ThreadSetup();
+		CalcPool.Start([this]()
+		{
+			DispatchOwner->ThreadSetup();
+		});
+		LocalNow = GetShadowNow();
+		LocalFrame = GetShadowFrame();
 		while(running) {
-
-			for(TickliteGroup& Group : ExecutionGroups)
-			{
-				for(TSharedPtr<TicklitePrototype> Tickable : Group)
-				{
-					CalcINE(Tickable);
-				}
-			}
+			const ArtilleryTime Upcoming = LocalNow + 1;
+			const uint64 UpcomingFrame = LocalFrame + 1;
+			CalculateAll(UpcomingFrame);
 			
 			//if we have any ticklite requests, perform their calculations here and then
 			//add them.
 			//TODO: Reassess 12/10/24
 			//this may cause consistency issues during resim, as artillery guns are fired on the main thread
 			//which is not cadence-locked to the artillery threads. however, during resim, I believe this can be
-			//resolved with the ticklite's add timestamp. and until we have resim, this is a non-issue.
-			while(!QueuedAdds->IsEmpty())
+			//resolved with the ticklite's add timestamp. right now a resim's rerun guns add on the tick they land on.
+			//the queue's order depends on which thread got there first, so sort the batch before anything goes in.
+			AddBatch.Reset();
+			StampLiteRequest AddTup;
+			while(QueuedAdds->Dequeue(AddTup))
 			{
-				const StampLiteRequest AddTup = *QueuedAdds->Peek();
-				TSharedPtr<TicklitePrototype> ptr =  TickliteAdd(AddTup.Key, AddTup.Value);
-				if(ptr)
-				{
-					CalcINE(ptr);
-				}
-				QueuedAdds->Dequeue();
+				AddBatch.Add(MoveTemp(AddTup));
+			}
+			Algo::StableSortBy(AddBatch, [](const StampLiteRequest& Request) { return Request.Key.SortKey; });
+			for (StampLiteRequest& Request : AddBatch)
+			{
+				TickliteAdd(MoveTemp(Request.Key), Request.Value, Upcoming, UpcomingFrame);
 			}
+			AddBatch.Reset();
 			
 			StartTicklitesApply->Wait();
 			StartTicklitesApply->Reset(); // we can run long on sim, not on apply.
-
-			for (auto& Group : ExecutionGroups)
+			FScopeLock Lock(&ApplyLock);
+			bool Recalc = false;
+			if (!PendingReplay.IsEmpty())
 			{
-				//this is just to make it clearer, 0 works just as well.
-				int finalsize =  Group.IsEmpty() ? -1 : Group.Num();
-				for(int index = 0; index < finalsize;)
+				//a resim went back past us. rewind, catch up on the ticks it replayed, then redo the calc we did ahead of it.
+				RestoreAll(PendingReplay[0].Key);
+				for (const TPair<ArtilleryTime, uint64>& Replayed : PendingReplay)
 				{
-					//either a ticklite expires, and the count remaining drops by one, or we process it and move to next.
-					if(Group[index]->ShouldExpireTickable())
-					{
-						Group[index]->OnExpireTickable();
-						//TODO good chance we must save the ticklites from older frames that have expired if we want any hope at determinism
-						//TODO THIS VIOLATES ORDERING. ...kinda. it's complicated. look, you almost certainly don't want it here.
-						//we probably need to use sorted array anyway.
-						Group.RemoveAtSwap(index, EAllowShrinking::No); //https://github.com/JKurzer/Bristle54/issues/24#issue-2567178871 GH Issue 24: SWQP?!
-						
-						--finalsize;//hohoho. merry nothingmas.
-					}
-					else
-					{
-						Group[index]->ApplyTickable();
-						index++;
-					}
+					CalculateAll(Replayed.Value);
+					ApplyAll(Replayed.Value);
+					SaveAll(Replayed.Key);
 				}
-			}	
+				PendingReplay.Reset();
+				Recalc = true;
+			}
+			LocalNow = GetShadowNow();
+			LocalFrame = GetShadowFrame();
+			//if the busy worker got more than one frame ahead of us, calc ran for a frame that isn't the one we're applying.
+			if (Recalc || LocalFrame != UpcomingFrame)
+			{
+				CalculateAll(LocalFrame);
+			}
+			ApplyAll(LocalFrame);
+			SaveAll(LocalNow);
 		}
+		CalcPool.Stop();
 	
 		return 0;
 	}
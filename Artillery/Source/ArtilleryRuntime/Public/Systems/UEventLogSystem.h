@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <atomic>
 #include "CoreMinimal.h"
 #include "ArtilleryDispatch.h"
 #include "SkeletonTypes.h"
@@ -12,6 +13,7 @@ UENUM(BlueprintType, Blueprintable)
 enum class E_EventLogType : uint8
 {
 	Died,
+	MAX UMETA(Hidden)
 };
 
 USTRUCT()
@@ -26,6 +28,79 @@ struct FArtilleryEvent
 	FSkeletonKey OtherKey;
 };
 
+class UEventLogSubsystem;
+
+//Events of one type, oldest first. A view reads the log in place, so it's good until the next LogEvent, and like
+//LogEvent it's game thread only. Expiry on the busy worker never invalidates one, it only makes the log forget.
+class ARTILLERYRUNTIME_API FArtilleryEventTypeView
+{
+public:
+	class FIterator
+	{
+	public:
+		FIterator(const FArtilleryEventTypeView& InView, uint64 InAt) : View(InView), At(InAt) {}
+		const FArtilleryEvent& operator*() const;
+		FIterator& operator++() { ++At; return *this; }
+		bool operator!=(const FIterator& Other) const { return At != Other.At; }
+
+	private:
+		const FArtilleryEventTypeView& View;
+		uint64 At;
+	};
+
+	FArtilleryEventTypeView(const UEventLogSubsystem* InLog, E_EventLogType InType, uint64 InFrom, uint64 InTo)
+		: Log(InLog), Type(InType), From(InFrom), To(InTo) {}
+
+	FIterator begin() const { return FIterator(*this, From); }
+	FIterator end() const { return FIterator(*this, To); }
+	int32 Num() const { return static_cast<int32>(To - From); }
+	bool IsEmpty() const { return From == To; }
+
+private:
+	const UEventLogSubsystem* Log;
+	E_EventLogType Type;
+	uint64 From;
+	uint64 To;
+};
+
+//Events an entity was either side of, newest first. Same rules as the type view.
+class ARTILLERYRUNTIME_API FArtilleryEntityEventView
+{
+public:
+	class FIterator
+	{
+	public:
+		FIterator(const FArtilleryEntityEventView& InView, uint64 InAt) : View(InView), At(InAt) {}
+		const FArtilleryEvent& operator*() const;
+		FIterator& operator++();
+		bool operator!=(const FIterator& Other) const { return At != Other.At; }
+
+	private:
+		const FArtilleryEntityEventView& View;
+		uint64 At;
+	};
+
+	FArtilleryEntityEventView(const UEventLogSubsystem* InLog, FSkeletonKey InEntity, uint64 InLatest, uint64 InOldest)
+		: Log(InLog), Entity(InEntity), Latest(InLatest), Oldest(InOldest) {}
+
+	FIterator begin() const { return FIterator(*this, Latest); }
+	FIterator end() const { return FIterator(*this, 0); }
+	bool IsEmpty() const { return Latest == 0; }
+
+private:
+	const UEventLogSubsystem* Log;
+	FSkeletonKey Entity;
+	uint64 Latest;
+	//anything before this has expired, even if it's still sitting in the ring.
+	uint64 Oldest;
+};
+
+//The log is a fixed ring of events, numbered in the order they were logged. Every event lives the same number of ticks,
+//so they expire in order too, and expiry is just the busy worker walking the tail forward. Alongside the ring sit an
+//index of event numbers per type and a chain per entity, so nothing ever has to scan the whole log.
+//
+//LogEvent and the queries belong to the game thread, which is the only thing that writes the ring and the indices.
+//The busy worker only ever moves the tail.
 UCLASS()
 class ARTILLERYRUNTIME_API UEventLogSubsystem : public UTickableWorldSubsystem, public ISkeletonLord, public ITickHeavy
 {
@@ -35,9 +110,12 @@ public:
 	static inline UEventLogSubsystem* SelfPtr = nullptr;
 	constexpr static int OrdinateSeqKey = ORDIN::E_D_C::EventLogSystem;
 	
-	UEventLogSubsystem() : MyDispatch(nullptr), EventLog()
-	{
-	}
+	//power of two. if the ring fills before events expire, the oldest are dropped early.
+	static constexpr int32 Capacity = 4096;
+	static constexpr int32 LifeInTicks = 5 * 120;
+	static constexpr int32 TypeCount = static_cast<int32>(E_EventLogType::MAX);
+
+	UEventLogSubsystem();
 
 	virtual bool RegistrationImplementation() override;
 
@@ -45,7 +123,8 @@ public:
 	
 	void LogEvent(E_EventLogType LogType, FSkeletonKey LoggingKey, FSkeletonKey Other = FSkeletonKey::Invalid());
 
-	TArray<FArtilleryEvent> GetEventsOfType(E_EventLogType LogType) const;
+	FArtilleryEventTypeView GetEventsOfType(E_EventLogType LogType) const;
+	FArtilleryEntityEventView GetEventsFor(FSkeletonKey Entity) const;
 
 	TStatId GetStatId() const
 	{
@@ -59,5 +138,55 @@ protected:
 	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
 	
 private:
+	friend class FArtilleryEventTypeView;
+	friend class FArtilleryEntityEventView;
+	friend class FArtilleryEventTypeView::FIterator;
+	friend class FArtilleryEntityEventView::FIterator;
+	static constexpr uint64 Mask = Capacity - 1;
+
+	//where each entity's chain goes next, for whichever side of the event it was on.
+	struct FEventLinks
+	{
+		uint64 PrevForLogging = 0;
+		uint64 PrevForOther = 0;
+	};
+
+	//moves the tail up to Target, unless someone already moved it further.
+	void AdvanceTail(uint64 Target);
+	//drops entity chain heads that have expired, and moves each type's tail past them. game thread.
+	void PruneEntities();
+	void Link(FSkeletonKey Entity, uint64 Number, uint64& Prev);
+
+	//event numbers start at 1, so 0 can end a chain.
 	TArray<FArtilleryEvent> EventLog;
+	TArray<FEventLinks> Links;
+	std::atomic<uint64> Head = 1;
+	std::atomic<uint64> Tail = 1;
+
+	TArray<uint64> ByType[TypeCount];
+	uint64 TypeHead[TypeCount];
+	uint64 TypeTail[TypeCount];
+
+	TMap<FSkeletonKey, uint64> LatestFor;
+	uint64 PrunedTo = 1;
 };
+
+inline const FArtilleryEvent& FArtilleryEventTypeView::FIterator::operator*() const
+{
+	const uint64 Number = View.Log->ByType[static_cast<int32>(View.Type)][At & UEventLogSubsystem::Mask];
+	return View.Log->EventLog[Number & UEventLogSubsystem::Mask];
+}
+
+inline const FArtilleryEvent& FArtilleryEntityEventView::FIterator::operator*() const
+{
+	return View.Log->EventLog[At & UEventLogSubsystem::Mask];
+}
+
+inline FArtilleryEntityEventView::FIterator& FArtilleryEntityEventView::FIterator::operator++()
+{
+	const FArtilleryEvent& Event = View.Log->EventLog[At & UEventLogSubsystem::Mask];
+	const UEventLogSubsystem::FEventLinks& Links = View.Log->Links[At & UEventLogSubsystem::Mask];
+	const uint64 Prev = Event.LoggingKey == View.Entity ? Links.PrevForLogging : Links.PrevForOther;
+	At = Prev >= View.Oldest ? Prev : 0;
+	return *this;
+}
@@ -0,0 +1,195 @@
+﻿#include "BarrageContactStream.h"
+#include "Algo/Sort.h"
+
+using namespace JPH;
+
+namespace
+{
+	bool IsProjectile(uint64 Owner, ObjectLayer Layer)
+	{
+		return Layer == Layers::PROJECTILE || Layer == Layers::ENEMYPROJECTILE || IS_OF_SK_TYPE(Owner, SKELLY::SFIX_GUN_SHOT);
+	}
+
+	bool IsCharacter(ObjectLayer Layer)
+	{
+		return Layer == Layers::MOVING || Layer == Layers::ENEMY || Layer == Layers::BONKFREEENEMY || Layer == Layers::HITBOX;
+	}
+}
+
+void FBContactEventStream::FGroup::Init(int32 InCapacity)
+{
+	Capacity = InCapacity;
+	Count = 0;
+	Type.SetNumUninitialized(Capacity);
+	Body1.SetNum(Capacity);
+	Body2.SetNum(Capacity);
+	Owner1.SetNum(Capacity);
+	Owner2.SetNum(Capacity);
+	Layer1.SetNumZeroed(Capacity);
+	Layer2.SetNumZeroed(Capacity);
+	ProjectileSides.SetNumZeroed(Capacity);
+	Order.SetNumUninitialized(Capacity);
+	ScratchType.SetNumUninitialized(Capacity);
+	ScratchBody1.SetNum(Capacity);
+	ScratchBody2.SetNum(Capacity);
+	ScratchOwner1.SetNum(Capacity);
+	ScratchOwner2.SetNum(Capacity);
+	ScratchLayer1.SetNumZeroed(Capacity);
+	ScratchLayer2.SetNumZeroed(Capacity);
+	ScratchProjectileSides.SetNumZeroed(Capacity);
+}
+
+int32 FBContactEventStream::FGroup::Claim()
+{
+	//count can run past capacity while we're full. drain clamps it, so all that costs is the add.
+	const int32 Slot = Count.fetch_add(1, std::memory_order_relaxed);
+	if (Slot >= Capacity)
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return -1;
+	}
+	return Slot;
+}
+
+void FBContactEventStream::FGroup::SortForDeterminism(int32 Num)
+{
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Order[i] = i;
+	}
+	Algo::Sort(TArrayView<int32>(Order.GetData(), Num), [this](int32 A, int32 B)
+	{
+		if (Type[A] != Type[B])
+		{
+			return Type[A] < Type[B];
+		}
+		if (Body1[A].KeyIntoBarrage != Body1[B].KeyIntoBarrage)
+		{
+			return Body1[A].KeyIntoBarrage < Body1[B].KeyIntoBarrage;
+		}
+		return Body2[A].KeyIntoBarrage < Body2[B].KeyIntoBarrage;
+	});
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const int32 From = Order[i];
+		ScratchType[i] = Type[From];
+		ScratchBody1[i] = Body1[From];
+		ScratchBody2[i] = Body2[From];
+		ScratchOwner1[i] = Owner1[From];
+		ScratchOwner2[i] = Owner2[From];
+		ScratchLayer1[i] = Layer1[From];
+		ScratchLayer2[i] = Layer2[From];
+		ScratchProjectileSides[i] = ProjectileSides[From];
+	}
+	Swap(Type, ScratchType);
+	Swap(Body1, ScratchBody1);
+	Swap(Body2, ScratchBody2);
+	Swap(Owner1, ScratchOwner1);
+	Swap(Owner2, ScratchOwner2);
+	Swap(Layer1, ScratchLayer1);
+	Swap(Layer2, ScratchLayer2);
+	Swap(ProjectileSides, ScratchProjectileSides);
+}
+
+FBContactEventStream::FBContactEventStream(int32 ProjectileCapacity, int32 OtherCapacity)
+{
+	for (uint8 g = 0; g < static_cast<uint8>(EBarrageContactGroup::NUM); ++g)
+	{
+		Groups[g].Init(g == static_cast<uint8>(EBarrageContactGroup::Projectile) ? ProjectileCapacity : OtherCapacity);
+	}
+}
+
+EBarrageContactGroup FBContactEventStream::GroupOf(uint64 Owner1, ObjectLayer Layer1, uint64 Owner2, ObjectLayer Layer2)
+{
+	if (IsProjectile(Owner1, Layer1) || IsProjectile(Owner2, Layer2))
+	{
+		return EBarrageContactGroup::Projectile;
+	}
+	if (IsCharacter(Layer1) || IsCharacter(Layer2))
+	{
+		return EBarrageContactGroup::Character;
+	}
+	if (Layer1 == Layers::NON_MOVING || Layer2 == Layers::NON_MOVING)
+	{
+		return EBarrageContactGroup::Static;
+	}
+	return EBarrageContactGroup::Other;
+}
+
+void FBContactEventStream::Push(EBarrageContactEventType Type, FBarrageKey Key1, const Body& Body1, FBarrageKey Key2, const Body& Body2)
+{
+	const uint64 Owner1 = Body1.GetUserData();
+	const uint64 Owner2 = Body2.GetUserData();
+	//same test GroupOf uses, kept per side, so consumers agree with the grouping about which side is the projectile.
+	const uint8 Sides = (IsProjectile(Owner1, Body1.GetObjectLayer()) ? FBContactEventSpan::ProjectileSide1 : 0)
+		| (IsProjectile(Owner2, Body2.GetObjectLayer()) ? FBContactEventSpan::ProjectileSide2 : 0);
+	FGroup& Group = Groups[static_cast<uint8>(GroupOf(Owner1, Body1.GetObjectLayer(), Owner2, Body2.GetObjectLayer()))];
+	const int32 Slot = Group.Claim();
+	if (Slot < 0)
+	{
+		return;
+	}
+	Group.Type[Slot] = Type;
+	Group.Body1[Slot] = Key1;
+	Group.Body2[Slot] = Key2;
+	Group.Owner1[Slot] = FSkeletonKey(Owner1);
+	Group.Owner2[Slot] = FSkeletonKey(Owner2);
+	Group.Layer1[Slot] = static_cast<uint8>(Body1.GetObjectLayer());
+	Group.Layer2[Slot] = static_cast<uint8>(Body2.GetObjectLayer());
+	Group.ProjectileSides[Slot] = Sides;
+}
+
+void FBContactEventStream::PushRemoved(FBarrageKey Key1, FBarrageKey Key2)
+{
+	//jolt can't promise the bodies still exist here, so there's nothing to classify on.
+	FGroup& Group = Groups[static_cast<uint8>(EBarrageContactGroup::Other)];
+	const int32 Slot = Group.Claim();
+	if (Slot < 0)
+	{
+		return;
+	}
+	Group.Type[Slot] = EBarrageContactEventType::REMOVED;
+	Group.Body1[Slot] = Key1;
+	Group.Body2[Slot] = Key2;
+	Group.Owner1[Slot] = FSkeletonKey();
+	Group.Owner2[Slot] = FSkeletonKey();
+	Group.Layer1[Slot] = Layers::NUM_LAYERS;
+	Group.Layer2[Slot] = Layers::NUM_LAYERS;
+	Group.ProjectileSides[Slot] = 0;
+}
+
+void FBContactEventStream::Drain(TFunctionRef<void(EBarrageContactGroup, const FBContactEventSpan&)> Visit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Drain Contact Events");
+	for (uint8 g = 0; g < static_cast<uint8>(EBarrageContactGroup::NUM); ++g)
+	{
+		FGroup& Group = Groups[g];
+		const uint64 Dropped = Group.Dropped.load(std::memory_order_relaxed);
+		if (Dropped != Group.DroppedReported)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Barrage: contact group %d dropped %llu events, it only holds %d a step."), g, Dropped - Group.DroppedReported, Group.Capacity);
+			Group.DroppedReported = Dropped;
+		}
+
+		const int32 Num = FMath::Min(Group.Count.load(std::memory_order_relaxed), Group.Capacity);
+		if (Num == 0)
+		{
+			continue;
+		}
+		Group.SortForDeterminism(Num);
+
+		FBContactEventSpan Span;
+		Span.Num = Num;
+		Span.Type = Group.Type.GetData();
+		Span.Body1 = Group.Body1.GetData();
+		Span.Body2 = Group.Body2.GetData();
+		Span.Owner1 = Group.Owner1.GetData();
+		Span.Owner2 = Group.Owner2.GetData();
+		Span.Layer1 = Group.Layer1.GetData();
+		Span.Layer2 = Group.Layer2.GetData();
+		Span.ProjectileSides = Group.ProjectileSides.GetData();
+		Visit(static_cast<EBarrageContactGroup>(g), Span);
+
+		Group.Count.store(0, std::memory_order_relaxed);
+	}
+}
@@ -1,6 +1,7 @@
 #include "BarrageDispatch.h"
 
 #include "BarrageContactEvent.h"
+#include "BarrageContactStream.h"
 #include "IsolatedJoltIncludes.h"
 #include "FWorldSimOwner.h"
 #include "CoordinateUtils.h"
@@ -22,7 +23,7 @@ bool UBarrageDispatch::RegistrationImplementation()
 
 	UE_LOG(LogTemp, Warning, TEXT("Barrage:TransformUpdateQueue: Online"));
 	GameTransformPump = MakeShareable(new TransformUpdatesForGameThread(20024));
-	ContactEventPump = MakeShareable(new TCircularQueue<BarrageContactEvent>(8192));
+	ContactEvents = MakeShareable(new FBContactEventStream(ProjectileContactCapacity, GroupContactCapacity));
 	FBarragePrimitive::GlobalBarrage = this;
 	//this approach may actually be too slow. it is pleasingly lockless, but it allocs 16megs
 	//and just iterating through that could be Rough for the gamethread.
@@ -33,7 +34,7 @@ bool UBarrageDispatch::RegistrationImplementation()
 	//used by UE delegates. Bind isn't exactly like a delegate though, because this actually performs a pretty slick typehiding trick
 	//which allows us to cleanly break a dependency.
 	std::function<void(int)> bind = std::bind(&UBarrageDispatch::GrantWorkerFeed, this, std::placeholders::_1);
-	JoltGameSim = MakeShareable(new FWorldSimOwner(TickRateInDelta, bind));
+	JoltGameSim = MakeShareable(new FWorldSimOwner(TickRateInDelta, bind, BroadPhaseKind));
 	JoltBodyLifecycleMapping = MakeShareable(new KeyToFBLet());
 	TranslationMapping = MakeShareable(new KeyToKey());
 	SelfPtr = this;
@@ -108,20 +109,23 @@ void UBarrageDispatch::Deinitialize()
 	}
 	HoldOpen = nullptr;
 
-	TSharedPtr<TCircularQueue<BarrageContactEvent>> HoldOpen2 = ContactEventPump;
-	ContactEventPump = nullptr;
-	if (HoldOpen2)
+	TSharedPtr<FBContactEventStream> HoldOpen2 = ContactEvents;
+	ContactEvents = nullptr;
+	if (HoldOpen2 && HoldOpen2.GetSharedReferenceCount() > 1)
 	{
-		if (HoldOpen2.GetSharedReferenceCount() > 1)
+		UE_LOG(LogTemp, Warning,
+		       TEXT(
+			       "Hey, so something's holding live references to the contact stream. Maybe. Shared Ref Count is not reliable."
+		       ));
+	}
+	HoldOpen2 = nullptr;
+	{
+		FScopeLock ConsumerLock(&ContactConsumerLock);
+		for (TArray<FBContactConsumer>& Consumers : ContactConsumers)
 		{
-			UE_LOG(LogTemp, Warning,
-			       TEXT(
-				       "Hey, so something's holding live references to the contact queue. Maybe. Shared Ref Count is not reliable."
-			       ));
+			Consumers.Empty();
 		}
-		HoldOpen2->Empty();
 	}
-	HoldOpen2 = nullptr;
 }
 
 void UBarrageDispatch::SphereCast(
@@ -181,6 +185,49 @@ void UBarrageDispatch::CastRay(
 	}
 }
 
+void UBarrageDispatch::SphereCastBatch(
+	TConstArrayView<FBSphereCastRequest> Requests,
+	TArrayView<FBCastHit> OutHits,
+	const JPH::BroadPhaseLayerFilter& BroadPhaseFilter,
+	const JPH::ObjectLayerFilter& ObjectFilter)
+{
+	check(OutHits.Num() >= Requests.Num());
+	TSharedPtr<FWorldSimOwner> HoldOpen = JoltGameSim;
+	if (HoldOpen && !Requests.IsEmpty())
+	{
+		HoldOpen->SphereCastBatch(Requests, OutHits, BroadPhaseFilter, ObjectFilter);
+	}
+}
+
+void UBarrageDispatch::CastRayBatch(
+	TConstArrayView<FBRayCastRequest> Requests,
+	TArrayView<FBCastHit> OutHits,
+	const JPH::BroadPhaseLayerFilter& BroadPhaseFilter,
+	const JPH::ObjectLayerFilter& ObjectFilter)
+{
+	check(OutHits.Num() >= Requests.Num());
+	TSharedPtr<FWorldSimOwner> HoldOpen = JoltGameSim;
+	if (HoldOpen && !Requests.IsEmpty())
+	{
+		HoldOpen->CastRayBatch(Requests, OutHits, BroadPhaseFilter, ObjectFilter);
+	}
+}
+
+void UBarrageDispatch::SphereSearchBatch(
+	TConstArrayView<FBSphereSearchRequest> Requests,
+	TArrayView<FBSearchSpan> OutSpans,
+	TArray<uint32>& OutFoundObjects,
+	const JPH::BroadPhaseLayerFilter& BroadPhaseFilter,
+	const JPH::ObjectLayerFilter& ObjectFilter)
+{
+	check(OutSpans.Num() >= Requests.Num());
+	TSharedPtr<FWorldSimOwner> HoldOpen = JoltGameSim;
+	if (HoldOpen && !Requests.IsEmpty())
+	{
+		HoldOpen->SphereSearchBatch(Requests, OutSpans, OutFoundObjects, BroadPhaseFilter, ObjectFilter);
+	}
+}
+
 //Defactoring the pointer management has actually made this much clearer than I expected.
 //these functions are overload polymorphic against our non-polymorphic POD params classes.
 //this is because over time, the needs of these classes may diverge and multiply
@@ -248,6 +295,7 @@ FBLet UBarrageDispatch::ManagePointers(FSkeletonKey OutKey, FBarrageKey temp, FB
 	indirect->Me = form;
 	JoltBodyLifecycleMapping->insert_or_assign(indirect->KeyIntoBarrage, indirect);
 	TranslationMapping->insert_or_assign(indirect->KeyOutOfBarrage, indirect->KeyIntoBarrage);
+	JoltGameSim->SetBodyOwner(temp, OutKey);
 	return indirect;
 }
 
@@ -264,6 +312,7 @@ FBLet UBarrageDispatch::LoadComplexStaticMesh(FBTransform& MeshTransform,
 		{
 			JoltBodyLifecycleMapping->insert_or_assign(shared->KeyIntoBarrage, shared);
 			TranslationMapping->insert_or_assign(OutKey, shared->KeyIntoBarrage);
+			JoltGameSim->SetBodyOwner(shared->KeyIntoBarrage, OutKey);
 		}
 		return shared;
 	}
@@ -335,10 +384,93 @@ TStatId UBarrageDispatch::GetStatId() const
 	RETURN_QUICK_DECLARE_CYCLE_STAT(UBarrageDispatch, STATGROUP_Tickables);
 }
 
+//LSD radix over the drained input set. we sort indices rather than the inputs themselves, so each pass moves
+//4 bytes per element instead of 48. key order, most significant first: body key, sequence number, action.
+//passes where every element lands in the same bucket are skipped, and that's most of them - the top half of a
+//barrage key is the world, the action fits in a byte, and sequence numbers are small.
+//returns whichever of the two buffers ended up holding the sorted order.
+static uint32* RadixSortInputs(const FBPhysicsInput* Inputs, uint32* Order, uint32* Scratch, uint32 Count)
+{
+	constexpr int Passes = 1 + 8 + 8;
+	auto ByteOf = [](const FBPhysicsInput& Input, int Pass) -> uint8
+	{
+		if (Pass == 0)
+		{
+			return static_cast<uint8>(Input.Action);
+		}
+		if (Pass <= 8)
+		{
+			return static_cast<uint8>(Input.Sequence >> ((Pass - 1) * 8));
+		}
+		return static_cast<uint8>(Input.Target.KeyIntoBarrage >> ((Pass - 9) * 8));
+	};
+
+	for (uint32 i = 0; i < Count; ++i)
+	{
+		Order[i] = i;
+	}
+	for (int Pass = 0; Pass < Passes; ++Pass)
+	{
+		uint32 Histogram[256] = {};
+		for (uint32 i = 0; i < Count; ++i)
+		{
+			++Histogram[ByteOf(Inputs[i], Pass)];
+		}
+		if (Histogram[ByteOf(Inputs[0], Pass)] == Count)
+		{
+			continue; //everyone's in one bucket, so this pass can't change anything.
+		}
+		uint32 Running = 0;
+		for (uint32& Bucket : Histogram)
+		{
+			const uint32 Here = Bucket;
+			Bucket = Running;
+			Running += Here;
+		}
+		for (uint32 i = 0; i < Count; ++i)
+		{
+			const uint32 Index = Order[i];
+			Scratch[Histogram[ByteOf(Inputs[Index], Pass)]++] = Index;
+		}
+		Swap(Order, Scratch);
+	}
+	return Order;
+}
+
+//inputs that tie on body, sequence, and action come from different threads, and the drain order between threads
+//isn't something we control. the payload breaks the tie, so the order - and the float sums we do over it - come out
+//the same on every machine. these runs are nearly always one or two long.
+static void BreakInputTies(const FBPhysicsInput* Inputs, uint32* Order, uint32 Count)
+{
+	auto SameSlot = [](const FBPhysicsInput& A, const FBPhysicsInput& B)
+	{
+		return A.Target == B.Target && A.Sequence == B.Sequence && A.Action == B.Action;
+	};
+	uint32 RunStart = 0;
+	for (uint32 i = 1; i <= Count; ++i)
+	{
+		if (i == Count || !SameSlot(Inputs[Order[i]], Inputs[Order[RunStart]]))
+		{
+			for (uint32 j = RunStart + 1; j < i; ++j)
+			{
+				const uint32 Moving = Order[j];
+				uint32 k = j;
+				while (k > RunStart && FMemory::Memcmp(&Inputs[Order[k - 1]].State, &Inputs[Moving].State, sizeof(JPH::Quat)) > 0)
+				{
+					Order[k] = Order[k - 1];
+					--k;
+				}
+				Order[k] = Moving;
+			}
+			RunStart = i;
+		}
+	}
+}
+
 void UBarrageDispatch::StackUp()
 {
-	uint16_t RefilledUpTo = 0;
-	uint16_t Adding = 0;
+	uint32 RefilledUpTo = 0;
+	uint32 Adding = 0;
 	if (JoltGameSim)
 	{
 		//accumulate.
@@ -349,7 +481,8 @@ void UBarrageDispatch::StackUp()
 			if (WorldSimOwnerFeedMap.Queue && ((HoldOpenThreadQueue != nullptr)) && WorldSimOwnerFeedMap.That !=
 				std::thread::id()) //if there IS a thread.
 			{
-				while (HoldOpenThreadQueue.Get() && !HoldOpenThreadQueue->IsEmpty())
+				//if we're full, the rest waits for next tick rather than running off the end of the set.
+				while (HoldOpenThreadQueue.Get() && !HoldOpenThreadQueue->IsEmpty() && RefilledUpTo < MaxInputsPerStackUp)
 				{
 					const FBPhysicsInput* input = HoldOpenThreadQueue->Peek();
 					InternalSortableSet[RefilledUpTo] = *input;
@@ -359,11 +492,20 @@ void UBarrageDispatch::StackUp()
 				}
 			}
 		}
+		if (RefilledUpTo == 0)
+		{
+			return;
+		}
+
+		//order. after this, the set is grouped by body, and each body's inputs are in sequence order.
+		//that's the order we apply in, so physics input order no longer depends on which thread drained first.
+		uint32* Sorted = RadixSortInputs(InternalSortableSet.data(), InputOrder.data(), InputOrderScratch.data(), RefilledUpTo);
+		BreakInputTies(InternalSortableSet.data(), Sorted, RefilledUpTo);
 
-		//process.
-		for (int i = 0; i < RefilledUpTo; ++i)
+		//process. adds come out of the sort in body order, which keeps the batch deterministic too.
+		for (uint32 i = 0; i < RefilledUpTo && Adding < Adds.size(); ++i)
 		{
-			auto& input = InternalSortableSet[i];
+			const FBPhysicsInput& input = InternalSortableSet[Sorted[i]];
 			//handle adds first!
 			if (input.Action == PhysicsInputType::ADD)
 			{
@@ -371,7 +513,6 @@ void UBarrageDispatch::StackUp()
 				++Adding;
 			}
 		}
-		// std::sort(Adds.data(), Adding....); add sort here once we have our ordering worked out.
 
 		JPH::BodyInterface* BodyInt = JoltGameSim->body_interface;
 		//adding in one batch MASSIVELY reduces thread contention and the amount of quadtree messiness.
@@ -382,52 +523,88 @@ void UBarrageDispatch::StackUp()
 			JPH::BodyInterface::AddState state = BodyInt->AddBodiesPrepare(Adds.data(), Adding);
 			BodyInt->AddBodiesFinalize(Adds.data(), Adding, state, JPH::EActivation::Activate);
 		}
-		for (int i = 0; i < RefilledUpTo; ++i)
+
+		//this has to be the locking interface. primitives release their bodies from whatever thread drops the last ref,
+		//and the game thread reads through the locking getters, so nothing guarantees we're alone with these bodies.
+		//merging still means one lock per set per body, not one per input.
+		JPH::BodyInterface& Bodies = *BodyInt;
+		uint32 RunStart = 0;
+		while (RunStart < RefilledUpTo)
 		{
-			auto& input = InternalSortableSet[i];
+			const FBarrageKey RunTarget = InternalSortableSet[Sorted[RunStart]].Target;
+			uint32 RunEnd = RunStart + 1;
+			while (RunEnd < RefilledUpTo && InternalSortableSet[Sorted[RunEnd]].Target == RunTarget)
+			{
+				++RunEnd;
+			}
+
 			JPH::BodyID result;
-			const bool bID = JoltGameSim->BarrageToJoltMapping->find(input.Target, result);
-			if (bID && input.metadata == FBShape::Character)
+			const bool bID = JoltGameSim->BarrageToJoltMapping->find(RunTarget, result);
+			//merge within the run. forces sum, since that's what jolt would do with them anyway. everything else is a set,
+			//so the last one in sequence order wins. characters ingest every input, in order.
+			JPH::Vec3 ForceSum = JPH::Vec3::sZero();
+			bool HasForce = false;
+			const FBPhysicsInput* LastOf[PhysicsInputType::ADD + 1] = {};
+			for (uint32 i = RunStart; i < RunEnd; ++i)
 			{
-				UpdateCharacter(const_cast<FBPhysicsInput&>(input));
+				FBPhysicsInput& input = InternalSortableSet[Sorted[i]];
+				if (bID && input.metadata == FBShape::Character)
+				{
+					UpdateCharacter(input);
+				}
+				else if (bID && !result.IsInvalid())
+				{
+					switch (input.Action)
+					{
+					case PhysicsInputType::ADD:
+						//in retrospect, this should have just added another bloody queue set. ugh.
+						//skip, already handled.
+						break;
+					case PhysicsInputType::OtherForce:
+					case PhysicsInputType::SelfMovement:
+					case PhysicsInputType::AIMovement:
+						ForceSum += input.State.GetXYZ();
+						HasForce = true;
+						break;
+					case PhysicsInputType::Rotation:
+					case PhysicsInputType::Velocity:
+					case PhysicsInputType::SetPosition:
+					case PhysicsInputType::SetGravityFactor:
+						LastOf[input.Action] = &input;
+						break;
+					default:
+						UE_LOG(LogTemp, Warning,
+						       TEXT("UBarrageDispatch::StackUp: Unimplemented handling for input action [%d]"),
+						       input.Action);
+					}
+				}
 			}
 
-			if (bID && !result.IsInvalid() && input.metadata != FBShape::Character)
+			if (bID && !result.IsInvalid())
 			{
-				switch (input.Action)
+				if (const FBPhysicsInput* Set = LastOf[PhysicsInputType::Rotation])
 				{
-				case PhysicsInputType::ADD:
-					//in retrospect, this should have just added another bloody queue set. ugh.
-					//skip, already handled.
-					break;
-				case PhysicsInputType::Rotation:
 					//prolly gonna wanna change this to add torque................... not sure.
-					BodyInt->SetRotation(result, input.State, JPH::EActivation::Activate);
-					break;
-				case PhysicsInputType::OtherForce:
-					BodyInt->AddForce(result, input.State.GetXYZ(), JPH::EActivation::Activate);
-					break;
-				case PhysicsInputType::Velocity:
-					BodyInt->SetLinearVelocity(result, input.State.GetXYZ());
-					break;
-				case PhysicsInputType::SetPosition:
-					BodyInt->SetPosition(result, input.State.GetXYZ(), JPH::EActivation::Activate);
-					break;
-				case PhysicsInputType::SelfMovement:
-					BodyInt->AddForce(result, input.State.GetXYZ(), JPH::EActivation::Activate);
-					break;
-				case PhysicsInputType::AIMovement:
-					BodyInt->AddForce(result, input.State.GetXYZ(), JPH::EActivation::Activate);
-					break;
-				case PhysicsInputType::SetGravityFactor:
-					BodyInt->SetGravityFactor(result, input.State.GetZ());
-					break;
-				default:
-					UE_LOG(LogTemp, Warning,
-					       TEXT("UBarrageDispatch::StackUp: Unimplemented handling for input action [%d]"),
-					       input.Action);
+					Bodies.SetRotation(result, Set->State, JPH::EActivation::Activate);
+				}
+				if (const FBPhysicsInput* Set = LastOf[PhysicsInputType::SetPosition])
+				{
+					Bodies.SetPosition(result, Set->State.GetXYZ(), JPH::EActivation::Activate);
+				}
+				if (const FBPhysicsInput* Set = LastOf[PhysicsInputType::Velocity])
+				{
+					Bodies.SetLinearVelocity(result, Set->State.GetXYZ());
+				}
+				if (const FBPhysicsInput* Set = LastOf[PhysicsInputType::SetGravityFactor])
+				{
+					Bodies.SetGravityFactor(result, Set->State.GetZ());
+				}
+				if (HasForce)
+				{
+					Bodies.AddForce(result, ForceSum, JPH::EActivation::Activate);
 				}
 			}
+			RunStart = RunEnd;
 		}
 	}
 }
@@ -457,9 +634,53 @@ void UBarrageDispatch::StepWorld(uint64 Time, uint64_t TickCount)
 
 		CleanTombs();
 		PinSim->StepSimulation();
+
+		//anything tombstoned since the last step stops publishing now. this used to be found by a full locked scan
+		//of the lifecycle map every tick, which got expensive fast with a lot of sleeping or static bodies around.
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Jolt Body Lifecycle Update");
+			TSharedPtr<TArray<FBLet>> Tomb = Tombs[TombOffset];
+			TArray<FBLet, TInlineAllocator<8>> Unfiled;
+			FBLet Fresh;
+			while (FreshTombstones.Dequeue(Fresh))
+			{
+				if (Fresh && Fresh->tombstone != 0)
+				{
+					//it stops publishing either way. it just can't be buried without a tomb to put it in.
+					PinSim->SetBodyOwner(Fresh->KeyIntoBarrage, FSkeletonKey());
+					if (Fresh->Me == FBShape::Character)
+					{
+						PinSim->RetireCharacter(Fresh->KeyIntoBarrage);
+					}
+					if (Tomb)
+					{
+						Tomb->Push(Fresh);
+					}
+					else
+					{
+						Unfiled.Add(Fresh);
+					}
+				}
+			}
+			if (!Unfiled.IsEmpty())
+			{
+				//only happens around init and deinit. hold them for the next step rather than lose them.
+				UE_LOG(LogTemp, Warning, TEXT("Barrage:Dispatch: No tomb at offset [%u], holding [%d] tombstones for the next step."), TombOffset, Unfiled.Num());
+				for (FBLet& Held : Unfiled)
+				{
+					FreshTombstones.Enqueue(Held);
+				}
+			}
+		}
+
+		TSharedPtr<TransformUpdatesForGameThread> HoldOpenPump = GameTransformPump;
 		TSharedPtr<TMap<FBarrageKey, TSharedPtr<FBCharacterBase>>> HoldOpenCharacters = PinSim->CharacterToJoltMapping;
 		if (HoldOpenCharacters)
 		{
+			//forgetting happens on this thread too, so the read lock only keeps the game thread's adds out.
+			FReadScopeLock Reading(PinSim->CharacterMappingLock);
+			//characters only collide with each other through this, so it has to be current before anyone steps.
+			PinSim->CharacterHashGrid.Rebuild();
 			// ReSharper disable once CppTemplateArgumentsCanBeDeduced - disabled to clear warning that causes compiler error if "fixed"
 			for (TTuple<FBarrageKey, TSharedPtr<FBCharacterBase>> CharacterKeyAndBase : *HoldOpenCharacters)
 			{
@@ -473,120 +694,190 @@ void UBarrageDispatch::StepWorld(uint64 Time, uint64_t TickCount)
 						CharacterKeyAndBase.Value->mForcesUpdate = CharacterKeyAndBase.Value->World->GetGravity();
 					}
 					CharacterKeyAndBase.Value->StepCharacter();
+					//atm, characters cannot be inactive, so they always publish.
+					if (HoldOpenPump && CharacterKeyAndBase.Value->mOwnerKey.IsValid())
+					{
+						JPH::Ref<JPH::CharacterVirtual> CharacterPtr = CharacterKeyAndBase.Value->mCharacter;
+						HoldOpenPump->Enqueue(TransformUpdate(
+							CharacterKeyAndBase.Value->mOwnerKey,
+							Time,
+							CoordinateUtils::FromJoltRotation(CharacterPtr->GetRotation()),
+							CoordinateUtils::FromJoltCoordinates(CharacterPtr->GetPosition()),
+							0));
+					}
 				}
 			}
 		}
 
+		if (HoldOpenPump)
 		{
-			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Jolt Body Lifecycle Update");
-			//maintain tombstones
-			TSharedPtr<KeyToFBLet> HoldCuckooLifecycle = JoltBodyLifecycleMapping;
-			TSharedPtr<KeyToKey> HoldCuckooTranslation = TranslationMapping;
-			if (HoldCuckooLifecycle && HoldCuckooLifecycle.Get() && !HoldCuckooLifecycle.Get()->empty())
+			TRACE_CPUPROFILER_EVENT_SCOPE_STR("Active Body Transform Extraction");
+			//only bodies jolt considers awake can have moved, so that's all we walk. the owner key rides in the body's
+			//user data, so there are no map lookups and no lock on the lifecycle table. we're on the step thread, between
+			//steps, so nothing else is mutating the active list and the no-lock interface is fine here.
+			const JPH::BodyLockInterfaceNoLock& BodyLock = PinSim->physics_system->GetBodyLockInterfaceNoLock();
+			const uint32 ActiveCount = PinSim->physics_system->GetNumActiveBodies(JPH::EBodyType::RigidBody);
+			const JPH::BodyID* Active = PinSim->physics_system->GetActiveBodiesUnsafe(JPH::EBodyType::RigidBody);
+			for (uint32 i = 0; i < ActiveCount; ++i)
 			{
-				KeyToFBLet::locked_table HoldCuckooLifecycleLocked = HoldCuckooLifecycle->lock_table();
-				for (std::pair<const FBarrageKey, FBLet> KeyAndBarragePrimitive : HoldCuckooLifecycleLocked)
+				const JPH::Body* Body = BodyLock.TryGetBody(Active[i]);
+				if (Body && Body->GetUserData() != 0)
 				{
-					if (KeyAndBarragePrimitive.first.KeyIntoBarrage != 0)
-					{
-						FBLet HoldOpenFBP = KeyAndBarragePrimitive.second;
-						//NOTE: nullity check here includes tombstone check. Hence the odd form of the SECOND check.
-						//in other words, this checks != null && !tombstoned
-						if (FBarragePrimitive::IsNotNull(HoldOpenFBP))
-						{
-							FBarragePrimitive::TryUpdateTransformFromJolt(HoldOpenFBP, Time);
-							//returns a bool that can be used for debug.
-						} //This checks for != null && tombstoned
-						else if (HoldOpenFBP && HoldOpenFBP->tombstone != 0 && Tombs[TombOffset])
-						//just to make it explicit.
-						{
-							//TODO: MAY NOT BE THREADSAFE. CHECK NLT 10/5/24
-							Tombs[TombOffset]->Push(HoldOpenFBP);
-						}
-					}
+					HoldOpenPump->Enqueue(TransformUpdate(
+						FSkeletonKey(Body->GetUserData()),
+						Time,
+						CoordinateUtils::FromJoltRotation(Body->GetRotation()),
+						CoordinateUtils::FromJoltCoordinates(Body->GetPosition()),
+						0));
+				}
+			}
+		}
+
+		if (SnapshotEachTick)
+		{
+			FReadScopeLock Reading(PinSim->CharacterMappingLock);
+			PinSim->Snapshots.Capture(TickCount, *PinSim->physics_system, PinSim->CharacterToJoltMapping.Get());
+		}
+	}
+}
+
+void UBarrageDispatch::CleanTombs()
+{
+	//free tomb at offset - TombstoneInitialMinimum, fulfilling our promised minimum.
+	TSharedPtr<TArray<FBLet>>* HoldOpen = Tombs;
+	TSharedPtr<TArray<FBLet>> Mausoleum = HoldOpen[(TombOffset) % (TombstoneInitialMinimum + 1)]; //think this math is wrong.
+	TSharedPtr<KeyToFBLet> HoldOpenBMap = JoltBodyLifecycleMapping;
+	TSharedPtr<KeyToKey> HoldOpenTMap = TranslationMapping;
+	TSharedPtr<FWorldSimOwner> PinSim = JoltGameSim;
+	if(Mausoleum && !Mausoleum->IsEmpty() && HoldOpenBMap && HoldOpenTMap)
+	{
+		for (auto Tombstone : *Mausoleum)
+		{
+			if (Tombstone)
+			{
+				JoltBodyLifecycleMapping->erase(Tombstone->KeyIntoBarrage);
+				TranslationMapping->erase(Tombstone->KeyOutOfBarrage);
+				if (PinSim && Tombstone->Me == FBShape::Character)
+				{
+					PinSim->ForgetCharacter(Tombstone->KeyIntoBarrage);
 				}
 			}
 		}
 	}
+	
+	Mausoleum = HoldOpen[(TombOffset - TombstoneInitialMinimum) % (TombstoneInitialMinimum + 1)];
+	if (Mausoleum)
+	{
+		Mausoleum->Empty(); //roast 'em lmao.
+	}
+	TombOffset = (TombOffset + 1) % (TombstoneInitialMinimum + 1);
+}
+
+bool UBarrageDispatch::RestoreToTick(uint64_t TickCount)
+{
+	TSharedPtr<FWorldSimOwner> PinSim = JoltGameSim;
+	if (PinSim && PinSim->physics_system)
+	{
+		FReadScopeLock Reading(PinSim->CharacterMappingLock);
+		return PinSim->Snapshots.Restore(TickCount, *PinSim->physics_system, PinSim->CharacterToJoltMapping.Get());
+	}
+	return false;
+}
+
+bool UBarrageDispatch::CanRestoreToTick(uint64_t TickCount) const
+{
+	TSharedPtr<FWorldSimOwner> PinSim = JoltGameSim;
+	return PinSim && PinSim->Snapshots.Has(TickCount);
+}
+
+uint32 UBarrageDispatch::FingerprintTick(uint64_t TickCount) const
+{
+	TSharedPtr<FWorldSimOwner> PinSim = JoltGameSim;
+	return PinSim ? PinSim->Snapshots.Fingerprint(TickCount) : 0;
+}
+
+void UBarrageDispatch::AddContactConsumer(EBarrageContactGroup Group, FBContactConsumer Consumer)
+{
+	FScopeLock ConsumerLock(&ContactConsumerLock);
+	ContactConsumers[static_cast<uint8>(Group)].Add(MoveTemp(Consumer));
 }
 
 bool UBarrageDispatch::BroadcastContactEvents() const
 {
 	if (GetWorld())
 	{
-		TSharedPtr<TCircularQueue<BarrageContactEvent>> HoldOpen = ContactEventPump;
-		while (HoldOpen && !HoldOpen->IsEmpty())
+		TSharedPtr<FBContactEventStream> HoldOpen = ContactEvents;
+		if (!HoldOpen)
 		{
-			const BarrageContactEvent* Update = HoldOpen->Peek();
-			if (Update)
+			return false;
+		}
+		//the delegates are kept for anything that still wants one call per contact, and only cost anything if bound.
+		const bool AnyDelegates = OnBarrageContactAddedDelegate.IsBound() || OnBarrageContactPersistedDelegate.IsBound() || OnBarrageContactRemovedDelegate.IsBound();
+		try
+		{
+			FScopeLock ConsumerLock(&ContactConsumerLock);
+			HoldOpen->Drain([this, AnyDelegates](EBarrageContactGroup Group, const FBContactEventSpan& Span)
 			{
-				try
+				for (const FBContactConsumer& Consumer : ContactConsumers[static_cast<uint8>(Group)])
 				{
-					switch (Update->ContactEventType)
+					Consumer(Span);
+				}
+				if (!AnyDelegates)
+				{
+					return;
+				}
+				for (int32 i = 0; i < Span.Num; ++i)
+				{
+					const BarrageContactEvent Update(Span.Type[i],
+					                                 BarrageContactEntity(Span.Body1[i], static_cast<Layers::EJoltPhysicsLayer>(Span.Layer1[i])),
+					                                 BarrageContactEntity(Span.Body2[i], static_cast<Layers::EJoltPhysicsLayer>(Span.Layer2[i])));
+					switch (Update.ContactEventType)
 					{
 					case EBarrageContactEventType::ADDED:
-						OnBarrageContactAddedDelegate.Broadcast(*Update);
+						OnBarrageContactAddedDelegate.Broadcast(Update);
 						break;
 					case EBarrageContactEventType::PERSISTED:
-						OnBarrageContactPersistedDelegate.Broadcast(*Update);
+						OnBarrageContactPersistedDelegate.Broadcast(Update);
 						break;
 					case EBarrageContactEventType::REMOVED:
 						// REMOVE EVENTS REQUIRE ADDITIONAL SPECIAL HANDLING AS THEY DO NOT HAVE ALL DATA SET
-						OnBarrageContactRemovedDelegate.Broadcast(*Update);
+						OnBarrageContactRemovedDelegate.Broadcast(Update);
 						break;
 					default:
 						break;
 					}
-					HoldOpen->Dequeue();
-				}
-				catch (...)
-				{
-					return false; //we'll be back! we'll be back!!!!
 				}
-			}
+			});
+		}
+		catch (...)
+		{
+			return false; //we'll be back! we'll be back!!!!
 		}
 		return true;
 	}
 	return false;
 }
 
-inline BarrageContactEvent ConstructContactEvent(EBarrageContactEventType EventType, UBarrageDispatch* BarrageDispatch,
-                                                 const JPH::Body& inBody1, const JPH::Body& inBody2,
-                                                 const JPH::ContactManifold& inManifold,
-                                                 JPH::ContactSettings& ioSettings)
-{
-	return BarrageContactEvent(
-		EventType, BarrageContactEntity(BarrageDispatch->GenerateBarrageKeyFromBodyId(inBody1.GetID()), inBody1),
-		BarrageContactEntity(BarrageDispatch->GenerateBarrageKeyFromBodyId(inBody2.GetID()), inBody2));
-}
-
 void UBarrageDispatch::HandleContactAdded(const JPH::Body& inBody1, const JPH::Body& inBody2,
                                           const JPH::ContactManifold& inManifold,
                                           JPH::ContactSettings& ioSettings)
 {
-	BarrageContactEvent ContactEventToEnqueue = ConstructContactEvent(EBarrageContactEventType::ADDED, this, inBody1,
-	                                                                  inBody2, inManifold, ioSettings);
-	ContactEventPump->Enqueue(ContactEventToEnqueue);
+	ContactEvents->Push(EBarrageContactEventType::ADDED, GenerateBarrageKeyFromBodyId(inBody1.GetID()), inBody1,
+	                    GenerateBarrageKeyFromBodyId(inBody2.GetID()), inBody2);
 }
 
 void UBarrageDispatch::HandleContactPersisted(const JPH::Body& inBody1, const JPH::Body& inBody2,
                                               const JPH::ContactManifold& inManifold,
                                               JPH::ContactSettings& ioSettings)
 {
-	BarrageContactEvent ContactEventToEnqueue = ConstructContactEvent(EBarrageContactEventType::PERSISTED, this,
-	                                                                  inBody1, inBody2, inManifold, ioSettings);
-	ContactEventPump->Enqueue(ContactEventToEnqueue);
+	ContactEvents->Push(EBarrageContactEventType::PERSISTED, GenerateBarrageKeyFromBodyId(inBody1.GetID()), inBody1,
+	                    GenerateBarrageKeyFromBodyId(inBody2.GetID()), inBody2);
 }
 
 void UBarrageDispatch::HandleContactRemoved(const JPH::SubShapeIDPair& inSubShapePair) const
 {
-	FBarrageKey BK1 = this->GenerateBarrageKeyFromBodyId(inSubShapePair.GetBody1ID());
-	FBarrageKey BK2 = this->GenerateBarrageKeyFromBodyId(inSubShapePair.GetBody2ID());
-	BarrageContactEvent ContactEventToEnqueue(
-		EBarrageContactEventType::REMOVED,
-		BarrageContactEntity(BK1),
-		BarrageContactEntity(BK2));
-	ContactEventPump->Enqueue(ContactEventToEnqueue);
+	ContactEvents->PushRemoved(GenerateBarrageKeyFromBodyId(inSubShapePair.GetBody1ID()),
+	                           GenerateBarrageKeyFromBodyId(inSubShapePair.GetBody2ID()));
 }
 
 FBarrageKey UBarrageDispatch::GenerateBarrageKeyFromBodyId(const JPH::BodyID& Input) const
@@ -0,0 +1,271 @@
+﻿#include "CharacterHashGrid.h"
+#include "Jolt/Physics/Collision/CollisionDispatch.h"
+#include "PhysicsCharacter.h"
+
+using namespace JPH;
+
+void FBCharacterHashGrid::Add(const TSharedPtr<FBCharacterBase>& inCharacter)
+{
+	if (inCharacter && inCharacter->mCharacter)
+	{
+		PendingAdds.Enqueue(FRegistered{inCharacter->mCharacter, inCharacter});
+	}
+}
+
+void FBCharacterHashGrid::Remove(const CharacterVirtual* inCharacter)
+{
+	PendingRemoves.Enqueue(inCharacter);
+}
+
+void FBCharacterHashGrid::CellOf(Vec3Arg inPoint, int32 outCell[3]) const
+{
+	//converting a NaN or out of range float to int is undefined, so pin everything into the grid first. a NaN lands in
+	//cell zero, and anything huge lands on the edge, which at worst costs candidates.
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		const float Scaled = inPoint[Axis] * mInvCellSize;
+		outCell[Axis] = FMath::IsFinite(Scaled)
+			? FMath::FloorToInt32(FMath::Clamp(Scaled, -cMaxCellCoord, cMaxCellCoord))
+			: (Scaled > 0 ? int32(cMaxCellCoord) : Scaled < 0 ? -int32(cMaxCellCoord) : 0);
+	}
+}
+
+void FBCharacterHashGrid::Rebuild()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Character Hash Grid Rebuild");
+	{
+		FRegistered Added;
+		while (PendingAdds.Dequeue(Added))
+		{
+			mCharacters.Add(Added);
+		}
+		const CharacterVirtual* Removed = nullptr;
+		while (PendingRemoves.Dequeue(Removed))
+		{
+			mCharacters.RemoveAll([Removed](const FRegistered& R) { return R.Character.GetPtr() == Removed; });
+		}
+		//anything whose owner is already gone was never removed. it shouldn't happen, but it mustn't linger if it does.
+		mCharacters.RemoveAll([](const FRegistered& R) { return !R.Owner.IsValid(); });
+	}
+
+	mEntries.Reset(mCharacters.Num());
+	//size cells to the biggest character, so nobody spans more than two cells on an axis.
+	float CellSize = cMinCellSize;
+	for (const FRegistered& R : mCharacters)
+	{
+		const CharacterVirtual* C = R.Character.GetPtr();
+		const TSharedPtr<FBCharacterBase> Owner = R.Owner.Pin();
+		//speed can change at runtime, so the padding is whatever it is right now, not what it was at Add.
+		const float MaxStepDistance = Owner ? Owner->mMaxSpeed * FBCharacter::SpeedExcession * Owner->mDeltaTime : 0.0f;
+		AABox Bounds = C->GetShape()->GetWorldSpaceBounds(C->GetCenterOfMassTransform(), Vec3::sOne());
+		Bounds.ExpandBy(Vec3::sReplicate(C->GetCharacterPadding() + MaxStepDistance));
+		if (!Bounds.IsValid() || Bounds.mMin.IsNaN() || Bounds.mMax.IsNaN())
+		{
+			continue; //StepWorld resets NaN characters before stepping them. they'll be back next rebuild.
+		}
+		CellSize = FMath::Max(CellSize, 2.0f * Bounds.GetExtent().ReduceMax());
+		FEntry& Entry = mEntries.AddDefaulted_GetRef();
+		Entry.Character = C;
+		Entry.Bounds = Bounds;
+	}
+	mInvCellSize = 1.0f / CellSize;
+
+	uint32 CellRefs = 0;
+	for (FEntry& Entry : mEntries)
+	{
+		CellOf(Entry.Bounds.mMin, Entry.MinCell);
+		CellOf(Entry.Bounds.mMax, Entry.MaxCell);
+		CellRefs += (Entry.MaxCell[0] - Entry.MinCell[0] + 1) * (Entry.MaxCell[1] - Entry.MinCell[1] + 1) * (Entry.MaxCell[2] - Entry.MinCell[2] + 1);
+	}
+
+	const uint32 BucketCount = FMath::RoundUpToPowerOfTwo(FMath::Max(CellRefs * 2, 16u));
+	mBucketMask = BucketCount - 1;
+	mBucketStart.SetNumZeroed(BucketCount + 1, EAllowShrinking::No);
+	mBucketItems.SetNumUninitialized(CellRefs, EAllowShrinking::No);
+
+	//count, prefix sum, then fill back to front so each bucket ends up in entry order.
+	for (const FEntry& Entry : mEntries)
+	{
+		for (int32 z = Entry.MinCell[2]; z <= Entry.MaxCell[2]; ++z)
+		for (int32 y = Entry.MinCell[1]; y <= Entry.MaxCell[1]; ++y)
+		for (int32 x = Entry.MinCell[0]; x <= Entry.MaxCell[0]; ++x)
+		{
+			++mBucketStart[(HashCell(x, y, z) & mBucketMask) + 1];
+		}
+	}
+	for (uint32 b = 0; b < BucketCount; ++b)
+	{
+		mBucketStart[b + 1] += mBucketStart[b];
+	}
+	TArray<uint32> Cursor(mBucketStart.GetData() + 1, BucketCount);
+	for (int32 i = mEntries.Num() - 1; i >= 0; --i)
+	{
+		const FEntry& Entry = mEntries[i];
+		for (int32 z = Entry.MinCell[2]; z <= Entry.MaxCell[2]; ++z)
+		for (int32 y = Entry.MinCell[1]; y <= Entry.MaxCell[1]; ++y)
+		for (int32 x = Entry.MinCell[0]; x <= Entry.MaxCell[0]; ++x)
+		{
+			mBucketItems[--Cursor[HashCell(x, y, z) & mBucketMask]] = FBucketItem{uint32(i), {x, y, z}};
+		}
+	}
+}
+
+template <typename Visitor>
+void FBCharacterHashGrid::ForEachCandidate(const AABox& inQuery, const CharacterVirtual* inSkip, Visitor&& inVisitor) const
+{
+	if (mEntries.IsEmpty() || !inQuery.IsValid())
+	{
+		return;
+	}
+
+	int32 QMin[3];
+	int32 QMax[3];
+	CellOf(inQuery.mMin, QMin);
+	CellOf(inQuery.mMax, QMax);
+	const int64 QueryCells = int64(QMax[0] - QMin[0] + 1) * int64(QMax[1] - QMin[1] + 1) * int64(QMax[2] - QMin[2] + 1);
+	if (QueryCells > cMaxQueryCells || QueryCells > mEntries.Num())
+	{
+		//cheaper to just look at everyone. each entry is in the array once, so no dedupe needed.
+		for (const FEntry& Entry : mEntries)
+		{
+			if (Entry.Character != inSkip && Entry.Bounds.Overlaps(inQuery))
+			{
+				if (!inVisitor(Entry.Character))
+				{
+					return;
+				}
+			}
+		}
+		return;
+	}
+
+	for (int32 z = QMin[2]; z <= QMax[2]; ++z)
+	for (int32 y = QMin[1]; y <= QMax[1]; ++y)
+	for (int32 x = QMin[0]; x <= QMax[0]; ++x)
+	{
+		const uint32 Bucket = HashCell(x, y, z) & mBucketMask;
+		for (uint32 Item = mBucketStart[Bucket]; Item < mBucketStart[Bucket + 1]; ++Item)
+		{
+			//a bucket can hold other cells that hashed the same way, other cells of this same entry included. only the
+			//item for the cell we're actually in counts.
+			const FBucketItem& Held = mBucketItems[Item];
+			if (Held.Cell[0] != x || Held.Cell[1] != y || Held.Cell[2] != z)
+			{
+				continue;
+			}
+			//an entry sits in every cell it touches, so only report it from the first cell both boxes share. that's
+			//exactly once, with no visited set.
+			const FEntry& Entry = mEntries[Held.Entry];
+			if (x != FMath::Max(QMin[0], Entry.MinCell[0]) || y != FMath::Max(QMin[1], Entry.MinCell[1]) || z != FMath::Max(QMin[2], Entry.MinCell[2]))
+			{
+				continue;
+			}
+			if (Entry.Character != inSkip && Entry.Bounds.Overlaps(inQuery))
+			{
+				if (!inVisitor(Entry.Character))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+//the per-pair work below is CharacterVsCharacterCollisionSimple's, unchanged. only how we find the pairs is different.
+void FBCharacterHashGrid::CollideCharacter(const CharacterVirtual* inCharacter, RMat44Arg inCenterOfMassTransform,
+                                           const CollideShapeSettings& inCollideShapeSettings, RVec3Arg inBaseOffset,
+                                           CollideShapeCollector& ioCollector) const
+{
+	// Make shape 1 relative to inBaseOffset
+	Mat44 transform1 = inCenterOfMassTransform.PostTranslated(-inBaseOffset).ToMat44();
+
+	const Shape* shape1 = inCharacter->GetShape();
+	CollideShapeSettings settings = inCollideShapeSettings;
+
+	// Get bounds for character
+	AABox bounds1 = shape1->GetWorldSpaceBounds(transform1, Vec3::sOne());
+
+	AABox query = shape1->GetWorldSpaceBounds(inCenterOfMassTransform, Vec3::sOne());
+	query.ExpandBy(Vec3::sReplicate(inCollideShapeSettings.mMaxSeparationDistance));
+
+	ForEachCandidate(query, inCharacter, [&](const CharacterVirtual* c)
+	{
+		if (ioCollector.ShouldEarlyOut())
+		{
+			return false;
+		}
+
+		// Make shape 2 relative to inBaseOffset
+		Mat44 transform2 = c->GetCenterOfMassTransform().PostTranslated(-inBaseOffset).ToMat44();
+
+		// We need to add the padding of character 2 so that we will detect collision with its outer shell
+		settings.mMaxSeparationDistance = inCollideShapeSettings.mMaxSeparationDistance + c->GetCharacterPadding();
+
+		// Check if the bounding boxes of the characters overlap
+		const Shape* shape2 = c->GetShape();
+		AABox bounds2 = shape2->GetWorldSpaceBounds(transform2, Vec3::sOne());
+		bounds2.ExpandBy(Vec3::sReplicate(settings.mMaxSeparationDistance));
+		if (!bounds1.Overlaps(bounds2))
+		{
+			return true;
+		}
+
+		// Collector needs to know which character we're colliding with
+		ioCollector.SetUserData(reinterpret_cast<uint64>(c));
+
+		// Note that this collides against the character's shape without padding, this will be corrected for in CharacterVirtual::GetContactsAtPosition
+		CollisionDispatch::sCollideShapeVsShape(shape1, shape2, Vec3::sOne(), Vec3::sOne(), transform1, transform2, SubShapeIDCreator(), SubShapeIDCreator(), settings, ioCollector);
+		return true;
+	});
+
+	// Reset the user data
+	ioCollector.SetUserData(0);
+}
+
+void FBCharacterHashGrid::CastCharacter(const CharacterVirtual* inCharacter, RMat44Arg inCenterOfMassTransform,
+                                        Vec3Arg inDirection, const ShapeCastSettings& inShapeCastSettings,
+                                        RVec3Arg inBaseOffset, CastShapeCollector& ioCollector) const
+{
+	// Convert shape cast relative to inBaseOffset
+	Mat44 transform1 = inCenterOfMassTransform.PostTranslated(-inBaseOffset).ToMat44();
+	ShapeCast shape_cast(inCharacter->GetShape(), Vec3::sOne(), transform1, inDirection);
+
+	// Get world space bounds of the character in the form of center and extent
+	Vec3 origin = shape_cast.mShapeWorldBounds.GetCenter();
+	Vec3 extents = shape_cast.mShapeWorldBounds.GetExtent();
+
+	//the whole sweep, back in world space for the grid.
+	AABox query = shape_cast.mShapeWorldBounds;
+	query.Encapsulate(AABox(query.mMin + inDirection, query.mMax + inDirection));
+	query.Translate(inBaseOffset);
+
+	ForEachCandidate(query, inCharacter, [&](const CharacterVirtual* c)
+	{
+		if (ioCollector.ShouldEarlyOut())
+		{
+			return false;
+		}
+
+		// Make shape 2 relative to inBaseOffset
+		Mat44 transform2 = c->GetCenterOfMassTransform().PostTranslated(-inBaseOffset).ToMat44();
+
+		// Sweep bounding box of the character against the bounding box of the other character to see if they can collide
+		const Shape* shape2 = c->GetShape();
+		AABox bounds2 = shape2->GetWorldSpaceBounds(transform2, Vec3::sOne());
+		bounds2.ExpandBy(extents);
+		if (!RayAABoxHits(origin, inDirection, bounds2.mMin, bounds2.mMax))
+		{
+			return true;
+		}
+
+		// Collector needs to know which character we're colliding with
+		ioCollector.SetUserData(reinterpret_cast<uint64>(c));
+
+		// Note that this collides against the character's shape without padding, this will be corrected for in CharacterVirtual::GetFirstContactForSweep
+		CollisionDispatch::sCastShapeVsShapeWorldSpace(shape_cast, inShapeCastSettings, shape2, Vec3::sOne(), { }, transform2, SubShapeIDCreator(), SubShapeIDCreator(), ioCollector);
+		return true;
+	});
+
+	// Reset the user data
+	ioCollector.SetUserData(0);
+}
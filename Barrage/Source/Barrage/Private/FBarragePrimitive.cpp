@@ -62,10 +62,10 @@ bool FBarragePrimitive::TryUpdateTransformFromJolt(FBLet Target, uint64 Time)
 					{
 						//accumulate character update from OuterCharacter.
 						//SNAAAAAAAAAAAKE
-						TSharedPtr<FBCharacterBase>* CharacterRef = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
+						TSharedPtr<FBCharacterBase> CharacterRef = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
 						if (CharacterRef)
 						{
-							JPH::Ref<JPH::CharacterVirtual> CharacterPtr = CharacterRef->Get()->mCharacter;
+							JPH::Ref<JPH::CharacterVirtual> CharacterPtr = CharacterRef->mCharacter;
 							JPH::RVec3 Pos = CharacterPtr->GetPosition();
 							JPH::Quat Rot = CharacterPtr->GetRotation();
 							HoldOpen->Enqueue(TransformUpdate(
@@ -130,10 +130,10 @@ FVector3f FBarragePrimitive::GetPosition(FBLet Target)
 				}
 				if (Target->Me == FBShape::Character)
 				{
-					TSharedPtr<FBCharacterBase>* CharacterActual = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
-					if (CharacterActual && *CharacterActual)
+					TSharedPtr<FBCharacterBase> CharacterActual = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
+					if (CharacterActual)
 					{
-						return CoordinateUtils::FromJoltCoordinates(CharacterActual->Get()->mCharacter->GetPosition());
+						return CoordinateUtils::FromJoltCoordinates(CharacterActual->mCharacter->GetPosition());
 					}
 				}
 			}
@@ -154,10 +154,10 @@ FVector3f FBarragePrimitive::GetVelocity(FBLet Target)
 			{
 			case FBShape::Character:
 				{
-					TSharedPtr<FBCharacterBase>* CharacterActual = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
-					if (CharacterActual && *CharacterActual)
+					TSharedPtr<FBCharacterBase> CharacterActual = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
+					if (CharacterActual)
 					{
-						return CoordinateUtils::FromJoltCoordinates(CharacterActual->Get()->mEffectiveVelocity);
+						return CoordinateUtils::FromJoltCoordinates(CharacterActual->mEffectiveVelocity);
 					}
 				}
 				break;
@@ -254,10 +254,10 @@ void FBarragePrimitive::SpeedLimit(FBLet Target, float TargetSpeed)
 			// if they exist... we proceed. this replaces the older faulty check.				  curry for safety.
 			if (GameSimHoldOpen->BarrageToJoltMapping->find(Target->KeyIntoBarrage, result) && Target->Me == FBShape::Character) 
 			{
-				TSharedPtr<FBCharacterBase>* CharacterActual = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
-				if (CharacterActual && *CharacterActual)
+				TSharedPtr<FBCharacterBase> CharacterActual = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
+				if (CharacterActual)
 				{
-					CharacterActual->Get()->mMaxSpeed = TargetSpeed/100;
+					CharacterActual->mMaxSpeed = TargetSpeed/100;
 				}
 			}
 		}
@@ -282,10 +282,10 @@ FBarragePrimitive::FBGroundState FBarragePrimitive::GetCharacterGroundState(FBLe
 				// exists	is a character.
 				if (Target->Me == FBShape::Character)
 				{
-					TSharedPtr<FBCharacterBase>* CharacterActual = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
-					if (CharacterActual && *CharacterActual)
+					TSharedPtr<FBCharacterBase> CharacterActual = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
+					if (CharacterActual)
 					{
-						JPH::Ref<JPH::CharacterVirtual> CharVirtual = CharacterActual->Get()->mCharacter;
+						JPH::Ref<JPH::CharacterVirtual> CharVirtual = CharacterActual->mCharacter;
 						return FromJoltGroundState(CharVirtual->GetGroundState());
 					}
 					return FBGroundState::NotFound;
@@ -311,10 +311,10 @@ FVector3f FBarragePrimitive::GetCharacterGroundNormal(FBLet Target)
 			}
 			if (Target->Me == FBShape::Character)
 			{
-				TSharedPtr<FBCharacterBase>* CharacterActual = GameSimHoldOpen->CharacterToJoltMapping->Find(Target->KeyIntoBarrage);
-				if (CharacterActual && *CharacterActual)
+				TSharedPtr<FBCharacterBase> CharacterActual = GameSimHoldOpen->FindCharacter(Target->KeyIntoBarrage);
+				if (CharacterActual)
 				{
-					JPH::Ref<JPH::CharacterVirtual> CharVirtual = CharacterActual->Get()->mCharacter;
+					JPH::Ref<JPH::CharacterVirtual> CharVirtual = CharacterActual->mCharacter;
 					return CoordinateUtils::FromJoltUnitVector(CharVirtual->GetGroundNormal());
 				}
 				return FVector3f::ZeroVector;
@@ -3,24 +3,27 @@
 #include "BarrageContactListener.h"
 #include "CoordinateUtils.h"
 #include "Experimental/CollisionGroupUnaware_FleshBroadPhase.h"
+#include "Experimental/BPPaddingtonTree.h"
 #include "PhysicsCharacter.h"
 #include "CastShapeCollectors/SphereCastCollector.h"
 #include "CastShapeCollectors/SphereSearchCollector.h"
+#include "CastShapeCollectors/SphereSearchBatchCollector.h"
 #include "CollisionDetectionFilters/FirstHitRayCastCollector.h"
-#include "Chaos/TriangleMeshImplicitObject.h"
+#include "Misc/Paths.h"
 #include "Jolt/Physics/Collision/BroadPhase/BroadPhaseBruteForce.h"
+#include "Algo/Sort.h"
 
 using namespace JOLT;
 //it's going to be quite tempting to make that initexit a const or a reference. don't.
 // ReSharper disable once CppPassValueParameterByConstReference
-FWorldSimOwner::FWorldSimOwner(float cDeltaTime, InitExitFunction JobThreadInitializer)
+FWorldSimOwner::FWorldSimOwner(float cDeltaTime, InitExitFunction JobThreadInitializer, EBarrageBroadPhase BroadPhase)
 {
 	DeltaTime = cDeltaTime;
 
 	BarrageToJoltMapping = MakeShareable(new KeyToBody());
 	BoxCache = MakeShareable(new BoundsToShape());
+	MeshShapeCache = MakeShareable(new FBMeshShapeCache(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Barrage"), TEXT("CookedMeshShapes"))));
 	CharacterToJoltMapping = MakeShareable(new TMap<FBarrageKey, TSharedPtr<FBCharacterBase>>());
-	//mTestBroadPhase = std::make_shared<CollisionGroupUnaware_FleshBroadPhase>();
 	// Register allocation hook. In this example we'll just let Jolt use malloc / free but you can override these if you want (see Memory.h).
 	// This needs to be done before any other Jolt function is called.
 	RegisterDefaultAllocator();
@@ -49,9 +52,11 @@ FWorldSimOwner::FWorldSimOwner(float cDeltaTime, InitExitFunction JobThreadIniti
 	
 	
 	// Now we can create the actual physics system.
+	//the physics system owns whatever broadphase we hand it. nullptr gets jolt's quadtree.
+	JPH::BroadPhase* ChosenBroadPhase = BroadPhase == EBarrageBroadPhase::Paddington ? new MMBP_PaddingtonTree() : nullptr;
 	physics_system->Init(cMaxBodies, cNumBodyMutexes, cMaxBodyPairs, cMaxContactConstraints,
 	                     broad_phase_layer_interface, object_vs_broadphase_layer_filter,
-	                     object_vs_object_layer_filter);  //, mTestBroadPhase.get()); this can be used to experiment with broadphases.
+	                     object_vs_object_layer_filter, ChosenBroadPhase);
 	physics_system->SetContactListener(contact_listener.Get());
 	// The main way to interact with the bodies in the physics system is through the body interface. There is a locking and a non-locking
 	// variant of this. We're going to use the locking version.
@@ -180,6 +185,151 @@ inline void FWorldSimOwner::CastRay(FVector3d CastFrom, FVector3d Direction, con
 	}
 }
 
+//batches are run in z-order of their origins, which keeps consecutive queries in the same parts of the broadphase
+//tree and so mostly in cache. the index rides along in the pair so we can write results back in request order, and
+//it also breaks ties, which keeps the order deterministic. the scratch is per thread and only ever grows.
+typedef TPair<uint64, uint32> FBatchOrderEntry;
+template <typename RequestType, typename OriginOf>
+static TArrayView<FBatchOrderEntry> ZOrderBatch(TConstArrayView<RequestType> Requests, OriginOf Origin)
+{
+	static thread_local TArray<FBatchOrderEntry> ZOrderScratch;
+	ZOrderScratch.Reset();
+	ZOrderScratch.Reserve(Requests.Num());
+	for (int32 i = 0; i < Requests.Num(); ++i)
+	{
+		const FVector3d& At = Origin(Requests[i]);
+		ZOrderScratch.Emplace(FZOrderDistances::ComposeVoxelCode(At.X, At.Y, At.Z), i);
+	}
+	Algo::Sort(ZOrderScratch, [](const FBatchOrderEntry& A, const FBatchOrderEntry& B)
+	{
+		return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value);
+	});
+	return ZOrderScratch;
+}
+
+void FWorldSimOwner::SphereCastBatch(
+	TConstArrayView<FBSphereCastRequest> Requests,
+	TArrayView<FBCastHit> OutHits,
+	const BroadPhaseLayerFilter& BroadPhaseFilter,
+	const ObjectLayerFilter& ObjectFilter) const
+{
+	TArrayView<FBatchOrderEntry> Order = ZOrderBatch(Requests, [](const FBSphereCastRequest& R) -> const FVector3d& { return R.CastFrom; });
+
+	ShapeCastSettings settings;
+	settings.mUseShrunkenShapeAndConvexRadius = true;
+	settings.mReturnDeepestPoint = true;
+	const NarrowPhaseQuery& Query = physics_system->GetNarrowPhaseQueryNoLock();
+
+	//most batches are one kind of cast, so they're nearly always one radius. we only rebuild the sphere when it changes.
+	TOptional<SphereShape> Sphere;
+	double SphereRadius = -1;
+	for (const FBatchOrderEntry& Entry : Order)
+	{
+		const FBSphereCastRequest& Request = Requests[Entry.Value];
+		FBCastHit& Hit = OutHits[Entry.Value];
+		Hit.BodyID = BodyID::cInvalidBodyID;
+		if (Request.CastFrom.ContainsNaN())
+		{
+			continue;
+		}
+		if (!Sphere.IsSet() || SphereRadius != Request.Radius)
+		{
+			Sphere.Emplace(Request.Radius);
+			SphereRadius = Request.Radius;
+		}
+
+		BodyID Ignore;
+		GetBodyIDOrDefault(Request.Ignore, Ignore);
+		IgnoreSingleBodyFilter BodiesFilter(Ignore);
+
+		RShapeCast ShapeCast(
+			&Sphere.GetValue(),
+			Vec3::sReplicate(1.0f),
+			RMat44::sTranslation(CoordinateUtils::ToJoltCoordinates(Request.CastFrom)),
+			CoordinateUtils::ToJoltCoordinates(Request.Direction) * Request.Distance);
+		SphereCastCollector CastCollector(*(physics_system.Get()), ShapeCast);
+		Query.CastShape(ShapeCast, settings, ShapeCast.mCenterOfMassStart.GetTranslation(), CastCollector,
+		                BroadPhaseFilter, ObjectFilter, BodiesFilter);
+
+		if (CastCollector.mBody)
+		{
+			Hit.BodyID = CastCollector.mBody->GetID().GetIndexAndSequenceNumber();
+			Hit.Location = CoordinateUtils::FromJoltCoordinates(CastCollector.mContactPosition);
+			Hit.Normal = CoordinateUtils::FromJoltUnitVector(CastCollector.mContactNormal);
+			Hit.Distance = (Hit.Location - FVector3f(Request.CastFrom)).Length();
+		}
+	}
+}
+
+void FWorldSimOwner::CastRayBatch(
+	TConstArrayView<FBRayCastRequest> Requests,
+	TArrayView<FBCastHit> OutHits,
+	const BroadPhaseLayerFilter& BroadPhaseFilter,
+	const ObjectLayerFilter& ObjectFilter) const
+{
+	TArrayView<FBatchOrderEntry> Order = ZOrderBatch(Requests, [](const FBRayCastRequest& R) -> const FVector3d& { return R.CastFrom; });
+
+	const BroadPhaseQuery& Query = physics_system->GetBroadPhaseQuery();
+	const BodyLockInterface& Locks = physics_system->GetBodyLockInterfaceNoLock();
+	for (const FBatchOrderEntry& Entry : Order)
+	{
+		const FBRayCastRequest& Request = Requests[Entry.Value];
+		FBCastHit& Hit = OutHits[Entry.Value];
+		Hit.BodyID = BodyID::cInvalidBodyID;
+		if (Request.CastFrom.ContainsNaN())
+		{
+			continue;
+		}
+
+		BodyID Ignore;
+		GetBodyIDOrDefault(Request.Ignore, Ignore);
+		IgnoreSingleBodyFilter BodiesFilter(Ignore);
+
+		RRayCast Ray(CoordinateUtils::ToJoltCoordinates(Request.CastFrom), CoordinateUtils::ToJoltCoordinates(Request.Direction));
+		RayCastResult CastResult;
+		FirstHitRayCastCollector FirstHitCollector(Ray, CastResult, Locks, BodiesFilter);
+		Query.CastRay(RayCast(Ray), FirstHitCollector, BroadPhaseFilter, ObjectFilter);
+
+		if (FirstHitCollector.mHit.mBodyID != BodyID())
+		{
+			Hit.BodyID = FirstHitCollector.mHit.mBodyID.GetIndexAndSequenceNumber();
+			Hit.Location = CoordinateUtils::FromJoltCoordinates(FirstHitCollector.mContactPosition);
+			Hit.Normal = FVector3f::ZeroVector; //the single CastRay doesn't produce one either.
+			Hit.Distance = (Hit.Location - FVector3f(Request.CastFrom)).Length();
+		}
+	}
+}
+
+void FWorldSimOwner::SphereSearchBatch(
+	TConstArrayView<FBSphereSearchRequest> Requests,
+	TArrayView<FBSearchSpan> OutSpans,
+	TArray<uint32>& OutFoundObjectIDs,
+	const BroadPhaseLayerFilter& BroadPhaseFilter,
+	const ObjectLayerFilter& ObjectFilter) const
+{
+	TArrayView<FBatchOrderEntry> Order = ZOrderBatch(Requests, [](const FBSphereSearchRequest& R) -> const FVector3d& { return R.Location; });
+
+	const BroadPhaseQuery& Query = physics_system->GetBroadPhaseQuery();
+	SphereSearchBatchCollector Collector(physics_system->GetBodyLockInterfaceNoLock(), OutFoundObjectIDs);
+	for (const FBatchOrderEntry& Entry : Order)
+	{
+		const FBSphereSearchRequest& Request = Requests[Entry.Value];
+		FBSearchSpan& Span = OutSpans[Entry.Value];
+		Span.Offset = OutFoundObjectIDs.Num();
+		Span.Count = 0;
+		if (Request.Location.ContainsNaN())
+		{
+			continue;
+		}
+
+		BodyID Ignore;
+		GetBodyIDOrDefault(Request.Source, Ignore);
+		Collector.Restart(Ignore);
+		Query.CollideSphere(CoordinateUtils::ToJoltCoordinates(Request.Location), Request.Radius, Collector, BroadPhaseFilter, ObjectFilter);
+		Span.Count = Collector.BodyCount;
+	}
+}
+
 inline EMotionType LayerToMotionTypeMapping(uint16 Layer)
 {
 	switch (Layer)
@@ -341,12 +491,20 @@ inline FBarrageKey FWorldSimOwner::CreatePrimitive(FBCharParams& ToCreate, uint1
 	NewCharacter->mDeltaTime = DeltaTime;
 	NewCharacter->mForcesUpdate = Vec3::sZero();
 	// Create the shape
-	BodyID BodyIDTemp = NewCharacter->Create(&this->CharacterVsCharacterCollisionSimple);
+	BodyID BodyIDTemp = NewCharacter->Create(&this->CharacterHashGrid);
+	if (NewCharacter->mCharacter)
+	{
+		//the grid pads each character by the most it can move in one step, since the grid is only rebuilt once per step.
+		CharacterHashGrid.Add(NewCharacter);
+	}
 	//AddInternalQueuing(BodyIDTemp, 0);// we can't figure this out yet. we'll have to set it later or rearch for data exposure reasons. --JMK, can kicka
 	//Barrage key is unique to WORLD and BODY. This is crushingly important.
 	FBarrageKey FBK = GenerateBarrageKeyFromBodyId(BodyIDTemp);
 	BarrageToJoltMapping->insert(FBK, BodyIDTemp);
-	CharacterToJoltMapping->Add(FBK, NewCharacter);
+	{
+		FWriteScopeLock Writing(CharacterMappingLock);
+		CharacterToJoltMapping->Add(FBK, NewCharacter);
+	}
 	return FBK;
 }
 
@@ -425,69 +583,20 @@ FBLet FWorldSimOwner::LoadComplexStaticMesh(FBTransform& MeshTransform,
 			return nullptr;
 		}
 
-		//Here we go!
-		TArray<Chaos::FTriangleMeshImplicitObjectPtr>& MeshSet = collbody->TriMeshGeometries;
-		JPH::VertexList JoltVerts;
-		JPH::IndexedTriangleList JoltIndexedTriangles;
-		uint32 tris = 0;
-		for (Chaos::FTriangleMeshImplicitObjectPtr& Mesh : MeshSet)
-		{
-			tris += Mesh->Elements().GetNumTriangles();
-		}
-		JoltVerts.reserve(tris);
-		JoltIndexedTriangles.reserve(tris);
-		for (Chaos::FTriangleMeshImplicitObjectPtr& Mesh : MeshSet)
-		{
-			//indexed triangles are made by collecting the vertexes, then generating triples describing the triangles.
-			//this allows the heavier vertices to be stored only once, rather than each time they are used. for large models
-			//like terrain, this can be extremely significant. though, it's not truly clear to me if it's worth it.
-			const Chaos::FTrimeshIndexBuffer& VertToTriBuffers = Mesh->Elements();
-			const Chaos::TArrayCollectionArray<Chaos::TVector<float, 3>>& Verts = Mesh->Particles().X();
-			if (VertToTriBuffers.RequiresLargeIndices())
-			{
-				for (auto& aTri : VertToTriBuffers.GetLargeIndexBuffer())
-				{
-					JoltIndexedTriangles.push_back(IndexedTriangle(aTri[2], aTri[1], aTri[0]));
-				}
-			}
-			else
-			{
-				for (auto& aTri : VertToTriBuffers.GetSmallIndexBuffer())
-				{
-					JoltIndexedTriangles.push_back(IndexedTriangle(aTri[2], aTri[1], aTri[0]));
-				}
-			}
-
-			for (auto& vtx : Verts)
-			{
-				//need to figure out how to defactor this without breaking typehiding or having to create a bunch of util.h files.
-				//though, tbh, the util.h is the play. TODO: util.h ?
-				JoltVerts.push_back(CoordinateUtils::ToJoltCoordinates(vtx));
-			}
-		}
-		JPH::MeshShapeSettings FullMesh(JoltVerts, JoltIndexedTriangles);
-		//just the last boiler plate for now.
-		JPH::ShapeSettings::ShapeResult err = FullMesh.Create();
-		if (err.HasError())
+		//Here we go! placements of the same mesh at the same scale all share one cooked shape. see MeshShapeCache.h.
+		JPH::ShapeRefC shape = MeshShapeCache->GetOrCook(collbody, MeshTransform.GetScaleJoltArg());
+		if (!shape)
 		{
 			return nullptr;
 		}
-		//TODO: should we be holding the shape ref in gamesim owner?
-		auto& shape = err.Get();
 		BodyCreationSettings creation_settings;
 		creation_settings.mMotionType = EMotionType::Static;
 		creation_settings.mObjectLayer = Layers::NON_MOVING;
 		creation_settings.mFriction = 0.5f;
 		creation_settings.mRestitution = 0;
 		creation_settings.mUseManifoldReduction = true;
-		
-		Shape::ShapeResult result = shape->ScaleShape(MeshTransform.GetScaleJoltArg());
-		if (result.HasError() || result.IsEmpty())
-		{
-			throw;
-		}
 
-		Ref<Shape> OriginAndRotationApplied = new RotatedTranslatedShape(CoordinateUtils::ToJoltCoordinates(MeshTransform.GetLocation()), CoordinateUtils::ToJoltRotation(MeshTransform.GetRotationQuat()),  result.Get());
+		Ref<Shape> OriginAndRotationApplied = new RotatedTranslatedShape(CoordinateUtils::ToJoltCoordinates(MeshTransform.GetLocation()), CoordinateUtils::ToJoltRotation(MeshTransform.GetRotationQuat()), shape);
 		creation_settings.SetShape(OriginAndRotationApplied);
 		BodyID bID = body_interface->CreateBody(creation_settings)->GetID();
 		AddInternalQueuing(bID, 0);// You know that scene where data tries alcohol, hates it, and immediately orders another?
@@ -566,7 +675,7 @@ void FWorldSimOwner::AddInternalQueuing(JPH::BodyID ToQueue, uint64 ordinant)
 bool FWorldSimOwner::UpdateCharacter(FBPhysicsInput& Update)
 {
 	FBarrageKey key = Update.Target;
-	TSharedPtr<FBCharacterBase>* CharacterOuter = CharacterToJoltMapping->Find(key);
+	TSharedPtr<FBCharacterBase> CharacterOuter = FindCharacter(key);
 	//As you add handling for Characters with Inner Shapes, you'll need to use something like the line below.
 	//Unfortunately, it's going to be a lot of work. Right now, there's a bug preventing us from doing it, something in the lifecycle.
 	//auto CharacterInner = BarrageToJoltMapping->find(Update.Target.Get()->KeyIntoBarrage); 
@@ -574,7 +683,7 @@ bool FWorldSimOwner::UpdateCharacter(FBPhysicsInput& Update)
 	{
 		auto HoldOpen = physics_system;
 
-		(*CharacterOuter)->IngestUpdate(Update);
+		CharacterOuter->IngestUpdate(Update);
 		return true;
 	}
 	return false;
@@ -0,0 +1,336 @@
+﻿#include "MeshShapeCache.h"
+
+#include "CoordinateUtils.h"
+#include "Chaos/TriangleMeshImplicitObject.h"
+#include "Hash/xxhash.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeRWLock.h"
+#include "Jolt/Core/StreamIn.h"
+#include "Jolt/Core/StreamOut.h"
+
+using namespace JPH;
+
+namespace
+{
+	//jolt's binary shape format writes through these. the whole file is small enough to just hold in memory.
+	class FBArrayStreamOut final : public StreamOut
+	{
+	public:
+		explicit FBArrayStreamOut(TArray<uint8>& InBytes) : Bytes(InBytes) {}
+		virtual void WriteBytes(const void* inData, size_t inNumBytes) override
+		{
+			Bytes.Append(static_cast<const uint8*>(inData), static_cast<int32>(inNumBytes));
+		}
+		virtual bool IsFailed() const override { return false; }
+
+	private:
+		TArray<uint8>& Bytes;
+	};
+
+	class FBArrayStreamIn final : public StreamIn
+	{
+	public:
+		FBArrayStreamIn(const TArray<uint8>& InBytes, int64 InCursor) : Bytes(InBytes), Cursor(InCursor) {}
+		virtual void ReadBytes(void* outData, size_t inNumBytes) override
+		{
+			if (Failed || Cursor + int64(inNumBytes) > Bytes.Num())
+			{
+				//a truncated file reads as zeroes and fails, rather than walking off the end.
+				Failed = true;
+				FMemory::Memzero(outData, inNumBytes);
+				return;
+			}
+			FMemory::Memcpy(outData, Bytes.GetData() + Cursor, inNumBytes);
+			Cursor += inNumBytes;
+		}
+		virtual bool IsEOF() const override { return Cursor >= Bytes.Num(); }
+		virtual bool IsFailed() const override { return Failed; }
+
+	private:
+		const TArray<uint8>& Bytes;
+		int64 Cursor;
+		bool Failed = false;
+	};
+
+	struct FBCookedHeader
+	{
+		uint32 Magic;
+		uint32 CookVersion;
+		uint32 JoltVersion; //includes jolt's feature bits, so a double precision or nondeterministic build won't read our files.
+		uint32 Pad;
+		uint64 ContentHash;
+		//xxhash of everything after the header. jolt's restore trusts its input, so a flipped bit has to stop here.
+		uint64 PayloadHash;
+	};
+	static constexpr uint32 CookedMagic = 0x43534D42; // "BMSC"
+
+	using FChaosTrimeshes = TArray<Chaos::FTriangleMeshImplicitObjectPtr>;
+
+	//hashes exactly what CookFromChaos reads, and nothing else.
+	uint64 HashTrimeshes(const FChaosTrimeshes& Meshes)
+	{
+		FXxHash64Builder Builder;
+		const uint32 Version = FBMeshShapeCache::CookVersion;
+		Builder.Update(&Version, sizeof(Version));
+		for (const Chaos::FTriangleMeshImplicitObjectPtr& Mesh : Meshes)
+		{
+			const Chaos::FTrimeshIndexBuffer& Tris = Mesh->Elements();
+			const bool Large = Tris.RequiresLargeIndices();
+			const int32 NumTris = Tris.GetNumTriangles();
+			const int32 NumVerts = Mesh->Particles().Size();
+			Builder.Update(&Large, sizeof(Large));
+			Builder.Update(&NumTris, sizeof(NumTris));
+			Builder.Update(&NumVerts, sizeof(NumVerts));
+			if (Large)
+			{
+				Builder.Update(Tris.GetLargeIndexBuffer().GetData(), Tris.GetLargeIndexBuffer().NumBytes());
+			}
+			else
+			{
+				Builder.Update(Tris.GetSmallIndexBuffer().GetData(), Tris.GetSmallIndexBuffer().NumBytes());
+			}
+			for (const Chaos::TVector<float, 3>& Vtx : Mesh->Particles().X())
+			{
+				Builder.Update(&Vtx, sizeof(Vtx));
+			}
+		}
+		return Builder.Finalize().Hash;
+	}
+}
+
+FBMeshShapeCache::FBMeshShapeCache(const FString& InCookDirectory) : CookDirectory(InCookDirectory)
+{
+}
+
+ShapeRefC FBMeshShapeCache::GetOrCook(const UBodySetup* Body, Vec3Arg Scale)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Mesh Shape Cache");
+	if (!Body || Body->TriMeshGeometries.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	const uint64 ContentHash = ContentHashFor(Body);
+	const float ScaleBits[3] = {Scale.GetX(), Scale.GetY(), Scale.GetZ()};
+	FXxHash64Builder ScaledBuilder;
+	ScaledBuilder.Update(&ContentHash, sizeof(ContentHash));
+	ScaledBuilder.Update(ScaleBits, sizeof(ScaleBits));
+	const uint64 ScaledHash = ScaledBuilder.Finalize().Hash;
+
+	ShapeRefC Result;
+	if (Scaled.find(ScaledHash, Result))
+	{
+		return Result;
+	}
+
+	ShapeRefC Mesh = FindOrCookUnscaled(Body, ContentHash);
+	if (!Mesh)
+	{
+		return nullptr;
+	}
+	Shape::ShapeResult ScaledResult = Mesh->ScaleShape(Scale);
+	if (ScaledResult.HasError() || ScaledResult.IsEmpty())
+	{
+		return nullptr;
+	}
+	Result = ScaledResult.Get();
+	if (!Scaled.insert(ScaledHash, Result))
+	{
+		//someone else got there first. use theirs, so everyone's holding the same one.
+		Scaled.find(ScaledHash, Result);
+	}
+	return Result;
+}
+
+uint64 FBMeshShapeCache::ContentHashFor(const UBodySetup* Body)
+{
+	const TObjectKey<UBodySetup> Key(Body);
+	{
+		FReadScopeLock Reading(HashMemoLock);
+		const FHashMemo* Memo = HashMemos.Find(Key);
+		if (Memo && Memo->Meshes == Body->TriMeshGeometries)
+		{
+			return Memo->ContentHash;
+		}
+	}
+
+	const uint64 ContentHash = HashTrimeshes(Body->TriMeshGeometries);
+	FWriteScopeLock Writing(HashMemoLock);
+	HashMemos.Add(Key, FHashMemo{Body, Body->TriMeshGeometries, ContentHash});
+	if (HashMemos.Num() >= HashMemoSweepAt)
+	{
+		for (auto It = HashMemos.CreateIterator(); It; ++It)
+		{
+			if (!It->Value.Body.IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		HashMemoSweepAt = FMath::Max(64, HashMemos.Num() * 2);
+	}
+	return ContentHash;
+}
+
+ShapeRefC FBMeshShapeCache::FindOrCookUnscaled(const UBodySetup* Body, uint64 ContentHash)
+{
+	ShapeRefC Result;
+	if (Unscaled.find(ContentHash, Result))
+	{
+		return Result;
+	}
+
+	Result = LoadFromDisk(ContentHash);
+	if (!Result)
+	{
+		Result = CookFromChaos(Body);
+		if (!Result)
+		{
+			return nullptr;
+		}
+		SaveToDisk(ContentHash, Result);
+	}
+	if (!Unscaled.insert(ContentHash, Result))
+	{
+		Unscaled.find(ContentHash, Result);
+	}
+	return Result;
+}
+
+ShapeRefC FBMeshShapeCache::CookFromChaos(const UBodySetup* Body)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Cook Mesh Shape");
+	const FChaosTrimeshes& MeshSet = Body->TriMeshGeometries;
+	VertexList JoltVerts;
+	IndexedTriangleList JoltIndexedTriangles;
+	uint32 tris = 0;
+	uint32 verts = 0;
+	for (const Chaos::FTriangleMeshImplicitObjectPtr& Mesh : MeshSet)
+	{
+		tris += Mesh->Elements().GetNumTriangles();
+		verts += Mesh->Particles().Size();
+	}
+	JoltVerts.reserve(verts);
+	JoltIndexedTriangles.reserve(tris);
+	for (const Chaos::FTriangleMeshImplicitObjectPtr& Mesh : MeshSet)
+	{
+		//indexed triangles are made by collecting the vertexes, then generating triples describing the triangles.
+		//this allows the heavier vertices to be stored only once, rather than each time they are used. for large models
+		//like terrain, this can be extremely significant.
+		//each chaos trimesh indexes its own particles, so once they're all in one list, later meshes need offsetting.
+		const uint32 Base = static_cast<uint32>(JoltVerts.size());
+		const Chaos::FTrimeshIndexBuffer& VertToTriBuffers = Mesh->Elements();
+		if (VertToTriBuffers.RequiresLargeIndices())
+		{
+			for (auto& aTri : VertToTriBuffers.GetLargeIndexBuffer())
+			{
+				JoltIndexedTriangles.push_back(IndexedTriangle(Base + aTri[2], Base + aTri[1], Base + aTri[0]));
+			}
+		}
+		else
+		{
+			for (auto& aTri : VertToTriBuffers.GetSmallIndexBuffer())
+			{
+				JoltIndexedTriangles.push_back(IndexedTriangle(Base + aTri[2], Base + aTri[1], Base + aTri[0]));
+			}
+		}
+		for (auto& vtx : Mesh->Particles().X())
+		{
+			JoltVerts.push_back(CoordinateUtils::ToJoltCoordinates(vtx));
+		}
+	}
+
+	MeshShapeSettings FullMesh(JoltVerts, JoltIndexedTriangles);
+	ShapeSettings::ShapeResult err = FullMesh.Create();
+	if (err.HasError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Barrage: couldn't cook mesh shape for %s: %hs"), *GetNameSafe(Body->GetOuter()), err.GetError().c_str());
+		return nullptr;
+	}
+	return err.Get();
+}
+
+FString FBMeshShapeCache::PathFor(uint64 ContentHash) const
+{
+	return FPaths::Combine(CookDirectory, FString::Printf(TEXT("%016llx.jshape"), ContentHash));
+}
+
+ShapeRefC FBMeshShapeCache::LoadFromDisk(uint64 ContentHash) const
+{
+	if (CookDirectory.IsEmpty())
+	{
+		return nullptr;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Restore Cooked Mesh Shape");
+	const FString Path = PathFor(ContentHash);
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+	{
+		return nullptr;
+	}
+
+	FBCookedHeader Header;
+	if (Bytes.Num() < int32(sizeof(Header)))
+	{
+		IFileManager::Get().Delete(*Path, false, false, true);
+		return nullptr;
+	}
+	FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(Header));
+	if (Header.Magic != CookedMagic || Header.CookVersion != CookVersion || Header.JoltVersion != JPH_VERSION_ID || Header.ContentHash != ContentHash)
+	{
+		//stale. we'll cook over it.
+		return nullptr;
+	}
+
+	if (FXxHash64::HashBuffer(Bytes.GetData() + sizeof(Header), Bytes.Num() - sizeof(Header)).Hash != Header.PayloadHash)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Barrage: cooked mesh shape %s fails its checksum, recooking."), *Path);
+		IFileManager::Get().Delete(*Path, false, false, true);
+		return nullptr;
+	}
+
+	FBArrayStreamIn In(Bytes, sizeof(Header));
+	Shape::IDToShapeMap ShapeMap;
+	Shape::IDToMaterialMap MaterialMap;
+	Shape::ShapeResult Restored = Shape::sRestoreWithChildren(In, ShapeMap, MaterialMap);
+	if (In.IsFailed() || Restored.HasError() || !Restored.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Barrage: cooked mesh shape %s is damaged, recooking."), *Path);
+		IFileManager::Get().Delete(*Path, false, false, true);
+		return nullptr;
+	}
+	return Restored.Get();
+}
+
+void FBMeshShapeCache::SaveToDisk(uint64 ContentHash, const Shape* Cooked) const
+{
+	if (CookDirectory.IsEmpty())
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Save Cooked Mesh Shape");
+	TArray<uint8> Bytes;
+	FBCookedHeader Header{CookedMagic, CookVersion, JPH_VERSION_ID, 0, ContentHash, 0};
+	Bytes.AddZeroed(sizeof(Header));
+	FBArrayStreamOut Out(Bytes);
+	Shape::ShapeToIDMap ShapeMap;
+	Shape::MaterialToIDMap MaterialMap;
+	Cooked->SaveWithChildren(Out, ShapeMap, MaterialMap);
+	Header.PayloadHash = FXxHash64::HashBuffer(Bytes.GetData() + sizeof(Header), Bytes.Num() - sizeof(Header)).Hash;
+	FMemory::Memcpy(Bytes.GetData(), &Header, sizeof(Header));
+
+	//write somewhere private and move it into place, so a reader never sees half a file. this covers two worlds
+	//cooking the same mesh at once, and a crash mid write.
+	IFileManager& Files = IFileManager::Get();
+	Files.MakeDirectory(*CookDirectory, true);
+	const FString Temp = FPaths::CreateTempFilename(*CookDirectory, TEXT("cook"), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(Bytes, *Temp))
+	{
+		return;
+	}
+	if (!Files.Move(*PathFor(ContentHash), *Temp, true, true, false, true))
+	{
+		Files.Delete(*Temp, false, false, true);
+	}
+}
@@ -83,8 +83,7 @@ void FBCharacter::StepCharacter()
 	
 	RVec3 start_pos = GetPosition();
 	//allow single frame exccession
-	//TODO: factor this into a stupid constant.
-	float SpeedLimit = min(new_velocity.Length(), (mMaxSpeed * 1.20f));
+	float SpeedLimit = min(new_velocity.Length(), (mMaxSpeed * SpeedExcession));
 	Vec3 clamped = (new_velocity.Normalized() * SpeedLimit);
 	
 	mCharacter->SetLinearVelocity(clamped);
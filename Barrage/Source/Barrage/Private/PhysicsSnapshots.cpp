@@ -0,0 +1,165 @@
+﻿#include "PhysicsSnapshots.h"
+#include "FWorldSimOwner.h"
+
+using namespace JPH;
+
+namespace
+{
+	//only dynamic bodies are worth saving. records what it let through, since that's exactly the set restore needs.
+	class FBDynamicBodiesOnly final : public StateRecorderFilter
+	{
+	public:
+		explicit FBDynamicBodiesOnly(TArray<BodyID>& OutSaved) : Saved(&OutSaved) {}
+
+		virtual bool ShouldSaveBody(const Body& inBody) const override
+		{
+			if (!inBody.IsDynamic())
+			{
+				return false;
+			}
+			Saved->Add(inBody.GetID());
+			return true;
+		}
+
+	private:
+		TArray<BodyID>* Saved;
+	};
+
+	//global, bodies and contacts. contacts warm start the solver, so a resim without them won't land in the same place.
+	constexpr EStateRecorderState SnapshotState = EStateRecorderState::Global | EStateRecorderState::Bodies | EStateRecorderState::Contacts;
+}
+
+void FBPhysicsSnapshots::FRecorder::WriteBytes(const void* inData, size_t inNumBytes)
+{
+	Bytes.Append(static_cast<const uint8*>(inData), static_cast<int32>(inNumBytes));
+}
+
+void FBPhysicsSnapshots::FRecorder::ReadBytes(void* outData, size_t inNumBytes)
+{
+	if (Failed || Cursor + int64(inNumBytes) > Bytes.Num())
+	{
+		Failed = true;
+		FMemory::Memzero(outData, inNumBytes);
+		return;
+	}
+	FMemory::Memcpy(outData, Bytes.GetData() + Cursor, inNumBytes);
+	Cursor += inNumBytes;
+}
+
+void FBPhysicsSnapshots::FRecorder::Reset()
+{
+	Bytes.Reset();
+	Cursor = 0;
+	Failed = false;
+}
+
+void FBPhysicsSnapshots::FRecorder::Seek(int64 To)
+{
+	Cursor = To;
+	Failed = false;
+}
+
+void FBPhysicsSnapshots::Capture(uint64 Tick, const PhysicsSystem& System, const FCharacters* Characters)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Physics Snapshot Capture");
+	FSlot& Slot = SlotFor(Tick);
+	Slot.Valid = false;
+	Slot.Tick = Tick;
+	Slot.World.Reset();
+	Slot.Bodies.Reset();
+	Slot.CharacterStates.Reset();
+	Slot.CharacterOffsets.Reset();
+
+	FBDynamicBodiesOnly Filter(Slot.Bodies);
+	System.SaveState(Slot.World, SnapshotState, &Filter);
+
+	if (Characters)
+	{
+		for (const TPair<FBarrageKey, TSharedPtr<FBCharacterBase>>& Character : *Characters)
+		{
+			if (Character.Value && Character.Value->mCharacter)
+			{
+				Slot.CharacterOffsets.Emplace(Character.Key, Slot.CharacterStates.Num());
+				Character.Value->mCharacter->SaveState(Slot.CharacterStates);
+			}
+		}
+	}
+	Slot.Valid = !Slot.World.IsFailed() && !Slot.CharacterStates.IsFailed();
+}
+
+bool FBPhysicsSnapshots::Has(uint64 Tick) const
+{
+	const FSlot& Slot = SlotFor(Tick);
+	return Slot.Valid && Slot.Tick == Tick;
+}
+
+uint32 FBPhysicsSnapshots::Fingerprint(uint64 Tick) const
+{
+	if (!Has(Tick))
+	{
+		return 0;
+	}
+	const FSlot& Slot = SlotFor(Tick);
+	//never 0, so 0 can mean missing.
+	return FMath::Max(Slot.CharacterStates.Crc(Slot.World.Crc(0)), 1u);
+}
+
+bool FBPhysicsSnapshots::Restore(uint64 Tick, PhysicsSystem& System, const FCharacters* Characters)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_STR("Physics Snapshot Restore");
+	if (!Has(Tick))
+	{
+		return false;
+	}
+	FSlot& Slot = SlotFor(Tick);
+
+	//jolt bails partway through if a saved body is gone, leaving the world half restored. check first instead.
+	const BodyLockInterfaceNoLock& BodyLock = System.GetBodyLockInterfaceNoLock();
+	for (const BodyID& ID : Slot.Bodies)
+	{
+		const Body* Found = BodyLock.TryGetBody(ID);
+		if (!Found || !Found->IsDynamic() || !Found->IsInBroadPhase())
+		{
+			return false;
+		}
+	}
+
+	Slot.World.Seek(0);
+	if (!System.RestoreState(Slot.World) || Slot.World.IsFailed())
+	{
+		//can't trust anything after this one now.
+		Clear();
+		return false;
+	}
+
+	if (Characters)
+	{
+		for (const TPair<FBarrageKey, int64>& Saved : Slot.CharacterOffsets)
+		{
+			const TSharedPtr<FBCharacterBase>* Character = Characters->Find(Saved.Key);
+			if (Character && *Character && (*Character)->mCharacter)
+			{
+				Slot.CharacterStates.Seek(Saved.Value);
+				(*Character)->mCharacter->RestoreState(Slot.CharacterStates);
+			}
+		}
+	}
+
+	//everything after this tick belongs to a future that just got thrown away. the resim will write it again.
+	for (FSlot& Later : Slots)
+	{
+		if (Later.Tick > Tick)
+		{
+			Later.Valid = false;
+		}
+	}
+	return true;
+}
+
+void FBPhysicsSnapshots::Clear()
+{
+	for (FSlot& Slot : Slots)
+	{
+		Slot.Valid = false;
+	}
+}
@@ -0,0 +1,118 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FWorldSimOwner.h"
+#include "EPhysicsLayer.h"
+#include "HAL/PlatformTime.h"
+
+//projectile heavy churn, quadtree vs paddington. this builds its own sims and a sim tears down jolt's global factory
+//on the way out, so run it headless (-nullrhi, no pie world), not next to a live barrage dispatch.
+namespace BroadPhaseBench
+{
+	struct FChurnResult
+	{
+		double ChurnSeconds = 0;
+		double StepSeconds = 0;
+		double QuerySeconds = 0;
+		int32 Hits = 0;
+	};
+
+	class FCountingCollector final : public JPH::CollideShapeBodyCollector
+	{
+	public:
+		int32 Count = 0;
+		virtual void AddHit(const JPH::BodyID&) override { ++Count; }
+	};
+
+	//same seed, same scene, same order of adds and removes for both broadphases, so the hit counts have to agree.
+	static FChurnResult Run(EBarrageBroadPhase Kind, int32 Live, int32 PerStep, int32 Steps)
+	{
+		FChurnResult Result;
+		FWorldSimOwner Sim(1.0f / 120.0f, [](int) {}, Kind);
+		JPH::BodyInterface& Bodies = *Sim.body_interface;
+		FRandomStream Random(0xB00B1E5);
+
+		//a field of static pillars for the projectiles to fly through.
+		JPH::RefConst<JPH::Shape> Pillar = new JPH::BoxShape(JPH::Vec3(1, 8, 1));
+		for (int32 i = 0; i < 1024; ++i)
+		{
+			JPH::BodyCreationSettings Settings(Pillar, JPH::RVec3(Random.FRandRange(-500, 500), 0, Random.FRandRange(-500, 500)),
+				JPH::Quat::sIdentity(), JPH::EMotionType::Static, Layers::NON_MOVING);
+			Bodies.CreateAndAddBody(Settings, JPH::EActivation::DontActivate);
+		}
+		Sim.OptimizeBroadPhase();
+
+		JPH::RefConst<JPH::Shape> Round = new JPH::SphereShape(0.1f);
+		TArray<JPH::BodyID> Flying;
+		Flying.Reserve(Live + PerStep);
+		TArray<JPH::BodyID> Batch;
+		Batch.Reserve(PerStep);
+		FCountingCollector Collector;
+		for (int32 Step = 0; Step < Steps; ++Step)
+		{
+			double Start = FPlatformTime::Seconds();
+			Batch.Reset();
+			for (int32 i = 0; i < PerStep; ++i)
+			{
+				JPH::BodyCreationSettings Settings(Round, JPH::RVec3(Random.FRandRange(-500, 500), 2, Random.FRandRange(-500, 500)),
+					JPH::Quat::sIdentity(), JPH::EMotionType::Dynamic, Layers::PROJECTILE);
+				//sensors, so contacts never push them around and both runs fly the exact same paths.
+				Settings.mIsSensor = true;
+				Settings.mGravityFactor = 0;
+				Settings.mLinearVelocity = JPH::Vec3(Random.FRandRange(-300, 300), 0, Random.FRandRange(-300, 300));
+				Batch.Add(Bodies.CreateBody(Settings)->GetID());
+			}
+			JPH::BodyInterface::AddState State = Bodies.AddBodiesPrepare(Batch.GetData(), Batch.Num());
+			Bodies.AddBodiesFinalize(Batch.GetData(), Batch.Num(), State, JPH::EActivation::Activate);
+			Flying.Append(Batch);
+			if (Flying.Num() > Live)
+			{
+				const int32 Expired = Flying.Num() - Live;
+				Bodies.RemoveBodies(Flying.GetData(), Expired);
+				Bodies.DestroyBodies(Flying.GetData(), Expired);
+				Flying.RemoveAt(0, Expired, EAllowShrinking::No);
+			}
+			Result.ChurnSeconds += FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			Sim.StepSimulation();
+			Result.StepSeconds += FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			for (int32 q = 0; q < 64; ++q)
+			{
+				const JPH::Vec3 Center(Random.FRandRange(-500, 500), 2, Random.FRandRange(-500, 500));
+				Sim.physics_system->GetBroadPhaseQuery().CollideAABox(JPH::AABox(Center - JPH::Vec3::sReplicate(20), Center + JPH::Vec3::sReplicate(20)), Collector);
+			}
+			Result.QuerySeconds += FPlatformTime::Seconds() - Start;
+		}
+		Result.Hits = Collector.Count;
+
+		Bodies.RemoveBodies(Flying.GetData(), Flying.Num());
+		Bodies.DestroyBodies(Flying.GetData(), Flying.Num());
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBarrageBroadPhaseChurnBenchmark, "Barrage.Benchmark.BroadPhaseChurn",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBarrageBroadPhaseChurnBenchmark::RunTest(const FString& Parameters)
+{
+	//live projectiles, adds (and so removes) per step. 120 steps is one second of sim.
+	const int32 Scenes[][2] = {{1000, 50}, {4000, 200}, {16000, 800}};
+	for (const auto& Scene : Scenes)
+	{
+		const BroadPhaseBench::FChurnResult Quad = BroadPhaseBench::Run(EBarrageBroadPhase::JoltQuadTree, Scene[0], Scene[1], 120);
+		const BroadPhaseBench::FChurnResult Pad = BroadPhaseBench::Run(EBarrageBroadPhase::Paddington, Scene[0], Scene[1], 120);
+		AddInfo(FString::Printf(TEXT("live %d, churn %d/step: quadtree churn %.2fms step %.2fms query %.2fms | paddington churn %.2fms step %.2fms query %.2fms"),
+			Scene[0], Scene[1],
+			Quad.ChurnSeconds * 1000, Quad.StepSeconds * 1000, Quad.QuerySeconds * 1000,
+			Pad.ChurnSeconds * 1000, Pad.StepSeconds * 1000, Pad.QuerySeconds * 1000));
+		TestEqual(FString::Printf(TEXT("broadphases agree on query hits at %d live"), Scene[0]), Pad.Hits, Quad.Hits);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FWorldSimOwner.h"
+#include "PhysicsCharacter.h"
+#include "CharacterHashGrid.h"
+#include "HAL/PlatformTime.h"
+
+//the hash grid against jolt's simple collider, on the same characters. every character collides once against each,
+//and both have to find exactly the same contacts, or the grid is dropping or doubling neighbours. like the broadphase
+//benchmark, this builds its own sim, so run it headless.
+namespace CharacterGridBench
+{
+	class FCountingCollector final : public JPH::CollideShapeCollector
+	{
+	public:
+		int64 Count = 0;
+		virtual void AddHit(const JPH::CollideShapeResult&) override { ++Count; }
+	};
+
+	static double CollideAll(const JPH::CharacterVsCharacterCollision& Collider, const TArray<TSharedPtr<FBCharacter>>& Characters, int64& OutHits)
+	{
+		FCountingCollector Collector;
+		JPH::CollideShapeSettings Settings;
+		const double Start = FPlatformTime::Seconds();
+		for (const TSharedPtr<FBCharacter>& Character : Characters)
+		{
+			const JPH::CharacterVirtual* C = Character->mCharacter.GetPtr();
+			Settings.mMaxSeparationDistance = C->GetCharacterPadding();
+			Collider.CollideCharacter(C, C->GetCenterOfMassTransform(), Settings, JPH::RVec3::sZero(), Collector);
+		}
+		OutHits = Collector.Count;
+		return FPlatformTime::Seconds() - Start;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBarrageCharacterGridBenchmark, "Barrage.Benchmark.CharacterGrid",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBarrageCharacterGridBenchmark::RunTest(const FString& Parameters)
+{
+	FWorldSimOwner Sim(1.0f / 120.0f, [](int) {});
+	const int32 Counts[] = {10, 50, 200, 500, 1000, 2000};
+	for (const int32 Count : Counts)
+	{
+		FBCharacterHashGrid Grid;
+		JPH::CharacterVsCharacterCollisionSimple Simple;
+		TArray<TSharedPtr<FBCharacter>> Characters;
+		FRandomStream Random(Count);
+		//about one character per square meter no matter the count, so there's always someone close enough to touch.
+		const float Half = 0.5f * FMath::Sqrt(float(Count));
+		for (int32 i = 0; i < Count; ++i)
+		{
+			TSharedPtr<FBCharacter> Character = MakeShareable(new FBCharacter);
+			Character->mInitialPosition = JPH::RVec3(Random.FRandRange(-Half, Half), 0, Random.FRandRange(-Half, Half));
+			Character->World = Sim.physics_system;
+			Character->mDeltaTime = Sim.DeltaTime;
+			Character->Create(&Grid);
+			if (!Character->mCharacter)
+			{
+				AddError(TEXT("couldn't create a character"));
+				return false;
+			}
+			Grid.Add(Character);
+			Simple.Add(Character->mCharacter.GetPtr());
+			Characters.Add(Character);
+		}
+
+		const double RebuildStart = FPlatformTime::Seconds();
+		Grid.Rebuild();
+		const double RebuildSeconds = FPlatformTime::Seconds() - RebuildStart;
+
+		int64 GridHits = 0;
+		int64 SimpleHits = 0;
+		const double GridSeconds = CharacterGridBench::CollideAll(Grid, Characters, GridHits);
+		const double SimpleSeconds = CharacterGridBench::CollideAll(Simple, Characters, SimpleHits);
+		AddInfo(FString::Printf(TEXT("%d characters: grid %.3fms (+%.3fms rebuild), simple %.3fms, %lld contacts"),
+			Count, GridSeconds * 1000, RebuildSeconds * 1000, SimpleSeconds * 1000, SimpleHits));
+		TestEqual(FString::Printf(TEXT("grid and simple find the same contacts at %d characters"), Count), GridHits, SimpleHits);
+
+		for (const TSharedPtr<FBCharacter>& Character : Characters)
+		{
+			Simple.Remove(Character->mCharacter.GetPtr());
+		}
+	}
+	return true;
+}
+
+#endif
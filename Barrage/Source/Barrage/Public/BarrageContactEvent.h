@@ -19,6 +19,14 @@ struct BarrageContactEntity
 		MyLayer = Layers::NUM_LAYERS;
 	}
 	
+	BarrageContactEntity(const FBarrageKey ContactKeyIn, const Layers::EJoltPhysicsLayer LayerIn)
+	{
+		ContactKey = ContactKeyIn;
+		bIsProjectile = LayerIn == Layers::PROJECTILE || LayerIn == Layers::ENEMYPROJECTILE;
+		bIsStaticGeometry = LayerIn == Layers::NON_MOVING;
+		MyLayer = LayerIn;
+	}
+
 	BarrageContactEntity(const FBarrageKey ContactKeyIn, const JPH::Body& BodyIn)
 	{
 		ContactKey = ContactKeyIn;
@@ -0,0 +1,102 @@
+﻿// Copyright 2025 Oversized Sun Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BarrageContactEvent.h"
+#include "SkeletonTypes.h"
+#include <atomic>
+
+//which consumers care about a contact. decided once, when jolt reports it, by the owner key's prefix and the layers.
+//a contact goes to the first group either body qualifies for, in this order.
+enum class EBarrageContactGroup : uint8
+{
+	Projectile, //either side is a projectile. this is where the volume is.
+	Character,  //either side is something with locomotion: players, enemies, hitboxes.
+	Static,     //something ran into level geometry.
+	Other,      //debris, and removes, which don't carry enough to classify.
+	NUM
+};
+
+//a run of contacts from one group, laid out column by column. index i across the columns is one contact.
+//the owner keys come off the bodies' user data, so most consumers never need GetShapeRef just to find out who's who.
+//removes only have the barrage keys; owners are zero and layers are NUM_LAYERS.
+struct FBContactEventSpan
+{
+	int32 Num = 0;
+	const EBarrageContactEventType* Type = nullptr;
+	const FBarrageKey* Body1 = nullptr;
+	const FBarrageKey* Body2 = nullptr;
+	const FSkeletonKey* Owner1 = nullptr;
+	const FSkeletonKey* Owner2 = nullptr;
+	const uint8* Layer1 = nullptr;
+	const uint8* Layer2 = nullptr;
+	//which sides GroupOf counted as a projectile, by layer or by owner key. bit 0 is side 1, bit 1 is side 2.
+	const uint8* ProjectileSides = nullptr;
+
+	static constexpr uint8 ProjectileSide1 = 1;
+	static constexpr uint8 ProjectileSide2 = 2;
+	bool IsProjectile1(int32 i) const { return ProjectileSides[i] & ProjectileSide1; }
+	bool IsProjectile2(int32 i) const { return ProjectileSides[i] & ProjectileSide2; }
+};
+
+typedef TFunction<void(const FBContactEventSpan&)> FBContactConsumer;
+
+//Contact events out of the sim step, with no allocation after construction. Jolt reports contacts from every physics
+//job thread at once, so Push is multi producer: it claims a slot with one atomic add and writes straight into the columns.
+//When a group is full, the contact is dropped and counted instead of being silently lost.
+//
+//Producers only run inside the physics update and Drain only runs after it, on the step thread, so the two never
+//overlap. That means each group can just be a flat buffer that Drain empties, and every group drains as one span.
+//Drain also sorts each group by type and keys first, because the order jolt's threads report in isn't deterministic.
+class BARRAGE_API FBContactEventStream
+{
+public:
+	FBContactEventStream(int32 ProjectileCapacity, int32 OtherCapacity);
+
+	void Push(EBarrageContactEventType Type, FBarrageKey Key1, const JPH::Body& Body1, FBarrageKey Key2, const JPH::Body& Body2);
+	void PushRemoved(FBarrageKey Key1, FBarrageKey Key2);
+
+	//hands each non-empty group's span to Visit, then empties the group. step thread only, between steps.
+	void Drain(TFunctionRef<void(EBarrageContactGroup, const FBContactEventSpan&)> Visit);
+
+	//everything dropped for want of room, since construction.
+	uint64 GetDroppedCount(EBarrageContactGroup Group) const { return Groups[static_cast<uint8>(Group)].Dropped.load(std::memory_order_relaxed); }
+	int32 GetCapacity(EBarrageContactGroup Group) const { return Groups[static_cast<uint8>(Group)].Capacity; }
+
+	static EBarrageContactGroup GroupOf(uint64 Owner1, JPH::ObjectLayer Layer1, uint64 Owner2, JPH::ObjectLayer Layer2);
+
+private:
+	struct FGroup
+	{
+		int32 Capacity = 0;
+		std::atomic<int32> Count = 0;
+		std::atomic<uint64> Dropped = 0;
+		uint64 DroppedReported = 0;
+		TArray<EBarrageContactEventType> Type;
+		TArray<FBarrageKey> Body1;
+		TArray<FBarrageKey> Body2;
+		TArray<FSkeletonKey> Owner1;
+		TArray<FSkeletonKey> Owner2;
+		TArray<uint8> Layer1;
+		TArray<uint8> Layer2;
+		TArray<uint8> ProjectileSides;
+		//drain sorts through these, then swaps them in, so the sort doesn't allocate either.
+		TArray<int32> Order;
+		TArray<EBarrageContactEventType> ScratchType;
+		TArray<FBarrageKey> ScratchBody1;
+		TArray<FBarrageKey> ScratchBody2;
+		TArray<FSkeletonKey> ScratchOwner1;
+		TArray<FSkeletonKey> ScratchOwner2;
+		TArray<uint8> ScratchLayer1;
+		TArray<uint8> ScratchLayer2;
+		TArray<uint8> ScratchProjectileSides;
+
+		void Init(int32 InCapacity);
+		//-1 if we're full.
+		int32 Claim();
+		void SortForDeterminism(int32 Num);
+	};
+
+	FGroup Groups[static_cast<uint8>(EBarrageContactGroup::NUM)];
+};
@@ -11,7 +11,10 @@
 #include "FBarragePrimitive.h"
 #include "FBPhysicsInput.h"
 #include "Containers/CircularQueue.h"
+#include "Containers/Queue.h"
 #include "FBShapeParams.h"
+#include "FBQueryBatch.h"
+#include "BarrageContactStream.h"
 #include "KeyedConcept.h"
 #include "ORDIN.h"
 #include "TransformDispatch.h"
@@ -23,6 +26,14 @@
 
 static constexpr uint32 MAX_FOUND_OBJECTS = 1024;
 
+//which broadphase the jolt sim gets built with. the paddington tree is a grid-trie that handles heavy add/remove churn,
+//like projectiles, without rebuilding. the quadtree is jolt's stock broadphase and is still the safe default.
+enum class EBarrageBroadPhase : uint8
+{
+	JoltQuadTree,
+	Paddington
+};
+
 class BARRAGE_API FBarrageBounder
 {
 	friend class FBBoxParams;
@@ -74,9 +85,14 @@ public:
 	virtual bool RegistrationImplementation() override;
 	void GrantWorkerFeed(int MyThreadIndex);
 	static constexpr float TickRateInDelta = 1.0 / HERTZ_OF_BARRAGE;
+	//read once, when the sim is created in RegistrationImplementation. changing it after that does nothing.
+	EBarrageBroadPhase BroadPhaseKind = EBarrageBroadPhase::JoltQuadTree;
 	int32 ThreadAccTicker = 0;
 	TSharedPtr<TransformUpdatesForGameThread> GameTransformPump;
-	TSharedPtr<TCircularQueue<BarrageContactEvent>> ContactEventPump;
+	//contacts out of the step, grouped, see BarrageContactStream.h. projectile swarms get the big buffer.
+	TSharedPtr<FBContactEventStream> ContactEvents;
+	static constexpr int32 ProjectileContactCapacity = 16384;
+	static constexpr int32 GroupContactCapacity = 4096;
 	 //this value indicates you have none.
 	mutable FCriticalSection GrowOnlyAccLock;
 	int32 WorkerThreadAccTicker = 0;
@@ -96,7 +112,16 @@ public:
 	virtual void SphereSearch(FBarrageKey ShapeSource, FVector3d Location, double Radius, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter, const JPH::BodyFilter& BodiesFilter, uint32* OutFoundObjectCount, TArray<uint32>& OutFoundObjects);
 
 	virtual void CastRay(FVector3d CastFrom, FVector3d Direction, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter, const JPH::BodyFilter& BodiesFilter, TSharedPtr<FHitResult> OutHit);
-	
+
+	//Batched queries. If you have more than a handful of casts to do in one tick, use these.
+	//Requests and results are caller-owned and must be the same length. OutHits[i] always answers Requests[i].
+	//Filters are shared across the batch; each request can name one body to ignore, which covers the "don't hit yourself" case.
+	//Requests with NaN origins are skipped and report no hit, same as the single versions.
+	virtual void SphereCastBatch(TConstArrayView<FBSphereCastRequest> Requests, TArrayView<FBCastHit> OutHits, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter);
+	virtual void CastRayBatch(TConstArrayView<FBRayCastRequest> Requests, TArrayView<FBCastHit> OutHits, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter);
+	//found bodies are appended to OutFoundObjects. OutSpans[i] tells you which slice of it belongs to Requests[i].
+	virtual void SphereSearchBatch(TConstArrayView<FBSphereSearchRequest> Requests, TArrayView<FBSearchSpan> OutSpans, TArray<uint32>& OutFoundObjects, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter);
+
 	//and viola [sic] actually pretty elegant even without type polymorphism by using overloading polymorphism.
 	FBLet CreatePrimitive(FBBoxParams& Definition, FSkeletonKey Outkey, uint16 Layer, bool IsSensor = false, bool forceDynamic = false, bool isMovable = true);
 	FBLet CreatePrimitive(FBCharParams& Definition, FSkeletonKey Outkey, uint16 Layer);
@@ -121,6 +146,8 @@ public:
 		if (FBarragePrimitive::IsNotNull(Target))
 		{
 			Target->tombstone = TombstoneInitialMinimum + TombOffset;
+			//StepWorld picks these up, rather than hunting for them across every body we have.
+			FreshTombstones.Enqueue(Target);
 			return Target->tombstone;
 		}
 		return 1;
@@ -140,8 +167,22 @@ public:
 	//ONLY call this from a thread OTHER than gamethread, or you will experience untold sorrow.
 	void StepWorld(uint64 Time, uint64_t TickCount);
 
-	//TODO: oh dear I'm doing the same thing as the TransformQueue... Also probably want to check back on this.
+	//StepWorld snapshots dynamic bodies and characters after each step, FBPhysicsSnapshots::Depth steps deep.
+	//switch off if nothing will ever roll back. read every step, so it can be flipped at any time.
+	bool SnapshotEachTick = true;
+	//puts the world back the way it was right after StepWorld(TickCount). call it from the same thread as StepWorld,
+	//between steps, then step TickCount + 1 onward to resim. false means nothing was changed.
+	bool RestoreToTick(uint64_t TickCount);
+	//whether we've still got a snapshot for that tick. restore can still refuse it, but this is the cheap check.
+	bool CanRestoreToTick(uint64_t TickCount) const;
+	//a hash of the snapshot for that tick, 0 if there isn't one. see FBPhysicsSnapshots::Fingerprint.
+	uint32 FingerprintTick(uint64_t TickCount) const;
+
+	//hands each contact group to its consumers as one span, then to the per-contact delegates below if anyone is bound.
+	//call from the StepWorld thread, after StepWorld.
 	bool BroadcastContactEvents() const;
+	//bulk contact handling. the consumer is called once per step with every contact in its group, on the StepWorld thread.
+	void AddContactConsumer(EBarrageContactGroup Group, FBContactConsumer Consumer);
 	
 	FOnBarrageContactAdded OnBarrageContactAddedDelegate;
 	void HandleContactAdded(const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold,
@@ -172,8 +213,12 @@ public:
 	JPH::IgnoreSingleBodyFilter GetFilterToIgnoreSingleBody(const FBLet& ToIgnore) const;
 	
 private:
+	mutable FCriticalSection ContactConsumerLock;
+	TArray<FBContactConsumer> ContactConsumers[static_cast<uint8>(EBarrageContactGroup::NUM)];
 	TSharedPtr<KeyToFBLet> JoltBodyLifecycleMapping;
 	TSharedPtr<KeyToKey> TranslationMapping;
+	//anything tombstoned since the last step. SuggestTombstone can be called from any thread, StepWorld drains it.
+	TQueue<FBLet, EQueueMode::Mpsc> FreshTombstones;
 	FBLet ManagePointers(FSkeletonKey OutKey, FBarrageKey temp, FBShape form) const;
 	uint32 TombOffset = 0; //ticks up by one every world step.
 	//this is a little hard to explain. so keys are inserted as 
@@ -184,34 +229,14 @@ private:
 	//or optimize this for memory better. In general, Barrage and Artillery trade memory for speed and elegance.
 	TSharedPtr<TArray<FBLet>> Tombs[TombstoneInitialMinimum + 1];
 
-	void CleanTombs()
-	{
-		//free tomb at offset - TombstoneInitialMinimum, fulfilling our promised minimum.
-		TSharedPtr<TArray<FBLet>>* HoldOpen = Tombs;
-		TSharedPtr<TArray<FBLet>> Mausoleum = HoldOpen[(TombOffset) % (TombstoneInitialMinimum + 1)]; //think this math is wrong.
-		TSharedPtr<KeyToFBLet> HoldOpenBMap = JoltBodyLifecycleMapping;
-		TSharedPtr<KeyToKey> HoldOpenTMap = TranslationMapping;
-		if(Mausoleum && !Mausoleum->IsEmpty() && HoldOpenBMap && HoldOpenTMap)
-		{
-			for (auto Tombstone : *Mausoleum)
-			{
-				if (Tombstone)
-				{
-					JoltBodyLifecycleMapping->erase(Tombstone->KeyIntoBarrage);
-					TranslationMapping->erase(Tombstone->KeyOutOfBarrage);
-				}
-			}
-		}
-		
-		Mausoleum = HoldOpen[(TombOffset - TombstoneInitialMinimum) % (TombstoneInitialMinimum + 1)];
-		if (Mausoleum)
-		{
-			Mausoleum->Empty(); //roast 'em lmao.
-		}
-		TombOffset = (TombOffset + 1) % (TombstoneInitialMinimum + 1);
-	}
+	//lives in the cpp, since expired characters have to come out of the world sim's character mapping too.
+	void CleanTombs();
 
 private:
-	std::array<FBPhysicsInput, 32000> InternalSortableSet = {};
+	static constexpr uint32 MaxInputsPerStackUp = 32000;
+	std::array<FBPhysicsInput, MaxInputsPerStackUp> InternalSortableSet = {};
+	//StackUp sorts by index into the set above. two buffers, because radix passes ping-pong.
+	std::array<uint32, MaxInputsPerStackUp> InputOrder = {};
+	std::array<uint32, MaxInputsPerStackUp> InputOrderScratch = {};
 	std::array<JPH::BodyID, 8192> Adds;
 };
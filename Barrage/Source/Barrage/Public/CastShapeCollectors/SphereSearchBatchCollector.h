@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "IsolatedJoltIncludes.h"
+
+//Same idea as SphereSearchCollector, but built once per batch instead of once per search.
+//It writes found IDs straight into the caller's flat buffer, so there's no per-search body pointer array to allocate.
+class SphereSearchBatchCollector : public JPH::CollideShapeBodyCollector
+{
+public:
+	SphereSearchBatchCollector(const JPH::BodyLockInterface &inBodyLockInterface, TArray<uint32>& OutFoundObjectIDs)
+		: mBodyLockInterface(inBodyLockInterface), mFound(OutFoundObjectIDs)
+	{
+	}
+
+	//call before each search in the batch. this also clears the early out left over from the prior search.
+	void Restart(JPH::BodyID inIgnore)
+	{
+		ResetEarlyOutFraction();
+		mIgnore = inIgnore;
+		BodyCount = 0;
+	}
+
+	virtual void AddHit(const ResultType &inResult) override
+	{
+		if (BodyCount < MAX_FOUND_OBJECTS && inResult != mIgnore)
+		{
+			JPH::BodyLockRead lock(mBodyLockInterface, inResult);
+			if (lock.SucceededAndIsInBroadPhase())
+			{
+				mFound.Add(inResult.GetIndexAndSequenceNumber());
+				BodyCount++;
+			}
+		}
+	}
+
+	// Physics data handlers
+	const JPH::BodyLockInterface& mBodyLockInterface;
+	TArray<uint32>& mFound;
+	JPH::BodyID mIgnore;
+
+	// Hits found by the current search
+	uint32 BodyCount = 0;
+};
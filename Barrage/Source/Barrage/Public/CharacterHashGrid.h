@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "IsolatedJoltIncludes.h"
+
+class FBCharacterBase;
+
+//Character vs character collision over a hashed uniform grid. Jolt's CharacterVsCharacterCollisionSimple walks every
+//character for every collide and every cast, so a step costs characters squared, and we run hundreds of enemies.
+//This gets rebuilt once per StepWorld, before any character steps, and each StepCharacter only looks at the few cells
+//its own box touches.
+//
+//The grid is built from where characters were at rebuild. Characters keep moving while the step loop runs, so each
+//cell entry is padded by the farthest that character can go in one step, from its max speed as of that rebuild. The
+//final overlap test is always against the live transform, exactly like the simple collider, so as long as nobody moves
+//further than that in a step, padding only costs candidates. Something that does, like a teleport, can miss a
+//neighbour for the one step until the next rebuild catches up.
+//
+//Like the simple collider, this is not thread safe for queries: one character steps at a time. Add and Remove are
+//safe from any thread; they queue and land at the next Rebuild. Anything added has to be removed when its character
+//goes away, or it keeps colliding.
+class FBCharacterHashGrid : public JPH::CharacterVsCharacterCollision
+{
+public:
+	//the grid reads the character's max speed and step time at every rebuild, so speed changes are picked up.
+	void Add(const TSharedPtr<FBCharacterBase>& inCharacter);
+	void Remove(const JPH::CharacterVirtual* inCharacter);
+
+	//call once per world step, before stepping characters.
+	void Rebuild();
+
+	virtual void CollideCharacter(const JPH::CharacterVirtual* inCharacter, JPH::RMat44Arg inCenterOfMassTransform,
+	                              const JPH::CollideShapeSettings& inCollideShapeSettings, JPH::RVec3Arg inBaseOffset,
+	                              JPH::CollideShapeCollector& ioCollector) const override;
+	virtual void CastCharacter(const JPH::CharacterVirtual* inCharacter, JPH::RMat44Arg inCenterOfMassTransform,
+	                           JPH::Vec3Arg inDirection, const JPH::ShapeCastSettings& inShapeCastSettings,
+	                           JPH::RVec3Arg inBaseOffset, JPH::CastShapeCollector& ioCollector) const override;
+
+	int32 Num() const { return mCharacters.Num(); }
+
+	//cells never get smaller than this, in jolt units. keeps a handful of tiny characters from making a huge sparse grid.
+	static constexpr float cMinCellSize = 1.0f;
+	//a query that would visit more cells than this just scans the entries. long casts do this.
+	static constexpr int64 cMaxQueryCells = 256;
+	//cell coordinates are clamped to this on every axis, well clear of int32 overflow in the span math.
+	static constexpr float cMaxCellCoord = float(1 << 20);
+
+private:
+	struct FRegistered
+	{
+		JPH::Ref<JPH::CharacterVirtual> Character;
+		TWeakPtr<FBCharacterBase> Owner;
+	};
+
+	struct FEntry
+	{
+		const JPH::CharacterVirtual* Character;
+		//bounds at rebuild, padded by character padding and step distance.
+		JPH::AABox Bounds;
+		int32 MinCell[3];
+		int32 MaxCell[3];
+	};
+
+	//one per cell an entry touches. the cell rides along because different cells can share a bucket, including two
+	//cells of the same entry.
+	struct FBucketItem
+	{
+		uint32 Entry;
+		int32 Cell[3];
+	};
+
+	void CellOf(JPH::Vec3Arg inPoint, int32 outCell[3]) const;
+
+	static uint32 HashCell(int32 x, int32 y, int32 z)
+	{
+		return (uint32(x) * 73856093u) ^ (uint32(y) * 19349663u) ^ (uint32(z) * 83492791u);
+	}
+
+	//visits every entry whose padded box overlaps inQuery exactly once, skipping inSkip.
+	template <typename Visitor>
+	void ForEachCandidate(const JPH::AABox& inQuery, const JPH::CharacterVirtual* inSkip, Visitor&& inVisitor) const;
+
+	TQueue<FRegistered, EQueueMode::Mpsc> PendingAdds;
+	TQueue<const JPH::CharacterVirtual*, EQueueMode::Mpsc> PendingRemoves;
+	TArray<FRegistered> mCharacters;
+
+	TArray<FEntry> mEntries;
+	//counting-sort layout: the entries for bucket b are mBucketItems[mBucketStart[b]] to mBucketItems[mBucketStart[b + 1]].
+	TArray<uint32> mBucketStart;
+	TArray<FBucketItem> mBucketItems;
+	uint32 mBucketMask = 0;
+	float mInvCellSize = 1.0f;
+};
@@ -4,27 +4,24 @@
 
 #pragma once
 #include "IsolatedJoltIncludes.h"
-#include "FlattenedBodyBox.h"
 #include "PaddingtonTree.h"
+#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Physics/PhysicsLock.h>
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
 JPH_NAMESPACE_BEGIN
-	/// Fast SIMD based quad tree BroadPhase that is multithreading aware and tries to do a minimal amount of locking.
-	/// This variation uses a precomputed adaptive top node, triple buffers, and prefetches.
+	/// Grid-trie BroadPhase, one PaddingtonTree per broadphase layer. Multithreading aware, and tries to do a minimal amount of locking.
+	/// Unlike the quadtree broadphase, there's no double buffering: adds and removes edit the trees in place, and the
+	/// physics update only rebins and retightens whatever got dirty.
 	/// It's called a Paddington Tree because that's my dog's name.
 	/// It's not actually a cool backronym. Sorry. I just love my dog.
-	// ReSharper disable once CppClassNeedsConstructorBecauseOfUninitializedMember
 	// adds layer-count monomorphism, allowing signficantly more elegant tree handling.
 	template <uint32_t mNumLayers>
-	class JPH_EXPORT BPPaddingtonTree final : public BroadPhase
+	class BPPaddingtonTree final : public BroadPhase
 	{
 	public:
 		JPH_OVERRIDE_NEW_DELETE
 
-
-		using NodeBlob = std::vector<BodyBoxFlatCopy>;
-		/// Destructor
-
 	private:
 		/// Helper struct for AddBodies handle
 		struct LayerState
@@ -32,57 +29,47 @@ JPH_NAMESPACE_BEGIN
 			JPH_OVERRIDE_NEW_DELETE
 
 			BodyID* mBodyStart = nullptr;
-			BodyID* mBodyEnd;
-			PaddingtonTree::AddState mAddState;
-			std::shared_ptr<NodeBlob> mBodies;
-			//switch to pool once that's in place and use something like = NodeBlob(1024)); with ya boy the blind alloc
+			BodyID* mBodyEnd = nullptr;
 		};
 
 		using Tracking = PaddingtonTree::Tracking;
 		using TrackingVector = PaddingtonTree::TrackingVector;
 
+#ifdef JPH_ENABLE_ASSERTS
+		/// Context used to lock a physics lock
+		PhysicsLockContext mLockContext = nullptr;
+#endif // JPH_ENABLE_ASSERTS
+
 		/// Max amount of bodies we support
 		size_t mMaxBodies = 0;
 
 		/// Array that for each BodyID keeps track of where it is located in which tree
 		TrackingVector mTracking;
 
-		/// Node allocator for all trees
-		/// Paddington trees take care of their own node pooling for reasons that will become obvious.
-		//PaddingtonTree::Allocator mAllocator;
-
 		/// Information about broad phase layers
 		const BroadPhaseLayerInterface* mBroadPhaseLayerInterface = nullptr;
 
-		/// One tree per object layer. Update swaps. Rather than locking queries for update or framesync, we allow a query to hold
-		/// a ref per the holdopen pattern used throughout barrage and artillery. this is _significantly_ faster.
-		std::shared_ptr<PaddingtonTree> mLayers[mNumLayers];
+		/// One tree per broadphase layer. Trees own their own cells, so there's no shared node allocator to fight over.
+		PaddingtonTree mLayers[mNumLayers];
 
 		/// UpdateState implementation for this tree used during UpdatePrepare/Finalize()
 		struct UpdateStateImpl
 		{
-			PaddingtonTree* mTree;
-			PaddingtonTree::UpdateState mUpdateState;
+			uint32 mDirtyLayers;
 		};
 
 		static_assert(sizeof(UpdateStateImpl) <= sizeof(UpdateState));
 		static_assert(alignof(UpdateStateImpl) <= alignof(UpdateState));
+		static_assert(mNumLayers <= 32, "dirty layers are tracked in a uint32");
 
 		/// Mutex that prevents object modification during UpdatePrepare/Finalize()
 		SharedMutex mUpdateMutex;
 
-		/// We double buffer all trees so that we can query while building the next one and we destroy the old tree the next physics update.
-		/// This structure ensures that we wait for queries that are still using the old tree.
-		mutable SharedMutex mQueryLocks[2];
-
-		/// This index indicates which lock is currently active, it alternates between 0 and 1
-		atomic<uint32> mQueryLockIdx{0};
+		/// Guards the shape of the trees. Adds, removes and refits hold it exclusively, everything else shares it.
+		/// Notify only widens bounds atomically, so it can share it with queries.
+		mutable SharedMutex mStructureLock;
 
-		/// This is the next tree to update in UpdatePrepare()
-		uint32 mNextLayerToUpdate = 0;
-		bool RequireFull = false;
-
-public:
+	public:
 		// THE HEART OF THE CLASS, FOLKS
 		// implement Broadphase Interface
 		virtual ~BPPaddingtonTree() override
@@ -96,63 +83,48 @@ public:
 
 			// Store input parameters
 			mBroadPhaseLayerInterface = &inLayerInterface;
-			
+			JPH_ASSERT(inLayerInterface.GetNumBroadPhaseLayers() <= mNumLayers);
+
+#ifdef JPH_ENABLE_ASSERTS
+			mLockContext = inBodyManager;
+#endif // JPH_ENABLE_ASSERTS
+
 			// Store max bodies
 			mMaxBodies = inBodyManager->GetMaxBodies();
 
 			// Initialize tracking data
 			mTracking.resize(mMaxBodies);
-			// We use double the amount of nodes while rebuilding the tree during Update()
 
-			// Init sub trees
-			mLayers = new PaddingtonTree [mNumLayers];
+#if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 			for (uint l = 0; l < mNumLayers; ++l)
 			{
-				mLayers[l].Init(); //trees share an allocator, which is _very bad_ for memory locality.
-
-#if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
-		// Set the name of the layer
-		mLayers[l].SetName(inLayerInterface.GetBroadPhaseLayerName(BroadPhaseLayer(BroadPhaseLayer::Type(l))));
-#endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
+				// Set the name of the layer
+				mLayers[l].SetName(inLayerInterface.GetBroadPhaseLayerName(BroadPhaseLayer(BroadPhaseLayer::Type(l))));
 			}
-		}
-
-		virtual void FrameSync() override
-		{
-			JPH_PROFILE_FUNCTION();
-			
-			UniqueLock root_lock(
-				mQueryLocks[mQueryLockIdx ^ 1]
-				JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseQuery));
-
-			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-				mLayers[l].DiscardOldTree();
+#endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 		}
 
 		//this is paired with the artillery busy worker, which always optimizes once every 128 ticks, and never while a step is running.
-		//you may need to revisit guarantees here around memory allocators or you'll probably get EFFED in the allocator. 
-		virtual void BPPaddingtonTree::Optimize() override
+		//it's the only place we'll refit the root cube, since that touches every body in the layer.
+		virtual void Optimize() override
 		{
 			JPH_PROFILE_FUNCTION();
 
-			FrameSync();
-
 			LockModifications();
 
-			for (uint l = 0; l < mNumLayers; ++l)
 			{
-				PaddingtonTree& tree = mLayers[l];
-				if (tree.HasBodies())
+				unique_lock lock(mStructureLock);
+				for (uint l = 0; l < mNumLayers; ++l)
 				{
-					PaddingtonTree::UpdateState update_state;
-					tree.UpdatePrepare(mBodyManager->GetBodies(), mTracking, update_state, true);
-					tree.UpdateFinalize(mBodyManager->GetBodies(), mTracking, update_state);
+					PaddingtonTree& tree = mLayers[l];
+					if (tree.HasBodies())
+					{
+						tree.Rebuild(mTracking, false);
+					}
 				}
 			}
 
 			UnlockModifications();
-
-			mNextLayerToUpdate = 0;
 		}
 
 		virtual void LockModifications() override
@@ -161,6 +133,7 @@ public:
 			PhysicsLock::sLock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
 		}
 
+		//this runs alongside find colliding pairs, so it can't touch the trees. it just notes who's dirty.
 		virtual BroadPhase::UpdateState UpdatePrepare() override
 		{
 			// LockModifications should have been called
@@ -169,30 +142,16 @@ public:
 			// Create update state
 			UpdateState update_state;
 			UpdateStateImpl* update_state_impl = reinterpret_cast<UpdateStateImpl*>(&update_state);
+			update_state_impl->mDirtyLayers = 0;
 
-			// Loop until we've seen all layers
-			for (uint iteration = 0; iteration < mNumLayers; ++iteration)
+			for (uint l = 0; l < mNumLayers; ++l)
 			{
-				// Get the layer
-				PaddingtonTree& tree = mLayers[mNextLayerToUpdate];
-				mNextLayerToUpdate = (mNextLayerToUpdate + 1) % mNumLayers;
-
-				// If it is dirty we update this one
-				if (tree.HasBodies() && tree.IsDirty() && tree.CanBeUpdated())
+				if (mLayers[l].IsDirty())
 				{
-					update_state_impl->mTree = &tree;
-					bool capture = RequireFull; //this is atomic but offers no order guarantees.
-					RequireFull = false; //we set this to false NOW but still execute the full update.
-					//this reduces the chance of a missed remove req to near zero.
-					//TODO: switch to atomic for sanity?
-					tree.UpdatePrepare(mBodyManager->GetBodies(), mTracking, update_state_impl->mUpdateState, capture);
-
-					return update_state;
+					update_state_impl->mDirtyLayers |= 1u << l;
 				}
 			}
 
-			// Nothing to update
-			update_state_impl->mTree = nullptr;
 			return update_state;
 		}
 
@@ -201,16 +160,20 @@ public:
 			// LockModifications should have been called
 			JPH_ASSERT(mUpdateMutex.is_locked());
 
-			// Test if a tree was updated
 			const UpdateStateImpl* update_state_impl = reinterpret_cast<const UpdateStateImpl*>(&inUpdateState);
-			if (update_state_impl->mTree == nullptr)
+			uint32 dirty = update_state_impl->mDirtyLayers;
+			if (dirty == 0)
+			{
 				return;
+			}
 
-			update_state_impl->mTree->UpdateFinalize(mBodyManager->GetBodies(), mTracking,
-			                                         update_state_impl->mUpdateState);
-
-			// Make all queries from now on use the new lock
-			mQueryLockIdx = mQueryLockIdx ^ 1;
+			unique_lock lock(mStructureLock);
+			while (dirty != 0)
+			{
+				uint l = CountTrailingZeros(dirty);
+				dirty &= dirty - 1;
+				mLayers[l].Refit(mTracking);
+			}
 		}
 
 		virtual void UnlockModifications() override
@@ -220,72 +183,67 @@ public:
 				mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
 		}
 
-		BroadPhase::AddState BPPaddingtonTree::AddBodiesPrepare(BodyID* ioBodies, int inNumber)
+		virtual AddState AddBodiesPrepare(BodyID* ioBodies, int inNumber) override
 		{
 			JPH_PROFILE_FUNCTION();
 
 			if (inNumber <= 0)
+			{
 				return nullptr;
+			}
 
 			const BodyVector& bodies = mBodyManager->GetBodies();
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			LayerState* state = new LayerState [mNumLayers];
-			for (uint32_t ii = 0; ii < mNumLayers; ++ii)
+			LayerState* state = new LayerState[mNumLayers];
+
+			// Sort bodies on layer
+			Body* const* const bodies_ptr = bodies.data(); // C pointer or else sort is incredibly slow in debug mode
+			QuickSort(ioBodies, ioBodies + inNumber, [bodies_ptr](BodyID inLHS, BodyID inRHS)
 			{
-				state[ii].mBodies = std::make_shared<NodeBlob>(256);
-			}
-			// bin bodies by layer
-			Body* const * const bodies_ptr = bodies.data(); // C pointer or else sort is incredibly slow in debug mode
+				return bodies_ptr[inLHS.GetIndex()]->GetBroadPhaseLayer() < bodies_ptr[inRHS.GetIndex()]->GetBroadPhaseLayer();
+			});
+
 			BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
-			//single pass instead of quicksort. skipping around in bodies is deadly to our perf. qs is broadly faster, but causes more cache disorder
-			//this also means we walk out with a cached version of the body data we need, and we'll only touch body manager one more time.
-			for (int i = 0; i < inNumber; ++i)
-			{
-				auto& body = bodies_ptr[ioBodies[i].GetIndexAndSequenceNumber()];
-				auto BBBWB = body->GetWorldSpaceBounds(); //boundingbox body:worldspace bounds. okay, okay, sorry.
-				auto Cent = BBBWB.GetCenter();
-				auto Extt = BBBWB.GetExtent();
-				auto shadow = BodyBoxFlatCopy(Cent.GetX(), Cent.GetY(), Cent.GetZ(),
-				                              Extt.GetX() + 1, Extt.GetY() + 1, Extt.GetZ() + 1,
-				                              body->GetObjectLayer(),
-				                              body->IsKinematic(),
-				                              body->IsDynamic(),
-				                              body->IsSensor(),
-				                              body->IsRigidBody(),
-				                              body->IsStatic(),
-				                              body->IsActive(),
-				                              body->GetCollideKinematicVsNonDynamic(),
-				                              ioBodies[i]);
-				state[shadow.layer].mBodies->push_back(shadow);
-			}
-
-			for (uint32_t shadow = 0; shadow < mNumLayers; ++shadow)
+			while (b_start < b_end)
 			{
 				// Get broadphase layer
-				if (state[shadow].mBodies->size() > 0)
-				{
-					LayerState& layer_state = state[shadow];
-					// Keep track of state for this layer
+				BroadPhaseLayer::Type broadphase_layer = (BroadPhaseLayer::Type)bodies[b_start->GetIndex()]->GetBroadPhaseLayer();
+				JPH_ASSERT(broadphase_layer < mNumLayers);
 
-					// Insert all bodies of the same layer
-					//mLayers[shadow].AddBodiesPrepare(bodies, mTracking, b_start, int(b_mid - b_start), layer_state.mAddState);
+				// Find first body with different layer
+				BodyID* b_mid = std::upper_bound(b_start, b_end, broadphase_layer,
+				                                 [bodies_ptr](BroadPhaseLayer::Type inLayer, BodyID inBodyID)
+				                                 {
+					                                 return inLayer < (BroadPhaseLayer::Type)bodies_ptr[inBodyID.GetIndex()]->GetBroadPhaseLayer();
+				                                 });
 
-					// Keep track in which tree we placed the object
-					for (auto& b : *(state[shadow].mBodies))
-					{
-						uint32 index = b.meta.GetIndex();
-						Tracking& t = mTracking[index];
-						t.mBroadPhaseLayer = shadow;
-						t.mObjectLayer = bodies[index]->GetObjectLayer();
-					}
+				// Keep track of state for this layer
+				LayerState& layer_state = state[broadphase_layer];
+				layer_state.mBodyStart = b_start;
+				layer_state.mBodyEnd = b_mid;
+
+				// Keep track in which tree we placed the object
+				for (const BodyID* b = b_start; b < b_mid; ++b)
+				{
+					uint32 index = b->GetIndex();
+					JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
+					JPH_ASSERT(!bodies[index]->IsInBroadPhase());
+					Tracking& t = mTracking[index];
+					JPH_ASSERT(t.mBroadPhaseLayer == (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+					t.mBroadPhaseLayer = broadphase_layer;
+					JPH_ASSERT(t.mObjectLayer == cObjectLayerInvalid);
+					t.mObjectLayer = bodies[index]->GetObjectLayer();
 				}
+
+				// Repeat
+				b_start = b_mid;
 			}
 
 			return state;
 		}
 
-		void BPPaddingtonTree::AddBodiesFinalize(BodyID* ioBodies, int inNumber, AddState inAddState)
+		virtual void AddBodiesFinalize(BodyID* ioBodies, int inNumber, AddState inAddState) override
 		{
 			JPH_PROFILE_FUNCTION();
 
@@ -296,8 +254,6 @@ public:
 			}
 
 			// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
-			//todo: switch this to a try lock with a thread safe fallback. that will allow us to isolate our memory allocations
-			//which means we can switch to a brute-stupid memory allocation solution like the threadblind alloc for extreme speed.
 			SharedLock lock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
 
 			BodyVector& bodies = mBodyManager->GetBodies();
@@ -305,107 +261,249 @@ public:
 
 			LayerState* state = (LayerState*)inAddState;
 
-			for (BroadPhaseLayer::Type broadphase_layer = 0; broadphase_layer < mNumLayers; broadphase_layer++)
 			{
-				const LayerState& l = state[broadphase_layer];
-				if (l.mBodyStart != nullptr)
+				unique_lock structure(mStructureLock);
+				for (BroadPhaseLayer::Type broadphase_layer = 0; broadphase_layer < mNumLayers; broadphase_layer++)
 				{
-					// Insert all bodies of the same layer
-					mLayers[broadphase_layer].AddBodiesFinalize(mTracking, int(l.mBodyEnd - l.mBodyStart), l.mAddState);
-
-					// Mark added to broadphase
-					for (const BodyID* b = l.mBodyStart; b < l.mBodyEnd; ++b)
+					const LayerState& l = state[broadphase_layer];
+					if (l.mBodyStart != nullptr)
 					{
-						uint32 index = b->GetIndex();
-						JPH_ASSERT(bodies[index]->GetID() == *b,
-						           "Provided BodyID doesn't match BodyID in body manager");
-						JPH_ASSERT(mTracking[index].mBroadPhaseLayer == broadphase_layer);
-						JPH_ASSERT(mTracking[index].mObjectLayer == bodies[index]->GetObjectLayer());
-						JPH_ASSERT(!bodies[index]->IsInBroadPhase());
-						bodies[index]->SetInBroadPhaseInternal(true);
+						// Insert all bodies of the same layer
+						mLayers[broadphase_layer].AddBodies(bodies, mTracking, l.mBodyStart, int(l.mBodyEnd - l.mBodyStart));
 					}
 				}
 			}
 
-			delete [] state;
+			for (BroadPhaseLayer::Type broadphase_layer = 0; broadphase_layer < mNumLayers; broadphase_layer++)
+			{
+				const LayerState& l = state[broadphase_layer];
+				// Mark added to broadphase
+				for (const BodyID* b = l.mBodyStart; b < l.mBodyEnd; ++b)
+				{
+					uint32 index = b->GetIndex();
+					JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
+					JPH_ASSERT(mTracking[index].mBroadPhaseLayer == broadphase_layer);
+					JPH_ASSERT(mTracking[index].mObjectLayer == bodies[index]->GetObjectLayer());
+					JPH_ASSERT(!bodies[index]->IsInBroadPhase());
+					bodies[index]->SetInBroadPhaseInternal(true);
+				}
+			}
+
+			delete[] state;
 		}
 
-		void BPPaddingtonTree::AddBodiesAbort(BodyID* ioBodies, int inNumber, AddState inAddState)
+		virtual void AddBodiesAbort(BodyID* ioBodies, int inNumber, AddState inAddState) override
 		{
-			throw; //absolutely not. just remove them like a normal human, for the love of god.
+			JPH_PROFILE_FUNCTION();
+
+			if (inNumber <= 0)
+			{
+				JPH_ASSERT(inAddState == nullptr);
+				return;
+			}
+
+			JPH_IF_ENABLE_ASSERTS(const BodyVector& bodies = mBodyManager->GetBodies();)
+			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+			//nothing went into a tree yet, prepare only touched tracking.
+			for (const BodyID* b = ioBodies, *b_end = ioBodies + inNumber; b < b_end; ++b)
+			{
+				uint32 index = b->GetIndex();
+				JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
+				JPH_ASSERT(!bodies[index]->IsInBroadPhase());
+				Tracking& t = mTracking[index];
+				t.mBroadPhaseLayer = (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid;
+				t.mObjectLayer = cObjectLayerInvalid;
+			}
+
+			delete[] (LayerState*)inAddState;
 		}
 
-		//TODO: just lie less?
-		void BPPaddingtonTree::RemoveBodies(BodyID* ioBodies, int inNumber)
+		virtual void RemoveBodies(BodyID* ioBodies, int inNumber) override
 		{
 			JPH_PROFILE_FUNCTION();
 
-			RequireFull = true; // we DO NOT manually remove things. I lied above.
+			if (inNumber <= 0)
+			{
+				return;
+			}
+
+			// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
+			SharedLock lock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+
+			BodyVector& bodies = mBodyManager->GetBodies();
+			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+			// Sort bodies on layer
+			Tracking* tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
+			QuickSort(ioBodies, ioBodies + inNumber, [tracking](BodyID inLHS, BodyID inRHS)
+			{
+				return tracking[inLHS.GetIndex()].mBroadPhaseLayer < tracking[inRHS.GetIndex()].mBroadPhaseLayer;
+			});
+
+			{
+				unique_lock structure(mStructureLock);
+				BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
+				while (b_start < b_end)
+				{
+					// Get broad phase layer
+					BroadPhaseLayer::Type broadphase_layer = tracking[b_start->GetIndex()].mBroadPhaseLayer;
+					JPH_ASSERT(broadphase_layer < mNumLayers);
+
+					// Find first body with different layer
+					BodyID* b_mid = std::upper_bound(b_start, b_end, broadphase_layer,
+					                                 [tracking](BroadPhaseLayer::Type inLayer, BodyID inBodyID)
+					                                 {
+						                                 return inLayer < tracking[inBodyID.GetIndex()].mBroadPhaseLayer;
+					                                 });
+
+					// Remove all bodies of the same layer. each one is a swap-fill in its own cell, no rebuild.
+					mLayers[broadphase_layer].RemoveBodies(mTracking, b_start, int(b_mid - b_start));
+
+					// Repeat
+					b_start = b_mid;
+				}
+			}
+
+			for (const BodyID* b = ioBodies, *b_end = ioBodies + inNumber; b < b_end; ++b)
+			{
+				uint32 index = b->GetIndex();
+				JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
+				JPH_ASSERT(bodies[index]->IsInBroadPhase());
+
+				// Reset tracking
+				Tracking& t = tracking[index];
+				t.mBroadPhaseLayer = (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid;
+				t.mObjectLayer = cObjectLayerInvalid;
+
+				// Mark removed from broadphase
+				bodies[index]->SetInBroadPhaseInternal(false);
+			}
 		}
 
-		void BPPaddingtonTree::NotifyBodiesAABBChanged(BodyID* ioBodies, int inNumber, bool inTakeLock)
+		virtual void NotifyBodiesAABBChanged(BodyID* ioBodies, int inNumber, bool inTakeLock) override
 		{
 			JPH_PROFILE_FUNCTION();
 
 			if (inNumber <= 0)
+			{
 				return;
+			}
 
 			// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
 			if (inTakeLock)
+			{
 				PhysicsLock::sLockShared(
 					mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+			}
 			else
+			{
 				JPH_ASSERT(mUpdateMutex.is_locked());
+			}
 
 			const BodyVector& bodies = mBodyManager->GetBodies();
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
 			// Sort bodies on layer
 			const Tracking* tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
-			//QuickSort(ioBodies, ioBodies + inNumber, [tracking](BodyID inLHS, BodyID inRHS) { return tracking[inLHS.GetIndex()].mBroadPhaseLayer < tracking[inRHS.GetIndex()].mBroadPhaseLayer; });
-
-			BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
-			while (b_start < b_end)
+			QuickSort(ioBodies, ioBodies + inNumber, [tracking](BodyID inLHS, BodyID inRHS)
 			{
-				// Get broadphase layer
-				BroadPhaseLayer::Type broadphase_layer = tracking[b_start->GetIndex()].mBroadPhaseLayer;
-				JPH_ASSERT(broadphase_layer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
-
-				// Find first body with different layer
-				BodyID* b_mid = std::upper_bound(b_start, b_end, broadphase_layer,
-				                                 [tracking](BroadPhaseLayer::Type inLayer, BodyID inBodyID)
-				                                 {
-					                                 return inLayer < tracking[inBodyID.GetIndex()].mBroadPhaseLayer;
-				                                 });
-
-				// Notify all bodies of the same layer changed
-				mLayers[broadphase_layer].NotifyBodiesAABBChanged(bodies, mTracking, b_start, int(b_mid - b_start));
+				return tracking[inLHS.GetIndex()].mBroadPhaseLayer < tracking[inRHS.GetIndex()].mBroadPhaseLayer;
+			});
 
-				// Repeat
-				b_start = b_mid;
+			{
+				shared_lock structure(mStructureLock);
+				BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
+				while (b_start < b_end)
+				{
+					// Get broadphase layer
+					BroadPhaseLayer::Type broadphase_layer = tracking[b_start->GetIndex()].mBroadPhaseLayer;
+					JPH_ASSERT(broadphase_layer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+
+					// Find first body with different layer
+					BodyID* b_mid = std::upper_bound(b_start, b_end, broadphase_layer,
+					                                 [tracking](BroadPhaseLayer::Type inLayer, BodyID inBodyID)
+					                                 {
+						                                 return inLayer < tracking[inBodyID.GetIndex()].mBroadPhaseLayer;
+					                                 });
+
+					// Notify all bodies of the same layer changed
+					mLayers[broadphase_layer].NotifyBodiesAABBChanged(bodies, mTracking, b_start, int(b_mid - b_start));
+
+					// Repeat
+					b_start = b_mid;
+				}
 			}
 
 			if (inTakeLock)
+			{
 				PhysicsLock::sUnlockShared(
 					mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+			}
 		}
 
-		void BPPaddingtonTree::NotifyBodiesLayerChanged(BodyID* ioBodies, int inNumber)
+		virtual void NotifyBodiesLayerChanged(BodyID* ioBodies, int inNumber) override
 		{
-			//this is no longer supported.
-			throw;
+			JPH_PROFILE_FUNCTION();
+
+			if (inNumber <= 0)
+			{
+				return;
+			}
+
+			// First sort the bodies that actually changed layer to beginning of the array
+			const BodyVector& bodies = mBodyManager->GetBodies();
+			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+			int same_layer = 0;
+			for (BodyID* body_id = ioBodies + inNumber - 1; body_id >= ioBodies; --body_id)
+			{
+				uint32 index = body_id->GetIndex();
+				JPH_ASSERT(bodies[index]->GetID() == *body_id, "Provided BodyID doesn't match BodyID in body manager");
+				const Body* body = bodies[index];
+				BroadPhaseLayer::Type broadphase_layer = (BroadPhaseLayer::Type)body->GetBroadPhaseLayer();
+				JPH_ASSERT(broadphase_layer < mNumLayers);
+				if (mTracking[index].mBroadPhaseLayer == broadphase_layer)
+				{
+					// Update tracking information
+					mTracking[index].mObjectLayer = body->GetObjectLayer();
+
+					// Move the body to the end, layer didn't change
+					std::swap(*body_id, ioBodies[inNumber - 1]);
+					--inNumber;
+					++same_layer;
+				}
+			}
+
+			//same tree, different object layer. the leaf and the masks get patched in place.
+			if (same_layer > 0)
+			{
+				SharedLock lock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+				unique_lock structure(mStructureLock);
+				for (BodyID* b = ioBodies + inNumber, *b_end = ioBodies + inNumber + same_layer; b < b_end; ++b)
+				{
+					mLayers[mTracking[b->GetIndex()].mBroadPhaseLayer].NotifyBodiesLayerChanged(bodies, mTracking, b, 1);
+				}
+			}
+
+			if (inNumber > 0)
+			{
+				// Changing layer requires us to remove from one tree and add to another, so this is equivalent to removing all bodies first and then adding them again
+				RemoveBodies(ioBodies, inNumber);
+				AddState add_state = AddBodiesPrepare(ioBodies, inNumber);
+				AddBodiesFinalize(ioBodies, inNumber, add_state);
+			}
 		}
 
-		void BPPaddingtonTree::CastRay(const RayCast& inRay, RayCastBodyCollector& ioCollector,
-		                               const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
-		                               const ObjectLayerFilter& inObjectLayerFilter) const
+		virtual void CastRay(const RayCast& inRay, RayCastBodyCollector& ioCollector,
+		                     const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
+		                     const ObjectLayerFilter& inObjectLayerFilter) const override
 		{
 			JPH_PROFILE_FUNCTION();
 
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			// Loop over all layers and test the ones that could hit
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
@@ -414,23 +512,25 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CastRay(inRay, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CastRay(inRay, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
 
-		void BPPaddingtonTree::CollideAABox(const AABox& inBox, CollideShapeBodyCollector& ioCollector,
-		                                    const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
-		                                    const ObjectLayerFilter& inObjectLayerFilter) const
+		virtual void CollideAABox(const AABox& inBox, CollideShapeBodyCollector& ioCollector,
+		                          const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
+		                          const ObjectLayerFilter& inObjectLayerFilter) const override
 		{
 			JPH_PROFILE_FUNCTION();
 
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			// Loop over all layers and test the ones that could hit
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
@@ -439,23 +539,25 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CollideAABox(inBox, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CollideAABox(inBox, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
 
-		void BPPaddingtonTree::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector& ioCollector,
-		                                     const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
-		                                     const ObjectLayerFilter& inObjectLayerFilter) const
+		virtual void CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector& ioCollector,
+		                           const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
+		                           const ObjectLayerFilter& inObjectLayerFilter) const override
 		{
 			JPH_PROFILE_FUNCTION();
 
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			// Loop over all layers and test the ones that could hit
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
@@ -464,9 +566,11 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CollideSphere(inCenter, inRadius, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CollideSphere(inCenter, inRadius, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
@@ -479,8 +583,8 @@ public:
 
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			// Loop over all layers and test the ones that could hit
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
@@ -489,9 +593,11 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CollidePoint(inPoint, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CollidePoint(inPoint, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
@@ -504,8 +610,8 @@ public:
 
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			// Loop over all layers and test the ones that could hit
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
@@ -514,13 +620,16 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CollideOrientedBox(inBox, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CollideOrientedBox(inBox, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
 
+		//only ever called from inside the step, where the update mutex already keeps adds, removes and refits out.
 		virtual void CastAABoxNoLock(const AABoxCast& inBox, CastShapeBodyCollector& ioCollector,
 		                             const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
 		                             const ObjectLayerFilter& inObjectLayerFilter) const override
@@ -536,9 +645,11 @@ public:
 				if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 				{
 					JPH_PROFILE(tree.GetName());
-					tree.CastAABox(inBox, ioCollector, inObjectLayerFilter, mTracking);
+					tree.CastAABox(inBox, ioCollector, inObjectLayerFilter);
 					if (ioCollector.ShouldEarlyOut())
+					{
 						break;
+					}
 				}
 			}
 		}
@@ -547,8 +658,8 @@ public:
 		                       const BroadPhaseLayerFilter& inBroadPhaseLayerFilter,
 		                       const ObjectLayerFilter& inObjectLayerFilter) const override
 		{
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			CastAABoxNoLock(inBox, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
 		}
@@ -564,11 +675,14 @@ public:
 			const BodyVector& bodies = mBodyManager->GetBodies();
 			JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-			// Note that we don't take any locks at this point. We know that the tree is not going to be swapped or deleted while finding collision pairs due to the way the jobs are scheduled in the PhysicsSystem::Update.
+			// Note that we don't take any locks at this point. We know that the trees are not going to be restructured while finding collision pairs due to the way the jobs are scheduled in the PhysicsSystem::Update.
 
 			// Sort bodies on layer
 			const Tracking* tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
-			//QuickSort(ioActiveBodies, ioActiveBodies + inNumActiveBodies, [tracking](BodyID inLHS, BodyID inRHS) { return tracking[inLHS.GetIndex()].mObjectLayer < tracking[inRHS.GetIndex()].mObjectLayer; });
+			QuickSort(ioActiveBodies, ioActiveBodies + inNumActiveBodies, [tracking](BodyID inLHS, BodyID inRHS)
+			{
+				return tracking[inLHS.GetIndex()].mObjectLayer < tracking[inRHS.GetIndex()].mObjectLayer;
+			});
 
 			BodyID *b_start = ioActiveBodies, *b_end = ioActiveBodies + inNumActiveBodies;
 			while (b_start < b_end)
@@ -604,16 +718,17 @@ public:
 
 		virtual AABox GetBounds() const override
 		{
-			// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-			shared_lock lock(mQueryLocks[mQueryLockIdx]);
+			// Prevent this from running in parallel with adds, removes and refits
+			shared_lock lock(mStructureLock);
 
 			AABox bounds;
 			for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+			{
 				bounds.Encapsulate(mLayers[l].GetBounds());
+			}
 			return bounds;
 		}
 	};
-template class BPPaddingtonTree<JOLT::BroadPhaseLayers::NUM_LAYERS>;
 
 typedef BPPaddingtonTree<JOLT::BroadPhaseLayers::NUM_LAYERS> MMBP_PaddingtonTree;
 JPH_NAMESPACE_END
@@ -1,5 +1,6 @@
 ﻿#pragma once
-#include "Memory/IntraTickThreadblindAlloc.h"
+#include <Jolt/Core/Atomics.h>
+#include <Jolt/Geometry/AABox.h>
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
 JPH_NAMESPACE_BEGIN
@@ -9,210 +10,138 @@ class PDTH
 public:
 	static constexpr uint32 cInvalidNodeIndex = 0xffffffff; ///< Value used to indicate node index is invalid
 
-	class NodeID
-	{
-	public:
-		JPH_OVERRIDE_NEW_DELETE
-		/// Default constructor does not init
-		inline NodeID() = default;
-
-		/// Construct a node ID
-		static inline NodeID sInvalid() { return NodeID(cInvalidNodeIndex); }
-
-		static inline NodeID sFromBodyID(BodyID inID)
-		{
-			NodeID node_id(inID.GetIndexAndSequenceNumber());
-			JPH_ASSERT(node_id.IsBody());
-			return node_id;
-		}
-
-		static inline NodeID sFromNodeIndex(uint32 inIdx)
-		{
-			JPH_ASSERT((inIdx & cIsNode) == 0);
-			return NodeID(inIdx | cIsNode);
-		}
-
-		/// Check what type of ID it is
-		inline bool IsValid() const { return mID != cInvalidNodeIndex; }
-		inline bool IsBody() const { return (mID & cIsNode) == 0; }
-		inline bool IsNode() const { return (mID & cIsNode) != 0; }
-
-		/// Get body or node index
-		inline BodyID GetBodyID() const
-		{
-			JPH_ASSERT(IsBody());
-			return BodyID(mID);
-		}
-
-		inline uint32 GetNodeIndex() const
-		{
-			JPH_ASSERT(IsNode());
-			return mID & ~cIsNode;
-		}
-
-		/// Comparison
-		inline bool operator ==(const BodyID& inRHS) const { return mID == inRHS.GetIndexAndSequenceNumber(); }
-		inline bool operator ==(const NodeID& inRHS) const { return mID == inRHS.mID; }
+	//each level of the trie is a 4x4x4 grid. two levels deep gets us 16 leaf cells a side over the fitted root cube,
+	//4096 in all, and the root and every node can still be swept with 16 simd box tests.
+	static constexpr uint32 cSide = 4;
+	static constexpr uint32 cChildren = cSide * cSide * cSide;
+	static constexpr uint32 cLeafSide = cSide * cSide;
+	static constexpr uint32 cLeafCells = cChildren * cChildren;
 
-		friend class AtomicNodeID;
+	//a body's location is its leaf cell in the high bits and its slot in that cell in the low bits.
+	static constexpr uint32 cSlotBits = 20;
+	static constexpr uint32 cSlotMask = (1u << cSlotBits) - 1;
+	static constexpr uint32 cInvalidLocation = 0xffffffff;
 
-		inline explicit NodeID(uint32 inID) : mID(inID)
-		{
-		}
+	//object layers below this get their own bit in the cell masks. anything at or above it shares the top bit
+	//and gets checked exactly against the filter. barrage has ten layers, so this is just headroom.
+	static constexpr uint32 cTrackedLayers = 16;
+	static constexpr uint32 cUntrackedLayerBit = 1u << (cTrackedLayers - 1);
 
-		static const uint32 cIsNode = BodyID::cBroadPhaseBit;
-		///< If this bit is set it means that the ID refers to a node, otherwise it refers to a body
+	static JPH_INLINE uint32 sLayerBit(ObjectLayer inLayer)
+	{
+		return inLayer < cTrackedLayers - 1 ? (1u << inLayer) : cUntrackedLayerBit;
+	}
 
-		uint32 mID;
-	};
+	static JPH_INLINE uint32 sPackLocation(uint32 inCell, uint32 inSlot)
+	{
+		JPH_ASSERT(inSlot <= cSlotMask);
+		return (inCell << cSlotBits) | inSlot;
+	}
 
+	static JPH_INLINE uint32 sLocationCell(uint32 inLocation) { return inLocation >> cSlotBits; }
+	static JPH_INLINE uint32 sLocationSlot(uint32 inLocation) { return inLocation & cSlotMask; }
 
-	/// A NodeID that uses atomics to store the value
-	class AtomicNodeID
+	/// Four bodies, laid out so a leaf scan is exactly the same simd test as a node visit.
+	/// Empty slots carry inverted bounds, so they fail every test without any lane masking.
+	class alignas(16) LeafBlock
 	{
 	public:
-		/// Constructor
-		AtomicNodeID() = default;
-
-		explicit AtomicNodeID(const NodeID& inRHS) : mID(inRHS.mID)
-		{
-		}
-
-		/// Assignment
-		inline void operator =(const NodeID& inRHS) { mID = inRHS.mID; }
-
-		/// Getting the value
-		inline operator NodeID() const { return NodeID(mID); }
-
-		/// Check if the ID is valid
-		inline bool IsValid() const { return mID != PDTH::cInvalidNodeIndex; }
-
-		/// Comparison
-		inline bool operator ==(const BodyID& inRHS) const { return mID == inRHS.GetIndexAndSequenceNumber(); }
-		inline bool operator ==(const NodeID& inRHS) const { return mID == inRHS.mID; }
-
-		/// Atomically compare and swap value. Expects inOld value, replaces with inNew value or returns false
-		inline bool CompareExchange(NodeID inOld, NodeID inNew)
-		{
-			return mID.compare_exchange_strong(inOld.mID, inNew.mID);
-		}
-
-	private:
-		atomic<uint32> mID;
+		LeafBlock();
+		LeafBlock(const LeafBlock& inRHS);
+		LeafBlock& operator=(const LeafBlock& inRHS);
+
+		void GetSlotBounds(int inSlot, AABox& outBounds) const;
+
+		/// Bounds are written max first, then min, so a reader racing a notify sees either box or an empty one.
+		void SetSlotBounds(int inSlot, const AABox& inBounds);
+		void SetSlot(int inSlot, const AABox& inBounds, BodyID inBodyID, ObjectLayer inLayer);
+		void InvalidateSlot(int inSlot);
+
+		atomic<float> mBoundsMinX[4];
+		atomic<float> mBoundsMinY[4];
+		atomic<float> mBoundsMinZ[4];
+		atomic<float> mBoundsMaxX[4];
+		atomic<float> mBoundsMaxY[4];
+		atomic<float> mBoundsMaxZ[4];
+		BodyID mBodyIDs[4];
+		ObjectLayer mObjectLayers[4];
 	};
 
-	class Node
+	/// Shared bounds handling for the root and for nodes. Both are a 64 wide grid of loose boxes.
+	/// Loose means they only grow between refits, which is what lets notify run from every integration job at once.
+	class alignas(16) GridBounds
 	{
 	public:
-		/// Construct node
-		explicit Node(bool inIsChanged);
-
-		/// Get bounding box encapsulating all children
-		void GetNodeBounds(AABox& outBounds) const;
+		GridBounds();
 
-		/// Get bounding box in a consistent way with the functions below (check outBounds.IsValid() before using the box)
 		void GetChildBounds(int inChildIndex, AABox& outBounds) const;
-
-		/// Set the bounds in such a way that other threads will either see a fully correct bounding box or a bounding box with no volume
 		void SetChildBounds(int inChildIndex, const AABox& inBounds);
-
-		/// Invalidate bounding box in such a way that other threads will not temporarily see a very large bounding box
 		void InvalidateChildBounds(int inChildIndex);
 
-		/// Encapsulate inBounds in node bounds, returns true if there were changes
+		/// Atomically grows a child to cover inBounds. Returns true if it had to grow.
 		bool EncapsulateChildBounds(int inChildIndex, const AABox& inBounds);
 
-		/// behold a malevolent kingdom, where wrath is the sole offering.
-
-		//bounds are defined as offsets onto the radius from the center.
-		//in other words, a paddington node is a voxelized space of 256^3 blocks. This sounds bad but that's
-		//actually a quite surprising amount of precision. Right now, for ease of implementation, we provide
-		//the center with the node, but there's a way to more tightly encode this given that you have a link
-		//to the same info about the parent AND where you fit in it. We really don't want to use that, though.
-		//So why the FUDGE do it this way?
-		//Three reasons: insanely small, insanely fast, insanely easy to reason about.
-		//That.... last one is sort of a lie, though, if I'm honest. Cause. Um. See.....
-		//Paddington nodes have a weird kind-of advantage. 
-		char mBoundsMinX[4];
-		char mBoundsMinY[4];
-		char mBoundsMinZ[4];
-		char mBoundsMaxX[4];
-		char mBoundsMaxY[4];
-		char mBoundsMaxZ[4];
-		char mIsChanged = 0;
-		/// Index of child node or body ID.
-		AtomicNodeID mChildNodeID[4];
-
-		/// Index of the parent node.
-		/// Note: This value is unreliable during the UpdatePrepare/Finalize() function as a node may be relinked to the newly built tree.
-		atomic<uint32> mParentNodeIndex = cInvalidNodeIndex;
-		float xmin = 0;
-		float ymin = 0;
-		float zmin = 0;
-		float radius = 0;
-	};
+		void GetNodeBounds(AABox& outBounds) const;
 
-	using Allocator = IntraTickThreadblindAlloc<Node>;
+		atomic<float> mBoundsMinX[cChildren];
+		atomic<float> mBoundsMinY[cChildren];
+		atomic<float> mBoundsMinZ[cChildren];
+		atomic<float> mBoundsMaxX[cChildren];
+		atomic<float> mBoundsMaxY[cChildren];
+		atomic<float> mBoundsMaxZ[cChildren];
 
-	class MemoryPoolPool
-	{
-		//i know, I know, okay?
-		
+		/// Object layers present under each child. only ever a superset between refits.
+		uint32 mLayerMask[cChildren] = {};
+
+		/// Children that need a refit: something left, moved out, or grew the loose bounds.
+		atomic<uint64> mDirty{0};
 	};
-	
-	/// Class that represents a node in the tree
-	class RootNode
+
+	/// A node is a grid of leaf cells. Each cell is a packed run of leaf blocks, filled from the front.
+	class Node : public GridBounds
 	{
 	public:
-		/// Construct node
-		explicit RootNode(bool inIsChanged);
-
-		/// Get bounding box encapsulating all children
-		void GetNodeBounds(AABox& outBounds) const;
-
-		/// Get bounding box in a consistent way with the functions below (check outBounds.IsValid() before using the box)
-		void GetChildBounds(int inChildIndex, AABox& outBounds) const;
-
-		/// Set the bounds in such a way that other threads will either see a fully correct bounding box or a bounding box with no volume
-		void SetChildBounds(int inChildIndex, const AABox& inBounds);
-
-		/// Invalidate bounding box in such a way that other threads will not temporarily see a very large bounding box
-		void InvalidateChildBounds(int inChildIndex);
+		uint32 mCount[cChildren] = {};
+		Array<LeafBlock> mCells[cChildren];
+	};
 
-		/// Encapsulate inBounds in node bounds, returns true if there were changes
-		bool EncapsulateChildBounds(int inChildIndex, const AABox& inBounds);
+	/// The root is a grid of nodes over a cube we fit to the bodies. The cube is kept in doubles,
+	/// so far-flung clusters still bin into sane cells. Everything below the root is plain float world space.
+	class RootNode : public GridBounds
+	{
+	public:
+		Node mChildNodeID[cChildren];
 
-		/// behold a malevolent kingdom, where wrath is the sole offering.
-
-		//bounds are defined as offsets onto the radius from the center.
-		//in other words, a paddington node is a voxelized space of 256^3 blocks. This sounds bad but that's
-		//actually a quite surprising amount of precision. Right now, for ease of implementation, we provide
-		//the center with the node, but there's a way to more tightly encode this given that you have a link
-		//to the same info about the parent AND where you fit in it. We really don't want to use that, though.
-		//So why the FUDGE do it this way?
-		//Three reasons: insanely small, insanely fast, insanely easy to reason about.
-		//That.... last one is sort of a lie, though, if I'm honest. Cause. Um. See.....
-		//Paddington nodes have a weird kind-of advantage. 
-		char mBoundsMinX[64] = {};
-		char mBoundsMinY[64] = {};
-		char mBoundsMinZ[64] = {};
-		char mBoundsMaxX[64] = {};
-		char mBoundsMaxY[64] = {};
-		char mBoundsMaxZ[64] = {};
-		char mIsChanged = 0;
-		/// Index of child node or body ID.
-		/// If you have a small set, you should not have come here. Be glad and be gone. This is a forsaken land.
-		Node mChildNodeID[64] = {};
-
-		/// Index of the parent node.
-		/// Note: This value is unreliable during the UpdatePrepare/Finalize() function as a node may be relinked to the newly built tree.
-		atomic<uint32> mParentNodeIndex = cInvalidNodeIndex;
 		double xmin = 0;
 		double ymin = 0;
 		double zmin = 0;
-		double xmax = 0;
-		double ymax = 0;
-		double zmax = 0;
+		double mSide = 0;
+		double mInvLeafSize = 0;
+		bool mFitted = false;
+
+		/// Fit the root cube around inBounds, padded out so a little drift doesn't immediately clamp.
+		void Fit(const AABox& inBounds);
+
+		/// True if inBounds sits comfortably in the fitted cube. False means a rebuild would pay for itself.
+		bool FitsWell(const AABox& inBounds) const;
+
+		/// Leaf cell for a point. Points outside the cube clamp to the edge cells, which stays correct since
+		/// cell bounds are computed from what's actually in them, not from the grid.
+		JPH_INLINE uint32 CellOf(Vec3Arg inPoint) const
+		{
+			auto Axis = [this](float inValue, double inMin) -> uint32
+			{
+				double cell = (double(inValue) - inMin) * mInvLeafSize;
+				return cell <= 0.0 ? 0u : (cell >= double(cLeafSide - 1) ? cLeafSide - 1 : uint32(cell));
+			};
+			uint32 x = Axis(inPoint.GetX(), xmin);
+			uint32 y = Axis(inPoint.GetY(), ymin);
+			uint32 z = Axis(inPoint.GetZ(), zmin);
+			uint32 node = (x >> 2) + (y >> 2) * cSide + (z >> 2) * cSide * cSide;
+			uint32 cell = (x & 3) + (y & 3) * cSide + (z & 3) * cSide * cSide;
+			return node * cChildren + cell;
+		}
 	};
 };
-JPH_NAMESPACE_END
\ No newline at end of file
+JPH_NAMESPACE_END
+PRAGMA_POP_PLATFORM_DEFAULT_PACKING
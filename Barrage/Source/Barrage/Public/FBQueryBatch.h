@@ -0,0 +1,74 @@
+﻿// Copyright 2025 Oversized Sun Inc. All Rights Reserved.
+
+#pragma once
+
+#include "FBarrageKey.h"
+
+//These are the request and result records for the batched query path on UBarrageDispatch.
+//Like the shape params, they're in UE space and UE units, and they're PODs on purpose. The caller owns
+//both the requests and the result buffers, so a ticklite group or a state tree can keep one of each around
+//and just refill it every tick instead of allocating a TSharedPtr<FHitResult> per cast.
+//Results are always written by index: OutHits[i] answers Requests[i], regardless of the order we actually ran them in.
+
+//don't change this unless you're sure it's safe. member size AND order alter packing.
+struct FBSphereCastRequest
+{
+	FVector3d CastFrom;
+	FVector3d Direction; //unit
+	double Radius;
+	double Distance;
+	//the caster, usually. zero means ignore nothing.
+	FBarrageKey Ignore;
+};
+
+struct FBRayCastRequest
+{
+	FVector3d CastFrom;
+	FVector3d Direction; //not unit. length is the cast length, same as CastRay.
+	FBarrageKey Ignore;
+};
+
+struct FBSphereSearchRequest
+{
+	FVector3d Location;
+	double Radius;
+	//the searcher, usually. zero means ignore nothing.
+	FBarrageKey Source;
+};
+
+//this is a compact stand-in for FHitResult. if you need the real thing for gameplay code, use FillHitResult.
+//BodyID uses the same munging as the single queries, so cInvalidBodyID means no hit.
+struct FBCastHit
+{
+	uint32 BodyID;
+	float Distance;
+	FVector3f Location;
+	FVector3f Normal;
+
+	bool IsHit() const
+	{
+		return BodyID != 0xffffffff; //JPH::BodyID::cInvalidBodyID, without dragging jolt into this header.
+	}
+
+	void FillHitResult(FHitResult& Out) const
+	{
+		Out.Init();
+		Out.MyItem = BodyID;
+		if (IsHit())
+		{
+			Out.bBlockingHit = true;
+			Out.Location.Set(Location.X, Location.Y, Location.Z);
+			Out.ImpactPoint.Set(Location.X, Location.Y, Location.Z);
+			Out.ImpactNormal.Set(Normal.X, Normal.Y, Normal.Z);
+			Out.Distance = Distance;
+		}
+	}
+};
+
+//sphere searches return a variable number of bodies, so the found IDs all go into one flat array
+//and each request gets a span into it.
+struct FBSearchSpan
+{
+	uint32 Offset;
+	uint32 Count;
+};
@@ -10,7 +10,12 @@
 #include "FBShapeParams.h"
 #include "FBarrageKey.h"
 #include "FBPhysicsInput.h"
+#include "FBQueryBatch.h"
+#include "CharacterHashGrid.h"
+#include "MeshShapeCache.h"
+#include "PhysicsSnapshots.h"
 #include "SkeletonTypes.h"
+#include "Misc/ScopeRWLock.h"
 #include "EPhysicsLayer.h"
 //#include "Experimental/CollisionGroupUnaware_FleshBroadPhase.h"
 #include "IsolatedJoltIncludes.h"
@@ -58,6 +63,9 @@ public:
 	JPH::Quat mCapsuleRotationUpdate = JPH::Quat::sIdentity();
 	JPH::Ref<JPH::CharacterVirtual> mCharacter = JPH::Ref<JPH::CharacterVirtual>();
 	float mDeltaTime = 0.01; //set this yourself or have a bad time.
+	//who we publish transforms for. characters don't have a body to carry user data, so they carry this instead.
+	//it's cleared when the character's FBLet is tombstoned.
+	FSkeletonKey mOwnerKey;
 
 	// Calculated effective velocity after a step
 	JPH::Vec3 mEffectiveVelocity = JPH::Vec3::sZero();
@@ -83,8 +91,19 @@ public:
 	//BodyId is actually a freaking 4byte struct, so it's _worse_ potentially to have a pointer to it than just copy it.
 	TSharedPtr<KeyToBody> BarrageToJoltMapping;
 	TSharedPtr<BoundsToShape> BoxCache;
+	TSharedPtr<FBMeshShapeCache> MeshShapeCache;
 	TSharedPtr<TMap<FBarrageKey, TSharedPtr<FBCharacterBase>>> CharacterToJoltMapping;
-	//std::shared_ptr<JPH::CollisionGroupUnaware_FleshBroadPhase> mTestBroadPhase;
+	//characters are added from the game thread, dropped and walked on the step thread, and looked up from anywhere
+	//a primitive's getters get called. everything that touches the map takes this, writers exclusively.
+	mutable FRWLock CharacterMappingLock;
+
+	//copies the pointer out under the read lock, so the character stays alive even if it's forgotten right after.
+	TSharedPtr<FBCharacterBase> FindCharacter(FBarrageKey Key) const
+	{
+		FReadScopeLock Reading(CharacterMappingLock);
+		const TSharedPtr<FBCharacterBase>* Character = CharacterToJoltMapping->Find(Key);
+		return Character ? *Character : TSharedPtr<FBCharacterBase>();
+	}
 	
 	 /*
 	 * 
@@ -100,13 +119,48 @@ public:
 		return FoundBodyID;
 	}
 
+	//bodies carry the skeleton key of their owner in jolt's user data. that's what lets StepWorld publish transforms
+	//straight off the active body list without going back through any of our maps. zero means publish nothing.
+	void SetBodyOwner(FBarrageKey Key, FSkeletonKey Owner)
+	{
+		JPH::BodyID result;
+		if (TSharedPtr<FBCharacterBase> Character = FindCharacter(Key))
+		{
+			Character->mOwnerKey = Owner;
+		}
+		else if (GetBodyIDOrDefault(Key, result) && !result.IsInvalid())
+		{
+			body_interface->SetUserData(result, Owner.Obj);
+		}
+	}
+
+	//tombstoned characters leave the collision grid right away so they stop colliding, but stay in the mapping until
+	//the tombstone's grace period is up, same as bodies. step thread only, same as the grid's rebuild.
+	void RetireCharacter(FBarrageKey Key)
+	{
+		TSharedPtr<FBCharacterBase> Character = FindCharacter(Key);
+		if (Character && Character->mCharacter)
+		{
+			CharacterHashGrid.Remove(Character->mCharacter.GetPtr());
+		}
+	}
+
+	//called from clean tombs once the grace period is over. this is what lets the jolt character actually go.
+	void ForgetCharacter(FBarrageKey Key)
+	{
+		FWriteScopeLock Writing(CharacterMappingLock);
+		CharacterToJoltMapping->Remove(Key);
+	}
+
 	const unsigned int AllocationArenaSize = 256 * 1024 * 1024;
 	TSharedPtr<JPH::TempAllocatorImpl> Allocator;
-	// List of active characters in the scene so they can collide
+	// Characters in the scene so they can collide with each other
 	//https://github.com/jrouwe/JoltPhysics/blob/e3ed3b1d33f3a0e7195fbac8b45b30f0a5c8a55b/Jolt/Physics/Character/CharacterVirtual.h#L143
-	//note this is the only extant character collision handler, and it is not very efficient since it doesn't use a BSP.
-	//This will need to go as soon as we have more than three characters or so.
-	JPH::CharacterVsCharacterCollisionSimple CharacterVsCharacterCollisionSimple;
+	//jolt's simple handler checks every character against every other, which stopped being okay somewhere around three.
+	//this is a hashed grid instead, rebuilt once per StepWorld. see CharacterHashGrid.h.
+	FBCharacterHashGrid CharacterHashGrid;
+	//dynamic body and character state, one per step, for rollback. only touched from the step thread.
+	FBPhysicsSnapshots Snapshots;
 	// Each broadphase layer results in a separate bounding volume tree in the broad phase. You at least want to have
 	// a layer for non-moving and moving objects to avoid having to update a tree full of static objects every frame.
 	// You can have a 1-on-1 mapping between object layers and broadphase layers (like in this case) but if you have
@@ -297,7 +351,7 @@ public:
 	//do not move this up. see C++ standard ~ 12.6.2
 	TSharedPtr<JPH::PhysicsSystem> physics_system;
 
-	FWorldSimOwner(float cDeltaTime, InitExitFunction JobThreadInitializer);
+	FWorldSimOwner(float cDeltaTime, InitExitFunction JobThreadInitializer, EBarrageBroadPhase BroadPhase = EBarrageBroadPhase::JoltQuadTree);
 	void SphereCast(
 		double Radius,
 		double Distance,
@@ -321,6 +375,12 @@ public:
 	// Cast a ray at something and get the first thing it hits
 	void CastRay(FVector3d CastFrom, FVector3d Direction, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter, const JPH::BodyFilter& BodiesFilter, TSharedPtr<FHitResult> OutHit) const;
 
+	//batched forms of the above. see FBQueryBatch.h. filters are shared by the whole batch, and requests are run
+	//in z-order of their origin so that consecutive queries walk the same parts of the broadphase tree.
+	void SphereCastBatch(TConstArrayView<FBSphereCastRequest> Requests, TArrayView<FBCastHit> OutHits, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter) const;
+	void CastRayBatch(TConstArrayView<FBRayCastRequest> Requests, TArrayView<FBCastHit> OutHits, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter) const;
+	void SphereSearchBatch(TConstArrayView<FBSphereSearchRequest> Requests, TArrayView<FBSearchSpan> OutSpans, TArray<uint32>& OutFoundObjectIDs, const JPH::BroadPhaseLayerFilter& BroadPhaseFilter, const JPH::ObjectLayerFilter& ObjectFilter) const;
+
 	JPH::Ref<JPH::Shape> AttemptBoxCache(double JoltX, double JoltY, double JoltZ, float HEReduceMin);
 	//we could use type indirection or inheritance, but the fact of the matter is that this is much easier
 	//to understand and vastly vastly faster. it's also easier to optimize out allocations, and it's very
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "IsolatedJoltIncludes.h"
+#include "UObject/ObjectKey.h"
+
+//Cooked mesh shapes, shared. LoadComplexStaticMesh used to turn the chaos trimesh into a brand new jolt MeshShape for
+//every single placement, and on the big maps that conversion was most of level load. Now a mesh gets cooked once per
+//content, and every placement of it at the same scale gets the same ShapeRefC.
+//
+//Keys are content hashes of the chaos trimesh data, not asset pointers or names, so two assets with the same collision
+//share a shape and a reimported mesh with changed collision doesn't. Cooked shapes also go to disk in jolt's binary
+//shape format, named by that hash, so the next load of the level skips triangle conversion entirely and just restores.
+//
+//Hashing a big trimesh isn't free either, so each body setup remembers its hash for as long as it keeps the same chaos
+//trimeshes. a re-cook swaps those out, which is what sends it back through the hash.
+//
+//Safe to call from any thread. Two threads missing on the same mesh at once will both cook it, and one of them wins.
+class FBMeshShapeCache
+{
+public:
+	//empty directory means memory only.
+	explicit FBMeshShapeCache(const FString& InCookDirectory);
+
+	//the unrotated, untranslated shape for this body setup's trimeshes at this scale. null if there's nothing to cook.
+	JPH::ShapeRefC GetOrCook(const UBodySetup* Body, JPH::Vec3Arg Scale);
+
+	//bump this if the way we build the MeshShape changes, so old files on disk stop matching.
+	static constexpr uint32 CookVersion = 2;
+
+private:
+	//what a body setup hashed to, and the trimeshes it had when it did. holding them keeps their addresses from being
+	//reused, so a pointer match really does mean nothing was re-cooked.
+	struct FHashMemo
+	{
+		TWeakObjectPtr<const UBodySetup> Body;
+		TArray<Chaos::FTriangleMeshImplicitObjectPtr> Meshes;
+		uint64 ContentHash = 0;
+	};
+
+	uint64 ContentHashFor(const UBodySetup* Body);
+	JPH::ShapeRefC FindOrCookUnscaled(const UBodySetup* Body, uint64 ContentHash);
+	static JPH::ShapeRefC CookFromChaos(const UBodySetup* Body);
+	JPH::ShapeRefC LoadFromDisk(uint64 ContentHash) const;
+	void SaveToDisk(uint64 ContentHash, const JPH::Shape* Cooked) const;
+	FString PathFor(uint64 ContentHash) const;
+
+	//content hash to the cooked mesh, and content hash mixed with scale to the scaled shape that bodies actually use.
+	libcuckoo::cuckoohash_map<uint64, JPH::ShapeRefC> Unscaled;
+	libcuckoo::cuckoohash_map<uint64, JPH::ShapeRefC> Scaled;
+	//keyed weakly, so a collected body setup's memo just goes stale and gets swept on a later insert.
+	TMap<TObjectKey<UBodySetup>, FHashMemo> HashMemos;
+	int32 HashMemoSweepAt = 64;
+	FRWLock HashMemoLock;
+	FString CookDirectory;
+};
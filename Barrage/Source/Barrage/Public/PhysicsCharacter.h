@@ -19,6 +19,9 @@
 class FBCharacter : public FBCharacterBase
 {
 public:
+	//how far over max speed we let a character go for a single frame. the character hash grid pads by this too.
+	static constexpr float SpeedExcession = 1.20f;
+
 	JPH::RVec3 GetPosition() const
 	{
 		return mCharacter->GetPosition();
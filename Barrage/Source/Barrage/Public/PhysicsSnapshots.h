@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FBarrageKey.h"
+#include "IsolatedJoltIncludes.h"
+
+class FBCharacterBase;
+
+//Ring of physics world snapshots, one per step, for rollback. Built on jolt's SaveState and RestoreState, but only
+//dynamic bodies get saved. statics never move and kinematics are driven by us, so saving them is pure waste, and
+//it's what makes a whole-world save per tick so slow. Characters aren't jolt bodies, so they're saved alongside.
+//
+//A snapshot for tick N is the world as it stands after StepWorld(N). Restoring it and then stepping N+1 onward is a
+//resim. Buffers are reused slot to slot, so after the first lap around the ring, capture doesn't allocate.
+//
+//What this does not cover: constraints, and bodies created after the snapshot was taken (they're left where they
+//are). A restore is refused outright if any body in the snapshot has since been destroyed or stopped being dynamic,
+//rather than half applying. Tombstoning keeps bodies around for a while, so inside the window that's rare.
+//
+//Not thread safe. Capture and Restore belong to whoever calls StepWorld, between steps.
+class BARRAGE_API FBPhysicsSnapshots
+{
+public:
+	//power of two. ~150 bytes a dynamic body, so 10k bodies is about 1.5 megs a slot.
+	static constexpr uint32 Depth = 16;
+
+	using FCharacters = TMap<FBarrageKey, TSharedPtr<FBCharacterBase>>;
+
+	void Capture(uint64 Tick, const JPH::PhysicsSystem& System, const FCharacters* Characters);
+	//false if we don't have that tick anymore, or the world has changed too much to restore it.
+	bool Restore(uint64 Tick, JPH::PhysicsSystem& System, const FCharacters* Characters);
+	bool Has(uint64 Tick) const;
+	//a hash of everything saved for Tick, or 0 if we don't have it. the same tick stepped twice from the same start
+	//should hash the same, which is how a resim gets checked for determinism.
+	uint32 Fingerprint(uint64 Tick) const;
+	void Clear();
+
+private:
+	//jolt's own StateRecorderImpl sits on a stringstream, which allocates every time. this doesn't, after warm up.
+	class FRecorder final : public JPH::StateRecorder
+	{
+	public:
+		virtual void WriteBytes(const void* inData, size_t inNumBytes) override;
+		virtual void ReadBytes(void* outData, size_t inNumBytes) override;
+		virtual bool IsEOF() const override { return Cursor >= Bytes.Num(); }
+		virtual bool IsFailed() const override { return Failed; }
+
+		void Reset();
+		void Seek(int64 To);
+		int64 Num() const { return Bytes.Num(); }
+		uint32 Crc(uint32 Seed) const { return FCrc::MemCrc32(Bytes.GetData(), Bytes.Num(), Seed); }
+
+	private:
+		TArray<uint8> Bytes;
+		int64 Cursor = 0;
+		bool Failed = false;
+	};
+
+	struct FSlot
+	{
+		uint64 Tick = 0;
+		bool Valid = false;
+		FRecorder World;
+		//every body SaveState wrote, so restore can check they all still exist before touching anything.
+		TArray<JPH::BodyID> Bodies;
+		FRecorder CharacterStates;
+		TArray<TPair<FBarrageKey, int64>> CharacterOffsets;
+	};
+
+	FSlot& SlotFor(uint64 Tick) { return Slots[Tick & (Depth - 1)]; }
+	const FSlot& SlotFor(uint64 Tick) const { return Slots[Tick & (Depth - 1)]; }
+
+	FSlot Slots[Depth];
+};
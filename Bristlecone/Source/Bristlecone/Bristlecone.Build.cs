@@ -20,12 +20,16 @@ public class Bristlecone : ModuleRules
         // Get the engine path. Ends with "Engine/"
         string engine_path = EngineDirectory;
         // Now get the base of UE's modules dir (could also be Developer, Editor, ThirdParty)
-        string src_path = engine_path + "\\Source\\Runtime\\";
+        string src_path = Path.Combine(engine_path, "Source", "Runtime");
 
         //Don't do this. We need it to avoid having to either patch the engine or rebuild most of sockets or use pointer arithmatic and void*
-        PrivateIncludePaths.Add(src_path + "Sockets\\Private\\BSDSockets\\");
-        PrivateIncludePaths.Add(src_path + "Sockets\\Private\\");
-        PublicAdditionalLibraries.Add("qwave.lib"); // this will need to be fixed. god.
+        //the batched linux transport reaches under FSocket the same way, so these are needed everywhere, not just on windows.
+        PrivateIncludePaths.Add(Path.Combine(src_path, "Sockets", "Private", "BSDSockets"));
+        PrivateIncludePaths.Add(Path.Combine(src_path, "Sockets", "Private"));
+        if (Target.Platform == UnrealTargetPlatform.Win64)
+        {
+            PublicAdditionalLibraries.Add("qwave.lib"); // this will need to be fixed. god.
+        }
 
 
         PublicDependencyModuleNames.AddRange(new string[] {
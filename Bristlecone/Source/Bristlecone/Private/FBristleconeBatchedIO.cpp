@@ -0,0 +1,179 @@
+#include "FBristleconeBatchedIO.h"
+#include "SocketSubsystem.h"
+
+#if PLATFORM_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <errno.h>
+#include <Runtime/Sockets/Private/BSDSockets/SocketsBSD.h>
+
+namespace
+{
+	int NativeOf(FSocket& Socket)
+	{
+		return static_cast<int>(static_cast<FSocketBSD&>(Socket).GetNativeSocket());
+	}
+}
+
+int32 FBristleconeBatchedIO::Send(FSocket& Socket, TConstArrayView<FOutgoing> Batch)
+{
+	const int Native = NativeOf(Socket);
+	sockaddr_in Addresses[MaxBatch];
+	iovec Vectors[MaxBatch];
+	mmsghdr Headers[MaxBatch];
+	int32 Sent = 0;
+	for (int32 Start = 0; Start < Batch.Num(); Start += MaxBatch)
+	{
+		const int32 Count = FMath::Min(MaxBatch, Batch.Num() - Start);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FOutgoing& Out = Batch[Start + i];
+			Addresses[i] = {};
+			Addresses[i].sin_family = AF_INET;
+			Addresses[i].sin_port = htons(Out.To->Port);
+			Addresses[i].sin_addr.s_addr = htonl(Out.To->Address.Value);
+			Vectors[i].iov_base = const_cast<uint8*>(Out.Data);
+			Vectors[i].iov_len = Out.Size;
+			Headers[i] = {};
+			Headers[i].msg_hdr.msg_name = &Addresses[i];
+			Headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			Headers[i].msg_hdr.msg_iov = &Vectors[i];
+			Headers[i].msg_hdr.msg_iovlen = 1;
+		}
+		int32 Done = 0;
+		while (Done < Count)
+		{
+			const int Result = sendmmsg(Native, Headers + Done, Count - Done, 0);
+			if (Result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				//a full send buffer or a dead route. either way, the next tick's clones cover for these.
+				return Sent + Done;
+			}
+			Done += Result;
+		}
+		Sent += Done;
+	}
+	return Sent;
+}
+
+bool FBristleconeBatchedIO::WaitForRead(FSocket& Socket, FTimespan Timeout)
+{
+	pollfd Poll = {};
+	Poll.fd = NativeOf(Socket);
+	Poll.events = POLLIN;
+	const int Result = poll(&Poll, 1, static_cast<int>(Timeout.GetTotalMilliseconds()));
+	return Result > 0 && (Poll.revents & POLLIN);
+}
+
+int32 FBristleconeBatchedIO::Receive(FSocket& Socket, uint8* Slots, int32 SlotSize, int32* Sizes, int32 Count, FIPv4Endpoint* From)
+{
+	Count = FMath::Min(Count, MaxBatch);
+	iovec Vectors[MaxBatch];
+	mmsghdr Headers[MaxBatch];
+	sockaddr_in Addresses[MaxBatch];
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Vectors[i].iov_base = Slots + i * SlotSize;
+		Vectors[i].iov_len = SlotSize;
+		Headers[i] = {};
+		Headers[i].msg_hdr.msg_iov = &Vectors[i];
+		Headers[i].msg_hdr.msg_iovlen = 1;
+		if (From)
+		{
+			Headers[i].msg_hdr.msg_name = &Addresses[i];
+			Headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		}
+	}
+	int Result;
+	do
+	{
+		Result = recvmmsg(NativeOf(Socket), Headers, Count, MSG_DONTWAIT, nullptr);
+	}
+	while (Result < 0 && errno == EINTR);
+	if (Result <= 0)
+	{
+		return 0;
+	}
+
+	//squeeze out anything truncated, so the caller only sees whole datagrams.
+	int32 Kept = 0;
+	for (int32 i = 0; i < Result; ++i)
+	{
+		if (Headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+		{
+			continue;
+		}
+		if (Kept != i)
+		{
+			FMemory::Memcpy(Slots + Kept * SlotSize, Slots + i * SlotSize, Headers[i].msg_len);
+		}
+		if (From)
+		{
+			From[Kept] = FIPv4Endpoint(FIPv4Address(ntohl(Addresses[i].sin_addr.s_addr)), ntohs(Addresses[i].sin_port));
+		}
+		Sizes[Kept++] = static_cast<int32>(Headers[i].msg_len);
+	}
+	return Kept;
+}
+
+#else
+
+int32 FBristleconeBatchedIO::Send(FSocket& Socket, TConstArrayView<FOutgoing> Batch)
+{
+	int32 Sent = 0;
+	for (const FOutgoing& Out : Batch)
+	{
+		int32 BytesSent = 0;
+		if (Socket.SendTo(Out.Data, Out.Size, BytesSent, *Out.To->ToInternetAddr()) && BytesSent > 0)
+		{
+			++Sent;
+		}
+	}
+	return Sent;
+}
+
+bool FBristleconeBatchedIO::WaitForRead(FSocket& Socket, FTimespan Timeout)
+{
+	return Socket.Wait(ESocketWaitConditions::WaitForRead, Timeout);
+}
+
+namespace
+{
+	//the biggest datagram udp over ipv4 can carry. everything is read into this whole, so we always know its real size.
+	constexpr int32 MaxDatagram = 65507;
+	thread_local TArray<uint8> Scratch;
+}
+
+int32 FBristleconeBatchedIO::Receive(FSocket& Socket, uint8* Slots, int32 SlotSize, int32* Sizes, int32 Count, FIPv4Endpoint* From)
+{
+	const TSharedRef<FInternetAddr> Source = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	if (Scratch.Num() < MaxDatagram)
+	{
+		Scratch.SetNumUninitialized(MaxDatagram);
+	}
+	int32 Kept = 0;
+	//only a yes or no. on windows, the pending count is every queued datagram added up, not the size of the next one.
+	uint32 Pending = 0;
+	while (Kept < Count && Socket.HasPendingData(Pending))
+	{
+		int32 BytesRead = 0;
+		if (!Socket.RecvFrom(Scratch.GetData(), MaxDatagram, BytesRead, *Source) || BytesRead <= 0 || BytesRead > SlotSize)
+		{
+			continue;
+		}
+		FMemory::Memcpy(Slots + Kept * SlotSize, Scratch.GetData(), BytesRead);
+		if (From)
+		{
+			From[Kept] = FIPv4Endpoint(Source);
+		}
+		Sizes[Kept++] = BytesRead;
+	}
+	return Kept;
+}
+
+#endif
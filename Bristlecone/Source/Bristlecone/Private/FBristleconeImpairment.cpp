@@ -0,0 +1,162 @@
+#include "FBristleconeImpairment.h"
+
+FBristleconeImpairment::FBristleconeImpairment(const TArray<FBristleconeImpairmentPhase>& InScript, int32 Seed)
+	: Script(InScript), Random(Seed)
+{
+	if (Script.IsEmpty())
+	{
+		//no script is a clean link, which is still useful for checking the plumbing.
+		Script.AddDefaulted();
+	}
+	for (const FBristleconeImpairmentPhase& Phase : Script)
+	{
+		if (Phase.duration_seconds <= 0)
+		{
+			LoopSeconds = 0;
+			break;
+		}
+		LoopSeconds += Phase.duration_seconds;
+	}
+	Held.Reserve(256);
+}
+
+const FBristleconeImpairmentPhase& FBristleconeImpairment::PhaseAt(double Now)
+{
+	if (StartedAt < 0)
+	{
+		StartedAt = Now;
+	}
+	double Into = Now - StartedAt;
+	if (LoopSeconds > 0)
+	{
+		Into = FMath::Fmod(Into, LoopSeconds);
+	}
+	for (const FBristleconeImpairmentPhase& Phase : Script)
+	{
+		if (Phase.duration_seconds <= 0 || Into < Phase.duration_seconds)
+		{
+			return Phase;
+		}
+		Into -= Phase.duration_seconds;
+	}
+	return Script.Last();
+}
+
+bool FBristleconeImpairment::Lose(const FBristleconeImpairmentPhase& Phase)
+{
+	const double Loss = Phase.loss_percent / 100.0;
+	if (Loss <= 0)
+	{
+		InBurst = false;
+		return false;
+	}
+	if (Loss >= 1)
+	{
+		return true;
+	}
+	//in a burst, everything's lost. leaving it at 1/burst gives that mean length, and entering at this rate makes the
+	//fraction of time spent in one come out to Loss.
+	const double Leave = 1.0 / FMath::Max(1.0f, Phase.mean_burst_length);
+	const double Enter = FMath::Min(1.0, Loss * Leave / (1.0 - Loss));
+	InBurst = InBurst ? Random.FRand() >= Leave : Random.FRand() < Enter;
+	return InBurst;
+}
+
+double FBristleconeImpairment::DelayFor(const FBristleconeImpairmentPhase& Phase)
+{
+	const double Base = Phase.base_latency_ms;
+	const double Spread = Phase.latency_spread_ms;
+	double Millis = Base;
+	switch (Phase.latency_shape)
+	{
+	case EBristleconeLatencyShape::Uniform:
+		Millis = Base + Spread * Random.FRand();
+		break;
+	case EBristleconeLatencyShape::Normal:
+		{
+			//box-muller. a standard deviation of half the spread keeps the clamp at base from piling much up there.
+			const double U = FMath::Max(static_cast<double>(Random.FRand()), 1e-7);
+			const double Z = FMath::Sqrt(-2.0 * FMath::Loge(U)) * FMath::Cos(UE_DOUBLE_TWO_PI * Random.FRand());
+			Millis = FMath::Max(Base, Base + Spread + Z * Spread * 0.5);
+		}
+		break;
+	case EBristleconeLatencyShape::Exponential:
+		Millis = Base - Spread * FMath::Loge(FMath::Max(1.0 - Random.FRand(), 1e-7));
+		break;
+	}
+	if (Phase.reorder_percent > 0 && Random.FRand() * 100 < Phase.reorder_percent)
+	{
+		Millis += Phase.reorder_ms;
+	}
+	return Millis / 1000.0;
+}
+
+void FBristleconeImpairment::Admit(const uint8* Data, int32 Size, const FIPv4Endpoint& From, double Now)
+{
+	++Stats.Admitted;
+	const FBristleconeImpairmentPhase& Phase = PhaseAt(Now);
+	if (Lose(Phase))
+	{
+		++Stats.Dropped;
+		return;
+	}
+	const bool Twice = Phase.duplicate_percent > 0 && Random.FRand() * 100 < Phase.duplicate_percent;
+	Stats.Duplicated += Twice;
+	for (int32 Copy = 0; Copy < 1 + Twice; ++Copy)
+	{
+		if (Held.Num() >= MaxHeld || Size > MaxDatagramSize)
+		{
+			++Stats.Overflowed;
+			return;
+		}
+		FHeld Hold;
+		Hold.ReleaseAt = Now + DelayFor(Phase);
+		Hold.Sequence = ++NextSequence;
+		Hold.From = From;
+		Hold.Size = Size;
+		FMemory::Memcpy(Hold.Data, Data, Size);
+		Held.HeapPush(MoveTemp(Hold), &Sooner);
+	}
+}
+
+int32 FBristleconeImpairment::Pass(uint8* Slots, int32 SlotSize, int32* Sizes, FIPv4Endpoint* From, int32 Count,
+                                   int32 Capacity, double Now)
+{
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Admit(Slots + i * SlotSize, Sizes[i], From ? From[i] : FIPv4Endpoint(), Now);
+	}
+	int32 Out = 0;
+	FHeld Next;
+	while (Out < Capacity && !Held.IsEmpty() && Held.HeapTop().ReleaseAt <= Now)
+	{
+		Held.HeapPop(Next, &Sooner, EAllowShrinking::No);
+		if (Next.Size > SlotSize)
+		{
+			continue;
+		}
+		if (Next.Sequence < HighestReleased)
+		{
+			++Stats.Reordered;
+		}
+		HighestReleased = FMath::Max(HighestReleased, Next.Sequence);
+		FMemory::Memcpy(Slots + Out * SlotSize, Next.Data, Next.Size);
+		Sizes[Out] = Next.Size;
+		if (From)
+		{
+			From[Out] = Next.From;
+		}
+		++Out;
+	}
+	Stats.Released += Out;
+	return Out;
+}
+
+FTimespan FBristleconeImpairment::UntilNextRelease(double Now) const
+{
+	if (Held.IsEmpty())
+	{
+		return FTimespan::MaxValue();
+	}
+	return FTimespan::FromSeconds(FMath::Max(0.0, Held.HeapTop().ReleaseAt - Now));
+}
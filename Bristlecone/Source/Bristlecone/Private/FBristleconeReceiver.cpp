@@ -1,15 +1,16 @@
 ﻿#include "FBristleconeReceiver.h"
+#include "FBristleconeBatchedIO.h"
 
 
 
-FBristleconeReceiver::FBristleconeReceiver() : MySeen(0x0b1), running(false) {
+FBristleconeReceiver::FBristleconeReceiver() : running(false) {
 	UE_LOG(LogTemp, Display, TEXT("Bristlecone:Receiver: Constructing Bristlecone Receiver"));
 }
 
 void FBristleconeReceiver::BindSink(TheCone::RecvQueue QueueCandidate)
 {
-	Queue.Reset();
-	Queue = QueueCandidate;
+	stream_queues[0].Reset();
+	stream_queues[0] = QueueCandidate;
 }
 
 void FBristleconeReceiver::BindStatsSink(TheCone::TimestampQueue QueueCandidate)
@@ -26,18 +27,46 @@ void FBristleconeReceiver::SetLocalSocket(const TSharedPtr<FSocket, ESPMode::Thr
 	receiver_socket = new_socket;
 }
 
+void FBristleconeReceiver::SetPeers(const TArray<FIPv4Endpoint>& new_peers, const TArray<FIPv4Endpoint>& new_relays) {
+	peers = new_peers;
+	relays = new_relays;
+}
+
+void FBristleconeReceiver::SetRelayMode(bool relay) {
+	relay_mode = relay;
+}
+
+int32 FBristleconeReceiver::GetStreamCount() const {
+	return stream_count.load(std::memory_order_acquire);
+}
+
+TheCone::RecvQueue FBristleconeReceiver::GetStream(int32 index, FIPv4Endpoint* from) const {
+	if (index < 0 || index >= GetStreamCount()) {
+		return nullptr;
+	}
+	if (from) {
+		*from = stream_origins[index];
+	}
+	return stream_queues[index];
+}
+
+void FBristleconeReceiver::SetImpairment(const TArray<FBristleconeImpairmentPhase>& script, int32 seed) {
+	impairment = MakeUnique<FBristleconeImpairment>(script, seed);
+}
+
+const FBristleconeImpairment* FBristleconeReceiver::GetImpairment() const {
+	return impairment.Get();
+}
+
 bool FBristleconeReceiver::Init() {
 	UE_LOG(LogTemp, Display, TEXT("Bristlecone:Receiver: Initializing Bristlecone receiver thread"));
 	socket_subsystem.Reset(ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM));
-	SeenCycles = 0;
-	HighestSeen = 0;
 	running = true;
 	return true;
 }
 
 uint32 FBristleconeReceiver::Run() {
 	UE_LOG(LogTemp, Display, TEXT("Bristlecone:Receiver: Running receiver thread"));
-	const TSharedRef<FInternetAddr> targetAddr = socket_subsystem->CreateInternetAddr();
 	FString localNID = FGenericPlatformMisc::GetLoginId();
 
 	//if you use a system like this, the reflector will need the unhashed ids AND the session id.
@@ -46,46 +75,140 @@ uint32 FBristleconeReceiver::Run() {
 	//it's not actually needed, interestingly, but it does make life a ton more convenient and we want to stay word aligned.
 	//likely timestamp as (nanos >> K) & 0xFFFFFFFF or the lower 32 bits of the nanosecond timestamp, discarding the 
 	//first K binary digits to help remove jitter's effect.
-	uint32_t ThinHash = FTextLocalizationResource::HashString(localNID, TheCone::DummyGetBristleconeSessionID());
-	MySeen = TheCone::CycleTracking(ThinHash);
-	const FTimespan Period(100000); //we wait 10ms at a stop. we don't have anything to do while we aren't waiting, but I don't trust it.
+	ThinHash = FTextLocalizationResource::HashString(localNID, TheCone::DummyGetBristleconeSessionID());
+	stream_seen.Reset();
+	stream_of.Reset();
+	stream_count.store(0, std::memory_order_release);
+	//one stream, from anywhere.
+	single_stream = peers.Num() <= 1 && relays.IsEmpty();
+	if (single_stream) {
+		ClaimStream(peers.IsEmpty() ? FIPv4Endpoint(FIPv4Address::Any, 0) : peers[0]);
+	}
+	//one send interval. the poll wakes the moment anything lands, so this only bounds how long we take to notice a stop.
+	const FTimespan Period = FTimespan::FromSeconds(1.0 / TheCone::BristleconeSendHertz);
+	//a slot fits a packet in either form, raw or encoded, in an envelope if it came through a relay.
+	constexpr int32 SlotSize = TheCone::MAX_DATAGRAM_SIZE;
+	received_data.SetNumUninitialized(SlotSize * FBristleconeBatchedIO::MaxBatch);
 	while (running && receiver_socket) {
 		TheCone::Packet_tpl receiving_state;
 	
-		uint32 socket_data_size;
-		while (receiver_socket.IsValid() && receiver_socket->HasPendingData(socket_data_size)) {
-			int32 bytes_read = 0;
-
-			received_data.SetNumUninitialized(FMath::Min(socket_data_size, 65507u));
-			receiver_socket->RecvFrom(received_data.GetData(), received_data.Num(), bytes_read, *targetAddr);
-
-			memcpy(&receiving_state, received_data.GetData(), bytes_read);
-			//this & logging are VERY slow, like potentially reordering our perceived timings slow. We need to be careful as hell interacting
-			//with time and logging, since we're now operating in the lock-sensitive time regime. we'll need a solution.
-			const uint64_t cycle = receiving_state.GetCycleMeta();
-			//we keep a mask of the 64 cycles before the highest seen to make sure we don't emit more than once.
-			//if it's higher, we slide forwards and don't need to check the mask. That's handled in the BitTracker
-			if (!MySeen.Update(cycle))
+		int32 batch_count = FBristleconeBatchedIO::MaxBatch;
+		//a full batch means there's probably more waiting, so keep going before we block again.
+		while (receiver_socket.IsValid() && batch_count == FBristleconeBatchedIO::MaxBatch) {
+			batch_count = FBristleconeBatchedIO::Receive(*receiver_socket, received_data.GetData(), SlotSize, received_sizes,
+				FBristleconeBatchedIO::MaxBatch, received_from);
+			int32 ready_count = batch_count;
+			if (impairment)
 			{
-				continue;
+				//what we just read goes in, and whatever's due comes out in its place.
+				ready_count = impairment->Pass(received_data.GetData(), SlotSize, received_sizes, received_from,
+					batch_count, FBristleconeBatchedIO::MaxBatch, FPlatformTime::Seconds());
 			}
-			if (LogOnReceive)
+			relay_outgoing.Reset();
+			relay_count = 0;
+			for (int32 i = 0; i < ready_count; ++i)
 			{
-				uint32_t lsbTime = NarrowClock::getSlicedMicrosecondNow();;
-				TheCone::CycleTimestamp v = TheCone::CycleTimestamp(lsbTime - receiving_state.GetTransferTime(), receiving_state.GetCycleMeta());
-				PacketStats->Enqueue(v); // p sure this doesn't leak memory? @Eliza, TODO: please sanity check me?
+				const uint8* datagram = received_data.GetData() + i * SlotSize;
+				int32 size = received_sizes[i];
+				FIPv4Endpoint origin = received_from[i];
+				//everything a relay sends is in an envelope, so anything from one that isn't, isn't ours.
+				const bool via_relay = relays.Contains(origin);
+				if (via_relay && !FBristleconeRelayEnvelope::Read(datagram, size, origin))
+				{
+					continue;
+				}
+				//raw or encoded, the codec tells. anything it can't read isn't ours.
+				if (!TheCone::PacketCodec::Decode(datagram, size, receiving_state))
+				{
+					continue;
+				}
+				const int32 stream = FindStream(origin, via_relay);
+				if (stream < 0)
+				{
+					++StrangersDropped;
+					continue;
+				}
+				//this & logging are VERY slow, like potentially reordering our perceived timings slow. We need to be careful as hell interacting
+				//with time and logging, since we're now operating in the lock-sensitive time regime. we'll need a solution.
+				const uint64_t cycle = receiving_state.GetCycleMeta();
+				//we keep a mask of the 64 cycles before the highest seen to make sure we don't emit more than once.
+				//if it's higher, we slide forwards and don't need to check the mask. That's handled in the BitTracker
+				if (!stream_seen[stream].Update(cycle))
+				{
+					++DuplicatesSuppressed;
+					continue;
+				}
+				//we don't relay what another relay already did.
+				if (relay_mode && !via_relay)
+				{
+					Relay(datagram, size, origin);
+				}
+				++PacketsDelivered;
+				if (LogOnReceive)
+				{
+					uint32_t lsbTime = NarrowClock::getSlicedMicrosecondNow();;
+					TheCone::CycleTimestamp v = TheCone::CycleTimestamp(lsbTime - receiving_state.GetTransferTime(), receiving_state.GetCycleMeta());
+					PacketStats->Enqueue(v); // p sure this doesn't leak memory? @Eliza, TODO: please sanity check me?
+				}
+				stream_queues[stream]->Enqueue(receiving_state);//this actually provokes a copy, which can be removed, I think, by not doing the mcpy
+			}
+			//forwarded as we got them, still encoded, in their envelopes. one send for the batch.
+			if (!relay_outgoing.IsEmpty() && receiver_socket.IsValid())
+			{
+				FBristleconeBatchedIO::Send(*receiver_socket, relay_outgoing);
 			}
-			Queue.Get()->Enqueue(receiving_state);//this actually provokes a copy, which can be removed, I think, by not doing the mcpy
-			
-
 		}
 	
-		receiver_socket.IsValid() ? receiver_socket.Get()->Wait(ESocketWaitConditions::WaitForRead, Period) : 0;
+		//held datagrams come due on their own, so don't sleep through them.
+		const FTimespan Wait = impairment ? FMath::Min(Period, impairment->UntilNextRelease(FPlatformTime::Seconds())) : Period;
+		receiver_socket.IsValid() ? FBristleconeBatchedIO::WaitForRead(*receiver_socket, Wait) : 0;
 	}
 	receiver_socket = nullptr;//revise this, it's not super safe even with threadsafe smart pointers, but it'll hold for now.
 	return 0;
 }
 
+int32 FBristleconeReceiver::FindStream(const FIPv4Endpoint& origin, bool via_relay) {
+	if (single_stream) {
+		return 0;
+	}
+	if (const int32* stream = stream_of.Find(origin)) {
+		return *stream;
+	}
+	//a relay vouches for whoever's behind it. anyone else has to be a peer.
+	if (!via_relay && !peers.Contains(origin)) {
+		return -1;
+	}
+	return ClaimStream(origin);
+}
+
+int32 FBristleconeReceiver::ClaimStream(const FIPv4Endpoint& origin) {
+	const int32 stream = stream_count.load(std::memory_order_relaxed);
+	if (stream >= TheCone::MAX_TARGET_COUNT) {
+		return -1;
+	}
+	if (!stream_queues[stream].IsValid()) {
+		stream_queues[stream] = MakeShareable(new TheCone::PacketQ(256));
+	}
+	stream_origins[stream] = origin;
+	stream_seen.Emplace(ThinHash ^ GetTypeHash(origin));
+	stream_of.Add(origin, stream);
+	//the queue and origin have to be there before anyone can see the stream.
+	stream_count.store(stream + 1, std::memory_order_release);
+	return stream;
+}
+
+void FBristleconeReceiver::Relay(const uint8* datagram, int32 size, const FIPv4Endpoint& origin) {
+	//at most one per datagram in the batch, so this never runs out.
+	uint8* wrapped = relay_data[relay_count++];
+	FBristleconeRelayEnvelope::Write(wrapped, origin);
+	FMemory::Memcpy(wrapped + FBristleconeRelayEnvelope::HEADER_SIZE, datagram, size);
+	for (const FIPv4Endpoint& peer : peers) {
+		if (peer != origin) {
+			relay_outgoing.Add({wrapped, FBristleconeRelayEnvelope::HEADER_SIZE + size, &peer});
+		}
+	}
+}
+
 void FBristleconeReceiver::Exit() {
 	UE_LOG(LogTemp, Display, TEXT("Bristlecone:Receiver: Stopping Bristlecone receiver thread."));
 	Cleanup();
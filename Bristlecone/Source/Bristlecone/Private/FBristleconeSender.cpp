@@ -1,6 +1,7 @@
 ﻿#include "FBristleconeSender.h"
 
 #include "UBristleconeWorldSubsystem.h"
+#include "FBristleconeBatchedIO.h"
 #include "Common/UdpSocketBuilder.h"
 
 //these includes shouldn't be moved to the .h, due to odd declaration behaviors.
@@ -24,7 +25,7 @@ FBristleconeSender::FBristleconeSender()
 : consecutive_zero_bytes_sent(0), running(false) {
 	UE_LOG(LogTemp, Display, TEXT("Bristlecone:Sender: Constructing Bristlecone Sender"));
 
-	target_endpoints = MakeShareable(new TArray<FIPv4Endpoint>());
+	target_endpoints = MakeShareable(new TArray<FBristleconeTarget>());
 	target_endpoints->Reserve(MAX_TARGET_COUNT);
 	
 }
@@ -39,11 +40,43 @@ void FBristleconeSender::BindSource(TheCone::SendQueue QueueCandidate)
 	Queue = QueueCandidate;
 }
 
-void FBristleconeSender::AddTargetAddress(FString target_address_str) {
-	FIPv4Address target_address;
-	FIPv4Address::Parse(target_address_str, target_address);
-	FIPv4Endpoint target_endpoint = FIPv4Endpoint(target_address, DEFAULT_PORT);
-	target_endpoints->Emplace(target_endpoint);
+bool FBristleconeSender::AddTargetAddress(FString target_address_str, uint8 sockets, int32 send_every) {
+	if (target_endpoints->Num() >= MAX_TARGET_COUNT) {
+		UE_LOG(LogTemp, Error, TEXT("Bristlecone:Sender: Already at %d targets, not adding %s."), MAX_TARGET_COUNT, *target_address_str);
+		return false;
+	}
+	FBristleconeTarget target;
+	//no port means the default one.
+	if (!FIPv4Endpoint::Parse(target_address_str, target.endpoint)) {
+		FIPv4Address target_address;
+		if (!FIPv4Address::Parse(target_address_str, target_address)) {
+			UE_LOG(LogTemp, Error, TEXT("Bristlecone:Sender: Could not parse target address %s."), *target_address_str);
+			return false;
+		}
+		target.endpoint = FIPv4Endpoint(target_address, DEFAULT_PORT);
+	}
+	target.sockets = sockets & SEND_ON_ALL ? sockets & SEND_ON_ALL : SEND_ON_ALL;
+	target.send_every = FMath::Clamp(send_every, 1, MAX_SEND_EVERY);
+	if (target.send_every != send_every) {
+		UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Sender: send_every %d for %s is out of range, using %d."),
+			send_every, *target.endpoint.ToString(), target.send_every);
+	}
+	target_endpoints->Emplace(target);
+	return true;
+}
+
+int32 FBristleconeSender::GetTargetCount() const {
+	return target_endpoints ? target_endpoints->Num() : 0;
+}
+
+TArray<FIPv4Endpoint> FBristleconeSender::GetTargetEndpoints() const {
+	TArray<FIPv4Endpoint> endpoints;
+	if (target_endpoints) {
+		for (const FBristleconeTarget& target : *target_endpoints) {
+			endpoints.Add(target.endpoint);
+		}
+	}
+	return endpoints;
 }
 
 void FBristleconeSender::SetLocalSockets(
@@ -60,6 +93,10 @@ void FBristleconeSender::SetWakeSender(FSharedEventRef NewWakeSender) {
 	WakeSender = NewWakeSender;
 }
 
+void FBristleconeSender::SetWrapAsRelay(bool wrap) {
+	wrap_as_relay = wrap;
+}
+
 void FBristleconeSender::ActivateDSCP()
 {
 
@@ -87,8 +124,8 @@ void FBristleconeSender::ActivateDSCP()
 	Version.MinorVersion = 0;
 	QOS_FLOWID     QoSFlowId = 0;
 	destination.sin_family = AF_INET;
-	destination.sin_port = target_endpoints->Last().Port;
-	destination.sin_addr.s_addr = target_endpoints->Last().Address.Value;
+	destination.sin_port = target_endpoints->Last().endpoint.Port;
+	destination.sin_addr.s_addr = target_endpoints->Last().endpoint.Address.Value;
 	// Get a handle to the QoS subsystem. this requires us to have the qwave lib file loaded to resolve the symbol. Oddly, you can't load the dll.
 
 	QOSCreateHandle(
@@ -146,38 +183,70 @@ uint32 FBristleconeSender::Run() {
 		WakeSender->Reset();
 		// Update ring array
 		//BRRRRRRRRRRRRRRRRRRRRRRRRRRRRRRR
+		//we snapshot every packet this wake produces first, then each socket sends the lot in one go. on linux that's
+		//one syscall per socket instead of one per packet, per socket, per endpoint.
 		while(!Queue.Get()->IsEmpty())
 		{
-			++counter;
-			sending_state.controller_arr = *Queue->Peek(); //assign by value or you'll have a bad time.
-			packet_container.InsertNewDatagram(&sending_state);
-			packet_container.GetPacket()->UpdateCycleOrMeta(counter);
+			staged_count = 0;
+			while (!Queue.Get()->IsEmpty() && staged_count < MAX_STAGED_PACKETS)
+			{
+				++counter;
+				sending_state.controller_arr = *Queue->Peek(); //assign by value or you'll have a bad time.
+				packet_container.InsertNewDatagram(&sending_state);
+				packet_container.GetPacket()->UpdateCycleOrMeta(counter);
+				//we may want a mode to timestamp each individual packet during testing so we can get a unique rtt
+				uint8* staged = staged_packets[staged_count];
+				int32 header = 0;
+				if (wrap_as_relay)
+				{
+					//no origin means it's ours.
+					FBristleconeRelayEnvelope::Write(staged, FIPv4Endpoint(FIPv4Address::Any, 0));
+					header = FBristleconeRelayEnvelope::HEADER_SIZE;
+				}
+				staged_sizes[staged_count] = header + FControllerStateCodec::Encode(*packet_container.GetPacket(),
+					packet_container.GetNewestIndex(), staged + header);
+				++staged_count;
+				Queue->Dequeue();
+			}
 			auto HoldOpen = target_endpoints;
 			if(HoldOpen && H1 && H2 && H3)
 			{
-				for (auto& endpoint : (*target_endpoints)) {
-					int32 bytes_sent;
-					//we may want a mode to timestamp each individual packet during testing so we can get a unique rtt
-					const FControllerStatePacket* current_controller_state = packet_container.GetPacket();
-					auto holdopen = endpoint;
-					bool packet_sent = H2->SendTo(reinterpret_cast<const uint8*>(current_controller_state), sizeof(FControllerStatePacket),
-						bytes_sent, *holdopen.ToInternetAddr());
-					packet_sent = H1->SendTo(reinterpret_cast<const uint8*>(current_controller_state), sizeof(FControllerStatePacket),
-						bytes_sent, *holdopen.ToInternetAddr());
-					packet_sent = H3->SendTo(reinterpret_cast<const uint8*>(current_controller_state), sizeof(FControllerStatePacket),
-						bytes_sent, *holdopen.ToInternetAddr());
-
-
-					if (bytes_sent == 0) {
-						consecutive_zero_bytes_sent++;
-					}
-					else {
-						consecutive_zero_bytes_sent = 0;
+				for (auto& socket_batch : outgoing)
+				{
+					socket_batch.Reset();
+				}
+				for (int32 staged = 0; staged < staged_count; ++staged)
+				{
+					for (FBristleconeTarget& target : *HoldOpen)
+					{
+						//pacing is per packet, not per socket, so a paced target still gets all its clones of the ones it gets.
+						if (target.pace_counter++ % target.send_every != 0)
+						{
+							continue;
+						}
+						const FBristleconeBatchedIO::FOutgoing out = {staged_packets[staged], staged_sizes[staged], &target.endpoint};
+						for (int32 socket = 0; socket < 3; ++socket)
+						{
+							if (target.sockets & (1 << socket))
+							{
+								outgoing[socket].Add(out);
+							}
+						}
 					}
+				}
+				//high, then low, then background, as before.
+				int32 sent = FBristleconeBatchedIO::Send(*H2, outgoing[0]);
+				sent += FBristleconeBatchedIO::Send(*H1, outgoing[1]);
+				sent += FBristleconeBatchedIO::Send(*H3, outgoing[2]);
 
+				const bool any_due = !outgoing[0].IsEmpty() || !outgoing[1].IsEmpty() || !outgoing[2].IsEmpty();
+				if (sent == 0 && any_due) {
+					consecutive_zero_bytes_sent++;
+				}
+				else {
+					consecutive_zero_bytes_sent = 0;
 				}
 			}
-			Queue->Dequeue();
 		}
 	}
 	
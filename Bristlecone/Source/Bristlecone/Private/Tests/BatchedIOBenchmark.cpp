@@ -0,0 +1,187 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FBristleconeBatchedIO.h"
+#include "FBristleconePacketCodec.h"
+#include "Common/UdpSocketBuilder.h"
+#include "SocketSubsystem.h"
+#include "HAL/PlatformTime.h"
+
+//Loopback throughput and latency for the batched path against the SendTo / HasPendingData / RecvFrom loop it replaced.
+//Throughput sends a tick's worth of clones at a time, which is a full MaxBatch, and drains them the way each receiver
+//does. Latency is one datagram, from send until its receive returns, on one thread. That makes it the syscall and
+//wakeup cost, not the network's. On anything but linux, the batched path is the loop, so both sides should match.
+namespace BatchedIOBench
+{
+	//what a controller state packet is on the wire, near enough.
+	constexpr int32 PacketSize = 47;
+	constexpr int32 SlotSize = TheCone::PacketCodec::MAX_WIRE_SIZE;
+
+	struct FLoopback
+	{
+		TSharedPtr<FSocket> Sender;
+		TSharedPtr<FSocket> Receiver;
+		FIPv4Endpoint To;
+
+		FLoopback()
+		{
+			const FIPv4Endpoint Local(FIPv4Address(127, 0, 0, 1), 0);
+			Receiver = MakeShareable(FUdpSocketBuilder(TEXT("Bristlecone.Bench.Receiver")).AsNonBlocking()
+				.BoundToEndpoint(Local).WithReceiveBufferSize(1 << 22).Build());
+			Sender = MakeShareable(FUdpSocketBuilder(TEXT("Bristlecone.Bench.Sender")).AsNonBlocking()
+				.BoundToEndpoint(Local).WithSendBufferSize(1 << 22).Build());
+			if (Receiver)
+			{
+				To = FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), Receiver->GetPortNo());
+			}
+		}
+
+		~FLoopback()
+		{
+			//same as the subsystem: close, and let the shared pointers delete them.
+			for (const TSharedPtr<FSocket>& Socket : {Sender, Receiver})
+			{
+				if (Socket.IsValid())
+				{
+					Socket->Close();
+				}
+			}
+		}
+
+		bool IsValid() const { return Sender.IsValid() && Receiver.IsValid(); }
+	};
+
+	struct FResult
+	{
+		double Seconds = 0;
+		int64 Sent = 0;
+		int64 Received = 0;
+		TArray<double> LatencyMicros;
+	};
+
+	//drains until Expected have arrived or the socket goes quiet for a few milliseconds.
+	static int64 Drain(FLoopback& Loop, bool Batched, int64 Expected, uint8* Slots, int32* Sizes)
+	{
+		int64 Got = 0;
+		const TSharedRef<FInternetAddr> Source = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+		while (Got < Expected)
+		{
+			if (Batched)
+			{
+				if (!FBristleconeBatchedIO::WaitForRead(*Loop.Receiver, FTimespan::FromMilliseconds(5)))
+				{
+					break;
+				}
+				Got += FBristleconeBatchedIO::Receive(*Loop.Receiver, Slots, SlotSize, Sizes, FBristleconeBatchedIO::MaxBatch);
+				continue;
+			}
+			uint32 Pending = 0;
+			if (!Loop.Receiver->HasPendingData(Pending))
+			{
+				if (!Loop.Receiver->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(5)))
+				{
+					break;
+				}
+				continue;
+			}
+			int32 BytesRead = 0;
+			if (Loop.Receiver->RecvFrom(Slots, SlotSize, BytesRead, *Source) && BytesRead > 0)
+			{
+				++Got;
+			}
+		}
+		return Got;
+	}
+
+	static void SendBatch(FLoopback& Loop, bool Batched, TConstArrayView<FBristleconeBatchedIO::FOutgoing> Batch, FResult& Result)
+	{
+		if (Batched)
+		{
+			Result.Sent += FBristleconeBatchedIO::Send(*Loop.Sender, Batch);
+			return;
+		}
+		const TSharedRef<FInternetAddr> To = Loop.To.ToInternetAddr();
+		for (const FBristleconeBatchedIO::FOutgoing& Out : Batch)
+		{
+			int32 BytesSent = 0;
+			if (Loop.Sender->SendTo(Out.Data, Out.Size, BytesSent, *To) && BytesSent > 0)
+			{
+				++Result.Sent;
+			}
+		}
+	}
+
+	static FResult Run(bool Batched, int32 Rounds, int32 Pings)
+	{
+		FResult Result;
+		FLoopback Loop;
+		if (!Loop.IsValid())
+		{
+			return Result;
+		}
+		uint8 Packet[PacketSize] = {};
+		TArray<uint8> Slots;
+		Slots.SetNumUninitialized(SlotSize * FBristleconeBatchedIO::MaxBatch);
+		int32 Sizes[FBristleconeBatchedIO::MaxBatch];
+		TArray<FBristleconeBatchedIO::FOutgoing> Batch;
+		Batch.Init({Packet, PacketSize, &Loop.To}, FBristleconeBatchedIO::MaxBatch);
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Round = 0; Round < Rounds; ++Round)
+		{
+			const int64 SentBefore = Result.Sent;
+			SendBatch(Loop, Batched, Batch, Result);
+			Result.Received += Drain(Loop, Batched, Result.Sent - SentBefore, Slots.GetData(), Sizes);
+		}
+		Result.Seconds = FPlatformTime::Seconds() - Start;
+
+		for (int32 Ping = 0; Ping < Pings; ++Ping)
+		{
+			FResult One;
+			const uint64 Sent = FPlatformTime::Cycles64();
+			SendBatch(Loop, Batched, MakeArrayView(Batch.GetData(), 1), One);
+			if (Drain(Loop, Batched, 1, Slots.GetData(), Sizes) == 1)
+			{
+				Result.LatencyMicros.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Sent) * 1000.0);
+			}
+		}
+		Result.LatencyMicros.Sort();
+		return Result;
+	}
+
+	static double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		return Sorted.IsEmpty() ? 0 : Sorted[FMath::Min(Sorted.Num() - 1, static_cast<int32>(Sorted.Num() * Fraction))];
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBristleconeBatchedIOBenchmark, "Bristlecone.Benchmark.BatchedIO",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBristleconeBatchedIOBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace BatchedIOBench;
+	constexpr int32 Rounds = 2000;
+	constexpr int32 Pings = 2000;
+	const FResult Loop = Run(false, Rounds, Pings);
+	const FResult Batched = Run(true, Rounds, Pings);
+	if (!TestTrue(TEXT("loopback sockets open"), Loop.Sent > 0 && Batched.Sent > 0))
+	{
+		return false;
+	}
+	const auto Report = [this](const TCHAR* Name, const FResult& Result)
+	{
+		AddInfo(FString::Printf(TEXT("%s: %.0f packets/s, %lld of %lld received | one packet send to receive p50 %.1fus p99 %.1fus"),
+			Name, Result.Received / FMath::Max(Result.Seconds, 1e-9), Result.Received, Result.Sent,
+			Percentile(Result.LatencyMicros, 0.5), Percentile(Result.LatencyMicros, 0.99)));
+	};
+	Report(TEXT("loop"), Loop);
+	Report(FBristleconeBatchedIO::IsNative() ? TEXT("mmsg") : TEXT("batched (the loop, off linux)"), Batched);
+	//loopback with a big buffer and a drain after every batch shouldn't drop anything.
+	TestEqual(TEXT("batched receives everything it sent"), Batched.Received, Batched.Sent);
+	TestEqual(TEXT("every batched ping came back"), Batched.LatencyMicros.Num(), Pings);
+	return true;
+}
+
+#endif
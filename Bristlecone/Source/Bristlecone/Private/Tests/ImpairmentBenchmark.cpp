@@ -0,0 +1,230 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FBristleconeImpairment.h"
+#include "BristleconeCommonTypes.h"
+#include "HAL/PlatformTime.h"
+
+//Send rate and clone count against simulated bad networks, headless. A sender makes an input every cycle at
+//BristleconeSendHertz and sends every send_every-th packet, Copies times over, the way one target on one to three
+//sockets gets them. The datagrams go through FBristleconeImpairment, and the receiver dedups by cycle with a
+//CycleTracking the way FBristleconeReceiver does. An input counts as delivered the first time any packet carrying it,
+//as any of its three clones, gets through.
+//
+//Time is simulated, not slept, so ten minutes of a session runs in well under a second, and the same seed gives the
+//same numbers every run. The wall clock only times the impairment itself.
+namespace ImpairmentBench
+{
+	constexpr int32 Capacity = 64;
+	constexpr int32 SlotSize = TheCone::MAX_DATAGRAM_SIZE;
+
+	struct FResult
+	{
+		//ms from an input being made to it arriving, for every input that did.
+		TArray<double> LatencyMillis;
+		int64 Inputs = 0;
+		int64 PacketsSent = 0;
+		int64 DatagramsSent = 0;
+		//released copies of a packet we'd already had, and how many of those the tracker threw away.
+		int64 Redundant = 0;
+		int64 RedundantSuppressed = 0;
+		//first copies the tracker threw away anyway, for being older than its window.
+		int64 FreshSuppressed = 0;
+		double ImpairmentSeconds = 0;
+		uint64 Admitted = 0;
+		uint64 Dropped = 0;
+		uint64 Duplicated = 0;
+		uint64 Reordered = 0;
+		uint64 Released = 0;
+		uint64 Overflowed = 0;
+	};
+
+	static FResult Run(const TArray<FBristleconeImpairmentPhase>& Script, int32 Seed, int32 Copies, int32 SendEvery, double Seconds)
+	{
+		FResult Result;
+		FBristleconeImpairment Impairment(Script, Seed);
+		TheCone::CycleTracking Seen(0x1A7);
+		const double Interval = 1.0 / TheCone::BristleconeSendHertz;
+		const int64 Cycles = static_cast<int64>(Seconds * TheCone::BristleconeSendHertz);
+		Result.Inputs = Cycles;
+
+		TArray<double> DeliveredAt;
+		TBitArray<> PacketSeen;
+		DeliveredAt.Init(-1, Cycles);
+		PacketSeen.Init(false, Cycles + 1);
+		uint8 Slots[Capacity * SlotSize];
+		int32 Sizes[Capacity];
+		TheCone::Packet_tpl Packet;
+		TheCone::Packet_tpl Received;
+
+		double Now = 0;
+		int64 Cycle = 0;
+		while (Cycle < Cycles || Impairment.UntilNextRelease(Now) != FTimespan::MaxValue())
+		{
+			const double NextSend = Cycle < Cycles ? Cycle * Interval : TNumericLimits<double>::Max();
+			const FTimespan Until = Impairment.UntilNextRelease(Now);
+			//a tick past due, so rounding to the timespan's 100ns never leaves it just short.
+			const double NextRelease = Until == FTimespan::MaxValue() ? TNumericLimits<double>::Max() : Now + Until.GetTotalSeconds() + 1e-7;
+			Now = FMath::Min(NextSend, NextRelease);
+
+			int32 Count = 0;
+			if (Cycle < Cycles && NextSend <= Now)
+			{
+				//the newest clone is this cycle's input, the other two the ones before. inputs go in one up, so 0 is none.
+				const uint32 Newest = Cycle % 3;
+				for (uint32 Age = 0; Age < 3; ++Age)
+				{
+					*Packet.GetPointerToElement((Newest + 3 - Age) % 3) = Cycle >= Age ? Cycle - Age + 1 : 0;
+				}
+				Packet.UpdateTransferTime(static_cast<long>(Cycle));
+				Packet.UpdateCycleOrMeta(static_cast<long>(Cycle + 1));
+				if (Cycle % SendEvery == 0)
+				{
+					for (; Count < Copies; ++Count)
+					{
+						Sizes[Count] = TheCone::PacketCodec::Encode(Packet, Newest, Slots + Count * SlotSize);
+					}
+					++Result.PacketsSent;
+					Result.DatagramsSent += Copies;
+				}
+				++Cycle;
+			}
+
+			int32 Out = 0;
+			do
+			{
+				const double Start = FPlatformTime::Seconds();
+				Out = Impairment.Pass(Slots, SlotSize, Sizes, nullptr, Count, Capacity, Now);
+				Result.ImpairmentSeconds += FPlatformTime::Seconds() - Start;
+				Count = 0;
+				for (int32 i = 0; i < Out; ++i)
+				{
+					if (!TheCone::PacketCodec::Decode(Slots + i * SlotSize, Sizes[i], Received))
+					{
+						continue;
+					}
+					const int32 PacketCycle = static_cast<int32>(Received.GetCycleMeta());
+					const bool Redundant = PacketSeen[PacketCycle];
+					PacketSeen[PacketCycle] = true;
+					Result.Redundant += Redundant;
+					if (!Seen.Update(PacketCycle))
+					{
+						(Redundant ? Result.RedundantSuppressed : Result.FreshSuppressed)++;
+						continue;
+					}
+					for (uint32 Clone = 0; Clone < 3; ++Clone)
+					{
+						const uint64 Input = *Received.GetPointerToElement(Clone);
+						if (Input != 0 && DeliveredAt[Input - 1] < 0)
+						{
+							DeliveredAt[Input - 1] = Now;
+						}
+					}
+				}
+			}
+			while (Out == Capacity);
+		}
+
+		for (int64 Input = 0; Input < Cycles; ++Input)
+		{
+			if (DeliveredAt[Input] >= 0)
+			{
+				Result.LatencyMillis.Add((DeliveredAt[Input] - Input * Interval) * 1000.0);
+			}
+		}
+		Result.LatencyMillis.Sort();
+		const FBristleconeImpairment::FStats& Stats = Impairment.Stats;
+		Result.Admitted = Stats.Admitted;
+		Result.Dropped = Stats.Dropped;
+		Result.Duplicated = Stats.Duplicated;
+		Result.Reordered = Stats.Reordered;
+		Result.Released = Stats.Released;
+		Result.Overflowed = Stats.Overflowed;
+		return Result;
+	}
+
+	static double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		return Sorted.IsEmpty() ? 0 : Sorted[FMath::Min(Sorted.Num() - 1, static_cast<int32>(Sorted.Num() * Fraction))];
+	}
+
+	static FBristleconeImpairmentPhase Phase(float Seconds, float Base, float Spread, float Loss, float Burst,
+		float Reorder = 0, float ReorderMs = 0, float Duplicate = 0)
+	{
+		FBristleconeImpairmentPhase Made;
+		Made.duration_seconds = Seconds;
+		Made.base_latency_ms = Base;
+		Made.latency_spread_ms = Spread;
+		Made.latency_shape = EBristleconeLatencyShape::Exponential;
+		Made.loss_percent = Loss;
+		Made.mean_burst_length = Burst;
+		Made.reorder_percent = Reorder;
+		Made.reorder_ms = ReorderMs;
+		Made.duplicate_percent = Duplicate;
+		return Made;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBristleconeImpairmentBenchmark, "Bristlecone.Benchmark.Impairment",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBristleconeImpairmentBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace ImpairmentBench;
+	//ten minutes a run.
+	constexpr double Seconds = 600;
+	constexpr int32 Seed = 0x5EED;
+	struct FProfile
+	{
+		const TCHAR* Name;
+		TArray<FBristleconeImpairmentPhase> Script;
+	};
+	const FProfile Profiles[] = {
+		{TEXT("clean"), {Phase(0, 30, 5, 0, 1)}},
+		{TEXT("2% loss"), {Phase(0, 30, 10, 2, 1)}},
+		{TEXT("5% loss in bursts of 4"), {Phase(0, 40, 15, 5, 4)}},
+		//ten good seconds, then two bad ones: a spike with bursty loss, reordering, and duplicates.
+		{TEXT("spiky wifi"), {Phase(10, 20, 5, 1, 1), Phase(2, 120, 60, 10, 3, 5, 30, 2)}},
+	};
+
+	for (const FProfile& Profile : Profiles)
+	{
+		for (const int32 Copies : {1, 2, 3})
+		{
+			for (const int32 SendEvery : {1, 3})
+			{
+				const FResult Result = Run(Profile.Script, Seed, Copies, SendEvery, Seconds);
+				const int64 Delivered = Result.LatencyMillis.Num();
+				AddInfo(FString::Printf(
+					TEXT("%s, %d copies, every %d: latency p50 %.1fms p99 %.1fms p99.9 %.1fms | inputs lost %.3f%% | datagrams dropped %.2f%% reordered %llu | dedup %lld of %lld redundant, %lld fresh too old | impairment %.0fns a datagram"),
+					Profile.Name, Copies, SendEvery,
+					Percentile(Result.LatencyMillis, 0.5), Percentile(Result.LatencyMillis, 0.99), Percentile(Result.LatencyMillis, 0.999),
+					100.0 * (Result.Inputs - Delivered) / FMath::Max<int64>(Result.Inputs, 1),
+					100.0 * Result.Dropped / FMath::Max<uint64>(Result.Admitted, 1), Result.Reordered,
+					Result.RedundantSuppressed, Result.Redundant, Result.FreshSuppressed,
+					Result.ImpairmentSeconds * 1e9 / FMath::Max<uint64>(Result.Admitted, 1)));
+
+				const FString Case = FString::Printf(TEXT("%s, %d copies, every %d"), Profile.Name, Copies, SendEvery);
+				//everything that went in either came out, was dropped, or overflowed, and nothing's left held.
+				TestEqual(Case + TEXT(": every datagram is accounted for"), Result.Admitted - Result.Dropped + Result.Duplicated,
+					Result.Released + Result.Overflowed);
+				TestEqual(Case + TEXT(": everything sent went through the impairment"), static_cast<int64>(Result.Admitted), Result.DatagramsSent);
+				TestEqual(Case + TEXT(": every redundant copy is suppressed"), Result.RedundantSuppressed, Result.Redundant);
+				if (Profile.Script[0].loss_percent == 0)
+				{
+					TestEqual(Case + TEXT(": a clean link loses no input"), Delivered, Result.Inputs);
+				}
+			}
+		}
+	}
+
+	//same seed, same script, same run, datagram for datagram.
+	const FResult First = Run(Profiles[3].Script, Seed, 2, 1, 60);
+	const FResult Again = Run(Profiles[3].Script, Seed, 2, 1, 60);
+	TestTrue(TEXT("the same seed gives the same run"), First.LatencyMillis == Again.LatencyMillis && First.Dropped == Again.Dropped
+		&& First.Reordered == Again.Reordered && First.Duplicated == Again.Duplicated);
+	return true;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FBristleconePacketCodec.h"
+#include "FControllerState.h"
+#include "HAL/PlatformTime.h"
+
+//the codec is pure, so all of this runs anywhere, no sockets. the fuzz is round trips of both made up and realistic
+//packets, plus decodes of garbage and of damaged encodings, which have to fail cleanly or decode to something, never
+//read past the end. run it under asan to make that last part mean something.
+namespace PacketCodecTest
+{
+	typedef FBristleconePacketCodec<FControllerState, 3> FCodec;
+	typedef FCodec::PacketType FPacket;
+
+	static uint64 CloneOf(const FPacket& Packet, uint32 Index)
+	{
+		return Packet.GetPointerToElement(Index)->controller_arr;
+	}
+
+	static bool Same(const FPacket& A, const FPacket& B)
+	{
+		if (A.GetTransferTime() != B.GetTransferTime() || A.GetCycleMeta() != B.GetCycleMeta())
+		{
+			return false;
+		}
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			if (CloneOf(A, i) != CloneOf(B, i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static uint64 RandomWord(FRandomStream& Random)
+	{
+		return static_cast<uint64>(Random.GetUnsignedInt()) << 32 | Random.GetUnsignedInt();
+	}
+
+	//what a player actually sends: mostly the same input as last cycle, sometimes a stick drifts or a button goes.
+	class FInputs
+	{
+	public:
+		explicit FInputs(int32 Seed) : Random(Seed) {}
+
+		uint64 Next()
+		{
+			const int32 Roll = Random.RandRange(0, 99);
+			if (Roll >= 70 && Roll < 95)
+			{
+				Input ^= static_cast<uint64>(Random.RandRange(1, 255)) << (Random.RandRange(0, 7) * 8);
+			}
+			else if (Roll >= 95)
+			{
+				Input = RandomWord(Random);
+			}
+			return Input;
+		}
+
+		FRandomStream Random;
+
+	private:
+		uint64 Input = 0;
+	};
+
+	//a send time ~11ms after the last, kept under a long even where that's 32 bits.
+	static long TimeOf(int32 Cycle)
+	{
+		return static_cast<long>(1000000 + static_cast<int64>(Cycle) * 11111 % 1000000000);
+	}
+
+	//a ring of clones the way the sender builds it. transfer time and cycle are forced, so runs repeat.
+	static uint32 Fill(FBristleconePacketContainer<FControllerState, 3>& Container, uint64 Input, long Time, long Cycle)
+	{
+		FControllerState State;
+		State.controller_arr = Input;
+		Container.InsertNewDatagram(&State);
+		Container.GetPacket()->UpdateTransferTime(Time);
+		Container.GetPacket()->UpdateCycleOrMeta(Cycle);
+		return Container.GetNewestIndex();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBristleconePacketCodecFuzzTest, "Bristlecone.PacketCodec.Fuzz",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBristleconePacketCodecFuzzTest::RunTest(const FString& Parameters)
+{
+	using namespace PacketCodecTest;
+	constexpr int32 Rounds = 200000;
+	uint8 Wire[FCodec::MAX_WIRE_SIZE];
+	FPacket Decoded;
+	int32 Failures = 0;
+
+	//anything at all: every clone, the slot, and both headers random, including negative and huge times.
+	FRandomStream Random(0xC0DEC);
+	for (int32 Round = 0; Round < Rounds && Failures < 10; ++Round)
+	{
+		FPacket Packet;
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			Packet.GetPointerToElement(i)->controller_arr = Random.RandRange(0, 3) == 0 ? 0 : RandomWord(Random);
+		}
+		Packet.UpdateTransferTime(static_cast<long>(RandomWord(Random)));
+		Packet.UpdateCycleOrMeta(static_cast<long>(Random.RandRange(0, 1) ? RandomWord(Random) : Random.RandRange(-300, 300)));
+		const uint32 Newest = Random.RandRange(0, 2);
+		const int32 Size = FCodec::Encode(Packet, Newest, Wire);
+		if (Size <= 0 || Size > FCodec::MAX_WIRE_SIZE || !FCodec::Decode(Wire, Size, Decoded) || !Same(Packet, Decoded))
+		{
+			AddError(FString::Printf(TEXT("random packet %d didn't round trip, %d bytes: %s"), Round, Size, *Packet.ToString()));
+			++Failures;
+		}
+	}
+
+	//realistic streams, which should almost always encode smaller than raw.
+	FInputs Inputs(0x1A7E);
+	FBristleconePacketContainer<FControllerState, 3> Container;
+	int32 Raw = 0;
+	for (int32 Round = 0; Round < Rounds && Failures < 10; ++Round)
+	{
+		const uint32 Newest = Fill(Container, Inputs.Next(), TimeOf(Round), Round);
+		const int32 Size = FCodec::Encode(*Container.GetPacket(), Newest, Wire);
+		Raw += Size == FCodec::RAW_SIZE ? 1 : 0;
+		if (!FCodec::Decode(Wire, Size, Decoded) || !Same(*Container.GetPacket(), Decoded))
+		{
+			AddError(FString::Printf(TEXT("realistic packet %d didn't round trip, %d bytes: %s"), Round, Size, *Container.GetPacket()->ToString()));
+			++Failures;
+		}
+	}
+	TestTrue(TEXT("realistic input almost never falls back to raw"), Raw < Rounds / 100);
+
+	//garbage. no expectations but not crashing, and not reading past size.
+	for (int32 Round = 0; Round < Rounds; ++Round)
+	{
+		const int32 Size = Random.RandRange(0, FCodec::MAX_WIRE_SIZE);
+		for (int32 i = 0; i < Size; ++i)
+		{
+			Wire[i] = static_cast<uint8>(Random.RandRange(0, 255));
+		}
+		//half of them look like ours, so they get past the tag check.
+		if (Size > 0 && Random.RandRange(0, 1))
+		{
+			Wire[0] = FCodec::CODEC_TAG | (Wire[0] & 0x3);
+		}
+		FCodec::Decode(Wire, Size, Decoded);
+	}
+
+	//damaged encodings: truncated, extended, or with a bit flipped. a truncated or extended encoding can't decode, since
+	//the codec always knows exactly how long it should be. the only exception is landing on the raw size.
+	for (int32 Round = 0; Round < Rounds && Failures < 10; ++Round)
+	{
+		const uint32 Newest = Fill(Container, Inputs.Next(), TimeOf(Round), Round);
+		int32 Size = FCodec::Encode(*Container.GetPacket(), Newest, Wire);
+		if (Size == FCodec::RAW_SIZE)
+		{
+			continue;
+		}
+		switch (Random.RandRange(0, 2))
+		{
+		case 0:
+			Size = Random.RandRange(0, Size - 1);
+			break;
+		case 1:
+			Wire[Size] = static_cast<uint8>(Random.RandRange(0, 255));
+			++Size;
+			break;
+		default:
+			{
+				const int32 Bit = Random.RandRange(0, Size * 8 - 1);
+				Wire[Bit / 8] ^= static_cast<uint8>(1u << (Bit % 8));
+				FCodec::Decode(Wire, Size, Decoded);
+			}
+			continue;
+		}
+		if (Size != FCodec::RAW_SIZE && FCodec::Decode(Wire, Size, Decoded))
+		{
+			AddError(FString::Printf(TEXT("damaged encoding %d of %d bytes decoded anyway"), Round, Size));
+			++Failures;
+		}
+	}
+	return Failures == 0;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBristleconePacketCodecBenchmark, "Bristlecone.Benchmark.PacketCodec",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBristleconePacketCodecBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace PacketCodecTest;
+	constexpr int32 Packets = 1 << 20;
+	//built up front, so the timing is just the codec.
+	TArray<FPacket> Stream;
+	TArray<uint32> Newest;
+	Stream.SetNum(Packets);
+	Newest.SetNum(Packets);
+	FInputs Inputs(0xBE7C4);
+	FBristleconePacketContainer<FControllerState, 3> Container;
+	for (int32 i = 0; i < Packets; ++i)
+	{
+		Newest[i] = Fill(Container, Inputs.Next(), TimeOf(i), i);
+		Stream[i] = *Container.GetPacket();
+	}
+
+	TArray<uint8> Wire;
+	TArray<int32> Sizes;
+	Wire.SetNumUninitialized(Packets * FCodec::MAX_WIRE_SIZE);
+	Sizes.SetNumUninitialized(Packets);
+	int64 Bytes = 0;
+	double Start = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Packets; ++i)
+	{
+		Sizes[i] = FCodec::Encode(Stream[i], Newest[i], Wire.GetData() + i * FCodec::MAX_WIRE_SIZE);
+		Bytes += Sizes[i];
+	}
+	const double EncodeSeconds = FPlatformTime::Seconds() - Start;
+
+	FPacket Decoded;
+	int32 Bad = 0;
+	Start = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Packets; ++i)
+	{
+		Bad += FCodec::Decode(Wire.GetData() + i * FCodec::MAX_WIRE_SIZE, Sizes[i], Decoded) ? 0 : 1;
+	}
+	const double DecodeSeconds = FPlatformTime::Seconds() - Start;
+
+	//udp over ipv4 adds 28 bytes of headers to every datagram, so that's what it's worth on the wire.
+	const double Average = static_cast<double>(Bytes) / Packets;
+	AddInfo(FString::Printf(TEXT("%.2f bytes a packet against %d raw (%.0f%%, %.0f%% with ip/udp headers), encode %.1fns, decode %.1fns"),
+		Average, FCodec::RAW_SIZE, 100.0 * Average / FCodec::RAW_SIZE, 100.0 * (Average + 28) / (FCodec::RAW_SIZE + 28),
+		EncodeSeconds * 1e9 / Packets, DecodeSeconds * 1e9 / Packets));
+	TestEqual(TEXT("every packet decodes"), Bad, 0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FBristleconeReceiver.h"
+#include "FBristleconeSender.h"
+#include "Common/UdpSocketBuilder.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+
+//End to end latency through a relay as the peer count grows. Every peer is a full sender and receiver, each with its
+//own threads and loopback socket, sending an input a tick at 90hz to one relay. The relay forwards each input to every
+//other peer. Latency is from the sender stamping the packet to the receiver handing it on, read off the receiver's own
+//LogOnReceive timestamps, so it's the whole path: sender wake, encode, relay, envelope, decode, dedup.
+//
+//The peers share a process, not one each. Spawning an editor per peer would mostly time the editor's boot. Nothing on
+//the path is shared between peers but the kernel, same as it would be across processes.
+namespace RelayLatencyBench
+{
+	constexpr int32 InputsPerPeer = 180;
+
+	static TSharedPtr<FSocket, ESPMode::ThreadSafe> OpenLoopback(const TCHAR* Name)
+	{
+		return MakeShareable(FUdpSocketBuilder(Name).AsNonBlocking()
+			.BoundToEndpoint(FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), 0))
+			.WithReceiveBufferSize(1 << 20).WithSendBufferSize(1 << 20).Build());
+	}
+
+	struct FNode
+	{
+		TSharedPtr<FSocket, ESPMode::ThreadSafe> Socket;
+		FIPv4Endpoint Endpoint;
+		FBristleconeReceiver Receiver;
+		FBristleconeSender Sender;
+		TheCone::SendQueue Inputs = MakeShareable(new TheCone::IncQ(256));
+		TheCone::TimestampQueue Latency = MakeShareable(new TheCone::TimestampQ(4096));
+		FSharedEventRef Wake;
+		TUniquePtr<FRunnableThread> ReceiverThread;
+		TUniquePtr<FRunnableThread> SenderThread;
+		//per stream, how many inputs it handed on.
+		TArray<int32> Delivered;
+
+		explicit FNode(const TCHAR* Name) : Socket(OpenLoopback(Name))
+		{
+			if (Socket)
+			{
+				Endpoint = FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), Socket->GetPortNo());
+				Receiver.SetLocalSocket(Socket);
+				Receiver.BindStatsSink(Latency);
+				Receiver.LogOnReceive = true;
+			}
+		}
+
+		void Start(bool Sends)
+		{
+			ReceiverThread.Reset(FRunnableThread::Create(&Receiver, TEXT("Bristlecone.Bench.Receiver")));
+			if (Sends)
+			{
+				Sender.SetLocalSockets(Socket, Socket, Socket);
+				Sender.BindSource(Inputs);
+				Sender.SetWakeSender(Wake);
+				SenderThread.Reset(FRunnableThread::Create(&Sender, TEXT("Bristlecone.Bench.Sender")));
+			}
+		}
+
+		void Drain(TArray<double>& Micros)
+		{
+			while (!Latency->IsEmpty())
+			{
+				Micros.Add(Latency->Peek()->first);
+				Latency->Dequeue();
+			}
+			Delivered.SetNum(Receiver.GetStreamCount());
+			for (int32 Stream = 0; Stream < Delivered.Num(); ++Stream)
+			{
+				const TheCone::RecvQueue Queue = Receiver.GetStream(Stream);
+				while (!Queue->IsEmpty())
+				{
+					++Delivered[Stream];
+					Queue->Dequeue();
+				}
+			}
+		}
+
+		~FNode()
+		{
+			//same as the subsystem: stop the threads, then close, and let the shared pointer delete it.
+			if (SenderThread)
+			{
+				SenderThread->Kill(false);
+				Wake->Trigger();
+				SenderThread->WaitForCompletion();
+			}
+			if (ReceiverThread)
+			{
+				ReceiverThread->Kill(true);
+			}
+			if (Socket)
+			{
+				Socket->Close();
+			}
+		}
+	};
+
+	static double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		return Sorted.IsEmpty() ? 0 : Sorted[FMath::Min(Sorted.Num() - 1, static_cast<int32>(Sorted.Num() * Fraction))];
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBristleconeRelayLatencyBenchmark, "Bristlecone.Benchmark.RelayLatency",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBristleconeRelayLatencyBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace RelayLatencyBench;
+	const double Interval = 1.0 / TheCone::BristleconeSendHertz;
+	for (const int32 PeerCount : {2, 4, 8, 16})
+	{
+		FNode Relay(TEXT("Bristlecone.Bench.Relay"));
+		TArray<TUniquePtr<FNode>> Peers;
+		TArray<FIPv4Endpoint> Endpoints;
+		for (int32 i = 0; i < PeerCount; ++i)
+		{
+			Peers.Add(MakeUnique<FNode>(TEXT("Bristlecone.Bench.Peer")));
+			Endpoints.Add(Peers.Last()->Endpoint);
+			if (!TestTrue(TEXT("loopback sockets open"), Relay.Socket.IsValid() && Peers.Last()->Socket.IsValid()))
+			{
+				return false;
+			}
+		}
+		Relay.Receiver.SetPeers(Endpoints, {});
+		Relay.Receiver.SetRelayMode(true);
+		Relay.Start(false);
+		for (const TUniquePtr<FNode>& Peer : Peers)
+		{
+			Peer->Sender.AddTargetAddress(Relay.Endpoint.ToString(), TheCone::SEND_ON_HIGH);
+			Peer->Receiver.SetPeers({Relay.Endpoint}, {Relay.Endpoint});
+			Peer->Start(true);
+		}
+
+		TArray<double> Micros;
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Tick = 0; Tick < InputsPerPeer; ++Tick)
+		{
+			for (int32 i = 0; i < PeerCount; ++i)
+			{
+				Peers[i]->Inputs->Enqueue(static_cast<uint64>(i) << 32 | Tick);
+				Peers[i]->Wake->Trigger();
+			}
+			for (const TUniquePtr<FNode>& Peer : Peers)
+			{
+				Peer->Drain(Micros);
+			}
+			FPlatformProcess::Sleep(FMath::Max(0.0, Start + (Tick + 1) * Interval - FPlatformTime::Seconds()));
+		}
+		//the last tick's inputs are still in flight.
+		FPlatformProcess::Sleep(0.1f);
+		int64 Delivered = 0;
+		for (const TUniquePtr<FNode>& Peer : Peers)
+		{
+			Peer->Drain(Micros);
+			TestEqual(FString::Printf(TEXT("with %d peers, each gets a stream per other peer"), PeerCount),
+				Peer->Receiver.GetStreamCount(), PeerCount - 1);
+			for (int32 Stream = 0; Stream < Peer->Delivered.Num(); ++Stream)
+			{
+				FIPv4Endpoint From;
+				Peer->Receiver.GetStream(Stream, &From);
+				TestTrue(FString::Printf(TEXT("with %d peers, streams are from other peers"), PeerCount),
+					From != Peer->Endpoint && Endpoints.Contains(From));
+				Delivered += Peer->Delivered[Stream];
+			}
+		}
+		Micros.Sort();
+		const int64 Expected = static_cast<int64>(PeerCount) * (PeerCount - 1) * InputsPerPeer;
+		AddInfo(FString::Printf(TEXT("%d peers: one way p50 %.0fus p99 %.0fus max %.0fus | %lld of %lld inputs delivered, relay took in %llu"),
+			PeerCount, Percentile(Micros, 0.5), Percentile(Micros, 0.99), Micros.IsEmpty() ? 0 : Micros.Last(),
+			Delivered, Expected, Relay.Receiver.PacketsDelivered.load()));
+		//loopback with room in every buffer. a missing input means the demux or the relay lost it.
+		TestEqual(FString::Printf(TEXT("with %d peers, every input reaches every other peer once"), PeerCount), Delivered, Expected);
+		//peers go before the relay, so nothing is still sending to it when it closes.
+		Peers.Empty();
+	}
+	return true;
+}
+
+#endif
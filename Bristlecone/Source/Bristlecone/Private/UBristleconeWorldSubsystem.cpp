@@ -18,8 +18,22 @@ bool UBristleconeWorldSubsystem::RegistrationImplementation()
 	//TODO @maslabgamer: does this leak memory?
 	const UBristleconeConstants* ConfigVals = GetDefault<UBristleconeConstants>();
 	LogOnReceive = ConfigVals->log_receive_c;
-	FString address = ConfigVals->default_address_c.IsEmpty() ? "34.207.0.66" : ConfigVals->default_address_c;
-	sender_runner.AddTargetAddress(address);
+	if (ConfigVals->peers_c.IsEmpty())
+	{
+		FString address = ConfigVals->default_address_c.IsEmpty() ? "34.207.0.66" : ConfigVals->default_address_c;
+		sender_runner.AddTargetAddress(address);
+	}
+	TArray<FIPv4Endpoint> Relays;
+	for (const FBristleconePeerConfig& Peer : ConfigVals->peers_c)
+	{
+		const uint8 Sockets = (Peer.send_high ? SEND_ON_HIGH : 0) | (Peer.send_low ? SEND_ON_LOW : 0)
+			| (Peer.send_background ? SEND_ON_BACKGROUND : 0);
+		if (sender_runner.AddTargetAddress(Peer.address, Sockets, Peer.send_every) && Peer.relay)
+		{
+			Relays.Add(sender_runner.GetTargetEndpoints().Last());
+		}
+	}
+	UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Sending to %d targets."), sender_runner.GetTargetCount());
 	UE_LOG(LogTemp, Warning,
 	       TEXT("BCN will not start unless another subsystem creates and binds queues during PostInitialize."));
 	UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Subsystem world initialized"));
@@ -60,12 +74,14 @@ bool UBristleconeWorldSubsystem::RegistrationImplementation()
 	}
 
 	local_endpoint = FIPv4Endpoint(FIPv4Address::Any, DEFAULT_PORT);
+	//every peer's clones land on, and relays leave from, the same sockets, so the buffers scale with the peers.
+	const int32 BufferedPackets = 25 * FMath::Max(1, sender_runner.GetTargetCount());
 	FUdpSocketBuilder socket_factory = FUdpSocketBuilder(TEXT("Bristlecone.Receiver.Socket"))
 	                                   .AsNonBlocking()
 	                                   .AsReusable()
 	                                   .BoundToEndpoint(local_endpoint)
-	                                   .WithReceiveBufferSize(CONTROLLER_STATE_PACKET_SIZE * 25)
-	                                   .WithSendBufferSize(CONTROLLER_STATE_PACKET_SIZE * 25);
+	                                   .WithReceiveBufferSize(CONTROLLER_STATE_PACKET_SIZE * BufferedPackets)
+	                                   .WithSendBufferSize(CONTROLLER_STATE_PACKET_SIZE * BufferedPackets);
 	socketHigh = MakeShareable(socket_factory.Build());
 	socketLow = MakeShareable(socket_factory.Build());
 	socketBackground = MakeShareable(socket_factory.Build());
@@ -75,6 +91,8 @@ bool UBristleconeWorldSubsystem::RegistrationImplementation()
 	//TODO: refactor this to allow proper data driven construction.
 	sender_runner.BindSource(QueueToSend);
 	sender_runner.SetLocalSockets(socketHigh, socketLow, socketBackground);
+	//a relay's peers read everything from it as an envelope, its own input included.
+	sender_runner.SetWrapAsRelay(ConfigVals->relay_mode_c);
 	sender_runner.ActivateDSCP();
 	sender_thread.Reset(FRunnableThread::Create(&sender_runner, TEXT("Bristlecone.Sender")));
 
@@ -84,6 +102,21 @@ bool UBristleconeWorldSubsystem::RegistrationImplementation()
 	receiver_runner.LogOnReceive = LogOnReceive;
 	receiver_runner.SetLocalSocket(socketHigh);
 	receiver_runner.BindSink(QueueOfReceived);
+	//every peer, and everyone behind a relay, gets their own stream. QueueOfReceived is whichever's first.
+	receiver_runner.SetPeers(sender_runner.GetTargetEndpoints(), Relays);
+	if (ConfigVals->relay_mode_c)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Relay mode. Forwarding between %d peers."), sender_runner.GetTargetCount());
+		receiver_runner.SetRelayMode(true);
+	}
+#if !UE_BUILD_SHIPPING
+	if (ConfigVals->impairment_enabled_c)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Simulating impairment. %d phases, seed %d."),
+		       ConfigVals->impairment_script_c.Num(), ConfigVals->impairment_seed_c);
+		receiver_runner.SetImpairment(ConfigVals->impairment_script_c, ConfigVals->impairment_seed_c);
+	}
+#endif
 
 	receiver_thread.Reset(FRunnableThread::Create(&receiver_runner, TEXT("Bristlecone.Receiver")));
 
@@ -116,6 +149,17 @@ void UBristleconeWorldSubsystem::Deinitialize()
 	{
 		receiver_thread->Kill();
 	}
+	if (const FBristleconeImpairment* Impairment = receiver_runner.GetImpairment())
+	{
+		//what the run looked like, so a send rate or clone count can be judged against it.
+		const FBristleconeImpairment::FStats& Stats = Impairment->Stats;
+		UE_LOG(LogTemp, Warning,
+		       TEXT("Bristlecone:Subsystem: Impairment admitted %llu, dropped %llu, duplicated %llu, reordered %llu, released %llu, overflowed %llu."),
+		       Stats.Admitted.load(), Stats.Dropped.load(), Stats.Duplicated.load(), Stats.Reordered.load(),
+		       Stats.Released.load(), Stats.Overflowed.load());
+		UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Delivered %llu packets, suppressed %llu duplicates."),
+		       receiver_runner.PacketsDelivered.load(), receiver_runner.DuplicatesSuppressed.load());
+	}
 
 	if (socketHigh.IsValid())
 	{
@@ -175,6 +219,16 @@ void UBristleconeWorldSubsystem::Tick(float DeltaTime)
 	//UE_LOG(LogTemp, Warning, TEXT("Bristlecone:Subsystem: Subsystem world ticked"));
 }
 
+int32 UBristleconeWorldSubsystem::GetPeerStreamCount() const
+{
+	return receiver_runner.GetStreamCount();
+}
+
+TheCone::RecvQueue UBristleconeWorldSubsystem::GetPeerStream(int32 Index, FIPv4Endpoint& From) const
+{
+	return receiver_runner.GetStream(Index, &From);
+}
+
 TStatId UBristleconeWorldSubsystem::GetStatId() const
 {
 	RETURN_QUICK_DECLARE_CYCLE_STAT(UFBristleconeWorldSubsystem, STATGROUP_Tickables);
@@ -5,6 +5,8 @@
 
 #include "CoreMinimal.h"
 #include "FBristleconePacket.h"
+#include "FBristleconePacketCodec.h"
+#include "FBristleconeRelayEnvelope.h"
 #include "FFastBitTracker.h"
 #include "UnsignedNarrowTime.h"
 #include "FControllerState.h"
@@ -16,6 +18,7 @@
 namespace TheCone {
 	typedef uint64_t PacketElement;
 	typedef FBristleconePacket<PacketElement, 3> Packet_tpl;
+	typedef FBristleconePacketCodec<PacketElement, 3> PacketCodec;
 	typedef std::pair<uint32_t, long> CycleTimestamp;
 	typedef TCircularQueue<Packet_tpl> PacketQ;
 	typedef TCircularQueue<PacketElement> IncQ;
@@ -39,9 +42,18 @@ namespace TheCone {
 
 	static constexpr int CONTROLLER_STATE_PACKET_SIZE = sizeof(FControllerStatePacket);
 	static constexpr int DEFAULT_PORT = 40000;
-	static constexpr uint16 MAX_TARGET_COUNT = 1;
+	static constexpr uint16 MAX_TARGET_COUNT = 16;
+	//a received datagram is at most a packet, raw or encoded, in a relay envelope.
+	static constexpr int32 MAX_DATAGRAM_SIZE = PacketCodec::MAX_WIRE_SIZE + FBristleconeRelayEnvelope::HEADER_SIZE;
+	//which of the three sockets a target gets its clones on.
+	static constexpr uint8 SEND_ON_HIGH = 1 << 0;
+	static constexpr uint8 SEND_ON_LOW = 1 << 1;
+	static constexpr uint8 SEND_ON_BACKGROUND = 1 << 2;
+	static constexpr uint8 SEND_ON_ALL = SEND_ON_HIGH | SEND_ON_LOW | SEND_ON_BACKGROUND;
 	static constexpr float SLEEP_TIME_BETWEEN_THREAD_TICKS = 0.008f;
 	static constexpr uint8 CLONE_SIZE = 3;
+	//every packet carries CLONE_SIZE inputs, so sending every CLONE_SIZEth packet is as thin as it gets without gaps.
+	static constexpr int32 MAX_SEND_EVERY = CLONE_SIZE;
 	static constexpr uint8 MAX_MIXED_CONSECUTIVE_PACKETS_ALLOWED = 100;
 
 	/*This class generalizes and defactors tracking the last K seen of a set. Right now, it's for cycles
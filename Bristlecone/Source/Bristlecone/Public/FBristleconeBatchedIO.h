@@ -0,0 +1,44 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Sockets.h"
+
+//Moves datagrams a batch at a time. On Linux, that's sendmmsg and recvmmsg, so a whole batch is one syscall, and the
+//wait is a poll on the native socket. Everywhere else, it's the same SendTo and RecvFrom loop we've always run, so
+//callers don't need to care which they got.
+//
+//This needs the native socket under the FSocket, so it has the same ugly dependency on the BSD socket internals that
+//ActivateDSCP does. Only hand it sockets from the platform socket subsystem.
+class FBristleconeBatchedIO
+{
+public:
+	//comfortably more than a tick's worth of clones to every endpoint, on every socket.
+	static constexpr int32 MaxBatch = 64;
+
+	struct FOutgoing
+	{
+		const uint8* Data = nullptr;
+		int32 Size = 0;
+		const FIPv4Endpoint* To = nullptr;
+	};
+
+	static constexpr bool IsNative()
+	{
+#if PLATFORM_LINUX
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//returns how many datagrams went out. batches bigger than MaxBatch are split.
+	static int32 Send(FSocket& Socket, TConstArrayView<FOutgoing> Batch);
+
+	//blocks until there's something to read or the timeout passes. true if there's something to read.
+	static bool WaitForRead(FSocket& Socket, FTimespan Timeout);
+
+	//reads up to Count datagrams without blocking, each into its own SlotSize slot of Slots, and writes each one's length
+	//to Sizes. anything that didn't fit its slot isn't one of ours, so it's dropped rather than handed back truncated.
+	//if From isn't null, each datagram's sender goes there too. returns how many were read.
+	static int32 Receive(FSocket& Socket, uint8* Slots, int32 SlotSize, int32* Sizes, int32 Count, FIPv4Endpoint* From = nullptr);
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "UBristleconeConstants.h"
+#include "BristleconeCommonTypes.h"
+#include <atomic>
+
+//A bad network, simulated, for datagrams we've already received. Everything that comes off the socket goes in, and
+//comes back out later, or twice, or not at all, according to a script of phases that loops. Latency is drawn per
+//datagram, so it reorders on its own once the spread is wider than the send interval; reorder_percent on top of that
+//holds single datagrams back so the ones behind them overtake. Loss comes in bursts, two state Gilbert-Elliott, sized so
+//the long run loss rate and the mean burst length are the two numbers in the phase.
+//
+//Everything random comes off one seeded stream, so the same seed and the same arrivals give the same result. Arrival
+//timing on a real socket isn't repeatable, so over loopback it's close rather than exact.
+//
+//Receiver thread only, apart from Stats.
+class FBristleconeImpairment
+{
+public:
+	//past this many held, new arrivals are dropped and counted as overflow. at 90hz, that's a very long delay.
+	static constexpr int32 MaxHeld = 4096;
+	static constexpr int32 MaxDatagramSize = TheCone::MAX_DATAGRAM_SIZE;
+
+	struct FStats
+	{
+		std::atomic<uint64> Admitted{0};
+		std::atomic<uint64> Dropped{0};
+		std::atomic<uint64> Duplicated{0};
+		//released behind something that arrived after it.
+		std::atomic<uint64> Reordered{0};
+		std::atomic<uint64> Released{0};
+		std::atomic<uint64> Overflowed{0};
+	};
+
+	FBristleconeImpairment(const TArray<FBristleconeImpairmentPhase>& InScript, int32 Seed);
+
+	//takes the Count datagrams laid out in Slots, the way FBristleconeBatchedIO::Receive leaves them, and replaces them
+	//with whatever held ones are due by Now, up to Capacity, laid out the same way. From can be null. returns how many.
+	int32 Pass(uint8* Slots, int32 SlotSize, int32* Sizes, FIPv4Endpoint* From, int32 Count, int32 Capacity, double Now);
+	//how long until the next held datagram is due. MaxValue if nothing's held.
+	FTimespan UntilNextRelease(double Now) const;
+
+	FStats Stats;
+
+private:
+	struct FHeld
+	{
+		double ReleaseAt = 0;
+		uint64 Sequence = 0;
+		FIPv4Endpoint From;
+		int32 Size = 0;
+		uint8 Data[MaxDatagramSize];
+	};
+
+	static bool Sooner(const FHeld& A, const FHeld& B)
+	{
+		return A.ReleaseAt < B.ReleaseAt || (A.ReleaseAt == B.ReleaseAt && A.Sequence < B.Sequence);
+	}
+
+	const FBristleconeImpairmentPhase& PhaseAt(double Now);
+	void Admit(const uint8* Data, int32 Size, const FIPv4Endpoint& From, double Now);
+	bool Lose(const FBristleconeImpairmentPhase& Phase);
+	double DelayFor(const FBristleconeImpairmentPhase& Phase);
+
+	TArray<FBristleconeImpairmentPhase> Script;
+	//one pass through the script, or 0 if some phase lasts forever.
+	double LoopSeconds = 0;
+	double StartedAt = -1;
+	FRandomStream Random;
+	//a heap, soonest first.
+	TArray<FHeld> Held;
+	uint64 NextSequence = 0;
+	uint64 HighestReleased = 0;
+	bool InBurst = false;
+};
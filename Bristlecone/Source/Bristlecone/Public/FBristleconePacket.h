@@ -40,6 +40,11 @@ public:
 		return packet.GetTransferTime();
 	}
 
+	//the slot the last InsertNewDatagram wrote.
+	uint32 GetNewestIndex() const {
+		return (clone_state_ring_index + CLONE_SIZE - 1) % CLONE_SIZE;
+	}
+
 private:
 	uint32 clone_state_ring_index;
 	FBristleconePacket<CLONE_TYPE, CLONE_SIZE> packet;
@@ -89,6 +94,10 @@ public:
 		return &clone_array[element_index];
 	}
 
+	const CLONE_TYPE* GetPointerToElement(uint32 element_index) const {
+		return &clone_array[element_index];
+	}
+
 	FString ToString() const {
 		FString output;// = FString::Printf(TEXT("Transfer time = %s, array = "), *transfer_time.ToString());
 		output += FString::Printf(TEXT("Transfer time = %lld"), transfer_time);
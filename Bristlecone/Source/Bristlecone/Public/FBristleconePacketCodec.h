@@ -0,0 +1,172 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FBristleconePacket.h"
+
+/**
+ * Packs a Bristlecone packet down before it goes on the wire. The clones in a packet are the same input a few cycles
+ * apart, and packed inputs barely change cycle to cycle, so sending all of them raw is mostly sending the same bits
+ * three times.
+ *
+ * Wire format, all little endian:
+ *   1 byte   header. high nibble is the codec tag, low two bits are the slot the newest clone sits in.
+ *   varint   transfer_time, zigzagged.
+ *   varint   cycle_metadata, zigzagged.
+ *   8 bytes  the newest clone, in full.
+ *   then, for each older clone, newest first, that clone XORed with the one after it, as one byte saying which bytes
+ *   of the XOR aren't zero, followed by just those bytes. An unchanged input costs one byte.
+ *
+ * If that somehow comes out no smaller than the raw packet, the raw packet goes instead. Raw packets are exactly
+ * sizeof(FBristleconePacket) and encoded ones are always smaller, so the size alone says which is which, and old
+ * senders still interoperate.
+ *
+ * Decoding puts every clone back in the slot it came from, so nothing downstream can tell the difference.
+ *
+ * @tparam CLONE_TYPE must be 8 bytes and trivially copyable. the packed inputs are.
+ * @tparam CLONE_SIZE at most 4, since the newest slot gets two bits.
+ */
+template<
+	typename CLONE_TYPE,
+	unsigned int CLONE_SIZE>
+class FBristleconePacketCodec {
+public:
+	typedef FBristleconePacket<CLONE_TYPE, CLONE_SIZE> PacketType;
+
+	static_assert(sizeof(CLONE_TYPE) == sizeof(uint64), "the codec deltas whole 64 bit inputs.");
+	static_assert(CLONE_SIZE >= 1 && CLONE_SIZE <= 4, "the newest slot has to fit in two bits.");
+
+	static constexpr uint8 CODEC_TAG = 0xB0;
+	static constexpr uint8 TAG_MASK = 0xF0;
+	static constexpr int32 MAX_VARINT_SIZE = 10;
+	static constexpr int32 RAW_SIZE = sizeof(PacketType);
+	static constexpr int32 MAX_ENCODED_SIZE = 1 + 2 * MAX_VARINT_SIZE + 8 + (CLONE_SIZE - 1) * 9;
+	//big enough for either form.
+	static constexpr int32 MAX_WIRE_SIZE = MAX_ENCODED_SIZE > RAW_SIZE ? MAX_ENCODED_SIZE : RAW_SIZE;
+
+	//writes the packet into out, which must hold MAX_WIRE_SIZE bytes, and returns how many bytes to send.
+	static int32 Encode(const PacketType& packet, uint32 newest_index, uint8* out) {
+		uint8 scratch[MAX_ENCODED_SIZE];
+		uint8* write = scratch;
+		*write++ = CODEC_TAG | static_cast<uint8>(newest_index & 0x3);
+		write = WriteVarint(write, ZigZag(packet.GetTransferTime()));
+		write = WriteVarint(write, ZigZag(packet.GetCycleMeta()));
+
+		uint64 newer = ReadClone(packet, newest_index);
+		for (int32 byte = 0; byte < 8; ++byte) {
+			*write++ = static_cast<uint8>(newer >> (byte * 8));
+		}
+		for (uint32 age = 1; age < CLONE_SIZE; ++age) {
+			const uint64 older = ReadClone(packet, (newest_index + CLONE_SIZE - age) % CLONE_SIZE);
+			const uint64 delta = older ^ newer;
+			uint8* mask = write++;
+			*mask = 0;
+			for (int32 byte = 0; byte < 8; ++byte) {
+				const uint8 value = static_cast<uint8>(delta >> (byte * 8));
+				if (value != 0) {
+					*mask |= static_cast<uint8>(1u << byte);
+					*write++ = value;
+				}
+			}
+			newer = older;
+		}
+
+		const int32 encoded_size = static_cast<int32>(write - scratch);
+		if (encoded_size >= RAW_SIZE) {
+			memcpy(out, &packet, RAW_SIZE);
+			return RAW_SIZE;
+		}
+		memcpy(out, scratch, encoded_size);
+		return encoded_size;
+	}
+
+	//false if it isn't a packet we could have sent, in which case packet is left in an unspecified state.
+	static bool Decode(const uint8* data, int32 size, PacketType& packet) {
+		if (size == RAW_SIZE) {
+			memcpy(&packet, data, RAW_SIZE);
+			return true;
+		}
+		if (size < 1 + 2 + 8 || size > RAW_SIZE || (data[0] & TAG_MASK) != CODEC_TAG) {
+			return false;
+		}
+		const uint8* read = data + 1;
+		const uint8* end = data + size;
+		const uint32 newest_index = data[0] & 0x3;
+		if (newest_index >= CLONE_SIZE) {
+			return false;
+		}
+
+		uint64 transfer_time = 0;
+		uint64 cycle_metadata = 0;
+		if (!ReadVarint(read, end, transfer_time) || !ReadVarint(read, end, cycle_metadata) || end - read < 8) {
+			return false;
+		}
+		packet.UpdateTransferTime(static_cast<long>(UnZigZag(transfer_time)));
+		packet.UpdateCycleOrMeta(static_cast<long>(UnZigZag(cycle_metadata)));
+
+		uint64 newer = 0;
+		for (int32 byte = 0; byte < 8; ++byte) {
+			newer |= static_cast<uint64>(*read++) << (byte * 8);
+		}
+		WriteClone(packet, newest_index, newer);
+		for (uint32 age = 1; age < CLONE_SIZE; ++age) {
+			if (read >= end) {
+				return false;
+			}
+			const uint8 mask = *read++;
+			uint64 delta = 0;
+			for (int32 byte = 0; byte < 8; ++byte) {
+				if (mask & (1u << byte)) {
+					if (read >= end) {
+						return false;
+					}
+					delta |= static_cast<uint64>(*read++) << (byte * 8);
+				}
+			}
+			newer ^= delta;
+			WriteClone(packet, (newest_index + CLONE_SIZE - age) % CLONE_SIZE, newer);
+		}
+		//trailing bytes mean it wasn't ours.
+		return read == end;
+	}
+
+private:
+	static uint64 ZigZag(long value) {
+		const int64 wide = static_cast<int64>(value);
+		return (static_cast<uint64>(wide) << 1) ^ static_cast<uint64>(wide >> 63);
+	}
+
+	static int64 UnZigZag(uint64 value) {
+		return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+	}
+
+	static uint8* WriteVarint(uint8* write, uint64 value) {
+		while (value >= 0x80) {
+			*write++ = static_cast<uint8>(value) | 0x80;
+			value >>= 7;
+		}
+		*write++ = static_cast<uint8>(value);
+		return write;
+	}
+
+	static bool ReadVarint(const uint8*& read, const uint8* end, uint64& value) {
+		value = 0;
+		for (int32 shift = 0; shift < 64 && read < end; shift += 7) {
+			const uint8 next = *read++;
+			value |= static_cast<uint64>(next & 0x7F) << shift;
+			if ((next & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static uint64 ReadClone(const PacketType& packet, uint32 index) {
+		uint64 value;
+		memcpy(&value, packet.GetPointerToElement(index), sizeof(uint64));
+		return value;
+	}
+
+	static void WriteClone(PacketType& packet, uint32 index, uint64 value) {
+		memcpy(packet.GetPointerToElement(index), &value, sizeof(uint64));
+	}
+};
@@ -6,35 +6,81 @@
 #include "SocketSubsystem.h"
 #include "Common/UdpSocketBuilder.h"
 #include "BristleconeCommonTypes.h"
+#include "FBristleconeBatchedIO.h"
+#include "FBristleconeImpairment.h"
+#include <atomic>
 
 class FBristleconeReceiver : public FRunnable {
 public:
 	FBristleconeReceiver();
 
+	//the first stream's queue. with one peer or none, everything we receive is that stream.
 	void BindSink(TheCone::RecvQueue QueueCandidate);
 	void BindStatsSink(TheCone::TimestampQueue QueueCandidate);
 	virtual ~FBristleconeReceiver() override;
 
 	void SetLocalSocket(const TSharedPtr<FSocket, ESPMode::ThreadSafe>& new_socket);
+	//who we'll take input from. every peer numbers its own cycles, so each one gets its own stream, with its own queue
+	//and its own CycleTracking, in the order their first packets land. anything from a relay is read as an envelope,
+	//and every origin behind it gets a stream too. with one peer and no relays, there's just the one stream and we take
+	//it from anywhere, the way we always have with the reflector. set before the thread starts.
+	void SetPeers(const TArray<FIPv4Endpoint>& peers, const TArray<FIPv4Endpoint>& relays);
+	//relay mode. every packet we haven't seen from a given peer goes straight back out, from this thread, in an
+	//envelope, to every other peer, so a relay never waits on the game thread or the sender. set before the thread starts.
+	void SetRelayMode(bool relay);
+	//everything received goes through a simulated bad network before we look at it. set before the thread starts.
+	void SetImpairment(const TArray<FBristleconeImpairmentPhase>& script, int32 seed);
+	//null unless impairment is on.
+	const FBristleconeImpairment* GetImpairment() const;
 	
 	virtual bool Init() override;
 	virtual uint32 Run() override;
 	virtual void Exit() override;
 	virtual void Stop() override;
 
+	//streams are only ever added, and a stream's queue and origin don't change once it's counted, so these are safe
+	//from the thread that drains the queues.
+	int32 GetStreamCount() const;
+	TheCone::RecvQueue GetStream(int32 index, FIPv4Endpoint* from = nullptr) const;
+
 	//public so it can be changed more easily in the future during runtime
 	//FObjects don't really have props, so not dealing with this atm.
 	bool LogOnReceive;
+	//packets handed on, and clones we'd already handed on and threw away. readable from anywhere.
+	std::atomic<uint64> PacketsDelivered{0};
+	std::atomic<uint64> DuplicatesSuppressed{0};
+	//packets from someone who isn't a peer, or past MAX_TARGET_COUNT streams, dropped.
+	std::atomic<uint64> StrangersDropped{0};
 
 private:
 	void Cleanup();
-	int64 SeenCycles;
-	int64 HighestSeen;
+	//-1 if they don't get one.
+	int32 FindStream(const FIPv4Endpoint& origin, bool via_relay);
+	int32 ClaimStream(const FIPv4Endpoint& origin);
+	void Relay(const uint8* datagram, int32 size, const FIPv4Endpoint& origin);
 	TSharedPtr<FSocket, ESPMode::ThreadSafe> receiver_socket;
+	//one packet-sized slot per datagram in a batch.
 	TArray<uint8> received_data;
-	TheCone::RecvQueue Queue;
+	int32 received_sizes[FBristleconeBatchedIO::MaxBatch];
 	TheCone::TimestampQueue PacketStats;
-	TheCone::CycleTracking MySeen;
+	//published by stream_count, so anything below it is done being written.
+	TheCone::RecvQueue stream_queues[TheCone::MAX_TARGET_COUNT];
+	FIPv4Endpoint stream_origins[TheCone::MAX_TARGET_COUNT];
+	std::atomic<int32> stream_count{0};
+	//the rest is receiver thread only. a relay dedupes what it forwards with these too.
+	TArray<TheCone::CycleTracking> stream_seen;
+	TMap<FIPv4Endpoint, int32> stream_of;
+	TArray<FIPv4Endpoint> peers;
+	TArray<FIPv4Endpoint> relays;
+	bool relay_mode = false;
+	bool single_stream = false;
+	uint32_t ThinHash = 0;
+	FIPv4Endpoint received_from[FBristleconeBatchedIO::MaxBatch];
+	//forwarded datagrams, each in its envelope, built once however many peers it goes to.
+	uint8 relay_data[FBristleconeBatchedIO::MaxBatch][TheCone::MAX_DATAGRAM_SIZE];
+	int32 relay_count = 0;
+	TArray<FBristleconeBatchedIO::FOutgoing, TInlineAllocator<FBristleconeBatchedIO::MaxBatch>> relay_outgoing;
+	TUniquePtr<FBristleconeImpairment> impairment;
 	TUniquePtr<ISocketSubsystem> socket_subsystem;
 	bool running;
 };
@@ -0,0 +1,56 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+
+//What a relay puts in front of everything it sends, so whoever gets it knows whose input it is. Without it, everything
+//forwarded arrives from the relay's address, and with more than two peers behind a relay, nobody can tell them apart.
+//
+//Wire format, little endian like the codec:
+//  1 byte   RELAY_TAG
+//  4 bytes  the origin's address
+//  2 bytes  the origin's port
+//  then the datagram as the origin sent it, raw or encoded.
+//
+//An origin of 0.0.0.0:0 is the relay's own input. The tag alone can't tell an envelope from a raw packet, so only
+//datagrams from a peer configured as a relay are read as envelopes, and a relay wraps everything it sends.
+struct FBristleconeRelayEnvelope
+{
+	static constexpr uint8 RELAY_TAG = 0xA5;
+	static constexpr int32 HEADER_SIZE = 7;
+
+	//writes HEADER_SIZE bytes to out.
+	static void Write(uint8* out, const FIPv4Endpoint& origin)
+	{
+		const uint32 address = origin.Address.Value;
+		out[0] = RELAY_TAG;
+		for (int32 byte = 0; byte < 4; ++byte)
+		{
+			out[1 + byte] = static_cast<uint8>(address >> (byte * 8));
+		}
+		out[5] = static_cast<uint8>(origin.Port);
+		out[6] = static_cast<uint8>(origin.Port >> 8);
+	}
+
+	//false if it isn't an envelope. otherwise data and size are moved past the header, onto what it carries, and
+	//origin is who sent that. the relay's own input keeps the origin it came in with.
+	static bool Read(const uint8*& data, int32& size, FIPv4Endpoint& origin)
+	{
+		if (size <= HEADER_SIZE || data[0] != RELAY_TAG)
+		{
+			return false;
+		}
+		uint32 address = 0;
+		for (int32 byte = 0; byte < 4; ++byte)
+		{
+			address |= static_cast<uint32>(data[1 + byte]) << (byte * 8);
+		}
+		const uint16 port = static_cast<uint16>(data[5] | data[6] << 8);
+		if (address != 0 || port != 0)
+		{
+			origin = FIPv4Endpoint(FIPv4Address(address), port);
+		}
+		data += HEADER_SIZE;
+		size -= HEADER_SIZE;
+		return true;
+	}
+};
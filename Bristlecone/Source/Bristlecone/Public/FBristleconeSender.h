@@ -1,26 +1,45 @@
 ﻿#pragma once
 #include "FBristleconePacket.h"
+#include "FBristleconePacketCodec.h"
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
 #include "FControllerState.h"
 #include "Interfaces/IPv4/IPv4Endpoint.h"
 
 #include "BristleconeCommonTypes.h"
+#include "FBristleconeBatchedIO.h"
 
 
+//somewhere we send to, and how.
+struct FBristleconeTarget {
+	FIPv4Endpoint endpoint;
+	uint8 sockets = TheCone::SEND_ON_ALL;
+	//send every Nth packet, from 1 to MAX_SEND_EVERY. every packet carries the last three inputs, so that thins the
+	//traffic without leaving a gap, just adding latency.
+	int32 send_every = 1;
+	int32 pace_counter = 0;
+};
+
 class FBristleconeSender : public FRunnable {
 public:
 	FBristleconeSender();
 	
 	virtual ~FBristleconeSender() override;
 	void BindSource(TheCone::SendQueue Queue);
-	void AddTargetAddress(FString target_address_str);
+	//address is "a.b.c.d" or "a.b.c.d:port". false if it doesn't parse or we're already at MAX_TARGET_COUNT.
+	//send_every past MAX_SEND_EVERY would lose input, so it's clamped. targets have to be added before the thread starts.
+	bool AddTargetAddress(FString target_address_str, uint8 sockets = TheCone::SEND_ON_ALL, int32 send_every = 1);
+	int32 GetTargetCount() const;
+	TArray<FIPv4Endpoint> GetTargetEndpoints() const;
 	void SetLocalSockets(
 		const TSharedPtr<FSocket, ESPMode::ThreadSafe>& new_socket_high,
 		const TSharedPtr<FSocket, ESPMode::ThreadSafe>& new_socket_low,
 		const TSharedPtr<FSocket, ESPMode::ThreadSafe>& new_socket_adaptive
 	);
 	void SetWakeSender(FSharedEventRef NewWakeSender);
+	//a relay wraps everything it sends, its own input included, so its peers can read every datagram from it as an
+	//envelope. set before the thread starts.
+	void SetWrapAsRelay(bool wrap);
 
 	void ActivateDSCP();
 	
@@ -32,17 +51,28 @@ public:
 private:
 	void Cleanup();
 
+	//a wake's worth of packets, snapshotted so they can all go out together.
+	static constexpr int32 MAX_STAGED_PACKETS = 16;
+
+	typedef FBristleconePacketCodec<FControllerState, 3> FControllerStateCodec;
+
 	FBristleconePacketContainer<FControllerState, 3> packet_container;
-;
+	//encoded as they're staged, so the wire bytes are built once no matter how many sockets and endpoints they go to.
+	uint8 staged_packets[MAX_STAGED_PACKETS][TheCone::MAX_DATAGRAM_SIZE];
+	int32 staged_sizes[MAX_STAGED_PACKETS];
+	int32 staged_count = 0;
+	//one per socket: high, low, background.
+	TArray<FBristleconeBatchedIO::FOutgoing, TInlineAllocator<FBristleconeBatchedIO::MaxBatch>> outgoing[3];
 	TSharedPtr<FSocket, ESPMode::ThreadSafe> sender_socket_high;
 	TSharedPtr<FSocket, ESPMode::ThreadSafe> sender_socket_low;
 	TSharedPtr<FSocket, ESPMode::ThreadSafe> sender_socket_background;
-	TSharedPtr<TArray<FIPv4Endpoint>> target_endpoints;
+	TSharedPtr<TArray<FBristleconeTarget>> target_endpoints;
 
 	FSharedEventRef WakeSender;
 
 	TUniquePtr<ISocketSubsystem> socket_subsystem;
 	TSharedPtr<TCircularQueue<uint64_t>> Queue;
 	uint8 consecutive_zero_bytes_sent;
+	bool wrap_as_relay = false;
 	bool running;
 };
@@ -5,6 +5,86 @@
 
 #include "CoreMinimal.h"
 #include "UBristleconeConstants.generated.h"
+
+//one peer to send to. sockets and pacing are per peer, so a peer on a poor link can get fewer, thinner clones.
+USTRUCT(BlueprintType)
+struct FBristleconePeerConfig
+{
+	GENERATED_BODY()
+
+	//"a.b.c.d" or "a.b.c.d:port".
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	FString address;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	bool send_high = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	bool send_low = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	bool send_background = true;
+
+	//send every Nth packet. each packet carries three inputs, so past 3 you start losing input.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 1, ClampMax = 3))
+	int32 send_every = 1;
+
+	//this peer runs in relay mode. everything it sends is wrapped with who it's really from, and everyone behind it
+	//gets their own stream.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	bool relay = false;
+};
+
+UENUM(BlueprintType)
+enum class EBristleconeLatencyShape : uint8
+{
+	//anywhere from base to base plus spread, evenly.
+	Uniform,
+	//centered on base plus spread, spread wide either side, clamped at base.
+	Normal,
+	//mostly near base, with a long tail. spread is the mean of the tail. closest to what a real link does.
+	Exponential
+};
+
+//one stretch of simulated network conditions. a script is a list of these, run in order and looped.
+USTRUCT(BlueprintType)
+struct FBristleconeImpairmentPhase
+{
+	GENERATED_BODY()
+
+	//how long this phase lasts. 0 means forever, so nothing after it ever runs.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0))
+	float duration_seconds = 0;
+
+	//one way delay every datagram gets, on top of whatever the real link adds.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0))
+	float base_latency_ms = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0))
+	float latency_spread_ms = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone")
+	EBristleconeLatencyShape latency_shape = EBristleconeLatencyShape::Exponential;
+
+	//long run fraction of datagrams dropped.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0, ClampMax = 100))
+	float loss_percent = 0;
+
+	//average run of datagrams lost together. 1 is independent loss. past 3, clones stop covering for it.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 1))
+	float mean_burst_length = 1;
+
+	//datagrams that get held back an extra reorder_ms, so the ones behind them overtake.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0, ClampMax = 100))
+	float reorder_percent = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0))
+	float reorder_ms = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bristlecone", meta = (ClampMin = 0, ClampMax = 100))
+	float duplicate_percent = 0;
+};
+
 UCLASS(Config = Game, defaultconfig, meta = (DisplayName = "Bristlecone Settings"))
 class BRISTLECONE_API UBristleconeConstants : public UDeveloperSettings
 {
@@ -15,5 +95,25 @@ public:
 
 	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone")
 	bool log_receive_c;
+
+	//if this is empty, we send to the reflector and nowhere else. every peer's input, and everyone's behind a relay, gets
+	//its own stream.
+	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone", meta = (DisplayName = "Peers"))
+	TArray<FBristleconePeerConfig> peers_c;
+
+	//forward what each peer sends us on to all the others. their peers have to list us as a relay.
+	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone", meta = (DisplayName = "Relay Mode"))
+	bool relay_mode_c;
+
+	//run everything we receive through a simulated bad network first. development builds only.
+	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone|Impairment", meta = (DisplayName = "Simulate Impairment"))
+	bool impairment_enabled_c;
+
+	//same seed, same script, same drops, delays, and duplicates, datagram for datagram.
+	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone|Impairment", meta = (DisplayName = "Impairment Seed"))
+	int32 impairment_seed_c;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Bristlecone|Impairment", meta = (DisplayName = "Impairment Script"))
+	TArray<FBristleconeImpairmentPhase> impairment_script_c;
 };
 
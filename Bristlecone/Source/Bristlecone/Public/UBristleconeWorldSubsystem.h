@@ -64,6 +64,11 @@ public:
 	TheCone::TimestampQueue ReceiveTimes;
 	bool LogOnReceive;
 
+	//every peer's input is its own stream, in the order their first packets landed. QueueOfReceived is the first. the
+	//rest turn up as peers do, so check the count again later rather than caching it. same 1p1c rules for each.
+	int32 GetPeerStreamCount() const;
+	TheCone::RecvQueue GetPeerStream(int32 Index, FIPv4Endpoint& From) const;
+
 	//This will grant access to the bristlecone synchronized time, and provides a lockless timestamp. that's as dangerous as it sounds
 	//so normally, we do not recommend using it directly. instead, use artillery's now, where protections will gradually accumulate.
 	uint32_t Now()
@@ -14,13 +14,32 @@
 #include "FArtilleryNoGuaranteeReadOnly.h"
 
 //this is vulnerable to memoization but I can't think of a pretty way to do that which doesn't make rollback insane to debug.
-//as a result, these lil fellers are stateless. If you wanna do a memoized version, I recommend it strongly, but make sure profiling
-//shows that's actually necessary. I sincerely doubt it will be.
+//as a result, these lil fellers are stateless. The matcher in artillery gets most of the memoization win anyway: each pattern
+//that can says what it wants as a compiled set of masks (below), and the matcher keeps the rolling history those read from.
+//runPattern is still the reference, and the only way a pattern that doesn't compile gets run.
+
+//Most patterns only care which buttons were down how many inputs ago, so they can be boiled down to a handful of masks
+//over input age and checked for every button at once against a short rolling history, without ever walking the buffer.
+//Age 0 is the input being matched, age 1 the one before it, and so on. A button matches if it was down at every age in
+//Down, up at every age in Up, and up at no more than one of the ages in AllowOneMiss. WholeUnion means it's all or nothing:
+//either every button in the union matches, or none do. A pattern that can't be said this way, like the flick, leaves
+//Compiled false and keeps running through runPattern.
+//These must say exactly what runPattern does. Inputs from before the stream started count as up.
+struct FCompiledActionPattern
+{
+	static constexpr uint32 MaxAge = 8;
+	bool Compiled = false;
+	uint8 Down = 0;
+	uint8 Up = 0;
+	uint8 AllowOneMiss = 0;
+	bool WholeUnion = false;
+};
 
 class FActionPattern_InternallyStateless
 {
 public:
 	virtual uint32_t const runPattern(uint64_t frameToRunBackFrom, FActionBitMask& ToSeekUnion,FANG_PTR Buffer) const = 0;
+	virtual FCompiledActionPattern getCompiled() const { return FCompiledActionPattern(); }
 
 	virtual ArtIPMKey const getName() const = 0;
 	static constexpr ArtIPMKey Name = ArtIPMKey::InternallyStateless; //you should never see this as getName is virtual.
@@ -39,6 +58,8 @@ public:
 	
 	virtual const ArtIPMKey getName() const override { return Name; };
 	static constexpr ArtIPMKey Name = ArtIPMKey::SingleFrameFire;
+
+	virtual FCompiledActionPattern getCompiled() const override { return {true, 0b1, 0, 0, false}; }
 };
 
 class FActionPattern_ButtonHoldAllowOneMiss : public FActionPattern_InternallyStateless
@@ -75,6 +96,9 @@ public:
 	
 	virtual const ArtIPMKey getName() const override { return Name; };
 	static constexpr ArtIPMKey Name = ArtIPMKey::ButtonHoldAllowOneMiss;
+
+	//down now, and up for at most one of the five before.
+	virtual FCompiledActionPattern getCompiled() const override { return {true, 0b1, 0, 0b111110, false}; }
 };
 
 class FActionPattern_OnPress : public FActionPattern_InternallyStateless
@@ -98,6 +122,8 @@ public:
 	
 	virtual const ArtIPMKey getName() const override { return Name; };
 	static constexpr ArtIPMKey Name = ArtIPMKey::OnPress;
+
+	virtual FCompiledActionPattern getCompiled() const override { return {true, 0b1, 0b111110, 0, false}; }
 };
 
 class FActionPattern_ButtonHold : public FActionPattern_InternallyStateless
@@ -121,6 +147,9 @@ public:
 	
 	virtual const ArtIPMKey getName() const override { return Name; };
 	static constexpr ArtIPMKey Name = ArtIPMKey::ButtonHold;
+
+	//ArtilleryHoldSweepBack back, inclusive.
+	virtual FCompiledActionPattern getCompiled() const override { return {true, 0b111111, 0, 0, false}; }
 };
 
 class FActionPattern_ButtonReleaseNoDelay : public FActionPattern_ButtonHold 
@@ -142,6 +171,9 @@ public:
 	
 	virtual const ArtIPMKey getName() const override { return Name; };
 	static constexpr ArtIPMKey Name = ArtIPMKey::ButtonReleaseNoDelay;
+
+	//the whole union held for a full hold, then the whole union up.
+	virtual FCompiledActionPattern getCompiled() const override { return {true, 0b1111110, 0b1, 0, true}; }
 };
 
 //NOTE: if you want to check if buttons were held across the whole stick-flick
@@ -88,14 +88,17 @@ public:
 		// but basically, cycle starts as a 32 bit number, Highest always comes from cycle
 		if (cycle > HighestSeen || HighestSeen - cycle > 0xFFFF)
 		{
-			//this isn't strictly needed but you shouldn't shift more than the width.
-			cycle - HighestSeen > 64 ? SeenCycles = 0 : SeenCycles >>= (cycle - HighestSeen);
+			//bit n is HighestSeen - n, so the mask slides up with it, and the new highest is seen too. otherwise the
+			//first repeat of the newest cycle got through. you can't shift by the width or more, so a jump that far clears.
+			const uint64_t delta = cycle - HighestSeen;
+			SeenCycles = delta >= 64 ? 0 : SeenCycles << delta;
+			SeenCycles |= 1ull;
 			HighestSeen = cycle;
 			return true;
 		}
 		// if it's off the bottom of the mask by a more reasonable amount
 		// we discard it. again, we use positive deltas.
-		if (HighestSeen - cycle > 64)
+		if (HighestSeen - cycle >= 64)
 		{
 			return false;
 		}
@@ -116,7 +119,7 @@ public:
 		{
 			return false;
 		} 
-		if (HighestSeen - cycle > 64) // lets us stay unsigned.
+		if (HighestSeen - cycle >= 64) // lets us stay unsigned.
 		{
 			return true;
 		}
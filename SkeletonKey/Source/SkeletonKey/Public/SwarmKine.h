@@ -31,7 +31,8 @@ public:
 	USwarmKineManager()
 	{
 		PrimaryComponentTick.bCanEverTick = true;
-		ToRemove = MakeShareable(new TCircularQueue<IDTYPE>(2048));
+		//expiry hands over whole ticks' worth of projectiles at once, so this needs to hold a burst.
+		ToRemove = MakeShareable(new TCircularQueue<IDTYPE>(16384));
 		KeyToMesh = MakeShareable(new LibCFSKInt());
 		MeshToKey = MakeShareable(new LibCIntFSK());
 		KeyToSceneComponent = MakeShareable(new TMap<FSkeletonKey, TObjectPtr<USceneComponent>>());
@@ -113,6 +114,15 @@ public:
 		}
 	}
 
+	//same as cleaning each up in turn, but the removals all land in one go on the next tick.
+	virtual void CleanupInstances(TConstArrayView<FSkeletonKey> Targets)
+	{
+		for (const FSkeletonKey& Target : Targets)
+		{
+			CleanupInstance(Target);
+		}
+	}
+
 	virtual TWeakObjectPtr<USceneComponent> GetSceneComponentForInstance(const FSkeletonKey InstanceKey)
 	{
 		TObjectPtr<USceneComponent> m = KeyToSceneComponent->FindRef(InstanceKey);
@@ -136,9 +146,23 @@ public:
 	{
 		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 		int32 Key = 0;
+		Removing.Reset();
 		while (ToRemove->Dequeue(Key))
 		{
-			RemoveInstanceById(FPrimitiveInstanceId(Key));
+			const int32 Index = GetInstanceIndexForId(FPrimitiveInstanceId(Key));
+			if (Index != INDEX_NONE)
+			{
+				Removing.Add(Index);
+			}
+		}
+		//one removal for the lot, rather than a render state update per instance.
+		if (Removing.Num() == 1)
+		{
+			RemoveInstance(Removing[0]);
+		}
+		else if (Removing.Num() > 1)
+		{
+			RemoveInstances(Removing, false);
 		}
 	};
 	
@@ -148,6 +172,8 @@ private:
 	TSharedPtr<LibCFSKInt> KeyToMesh;
 	TSharedPtr<LibCIntFSK> MeshToKey;
 	TSharedPtr<TMap<FSkeletonKey, TObjectPtr<USceneComponent>>> KeyToSceneComponent;
+	//game thread only, kept around so draining ToRemove doesn't allocate.
+	TArray<int32> Removing;
 };
 
 inline USwarmKineManager::~USwarmKineManager()